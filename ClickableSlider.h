@@ -4,6 +4,12 @@
 #include<QSlider>
 #include<QMouseEvent>
 #include<QStyle>
+#include<QLabel>
+#include<QImage>
+#include<QPixmap>
+#include<QPainter>
+#include<QStyleOptionSlider>
+#include<QVector>
 
 class ClickableSlider:public QSlider
 {
@@ -11,16 +17,65 @@ class ClickableSlider:public QSlider
 public:
     explicit ClickableSlider(QWidget *parent=nullptr):QSlider(parent){
         setOrientation(Qt::Horizontal); //设置滑动条方向为水平
+        setMouseTracking(true);         //未按下时也接收鼠标移动，用于悬停预览
     }
 
+    //计算横坐标对应的值，按滑槽范围换算，与波形、刻度对齐
+    int valueAt(int x) const{
+        QRect groove=grooveRect();
+        return QStyle::sliderValueFromPosition(minimum(),maximum(),x-groove.left(),groove.width());
+    }
+
+    //在悬停位置上方显示预览图
+    void showPreview(const QImage &image,const QString &text){
+        if(!m_previewLabel)
+        {
+            m_previewLabel=new QLabel(this,Qt::ToolTip|Qt::FramelessWindowHint);
+            m_previewLabel->setAlignment(Qt::AlignCenter);
+            m_previewLabel->setStyleSheet("QLabel{background:#202020;color:white;border:1px solid #2196F3;padding:2px;}");
+        }
+        if(image.isNull())
+            m_previewLabel->setText(text);
+        else
+            m_previewLabel->setPixmap(QPixmap::fromImage(image));
+        m_previewLabel->setToolTip(text);
+        m_previewLabel->adjustSize();
+
+        QPoint anchor=mapToGlobal(QPoint(m_nHoverX,0));
+        m_previewLabel->move(anchor.x()-m_previewLabel->width()/2,anchor.y()-m_previewLabel->height()-4);
+        m_previewLabel->show();
+    }
+
+    void hidePreview(){
+        if(m_previewLabel)
+            m_previewLabel->hide();
+    }
+
+    //入点、出点标记（与滑动条取值同单位），-1表示未设置
+    void setInPoint(int value){m_nInPoint=value;update();}
+    void setOutPoint(int value){m_nOutPoint=value;update();}
+    void clearInOut(){m_nInPoint=-1;m_nOutPoint=-1;update();}
+    int inPoint() const {return m_nInPoint;}
+    int outPoint() const {return m_nOutPoint;}
+    bool hasInOut() const {return m_nInPoint>=0 && m_nOutPoint>m_nInPoint;}
+
+    //关键帧位置刻度（与滑动条取值同单位），空表示不显示
+    void setKeyframes(const QVector<int> &positions){m_keyframes=positions;update();}
+
+    //画在滑槽背后的波形条，横向拉伸到滑槽两端，空图像表示不显示
+    void setWaveform(const QImage &image){m_waveform=image;update();}
+
+signals:
+    void hoverValueChanged(int value);  //悬停位置对应的值变化
+    void hoverLeft();                   //鼠标离开滑动条
+
 protected:
     void mousePressEvent(QMouseEvent *event) override{
         //仅处理左键点击事件
         if(event->button()==Qt::LeftButton)
         {
             //计算点击位置对应的值
-            double posRadio=event->pos().x()/static_cast<double>(width());
-            int newValue=posRadio*(maximum()-minimum())+minimum();
+            int newValue=valueAt(event->pos().x());
 
             //设置新值并触发信号
             setValue(newValue);
@@ -34,7 +89,84 @@ protected:
 
     }
 
+    void mouseMoveEvent(QMouseEvent *event) override{
+        m_nHoverX=event->pos().x();
+        emit hoverValueChanged(valueAt(m_nHoverX));
+        QSlider::mouseMoveEvent(event);
+    }
+
+    void paintEvent(QPaintEvent *event) override{
+        QRect groove=grooveRect();
 
+        //波形先画，滑槽和滑块盖在上面；横向取样式给出的滑槽范围，与滑槽两端对齐
+        //纵向占满控件高度：样式表里的滑槽只有几像素高且不透明，波形画在滑槽上下两侧
+        if(!m_waveform.isNull())
+        {
+            QPainter background(this);
+            background.setRenderHint(QPainter::SmoothPixmapTransform);
+            background.drawImage(QRect(groove.left(),0,groove.width(),height()),m_waveform);
+        }
+        QSlider::paintEvent(event);
+        if(m_keyframes.isEmpty() && m_nInPoint<0 && m_nOutPoint<0)
+            return;
+
+        QPainter painter(this);
+
+        //关键帧刻度画在滑槽下方，间距不足两个像素的合并为一条
+        if(!m_keyframes.isEmpty())
+        {
+            painter.setPen(QColor(255,255,255,120));
+            int nLastX=-2;
+            for(int keyframe:m_keyframes)
+            {
+                int x=xAt(keyframe);
+                if(x-nLastX<2)
+                    continue;
+                painter.drawLine(x,groove.bottom()+1,x,height()-1);
+                nLastX=x;
+            }
+        }
+        if(m_nInPoint<0 && m_nOutPoint<0)
+            return;
+
+        //在滑槽上叠加入出点之间的区间和两端的竖线
+        int nLeft=m_nInPoint>=0?xAt(m_nInPoint):groove.left();
+        int nRight=m_nOutPoint>=0?xAt(m_nOutPoint):groove.right();
+        if(nRight>nLeft)
+            painter.fillRect(QRect(nLeft,groove.top(),nRight-nLeft,groove.height()),QColor(255,193,7,110));
+        painter.setPen(QPen(QColor(255,193,7),2));
+        if(m_nInPoint>=0)
+            painter.drawLine(nLeft,0,nLeft,height());
+        if(m_nOutPoint>=0)
+            painter.drawLine(nRight,0,nRight,height());
+    }
+
+    void leaveEvent(QEvent *event) override{
+        hidePreview();
+        emit hoverLeft();
+        QSlider::leaveEvent(event);
+    }
+
+private:
+    QLabel *m_previewLabel=nullptr; //悬停预览弹窗
+    int m_nHoverX=0;                //最近一次悬停的横坐标
+    int m_nInPoint=-1;              //入点标记
+    int m_nOutPoint=-1;             //出点标记
+    QVector<int> m_keyframes;       //关键帧刻度
+    QImage m_waveform;              //音频波形条
+
+    //样式给出的滑槽矩形，波形、刻度、入出点和点击取值都按它的横向范围换算
+    QRect grooveRect() const{
+        QStyleOptionSlider option;
+        initStyleOption(&option);
+        return style()->subControlRect(QStyle::CC_Slider,&option,QStyle::SC_SliderGroove,this);
+    }
+
+    //取值对应的横坐标（valueAt的反函数）
+    int xAt(int value) const{
+        QRect groove=grooveRect();
+        return groove.left()+QStyle::sliderPositionFromValue(minimum(),maximum(),value,groove.width());
+    }
 
 };
 
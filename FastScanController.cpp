@@ -0,0 +1,120 @@
+#include "FastScanController.h"
+
+#include<QMediaMetaData>
+
+#include"PlaybackRates.h"
+
+namespace {
+const int kTickMs = 15;             //检查虚拟时钟的间隔
+const int kNoIndexFps = 8;          //无关键帧索引时每秒显示的帧数（每帧都要从关键帧解码）
+}
+
+FastScanController::FastScanController(QMediaPlayer *player,SeekScheduler *scheduler,KeyframeIndex *index,QObject *parent)
+    : QObject(parent)
+    , m_player(player)
+    , m_scheduler(scheduler)
+    , m_index(index)
+{
+    m_tickTimer = new QTimer(this);
+    m_tickTimer->setInterval(kTickMs);
+    m_tickTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_tickTimer,&QTimer::timeout,this,&FastScanController::tick);
+}
+
+void FastScanController::setMediaPlayer(QMediaPlayer *player)
+{
+    stop(false);
+    m_player=player;
+}
+
+double FastScanController::steppedRate(double rate,int nDirection)
+{
+    const QVector<PlaybackRateOption> &options=fastScanRateOptions();
+    if(!isScanRate(rate))
+        return nDirection>0?kMinRate:-kMinRate;
+
+    int nIndex=0;
+    for(int i=0;i<options.size();i++)
+    {
+        if(qFuzzyCompare(options.at(i).rateValue,rate))
+            nIndex=i;
+    }
+    return options.at(qBound(0,nIndex+nDirection,int(options.size())-1)).rateValue;
+}
+
+bool FastScanController::start(double rate)
+{
+    if(!isScanRate(rate) || !m_player->isSeekable() || m_player->duration()<=0)
+        return false;
+
+    if(!isActive())
+    {
+        //暂停后由定位驱动画面，音频随之静止
+        m_bResumePlaying=m_player->playbackState()==QMediaPlayer::PlayingState;
+        m_player->pause();
+        m_nAnchorMs=m_player->position();
+        m_nLastTarget=-1;
+        m_nShown=0;
+        double frameRate=m_player->metaData().value(QMediaMetaData::VideoFrameRate).toDouble();
+        m_nFrameMs=frameRate>0?qMax<qint64>(1,qRound64(1000/frameRate)):40;
+    }
+    else
+    {
+        m_nAnchorMs=qBound<qint64>(0,clockPosition(),m_player->duration());
+    }
+
+    m_dRate=rate;
+    m_clock.start();
+    m_tickTimer->start();
+    emit rateChanged(rate);
+    tick();
+    return true;
+}
+
+void FastScanController::stop(bool bResume)
+{
+    if(!isActive())
+        return;
+    m_tickTimer->stop();
+    m_dRate=0;
+    if(bResume && m_bResumePlaying)
+        m_player->play();
+    emit rateChanged(0);
+}
+
+qint64 FastScanController::clockPosition() const
+{
+    return m_nAnchorMs+qint64(m_dRate*m_clock.elapsed());
+}
+
+qint64 FastScanController::targetFor(qint64 position) const
+{
+    if(m_index->isReady())
+        return m_index->previousKeyframe(position);
+
+    //没有索引：步长随速率增大，保持每秒显示的帧数大致不变
+    qint64 nStride=qMax<qint64>(m_nFrameMs,qint64(qAbs(m_dRate)*1000/kNoIndexFps));
+    return position/nStride*nStride;
+}
+
+void FastScanController::tick()
+{
+    //上一帧还没到达就不发新定位，时钟照走，到达后直接跳到时钟当前对应的帧
+    if(m_scheduler->isBusy())
+        return;
+
+    qint64 nDuration=m_player->duration();
+    qint64 nPosition=clockPosition();
+    bool bEnd=m_dRate>0?nPosition>=nDuration:nPosition<=0;
+    nPosition=qBound<qint64>(0,nPosition,nDuration);
+
+    qint64 nTarget=targetFor(nPosition);
+    if(nTarget!=m_nLastTarget)
+    {
+        m_nLastTarget=nTarget;
+        m_nShown++;
+        m_scheduler->exactSeek(nTarget);
+    }
+    if(bEnd)
+        stop();
+}
@@ -0,0 +1,58 @@
+/*
+ * 快速浏览 4x以上的速率不让后端逐帧解码，而是暂停播放器、按虚拟时钟定位到当前应显示的关键帧
+ * 定位经SeekScheduler发出，上一帧未到达时不发新定位：解码跟不上时跳过中间的关键帧，画面不会越来越滞后
+ * 没有关键帧索引时按速率取每隔N帧的位置；负速率为反向快速浏览
+ */
+
+#ifndef FASTSCANCONTROLLER_H
+#define FASTSCANCONTROLLER_H
+
+#include<QObject>
+#include<QMediaPlayer>
+#include<QTimer>
+#include<QElapsedTimer>
+
+#include"SeekScheduler.h"
+#include"KeyframeIndex.h"
+
+class FastScanController : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr double kMinRate = 4.0;     //速率绝对值不低于此值时使用快速浏览
+
+    FastScanController(QMediaPlayer *player,SeekScheduler *scheduler,KeyframeIndex *index,QObject *parent=nullptr);
+
+    void setMediaPlayer(QMediaPlayer *player);  //切换跟随的主播放器（无缝切换时）
+    static bool isScanRate(double rate) {return qAbs(rate)>=kMinRate;}
+    static double steppedRate(double rate,int nDirection);  //在速率表中前进（1）或后退（-1）一级
+
+    bool start(double rate);    //开始快速浏览，已在浏览时从当前位置改用新速率；不可定位时返回false
+    void stop(bool bResume=true);   //退出快速浏览，bResume时恢复进入前的播放状态
+    bool isActive() const {return m_dRate!=0;}
+    double rate() const {return m_dRate;}
+    int shownFrames() const {return m_nShown;}  //本次浏览显示的帧数
+
+signals:
+    void rateChanged(double rate);  //开始、改变速率或退出（0）时发出
+
+private:
+    QMediaPlayer *m_player;
+    SeekScheduler *m_scheduler;
+    KeyframeIndex *m_index;
+    QTimer *m_tickTimer;
+    QElapsedTimer m_clock;          //自最近一次开始或改变速率起的时间
+
+    double m_dRate = 0;             //当前速率，0表示未在浏览
+    qint64 m_nAnchorMs = 0;         //m_clock开始时的虚拟位置
+    qint64 m_nLastTarget = -1;      //最近一次定位的目标
+    qint64 m_nFrameMs = 40;         //单帧时长，无索引时的最小步长
+    bool m_bResumePlaying = false;  //进入浏览前在播放
+    int m_nShown = 0;
+
+    qint64 clockPosition() const;   //虚拟时钟当前位置（毫秒，未截断到文件范围）
+    qint64 targetFor(qint64 position) const;    //虚拟位置对应的显示帧
+    void tick();
+};
+
+#endif // FASTSCANCONTROLLER_H
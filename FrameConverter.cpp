@@ -0,0 +1,549 @@
+#include "FrameConverter.h"
+
+#include<QVideoFrameFormat>
+#include<QVarLengthArray>
+#include<QVector>
+#include<QMutex>
+#include<QAtomicInt>
+#include<cstring>
+
+#if defined(Q_PROCESSOR_X86)
+#define FRAMECONVERTER_X86
+#include<immintrin.h>
+#if defined(Q_CC_MSVC)
+#include<intrin.h>
+#endif
+#endif
+
+//GCC/Clang按函数开启指令集，整个工程不必加-mavx2；MSVC不需要
+#if defined(FRAMECONVERTER_X86) && defined(Q_CC_GNU)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+namespace {
+//YUV转RGB系数，定点数放大64倍（亮度系数略取大，保证白电平到255）；三种实现用同样的16位饱和运算，结果逐位一致
+struct Coefficients
+{
+    int yOffset;
+    int yScale;
+    int rv;
+    int gu;
+    int gv;
+    int bu;
+};
+
+const Coefficients kBt601Limited = {16,75,102,25,52,129};
+const Coefficients kBt709Limited = {16,75,115,14,34,135};
+const Coefficients kBt601Full = {0,64,90,22,46,113};
+const Coefficients kBt709Full = {0,64,101,12,30,119};
+
+inline int saturate16(int value)
+{
+    return qBound(-32768,value,32767);
+}
+
+inline quint32 packPixel(int r,int g,int b)
+{
+    r=qBound(0,r>>6,255);
+    g=qBound(0,g>>6,255);
+    b=qBound(0,b>>6,255);
+    return 0xff000000u|quint32(r)<<16|quint32(g)<<8|quint32(b);
+}
+
+void convertRowScalar(const uchar *y,const uchar *u,const uchar *v,quint32 *dst,int n,const Coefficients &c)
+{
+    for(int x=0;x<n;x++)
+    {
+        int y16=(y[x]-c.yOffset)*c.yScale+32;
+        int u16=u[x]-128;
+        int v16=v[x]-128;
+        int r=saturate16(y16+v16*c.rv);
+        int g=saturate16(saturate16(y16-u16*c.gu)-v16*c.gv);
+        int b=saturate16(y16+u16*c.bu);
+        dst[x]=packPixel(r,g,b);
+    }
+}
+
+#ifdef FRAMECONVERTER_X86
+TARGET_SSE2 void convertRowSse2(const uchar *y,const uchar *u,const uchar *v,quint32 *dst,int n,const Coefficients &c)
+{
+    const __m128i zero=_mm_setzero_si128();
+    const __m128i alpha=_mm_set1_epi8(char(0xff));
+    const __m128i yOffset=_mm_set1_epi16(short(c.yOffset));
+    const __m128i yScale=_mm_set1_epi16(short(c.yScale));
+    const __m128i rounding=_mm_set1_epi16(32);
+    const __m128i uvOffset=_mm_set1_epi16(128);
+    const __m128i rv=_mm_set1_epi16(short(c.rv));
+    const __m128i gu=_mm_set1_epi16(short(c.gu));
+    const __m128i gv=_mm_set1_epi16(short(c.gv));
+    const __m128i bu=_mm_set1_epi16(short(c.bu));
+
+    int x=0;
+    for(;x+8<=n;x+=8)
+    {
+        __m128i y16=_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y+x)),zero);
+        __m128i u16=_mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(u+x)),zero),uvOffset);
+        __m128i v16=_mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(v+x)),zero),uvOffset);
+        y16=_mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(y16,yOffset),yScale),rounding);
+
+        __m128i r=_mm_srai_epi16(_mm_adds_epi16(y16,_mm_mullo_epi16(v16,rv)),6);
+        __m128i g=_mm_srai_epi16(_mm_subs_epi16(_mm_subs_epi16(y16,_mm_mullo_epi16(u16,gu)),_mm_mullo_epi16(v16,gv)),6);
+        __m128i b=_mm_srai_epi16(_mm_adds_epi16(y16,_mm_mullo_epi16(u16,bu)),6);
+
+        //饱和到0~255后交织成BGRA（即小端的0xAARRGGBB）
+        __m128i bg=_mm_unpacklo_epi8(_mm_packus_epi16(b,b),_mm_packus_epi16(g,g));
+        __m128i ra=_mm_unpacklo_epi8(_mm_packus_epi16(r,r),alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+x),_mm_unpacklo_epi16(bg,ra));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+x+4),_mm_unpackhi_epi16(bg,ra));
+    }
+    convertRowScalar(y+x,u+x,v+x,dst+x,n-x,c);
+}
+
+//饱和到0~255；打包在128位通道内进行，需要重排回顺序
+TARGET_AVX2 inline __m128i packLowAvx2(__m256i value)
+{
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(value,value),0xD8));
+}
+
+//每次16个像素
+TARGET_AVX2 void convertRowAvx2(const uchar *y,const uchar *u,const uchar *v,quint32 *dst,int n,const Coefficients &c)
+{
+    const __m128i alpha=_mm_set1_epi8(char(0xff));
+    const __m256i yOffset=_mm256_set1_epi16(short(c.yOffset));
+    const __m256i yScale=_mm256_set1_epi16(short(c.yScale));
+    const __m256i rounding=_mm256_set1_epi16(32);
+    const __m256i uvOffset=_mm256_set1_epi16(128);
+    const __m256i rv=_mm256_set1_epi16(short(c.rv));
+    const __m256i gu=_mm256_set1_epi16(short(c.gu));
+    const __m256i gv=_mm256_set1_epi16(short(c.gv));
+    const __m256i bu=_mm256_set1_epi16(short(c.bu));
+
+    int x=0;
+    for(;x+16<=n;x+=16)
+    {
+        __m256i y16=_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y+x)));
+        __m256i u16=_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(u+x))),uvOffset);
+        __m256i v16=_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v+x))),uvOffset);
+        y16=_mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(y16,yOffset),yScale),rounding);
+
+        __m256i r=_mm256_srai_epi16(_mm256_adds_epi16(y16,_mm256_mullo_epi16(v16,rv)),6);
+        __m256i g=_mm256_srai_epi16(_mm256_subs_epi16(_mm256_subs_epi16(y16,_mm256_mullo_epi16(u16,gu)),_mm256_mullo_epi16(v16,gv)),6);
+        __m256i b=_mm256_srai_epi16(_mm256_adds_epi16(y16,_mm256_mullo_epi16(u16,bu)),6);
+
+        __m128i b8=packLowAvx2(b);
+        __m128i g8=packLowAvx2(g);
+        __m128i r8=packLowAvx2(r);
+        __m128i bgLow=_mm_unpacklo_epi8(b8,g8);
+        __m128i bgHigh=_mm_unpackhi_epi8(b8,g8);
+        __m128i raLow=_mm_unpacklo_epi8(r8,alpha);
+        __m128i raHigh=_mm_unpackhi_epi8(r8,alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+x),_mm_unpacklo_epi16(bgLow,raLow));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+x+4),_mm_unpackhi_epi16(bgLow,raLow));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+x+8),_mm_unpacklo_epi16(bgHigh,raHigh));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+x+12),_mm_unpackhi_epi16(bgHigh,raHigh));
+    }
+    convertRowScalar(y+x,u+x,v+x,dst+x,n-x,c);
+}
+#endif
+
+//区域平均的纵向求和：把一行源像素累加到逐列的和上，整数运算，三种实现结果相同
+void accumulateRowScalar(const uchar *src,quint32 *sum,int n)
+{
+    for(int x=0;x<n;x++)
+        sum[x]+=src[x];
+}
+
+#ifdef FRAMECONVERTER_X86
+TARGET_SSE2 void accumulateRowSse2(const uchar *src,quint32 *sum,int n)
+{
+    const __m128i zero=_mm_setzero_si128();
+    int x=0;
+    for(;x+16<=n;x+=16)
+    {
+        __m128i bytes=_mm_loadu_si128(reinterpret_cast<const __m128i*>(src+x));
+        __m128i low=_mm_unpacklo_epi8(bytes,zero);
+        __m128i high=_mm_unpackhi_epi8(bytes,zero);
+        __m128i *dst=reinterpret_cast<__m128i*>(sum+x);
+        _mm_storeu_si128(dst,_mm_add_epi32(_mm_loadu_si128(dst),_mm_unpacklo_epi16(low,zero)));
+        _mm_storeu_si128(dst+1,_mm_add_epi32(_mm_loadu_si128(dst+1),_mm_unpackhi_epi16(low,zero)));
+        _mm_storeu_si128(dst+2,_mm_add_epi32(_mm_loadu_si128(dst+2),_mm_unpacklo_epi16(high,zero)));
+        _mm_storeu_si128(dst+3,_mm_add_epi32(_mm_loadu_si128(dst+3),_mm_unpackhi_epi16(high,zero)));
+    }
+    accumulateRowScalar(src+x,sum+x,n-x);
+}
+
+TARGET_AVX2 void accumulateRowAvx2(const uchar *src,quint32 *sum,int n)
+{
+    int x=0;
+    for(;x+16<=n;x+=16)
+    {
+        __m128i bytes=_mm_loadu_si128(reinterpret_cast<const __m128i*>(src+x));
+        __m256i *dst=reinterpret_cast<__m256i*>(sum+x);
+        _mm256_storeu_si256(dst,_mm256_add_epi32(_mm256_loadu_si256(dst),_mm256_cvtepu8_epi32(bytes)));
+        _mm256_storeu_si256(dst+1,_mm256_add_epi32(_mm256_loadu_si256(dst+1),_mm256_cvtepu8_epi32(_mm_srli_si128(bytes,8))));
+    }
+    accumulateRowScalar(src+x,sum+x,n-x);
+}
+#endif
+
+typedef void (*RowAccumulator)(const uchar*,quint32*,int);
+
+RowAccumulator rowAccumulator(FrameConverter::Path path)
+{
+#ifdef FRAMECONVERTER_X86
+    if(path==FrameConverter::Avx2)
+        return accumulateRowAvx2;
+    if(path==FrameConverter::Sse2)
+        return accumulateRowSse2;
+#else
+    Q_UNUSED(path)
+#endif
+    return accumulateRowScalar;
+}
+
+typedef void (*RowConverter)(const uchar*,const uchar*,const uchar*,quint32*,int,const Coefficients&);
+
+RowConverter rowConverter(FrameConverter::Path path)
+{
+#ifdef FRAMECONVERTER_X86
+    if(path==FrameConverter::Avx2)
+        return convertRowAvx2;
+    if(path==FrameConverter::Sse2)
+        return convertRowSse2;
+#else
+    Q_UNUSED(path)
+#endif
+    return convertRowScalar;
+}
+
+//输出图像的缓冲池：图像析构时缓冲回到池中，尺寸相同的下一帧直接复用
+struct PooledBuffer
+{
+    qsizetype size;
+    uchar *data;
+};
+
+class BufferPool
+{
+public:
+    ~BufferPool()
+    {
+        for(PooledBuffer *buffer:m_free)
+            destroy(buffer);
+    }
+
+    PooledBuffer *acquire(qsizetype size)
+    {
+        {
+            QMutexLocker lock(&m_mutex);
+            for(int i=0;i<m_free.size();i++)
+            {
+                if(m_free.at(i)->size==size)
+                    return m_free.takeAt(i);
+            }
+        }
+        PooledBuffer *buffer=new PooledBuffer;
+        buffer->size=size;
+        buffer->data=static_cast<uchar*>(qMallocAligned(size_t(size),64));
+        return buffer;
+    }
+
+    void release(PooledBuffer *buffer)
+    {
+        QMutexLocker lock(&m_mutex);
+        if(m_free.size()<kMaxFree)
+        {
+            m_free.append(buffer);
+            return;
+        }
+        lock.unlock();
+        destroy(buffer);
+    }
+
+private:
+    static const int kMaxFree = 8;
+    QMutex m_mutex;
+    QVector<PooledBuffer*> m_free;
+
+    static void destroy(PooledBuffer *buffer)
+    {
+        qFreeAligned(buffer->data);
+        delete buffer;
+    }
+};
+
+BufferPool &bufferPool()
+{
+    static BufferPool pool;
+    return pool;
+}
+
+void releasePooledBuffer(void *info)
+{
+    bufferPool().release(static_cast<PooledBuffer*>(info));
+}
+
+QAtomicInt s_activePath(-1);
+
+FrameConverter::Path pathFromEnvironment(FrameConverter::Path fallback)
+{
+    //FRAMESYNC_SIMD=scalar/sse2/avx2 用于对比各实现
+    QByteArray name=qgetenv("FRAMESYNC_SIMD").toLower();
+    if(name=="scalar")
+        return FrameConverter::Scalar;
+    if(name=="sse2")
+        return qMin(fallback,FrameConverter::Sse2);
+    return fallback;
+}
+
+QImage fallbackConvert(const QVideoFrame &frame,const QSize &targetSize,Qt::AspectRatioMode mode)
+{
+    QImage image=frame.toImage();
+    if(image.isNull() || !targetSize.isValid())
+        return image;
+    return image.scaled(targetSize,mode,Qt::SmoothTransformation);
+}
+} // namespace
+
+bool FrameConverter::canConvert(const QVideoFrame &frame)
+{
+    switch(frame.surfaceFormat().pixelFormat())
+    {
+    case QVideoFrameFormat::Format_NV12:
+    case QVideoFrameFormat::Format_NV21:
+    case QVideoFrameFormat::Format_YUV420P:
+    case QVideoFrameFormat::Format_YV12:
+        return frame.width()>=2 && frame.height()>=2;
+    default:
+        return false;
+    }
+}
+
+FrameConverter::Path FrameConverter::bestPath()
+{
+#if defined(FRAMECONVERTER_X86) && defined(Q_CC_MSVC)
+    int info[4];
+    __cpuid(info,1);
+    bool bOsAvx=(info[2]&(1<<27)) && (info[2]&(1<<28)) && (_xgetbv(0)&6)==6;
+    if(bOsAvx)
+    {
+        __cpuidex(info,7,0);
+        if(info[1]&(1<<5))
+            return Avx2;
+    }
+    return Sse2;
+#elif defined(FRAMECONVERTER_X86) && defined(Q_CC_GNU)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return Avx2;
+    if(__builtin_cpu_supports("sse2"))
+        return Sse2;
+    return Scalar;
+#else
+    return Scalar;
+#endif
+}
+
+FrameConverter::Path FrameConverter::activePath()
+{
+    int path=s_activePath.loadAcquire();
+    if(path<0)
+    {
+        path=pathFromEnvironment(bestPath());
+        s_activePath.storeRelease(path);
+    }
+    return Path(path);
+}
+
+void FrameConverter::setPath(Path path)
+{
+    s_activePath.storeRelease(qMin(path,bestPath()));
+}
+
+QString FrameConverter::pathName(Path path)
+{
+    switch(path)
+    {
+    case Avx2:
+        return "avx2";
+    case Sse2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+QImage FrameConverter::convert(const QVideoFrame &frame,const QSize &targetSize,Qt::AspectRatioMode mode)
+{
+    if(!canConvert(frame))
+        return fallbackConvert(frame,targetSize,mode);
+
+    QVideoFrame mapped(frame);
+    if(!mapped.map(QVideoFrame::ReadOnly))
+        return fallbackConvert(frame,targetSize,mode);
+
+    const QVideoFrameFormat format=frame.surfaceFormat();
+    const int nSrcWidth=frame.width();
+    const int nSrcHeight=frame.height();
+    QSize dstSize=targetSize.isValid()?frame.size().scaled(targetSize,mode):frame.size();
+    const int nDstWidth=qMax(1,dstSize.width());
+    const int nDstHeight=qMax(1,dstSize.height());
+
+    //色彩空间未标明时按分辨率推断：标清用BT.601，高清用BT.709
+    bool bBt709=format.colorSpace()==QVideoFrameFormat::ColorSpace_BT709
+                || (format.colorSpace()!=QVideoFrameFormat::ColorSpace_BT601 && nSrcHeight>576);
+    bool bFullRange=format.colorRange()==QVideoFrameFormat::ColorRange_Full;
+    const Coefficients &coefficients=bBt709?(bFullRange?kBt709Full:kBt709Limited)
+                                             :(bFullRange?kBt601Full:kBt601Limited);
+
+    //色度平面：NV格式交织存放，步长为2
+    const uchar *yPlane=mapped.bits(0);
+    const int nYStride=mapped.bytesPerLine(0);
+    const uchar *uPlane;
+    const uchar *vPlane;
+    int nUStride;
+    int nVStride;
+    int nChromaStep;
+    switch(format.pixelFormat())
+    {
+    case QVideoFrameFormat::Format_NV12:
+        uPlane=mapped.bits(1);
+        vPlane=uPlane+1;
+        nUStride=nVStride=mapped.bytesPerLine(1);
+        nChromaStep=2;
+        break;
+    case QVideoFrameFormat::Format_NV21:
+        vPlane=mapped.bits(1);
+        uPlane=vPlane+1;
+        nUStride=nVStride=mapped.bytesPerLine(1);
+        nChromaStep=2;
+        break;
+    case QVideoFrameFormat::Format_YV12:
+        vPlane=mapped.bits(1);
+        uPlane=mapped.bits(2);
+        nVStride=mapped.bytesPerLine(1);
+        nUStride=mapped.bytesPerLine(2);
+        nChromaStep=1;
+        break;
+    default:
+        uPlane=mapped.bits(1);
+        vPlane=mapped.bits(2);
+        nUStride=mapped.bytesPerLine(1);
+        nVStride=mapped.bytesPerLine(2);
+        nChromaStep=1;
+        break;
+    }
+
+    const qsizetype nBytesPerLine=qsizetype(nDstWidth)*4;
+    PooledBuffer *buffer=bufferPool().acquire(nBytesPerLine*nDstHeight);
+    QImage image(buffer->data,nDstWidth,nDstHeight,nBytesPerLine,QImage::Format_RGB32,releasePooledBuffer,buffer);
+
+    //缩放取最近的源像素（取像素中心）；缩小到一半以下时亮度和色度都取目标像素覆盖的源区域平均，避免缩略图锯齿
+    const bool bScaled=nDstWidth!=nSrcWidth || nDstHeight!=nSrcHeight;
+    const bool bAverage=nSrcWidth>=nDstWidth*2 && nSrcHeight>=nDstHeight*2;
+    QVarLengthArray<int,4096> srcX(nDstWidth);
+    for(int x=0;x<nDstWidth;x++)
+        srcX[x]=bScaled?qMin(nSrcWidth-1,int((2LL*x+1)*nSrcWidth/(2LL*nDstWidth))):x;
+
+    //区域平均时每个目标列覆盖的源列[srcX0,srcX1)
+    //先把目标行覆盖的源行纵向累加成逐列的和（向量化），再对列和做一趟横向区间求和
+    const int nChromaWidth=(nSrcWidth+1)/2;
+    const int nChromaHeight=(nSrcHeight+1)/2;
+    QVarLengthArray<int,4096> srcX0(bAverage?nDstWidth+1:0);
+    for(int x=0;bAverage && x<=nDstWidth;x++)
+        srcX0[x]=int(qint64(x)*nSrcWidth/nDstWidth);
+    QVarLengthArray<quint32,4096> yColumns(bAverage?nSrcWidth:0);
+    QVarLengthArray<quint32,4096> uColumns(bAverage?nChromaWidth*nChromaStep:0);  //NV格式U、V交织在同一数组
+    QVarLengthArray<quint32,4096> vColumns(bAverage && nChromaStep==1?nChromaWidth:0);
+    const uchar *chromaPlane=nChromaStep==2?qMin(uPlane,vPlane):uPlane;
+    const quint32 *uColumn=uColumns.constData()+(nChromaStep==2?uPlane-chromaPlane:0);
+    const quint32 *vColumn=nChromaStep==2?uColumns.constData()+(vPlane-chromaPlane):vColumns.constData();
+    RowAccumulator accumulateRow=rowAccumulator(activePath());
+
+    QVarLengthArray<uchar,4096> yRow(nDstWidth);
+    QVarLengthArray<uchar,4096> uRow(nDstWidth);
+    QVarLengthArray<uchar,4096> vRow(nDstWidth);
+    RowConverter convertRow=rowConverter(activePath());
+
+    for(int y=0;y<nDstHeight;y++)
+    {
+        if(bAverage)
+        {
+            //亮度：源行纵向累加
+            int nY0=int(qint64(y)*nSrcHeight/nDstHeight);
+            int nY1=int(qint64(y+1)*nSrcHeight/nDstHeight);
+            std::memset(yColumns.data(),0,sizeof(quint32)*size_t(nSrcWidth));
+            for(int sy=nY0;sy<nY1;sy++)
+                accumulateRow(yPlane+qsizetype(sy)*nYStride,yColumns.data(),nSrcWidth);
+
+            //色度平面是亮度的一半，覆盖区域按半分辨率取（奇数边界向外扩一格）；NV格式整行交织累加
+            int nCY0=nY0/2;
+            int nCY1=qMin(nChromaHeight,(nY1+1)/2);
+            std::memset(uColumns.data(),0,sizeof(quint32)*size_t(uColumns.size()));
+            std::memset(vColumns.data(),0,sizeof(quint32)*size_t(vColumns.size()));
+            for(int cy=nCY0;cy<nCY1;cy++)
+            {
+                if(nChromaStep==2)
+                {
+                    accumulateRow(chromaPlane+qsizetype(cy)*nUStride,uColumns.data(),nChromaWidth*2);
+                    continue;
+                }
+                accumulateRow(uPlane+qsizetype(cy)*nUStride,uColumns.data(),nChromaWidth);
+                accumulateRow(vPlane+qsizetype(cy)*nVStride,vColumns.data(),nChromaWidth);
+            }
+
+            //横向：每个目标列对覆盖的列和求和，每行只做一趟
+            for(int x=0;x<nDstWidth;x++)
+            {
+                quint32 nYSum=0;
+                for(int sx=srcX0[x];sx<srcX0[x+1];sx++)
+                    nYSum+=yColumns[sx];
+                quint32 nUSum=0;
+                quint32 nVSum=0;
+                int nCX1=qMin(nChromaWidth,(srcX0[x+1]+1)/2);
+                for(int cx=srcX0[x]/2;cx<nCX1;cx++)
+                {
+                    nUSum+=uColumn[cx*nChromaStep];
+                    nVSum+=vColumn[cx*nChromaStep];
+                }
+
+                quint32 nCount=quint32((srcX0[x+1]-srcX0[x])*(nY1-nY0));
+                quint32 nChromaCount=quint32((nCX1-srcX0[x]/2)*(nCY1-nCY0));
+                yRow[x]=uchar((nYSum+nCount/2)/nCount);
+                uRow[x]=uchar((nUSum+nChromaCount/2)/nChromaCount);
+                vRow[x]=uchar((nVSum+nChromaCount/2)/nChromaCount);
+            }
+            convertRow(yRow.constData(),uRow.constData(),vRow.constData(),reinterpret_cast<quint32*>(buffer->data+y*nBytesPerLine),nDstWidth,coefficients);
+            continue;
+        }
+
+        int nSrcY=bScaled?qMin(nSrcHeight-1,int((2LL*y+1)*nSrcHeight/(2LL*nDstHeight))):y;
+        const uchar *ySrc=yPlane+qsizetype(nSrcY)*nYStride;
+        const uchar *uSrc=uPlane+qsizetype(nSrcY/2)*nUStride;
+        const uchar *vSrc=vPlane+qsizetype(nSrcY/2)*nVStride;
+
+        //不缩放时亮度行直接使用，只需把色度展开到每个像素
+        const uchar *yLine=ySrc;
+        if(bScaled)
+        {
+            for(int x=0;x<nDstWidth;x++)
+                yRow[x]=ySrc[srcX[x]];
+            yLine=yRow.constData();
+        }
+        for(int x=0;x<nDstWidth;x++)
+        {
+            int cx=(srcX[x]>>1)*nChromaStep;
+            uRow[x]=uSrc[cx];
+            vRow[x]=vSrc[cx];
+        }
+
+        convertRow(yLine,uRow.constData(),vRow.constData(),reinterpret_cast<quint32*>(buffer->data+y*nBytesPerLine),nDstWidth,coefficients);
+    }
+
+    mapped.unmap();
+    return image;
+}
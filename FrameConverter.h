@@ -0,0 +1,34 @@
+/*
+ * 视频帧转图像 NV12/NV21/YUV420P/YV12直接在一趟中完成颜色转换和缩放，输出RGB32
+ * 缩小到一半以下（缩略图）时亮度和色度按区域平均，否则取最近的源像素
+ * 按运行时检测到的指令集选择AVX2、SSE2或标量实现，三者结果逐位一致
+ * 输出图像的内存来自缓冲池，图像释放后缓冲回池复用；其他像素格式退回QVideoFrame::toImage
+ */
+
+#ifndef FRAMECONVERTER_H
+#define FRAMECONVERTER_H
+
+#include<QImage>
+#include<QSize>
+#include<QVideoFrame>
+
+class FrameConverter
+{
+public:
+    enum Path{
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    //转换并缩放到targetSize（按mode保持宽高比），无效尺寸表示保持原尺寸
+    static QImage convert(const QVideoFrame &frame,const QSize &targetSize=QSize(),Qt::AspectRatioMode mode=Qt::KeepAspectRatio);
+    static bool canConvert(const QVideoFrame &frame);   //像素格式是否走快速路径
+
+    static Path bestPath();             //本机支持的最快实现
+    static Path activePath();           //当前使用的实现
+    static void setPath(Path path);     //指定实现（性能测试用），超出本机支持时取本机最快的
+    static QString pathName(Path path);
+};
+
+#endif // FRAMECONVERTER_H
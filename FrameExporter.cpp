@@ -0,0 +1,355 @@
+#include "FrameExporter.h"
+
+#include<QDir>
+#include<QFile>
+#include<QFileInfo>
+#include<QImageWriter>
+#include<QThread>
+#include<QUrl>
+#include<QtConcurrent>
+
+#include"FrameConverter.h"
+
+namespace {
+const int kProgressIntervalMs = 500;    //进度上报间隔
+const double kStartRate = 4.0;          //初始解码速率，跳帧时逐次减半
+const int kMaxDefaultQueued = 16;       //默认在编帧数上限（解码帧可能占用硬件表面）
+const int kMaxGapRetries = 4;           //同一处跳帧最多重新定位的次数，超过后作为真实间隔接受
+}
+
+FrameExporter::FrameExporter(QObject *parent)
+    : QObject(parent)
+{
+    m_player = new QMediaPlayer(this);
+    m_sink = new QVideoSink(this);
+    m_player->setVideoOutput(m_sink);
+    connect(m_sink,&QVideoSink::videoFrameChanged,this,&FrameExporter::onVideoFrame);
+    connect(m_player,&QMediaPlayer::mediaStatusChanged,this,&FrameExporter::onMediaStatus);
+    connect(m_player,&QMediaPlayer::errorOccurred,this,[this](){
+        fail("解码失败："+m_player->errorString());
+    });
+
+    m_progressTimer = new QTimer(this);
+    m_progressTimer->setInterval(kProgressIntervalMs);
+    connect(m_progressTimer,&QTimer::timeout,this,[this](){emit progressChanged(stats());});
+}
+
+FrameExporter::~FrameExporter()
+{
+    //编码任务的回调指向本对象，必须等它们全部结束
+    m_bCanceled=true;
+    m_player->stop();
+    m_pool.waitForDone();
+}
+
+bool FrameExporter::start(const Options &options)
+{
+    if(m_bRunning)
+    {
+        m_strError="已有导出任务在进行";
+        return false;
+    }
+    if(!QFileInfo::exists(options.filePath))
+    {
+        m_strError="源文件不存在";
+        return false;
+    }
+    if(options.outMs<=options.inMs)
+    {
+        m_strError="出点必须在入点之后";
+        return false;
+    }
+    if(!QDir().mkpath(options.outputDir))
+    {
+        m_strError="无法创建输出目录";
+        return false;
+    }
+
+    m_options=options;
+    int nThreads=options.threads>0?options.threads:QThread::idealThreadCount();
+    m_pool.setMaxThreadCount(nThreads);
+    m_nMaxQueued=options.maxQueuedFrames>0?options.maxQueuedFrames:qMin(2*nThreads,kMaxDefaultQueued);
+
+    m_strError.clear();
+    m_bDecodeDone=false;
+    m_bCanceled=false;
+    m_bThrottled=false;
+    m_bSeeking=false;
+    m_dRate=kStartRate;
+    m_nQueued=0;
+    m_nDecoded=0;
+    m_nGapRetries=0;
+    m_nAcceptedGaps=0;
+    m_nBackpressurePauses=0;
+    m_nLastTime=-1;
+    m_nFrameDuration=0;
+    m_nGapTime=-1;
+    m_nGapAttempts=0;
+    m_nWritten=0;
+    m_nFailed=0;
+    m_nBytesWritten=0;
+
+    m_bRunning=true;
+    m_clock.start();
+    m_progressTimer->start();
+    //媒体加载完成后再定位到入点
+    m_player->setSource(QUrl::fromLocalFile(options.filePath));
+    return true;
+}
+
+void FrameExporter::cancel()
+{
+    if(!m_bRunning)
+        return;
+    m_bCanceled=true;
+    finishDecode();
+}
+
+FrameExporter::Stats FrameExporter::stats() const
+{
+    Stats stats;
+    stats.decoded=m_nDecoded;
+    stats.written=m_nWritten;
+    stats.queued=m_nQueued;
+    stats.failed=m_nFailed;
+    stats.gapRetries=m_nGapRetries;
+    stats.acceptedGaps=m_nAcceptedGaps;
+    stats.backpressurePauses=m_nBackpressurePauses;
+    stats.bytesWritten=m_nBytesWritten;
+    stats.elapsedMs=m_clock.isValid()?m_clock.elapsed():0;
+    if(stats.elapsedMs>0)
+    {
+        stats.framesPerSecond=m_nWritten*1000.0/stats.elapsedMs;
+        stats.bytesPerSecond=m_nBytesWritten*1000.0/stats.elapsedMs;
+    }
+
+    //完整解码到出点之后算全部完成，否则按最后一帧的时间估算
+    if(m_bDecodeDone && !m_bCanceled && m_strError.isEmpty())
+        stats.progress=m_nQueued>0?double(m_nWritten+m_nFailed)/qMax(1,m_nDecoded):1.0;
+    else if(m_nLastTime>=0)
+        stats.progress=qBound(0.0,(m_nLastTime/1000.0-m_options.inMs)/(m_options.outMs-m_options.inMs),1.0);
+    return stats;
+}
+
+QString FrameExporter::suffix(Format format)
+{
+    switch(format)
+    {
+    case Jpeg:
+        return "jpg";
+    case Raw:
+        return "rgb32";
+    default:
+        return "png";
+    }
+}
+
+QStringList FrameExporter::existingFiles(const Options &options)
+{
+    QString pattern=QString("%1_*.%2").arg(options.prefix,suffix(options.format));
+    return QDir(options.outputDir).entryList({pattern},QDir::Files,QDir::Name);
+}
+
+void FrameExporter::onMediaStatus(QMediaPlayer::MediaStatus status)
+{
+    if(!m_bRunning || m_bDecodeDone)
+        return;
+
+    if(status==QMediaPlayer::LoadedMedia && m_player->playbackState()==QMediaPlayer::StoppedState)
+    {
+        //没有音频输出，播放器按系统时钟以倍速出帧
+        m_player->setPosition(m_options.inMs);
+        m_player->setPlaybackRate(m_dRate);
+        m_player->play();
+    }
+    else if(status==QMediaPlayer::EndOfMedia)
+    {
+        finishDecode();
+    }
+    else if(status==QMediaPlayer::InvalidMedia)
+    {
+        fail("无法打开源文件："+m_player->errorString());
+    }
+}
+
+void FrameExporter::onVideoFrame(const QVideoFrame &frame)
+{
+    if(!m_bRunning || m_bDecodeDone || !frame.isValid() || frame.startTime()<0)
+        return;
+
+    qint64 nTime=frame.startTime();
+    if(frame.endTime()>nTime)
+        m_nFrameDuration=frame.endTime()-nTime;
+
+    //重新定位后，定位前已经发出的后续帧还会陆续到达，等新位置的帧到了再继续
+    if(m_bSeeking)
+    {
+        if(nTime>m_nLastTime+m_nFrameDuration*3/2 && nTime!=m_nGapTime)
+            return;
+        m_bSeeking=false;
+    }
+    if(nTime<=m_nLastTime)
+        return;     //定位后重复送出的帧
+
+    if(m_nLastTime<0)
+    {
+        //入点落在这一帧的显示区间内才从它开始
+        qint64 nEnd=frame.endTime()>nTime?frame.endTime():nTime+1;
+        if(nEnd<=m_options.inMs*1000)
+            return;
+    }
+    else
+    {
+        qint64 nDelta=nTime-m_nLastTime;
+        if(frame.endTime()<=nTime && (m_nFrameDuration==0 || nDelta<m_nFrameDuration))
+            m_nFrameDuration=nDelta;    //帧不带结束时间时取相邻帧的最小间隔
+
+        //间隔超过1.5帧说明倍速下丢了帧：回到最后一帧重新解码，并降低速率
+        //只有1倍速下同一帧在定位后直接再次出现，才说明间隔本来就存在（可变帧率），照常接收并计数
+        //定位落点不稳定时同一帧未必再次出现，同一处重新定位次数达到上限后也直接接受
+        bool bGap=m_nFrameDuration>0 && nDelta>m_nFrameDuration*3/2;
+        bool bRepeated=nTime==m_nGapTime && m_dRate<=1.0;
+        bool bExhausted=m_nGapAttempts>=kMaxGapRetries;
+        if(bGap && !bRepeated && !bExhausted && m_nLastTime+m_nFrameDuration<=m_options.outMs*1000)
+        {
+            m_nGapTime=nTime;
+            m_nGapAttempts++;
+            m_nGapRetries++;
+            m_dRate=qMax(1.0,m_dRate/2);
+            resumeDecode();
+            return;
+        }
+        if(bGap)
+            m_nAcceptedGaps++;
+    }
+
+    //出点所在帧之后的第一帧，导出范围已经完整
+    if(nTime>m_options.outMs*1000)
+    {
+        finishDecode();
+        return;
+    }
+
+    m_nLastTime=nTime;
+    m_nGapAttempts=0;
+    m_nDecoded++;
+    enqueue(frame,m_nDecoded);
+}
+
+void FrameExporter::enqueue(const QVideoFrame &frame,int nIndex)
+{
+    QString fileName=QString("%1_%2.%3").arg(m_options.prefix).arg(nIndex,6,10,QChar('0')).arg(suffix(m_options.format));
+    QString filePath=QDir(m_options.outputDir).filePath(fileName);
+
+    m_nQueued++;
+    QtConcurrent::run(&m_pool,&FrameExporter::writeFrame,frame,filePath,m_options.format,m_options.quality)
+        .then(this,[this](qint64 nBytes){onFrameWritten(nBytes);});
+
+    //编码跟不上时暂停解码，暂停生效前送出的帧照常入队，超出上限的量很小
+    if(m_nQueued>=m_nMaxQueued && !m_bThrottled)
+    {
+        m_bThrottled=true;
+        m_nBackpressurePauses++;
+        m_player->pause();
+    }
+}
+
+void FrameExporter::onFrameWritten(qint64 nBytes)
+{
+    m_nQueued--;
+    if(nBytes<0)
+    {
+        m_nFailed++;
+    }
+    else
+    {
+        m_nWritten++;
+        m_nBytesWritten+=nBytes;
+    }
+
+    if(m_bThrottled && m_nQueued<=m_nMaxQueued/2)
+    {
+        m_bThrottled=false;
+        if(!m_bDecodeDone)
+            m_player->play();
+    }
+    checkFinished();
+}
+
+void FrameExporter::resumeDecode()
+{
+    //定位到最后一帧的中点，避免毫秒取整落到相邻帧
+    m_bSeeking=true;
+    m_player->setPlaybackRate(m_dRate);
+    m_player->setPosition((m_nLastTime+m_nFrameDuration/2)/1000);
+    if(!m_bThrottled)
+        m_player->play();
+}
+
+void FrameExporter::finishDecode()
+{
+    if(m_bDecodeDone)
+        return;
+    m_bDecodeDone=true;
+    m_player->stop();
+    checkFinished();
+}
+
+void FrameExporter::checkFinished()
+{
+    if(!m_bRunning || !m_bDecodeDone || m_nQueued>0)
+        return;
+
+    m_bRunning=false;
+    m_progressTimer->stop();
+    m_player->setSource(QUrl());    //释放源文件
+
+    if(m_strError.isEmpty() && !m_bCanceled)
+    {
+        if(m_nDecoded==0)
+            m_strError="范围内没有可导出的帧";
+        else if(m_nFailed>0)
+            m_strError=QString("%1帧写出失败").arg(m_nFailed);
+    }
+    emit progressChanged(stats());
+    emit finished(!m_bCanceled && m_strError.isEmpty());
+}
+
+void FrameExporter::fail(const QString &error)
+{
+    if(!m_bRunning)
+        return;
+    if(m_strError.isEmpty())
+        m_strError=error;
+    finishDecode();
+}
+
+qint64 FrameExporter::writeFrame(const QVideoFrame &frame,const QString &filePath,Format format,int nQuality)
+{
+    //颜色转换也在工作线程完成，主线程只负责按顺序取帧
+    QImage image=FrameConverter::convert(frame);
+    if(image.isNull())
+        return -1;
+
+    if(format==Raw)
+    {
+        if(image.format()!=QImage::Format_RGB32)
+            image=image.convertToFormat(QImage::Format_RGB32);
+        QFile file(filePath);
+        if(!file.open(QIODevice::WriteOnly))
+            return -1;
+        qint64 nLineBytes=qint64(image.width())*4;
+        for(int y=0;y<image.height();y++)
+        {
+            if(file.write(reinterpret_cast<const char*>(image.constScanLine(y)),nLineBytes)!=nLineBytes)
+                return -1;
+        }
+        return nLineBytes*image.height();
+    }
+
+    QImageWriter writer(filePath,format==Jpeg?"jpg":"png");
+    writer.setQuality(nQuality);
+    if(!writer.write(image))
+        return -1;
+    return QFileInfo(filePath).size();
+}
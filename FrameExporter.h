@@ -0,0 +1,116 @@
+/*
+ * 帧序列导出 把文件的一段时间范围逐帧导出为编号的PNG/JPEG/原始RGB32图像
+ * 解码、编码两级流水：独立播放器按时间戳顺序取帧，编码分散到线程池
+ * 在编帧数达到上限时暂停解码，回落到一半再继续，内存占用保持平稳
+ * 检测到跳帧时回退到最后一帧重新定位并降低解码速率，保证导出范围内不缺帧
+ */
+
+#ifndef FRAMEEXPORTER_H
+#define FRAMEEXPORTER_H
+
+#include<QObject>
+#include<QMediaPlayer>
+#include<QVideoSink>
+#include<QVideoFrame>
+#include<QThreadPool>
+#include<QElapsedTimer>
+#include<QTimer>
+#include<QStringList>
+
+class FrameExporter : public QObject
+{
+    Q_OBJECT
+public:
+    enum Format{
+        Png,
+        Jpeg,
+        Raw         //无文件头的RGB32（逐行紧排，每像素B、G、R、0xFF），尺寸同源视频
+    };
+
+    struct Options
+    {
+        QString filePath;           //源文件
+        qint64 inMs = 0;            //导出范围（毫秒，含两端）
+        qint64 outMs = 0;
+        QString outputDir;
+        QString prefix = "frame";   //输出文件名前缀，后接六位帧号
+        Format format = Png;
+        int quality = -1;           //JPEG/PNG质量，-1为编码器默认
+        int threads = 0;            //编码线程数，0为CPU核数
+        int maxQueuedFrames = 0;    //在编帧数上限，0为线程数的两倍（不超过16，硬件解码表面有限）
+    };
+
+    struct Stats
+    {
+        int decoded = 0;            //已交给编码的帧数
+        int written = 0;            //已写出的帧数
+        int queued = 0;             //正在编码的帧数
+        int failed = 0;             //写出失败的帧数
+        int gapRetries = 0;         //检测到跳帧后重新定位的次数
+        int acceptedGaps = 0;       //1倍速重新解码后仍然存在、作为真实间隔接受的跳帧
+        int backpressurePauses = 0; //因编码跟不上暂停解码的次数
+        double progress = 0;        //按时间计算的进度（0~1）
+        double framesPerSecond = 0; //写出速率
+        double bytesPerSecond = 0;
+        qint64 bytesWritten = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    explicit FrameExporter(QObject *parent=nullptr);
+    ~FrameExporter();
+
+    bool start(const Options &options);     //选项无效时返回false，errorString()给出原因
+    void cancel();                          //停止解码，已在编的帧写完后发出finished
+    bool isRunning() const {return m_bRunning;}
+    Stats stats() const;
+    QString errorString() const {return m_strError;}
+
+    static QString suffix(Format format);
+    static QStringList existingFiles(const Options &options);  //输出目录中同前缀同格式、会被覆盖的文件
+
+signals:
+    void progressChanged(const FrameExporter::Stats &stats);
+    void finished(bool bSuccess);           //全部写完、取消或出错
+
+private:
+    Options m_options;
+    QMediaPlayer *m_player;         //导出专用解码器，不绑定显示组件和音频输出
+    QVideoSink *m_sink;
+    QThreadPool m_pool;
+    QTimer *m_progressTimer;
+    QElapsedTimer m_clock;
+
+    bool m_bRunning = false;
+    bool m_bDecodeDone = false;     //已取到出点之后的帧或到达文件末尾
+    bool m_bCanceled = false;
+    bool m_bThrottled = false;      //编码跟不上，解码已暂停
+    bool m_bSeeking = false;        //重新定位后忽略定位前残留的帧，直到新位置的帧到达
+    double m_dRate = 4.0;           //当前解码速率，跳帧时减半
+    int m_nMaxQueued = 0;
+    int m_nQueued = 0;
+    int m_nDecoded = 0;
+    int m_nGapRetries = 0;
+    int m_nAcceptedGaps = 0;
+    int m_nBackpressurePauses = 0;
+    qint64 m_nLastTime = -1;        //最后一个交给编码的帧起始时间（微秒）
+    qint64 m_nFrameDuration = 0;    //单帧时长（微秒），由帧结束时间或相邻帧推算
+    qint64 m_nGapTime = -1;         //触发上次重新定位的帧，1倍速定位后直接再次出现说明是真实的时间间隔
+    int m_nGapAttempts = 0;         //当前这处跳帧已重新定位的次数，接收新帧后清零
+    int m_nWritten = 0;             //以下由编码完成的回调在主线程更新
+    int m_nFailed = 0;
+    qint64 m_nBytesWritten = 0;
+    QString m_strError;
+
+    void onVideoFrame(const QVideoFrame &frame);
+    void onMediaStatus(QMediaPlayer::MediaStatus status);
+    void enqueue(const QVideoFrame &frame,int nIndex);
+    void onFrameWritten(qint64 nBytes);
+    void resumeDecode();            //从最后一帧之后继续解码
+    void finishDecode();
+    void checkFinished();
+    void fail(const QString &error);
+
+    static qint64 writeFrame(const QVideoFrame &frame,const QString &filePath,Format format,int nQuality);
+};
+
+#endif // FRAMEEXPORTER_H
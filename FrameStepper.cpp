@@ -0,0 +1,231 @@
+#include "FrameStepper.h"
+
+#include<QMediaMetaData>
+
+FrameStepper::FrameStepper(QMediaPlayer *player,QVideoSink *sink,QObject *parent)
+    : QObject(parent)
+    , m_player(player)
+    , m_sink(sink)
+{
+    //主播放器输出的每一帧都进入缓存
+    connect(m_sink,&QVideoSink::videoFrameChanged,this,&FrameStepper::onVideoFrameChanged);
+    connect(m_player,&QMediaPlayer::playbackStateChanged,this,&FrameStepper::onPlaybackStateChanged);
+    connect(m_player,&QMediaPlayer::sourceChanged,this,&FrameStepper::onSourceChanged);
+
+    //回填解码器：只输出到内部sink，不显示也不出声
+    m_backfillPlayer = new QMediaPlayer(this);
+    m_backfillSink = new QVideoSink(this);
+    m_backfillPlayer->setVideoOutput(m_backfillSink);
+    connect(m_backfillSink,&QVideoSink::videoFrameChanged,this,&FrameStepper::onBackfillFrame);
+    connect(m_backfillPlayer,&QMediaPlayer::mediaStatusChanged,this,[this](QMediaPlayer::MediaStatus status){
+        if(status==QMediaPlayer::LoadedMedia && m_bBackfillPending)
+        {
+            m_bBackfillPending=false;
+            if(m_nBackfillEnd>=0)
+                runBackfill();
+        }
+    });
+}
+
+void FrameStepper::setMediaPlayer(QMediaPlayer *player)
+{
+    disconnect(m_player,nullptr,this,nullptr);
+    m_player=player;
+    connect(m_player,&QMediaPlayer::playbackStateChanged,this,&FrameStepper::onPlaybackStateChanged);
+    connect(m_player,&QMediaPlayer::sourceChanged,this,&FrameStepper::onSourceChanged);
+    onSourceChanged();
+}
+
+void FrameStepper::setCacheCapacity(int nFrames)
+{
+    m_nCapacity=qMax(2,nFrames);
+    while(m_frames.size()>m_nCapacity)
+        m_frames.erase(m_frames.begin());
+}
+
+void FrameStepper::stepForward()
+{
+    if(m_player->playbackState()==QMediaPlayer::PlayingState)
+        m_player->pause();
+
+    if(m_nCurrentTime<0)
+    {
+        seekToFrame(m_player->position()*1000+m_nFrameDuration);
+        return;
+    }
+
+    //之前后退时走的是缓存，前进也先从缓存取
+    if(m_bCacheAhead)
+    {
+        auto it=m_frames.upperBound(m_nCurrentTime);
+        if(it!=m_frames.end() && it.key()-m_nCurrentTime<=m_nFrameDuration*3/2)
+        {
+            presentFrame(it.value());
+            return;
+        }
+    }
+
+    seekToFrame(m_nCurrentTime+m_nFrameDuration);
+}
+
+void FrameStepper::stepBackward()
+{
+    if(m_player->playbackState()==QMediaPlayer::PlayingState)
+        m_player->pause();
+
+    if(m_nCurrentTime<0)
+    {
+        seekToFrame(qMax<qint64>(0,m_player->position()*1000-m_nFrameDuration));
+        return;
+    }
+
+    //缓存中紧邻当前帧的前一帧，间隔超过1.5帧说明中间有缺帧，视为未命中
+    auto it=m_frames.lowerBound(m_nCurrentTime);
+    if(it!=m_frames.begin())
+    {
+        --it;
+        if(m_nCurrentTime-it.key()<=m_nFrameDuration*3/2)
+        {
+            presentFrame(it.value());
+            return;
+        }
+    }
+
+    qint64 target=m_nCurrentTime-m_nFrameDuration;
+    if(target<0)
+        return;
+
+    //未命中：本次照常定位，同时在后台把目标之前的一段帧解码进缓存
+    seekToFrame(target);
+    startBackfill(target);
+}
+
+void FrameStepper::setExternalPresenting(bool bPresenting)
+{
+    if(bPresenting==m_bExternalPresenting)
+        return;
+    m_bExternalPresenting=bPresenting;
+    clear();
+}
+
+void FrameStepper::clear()
+{
+    m_frames.clear();
+    m_nCurrentTime=-1;
+    m_bCacheAhead=false;
+}
+
+void FrameStepper::onVideoFrameChanged(const QVideoFrame &frame)
+{
+    if(m_bPresenting || m_bExternalPresenting || !frame.isValid())
+        return;
+
+    updateFrameDuration(frame);
+    m_nCurrentTime=frame.startTime();
+    m_bCacheAhead=false;
+    insertFrame(frame);
+}
+
+void FrameStepper::onBackfillFrame(const QVideoFrame &frame)
+{
+    if(m_nBackfillEnd<0 || !frame.isValid())
+        return;
+
+    //到达区间终点后暂停回填解码器
+    if(frame.startTime()>=m_nBackfillEnd)
+    {
+        m_backfillPlayer->pause();
+        m_nBackfillEnd=-1;
+        return;
+    }
+    insertFrame(frame);
+}
+
+void FrameStepper::onPlaybackStateChanged(QMediaPlayer::PlaybackState state)
+{
+    //从缓存帧继续播放前，先把播放器定位到当前显示的帧
+    if(state==QMediaPlayer::PlayingState && m_bCacheAhead)
+    {
+        m_bCacheAhead=false;
+        m_player->setPosition((m_nCurrentTime+m_nFrameDuration/2)/1000);
+    }
+}
+
+void FrameStepper::onSourceChanged()
+{
+    clear();
+    m_nBackfillEnd=-1;
+    m_bBackfillPending=false;
+    m_backfillPlayer->stop();
+    m_backfillPlayer->setSource(QUrl());
+}
+
+void FrameStepper::insertFrame(const QVideoFrame &frame)
+{
+    m_frames.insert(frame.startTime(),frame);
+
+    //超出上限时淘汰距离当前帧最远的一端
+    while(m_frames.size()>m_nCapacity)
+    {
+        qint64 nFront=m_nCurrentTime-m_frames.firstKey();
+        qint64 nBack=m_frames.lastKey()-m_nCurrentTime;
+        if(nFront>=nBack)
+            m_frames.erase(m_frames.begin());
+        else
+            m_frames.erase(std::prev(m_frames.end()));
+    }
+}
+
+void FrameStepper::presentFrame(const QVideoFrame &frame)
+{
+    m_bPresenting=true;
+    m_sink->setVideoFrame(frame);
+    m_bPresenting=false;
+
+    m_nCurrentTime=frame.startTime();
+    m_bCacheAhead=true;
+    emit framePresented(m_nCurrentTime/1000);
+}
+
+void FrameStepper::seekToFrame(qint64 frameTime)
+{
+    //定位到帧中点，避免毫秒取整落到相邻帧
+    m_bCacheAhead=false;
+    m_player->setPosition((frameTime+m_nFrameDuration/2)/1000);
+}
+
+void FrameStepper::startBackfill(qint64 endTime)
+{
+    m_nBackfillEnd=endTime;
+    if(m_backfillPlayer->source()!=m_player->source())
+    {
+        m_bBackfillPending=true;
+        m_backfillPlayer->setSource(m_player->source());
+        return;
+    }
+    runBackfill();
+}
+
+void FrameStepper::runBackfill()
+{
+    //回填约半个缓存容量的帧，覆盖典型的GOP长度
+    qint64 nSpan=m_nFrameDuration*(m_nCapacity/2);
+    qint64 nStart=qMax<qint64>(0,m_nBackfillEnd-nSpan);
+    m_backfillPlayer->setPosition(nStart/1000);
+    m_backfillPlayer->setPlaybackRate(2.0);
+    m_backfillPlayer->play();
+}
+
+void FrameStepper::updateFrameDuration(const QVideoFrame &frame)
+{
+    if(frame.endTime()>frame.startTime())
+    {
+        m_nFrameDuration=frame.endTime()-frame.startTime();
+        return;
+    }
+
+    //帧本身不带结束时间时退回到媒体元数据中的帧率
+    double dFrameRate=m_player->metaData().value(QMediaMetaData::VideoFrameRate).toDouble();
+    if(dFrameRate>0)
+        m_nFrameDuration=qint64(1000000.0/dFrameRate);
+}
@@ -0,0 +1,68 @@
+/*
+ * 逐帧步进引擎 从QVideoSink截取解码帧 维护最近解码帧的有界缓存
+ * 后退步进优先从缓存取帧，未命中时才重新定位，并在后台回填当前GOP
+ */
+
+#ifndef FRAMESTEPPER_H
+#define FRAMESTEPPER_H
+
+#include<QObject>
+#include<QMap>
+#include<QMediaPlayer>
+#include<QVideoSink>
+#include<QVideoFrame>
+
+class FrameStepper : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FrameStepper(QMediaPlayer *player,QVideoSink *sink,QObject *parent=nullptr);
+
+    void setMediaPlayer(QMediaPlayer *player);  //切换跟随的主播放器（无缝切换时）
+    void setCacheCapacity(int nFrames);     //设置缓存帧数上限
+    int cacheCapacity() const {return m_nCapacity;}
+    int cachedFrameCount() const {return m_frames.size();}
+    qint64 frameDuration() const {return m_nFrameDuration;}    //单帧时长（微秒）
+    void setExternalPresenting(bool bPresenting);   //其他组件（倒放）正向sink送帧期间不缓存这些帧，切换时清空缓存
+
+public slots:
+    void stepForward();     //前进一帧
+    void stepBackward();    //后退一帧
+    void clear();           //清空帧缓存
+
+signals:
+    void framePresented(qint64 position);   //呈现缓存帧后发出（毫秒）
+
+private slots:
+    void onVideoFrameChanged(const QVideoFrame &frame);     //播放器输出新帧
+    void onBackfillFrame(const QVideoFrame &frame);         //回填解码器输出新帧
+    void onPlaybackStateChanged(QMediaPlayer::PlaybackState state);
+    void onSourceChanged();
+
+private:
+    QMediaPlayer *m_player;     //主播放器
+    QVideoSink *m_sink;         //主播放器的视频输出
+
+    //后台回填解码器 不绑定任何显示组件和音频输出
+    QMediaPlayer *m_backfillPlayer;
+    QVideoSink *m_backfillSink;
+    qint64 m_nBackfillEnd = -1;     //回填区间终点（微秒），-1表示空闲
+    bool m_bBackfillPending = false;    //回填解码器媒体尚未加载完成
+
+    QMap<qint64,QVideoFrame> m_frames;  //帧起始时间(微秒)——解码帧
+    int m_nCapacity = 48;               //缓存帧数上限（硬件解码表面有限，不宜过大）
+    qint64 m_nFrameDuration = 40000;    //单帧时长（微秒），默认25fps
+    qint64 m_nCurrentTime = -1;         //当前显示帧的时间戳（微秒）
+    bool m_bPresenting = false;         //正在向sink写入缓存帧（忽略回环信号）
+    bool m_bCacheAhead = false;         //显示帧来自缓存，主播放器位置尚未同步
+    bool m_bExternalPresenting = false; //sink上的帧来自其他组件，不是主播放器的解码帧
+
+    void insertFrame(const QVideoFrame &frame); //加入缓存并按距离淘汰
+    void presentFrame(const QVideoFrame &frame);    //将缓存帧送显
+    void seekToFrame(qint64 frameTime);         //未命中时通过播放器定位到指定帧
+    void startBackfill(qint64 endTime);         //后台解码endTime之前的一段帧
+    void runBackfill();
+    void updateFrameDuration(const QVideoFrame &frame);
+};
+
+#endif // FRAMESTEPPER_H
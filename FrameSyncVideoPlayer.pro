@@ -1,5 +1,6 @@
 QT       += core gui
 QT += multimedia multimediawidgets
+QT += concurrent network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -10,11 +11,69 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    FastScanController.cpp \
+    FrameConverter.cpp \
+    FrameExporter.cpp \
+    FrameStepper.cpp \
+    FrameTimingMonitor.cpp \
+    KeyframeIndex.cpp \
+    LibraryDock.cpp \
+    LoudnessAnalyzer.cpp \
+    MediaLibrary.cpp \
+    MediaPreroller.cpp \
+    MediaProber.cpp \
+    MetadataCache.cpp \
+    PlayHistoryStore.cpp \
+    PlaylistJournal.cpp \
+    PlaylistLoader.cpp \
+    PlaylistModel.cpp \
+    PlaylistProxyModel.cpp \
+    ReadAheadDevice.cpp \
+    ResumePositionStore.cpp \
+    ReversePlayer.cpp \
+    SeekScheduler.cpp \
+    StreamBuffer.cpp \
+    SyncController.cpp \
+    SyncPlayerWindow.cpp \
+    ThumbnailDiskCache.cpp \
+    ThumbnailProvider.cpp \
+    TimeshiftBuffer.cpp \
+    WaveformAnalyzer.cpp \
     main.cpp \
     player.cpp
 
 HEADERS += \
     ClickableSlider.h \
+    FastScanController.h \
+    FrameConverter.h \
+    FrameExporter.h \
+    FrameStepper.h \
+    FrameTimingMonitor.h \
+    FrameTimingOverlay.h \
+    KeyframeIndex.h \
+    LibraryDock.h \
+    LoudnessAnalyzer.h \
+    MediaLibrary.h \
+    MediaPreroller.h \
+    MediaProber.h \
+    MetadataCache.h \
+    PlaybackRates.h \
+    PlayHistoryStore.h \
+    PlaylistJournal.h \
+    PlaylistLoader.h \
+    PlaylistModel.h \
+    PlaylistProxyModel.h \
+    ReadAheadDevice.h \
+    ResumePositionStore.h \
+    ReversePlayer.h \
+    SeekScheduler.h \
+    StreamBuffer.h \
+    SyncController.h \
+    SyncPlayerWindow.h \
+    ThumbnailDiskCache.h \
+    ThumbnailProvider.h \
+    TimeshiftBuffer.h \
+    WaveformAnalyzer.h \
     player.h
 
 FORMS += \
@@ -0,0 +1,265 @@
+#include "FrameTimingMonitor.h"
+
+#include<QSaveFile>
+#include<QTextStream>
+#include<QJsonArray>
+#include<QJsonObject>
+#include<QJsonDocument>
+#include<algorithm>
+#include<cmath>
+
+namespace {
+const int kStatsIntervalMs = 500;       //统计刷新间隔
+const qint64 kWindowUs = 10000000;      //滚动统计窗口（10秒）
+const qint64 kMaxGapUs = 1000000;       //超过该间隔视为暂停或定位
+
+double percentile(QVector<double> &values,double p)
+{
+    if(values.isEmpty())
+        return 0;
+    int nIndex=qBound(0,int(std::ceil(p*values.size()))-1,int(values.size())-1);
+    std::nth_element(values.begin(),values.begin()+nIndex,values.end());
+    return values.at(nIndex);
+}
+}
+
+FrameTimingMonitor::FrameTimingMonitor(QVideoSink *sink,QObject *parent,int nCapacity)
+    : QObject(parent)
+    , m_sink(sink)
+{
+    m_samples.resize(qMax(1024,nCapacity));
+    m_statsTimer = new QTimer(this);
+    m_statsTimer->setInterval(kStatsIntervalMs);
+    connect(m_statsTimer,&QTimer::timeout,this,&FrameTimingMonitor::updateStats);
+}
+
+void FrameTimingMonitor::start()
+{
+    if(m_bActive)
+        return;
+
+    m_nHead=0;
+    m_nCount=0;
+    m_nInterval=0;
+    m_nLastPts=-1;
+    m_nLastArrival=-1;
+    m_nAnchorPts=-1;
+    m_stats=FrameTimingStats();
+    m_clock.start();
+
+    //只在打开监视时才连接，关闭时对播放没有任何开销
+    connect(m_sink,&QVideoSink::videoFrameChanged,this,&FrameTimingMonitor::onVideoFrameChanged);
+    m_statsTimer->start();
+    m_bActive=true;
+}
+
+void FrameTimingMonitor::stop()
+{
+    if(!m_bActive)
+        return;
+    disconnect(m_sink,&QVideoSink::videoFrameChanged,this,&FrameTimingMonitor::onVideoFrameChanged);
+    m_statsTimer->stop();
+    m_bActive=false;
+}
+
+void FrameTimingMonitor::setPlaybackRate(double rate)
+{
+    if(rate<=0)
+        return;
+    m_dRate=rate;
+    m_nAnchorPts=-1;
+}
+
+void FrameTimingMonitor::setExternalPresenting(bool bPresenting)
+{
+    m_bExternalPresenting=bPresenting;
+    m_nLastPts=-1;
+    m_nAnchorPts=-1;
+}
+
+void FrameTimingMonitor::onVideoFrameChanged(const QVideoFrame &frame)
+{
+    if(m_bExternalPresenting || !frame.isValid())
+        return;
+
+    Sample sample;
+    sample.pts=frame.startTime();
+    sample.arrival=m_clock.nsecsElapsed()/1000;
+    sample.jitter=0;
+    sample.lateness=0;
+    sample.dropped=0;
+    sample.late=false;
+
+    if(frame.endTime()>frame.startTime())
+        m_nInterval=frame.endTime()-frame.startTime();
+
+    //时间戳倒退、大跳或者长时间没有新帧，说明发生了定位或暂停，重建时间线
+    qint64 ptsGap=sample.pts-m_nLastPts;
+    qint64 arrivalGap=sample.arrival-m_nLastArrival;
+    sample.discontinuity=m_nLastPts<0 || m_nAnchorPts<0 || ptsGap<=0 || ptsGap>kMaxGapUs || arrivalGap>kMaxGapUs;
+
+    if(sample.discontinuity)
+    {
+        m_nAnchorPts=sample.pts;
+        m_nAnchorArrival=sample.arrival;
+    }
+    else
+    {
+        //帧本身不带时长时用最小的正间隔估计帧间隔
+        if(frame.endTime()<=frame.startTime() && (m_nInterval==0 || ptsGap<m_nInterval))
+            m_nInterval=ptsGap;
+
+        sample.jitter=arrivalGap-qint64(ptsGap/m_dRate);
+        if(m_nInterval>0 && ptsGap>m_nInterval*3/2)
+            sample.dropped=int(std::lround(double(ptsGap)/m_nInterval))-1;
+
+        //滞后为负说明时间线起点本身偏晚，把起点前移
+        sample.lateness=sample.arrival-m_nAnchorArrival-qint64((sample.pts-m_nAnchorPts)/m_dRate);
+        if(sample.lateness<0)
+        {
+            m_nAnchorArrival+=sample.lateness;
+            sample.lateness=0;
+        }
+        sample.late=m_nInterval>0 && sample.lateness>qint64(m_nInterval/m_dRate);
+    }
+
+    m_nLastPts=sample.pts;
+    m_nLastArrival=sample.arrival;
+    append(sample);
+}
+
+void FrameTimingMonitor::updateStats()
+{
+    FrameTimingStats stats;
+    if(m_nCount==0)
+    {
+        m_stats=stats;
+        emit statsChanged(m_stats);
+        return;
+    }
+
+    //从最新的样本往回取滚动窗口
+    qint64 now=m_clock.nsecsElapsed()/1000;
+    QVector<double> jitters;
+    int nDropped=0;
+    qint64 nFirstArrival=now;
+    for(int i=m_nCount-1;i>=0;i--)
+    {
+        const Sample &sample=sampleAt(i);
+        if(now-sample.arrival>kWindowUs)
+            break;
+        stats.frames++;
+        nFirstArrival=sample.arrival;
+        if(sample.discontinuity)
+            continue;
+        jitters.append(std::abs(sample.jitter)/1000.0);
+        nDropped+=sample.dropped;
+        if(sample.late)
+            stats.lateFrames++;
+    }
+
+    double dSpan=(now-nFirstArrival)/1e6;
+    if(dSpan>0)
+    {
+        stats.effectiveFps=stats.frames/dSpan;
+        stats.dropsPerMinute=nDropped*60.0/dSpan;
+    }
+    stats.jitterP50=percentile(jitters,0.5);
+    stats.jitterP99=percentile(jitters,0.99);
+
+    m_stats=stats;
+    emit statsChanged(m_stats);
+}
+
+const FrameTimingMonitor::Sample &FrameTimingMonitor::sampleAt(int nIndex) const
+{
+    int nCapacity=m_samples.size();
+    return m_samples.at((m_nHead-m_nCount+nIndex+nCapacity)%nCapacity);
+}
+
+void FrameTimingMonitor::append(const Sample &sample)
+{
+    m_samples[m_nHead]=sample;
+    m_nHead=(m_nHead+1)%m_samples.size();
+    if(m_nCount<m_samples.size())
+        m_nCount++;
+}
+
+bool FrameTimingMonitor::exportCsv(const QString &filePath) const
+{
+    QSaveFile file(filePath);
+    if(!file.open(QIODevice::WriteOnly|QIODevice::Text))
+        return false;
+
+    QTextStream out(&file);
+    out<<"arrival_us,pts_us,jitter_us,lateness_us,late,dropped,discontinuity\n";
+    for(int i=0;i<m_nCount;i++)
+    {
+        const Sample &sample=sampleAt(i);
+        out<<sample.arrival<<','<<sample.pts<<','<<sample.jitter<<','<<sample.lateness<<','
+           <<int(sample.late)<<','<<sample.dropped<<','<<int(sample.discontinuity)<<'\n';
+    }
+    out.flush();
+    return file.commit();
+}
+
+bool FrameTimingMonitor::exportChromeTrace(const QString &filePath) const
+{
+    //每帧一个完整事件（持续到下一帧到达），抖动和滞后作为计数器曲线
+    QJsonArray events;
+    for(int i=0;i<m_nCount;i++)
+    {
+        const Sample &sample=sampleAt(i);
+        qint64 nDuration=i+1<m_nCount?sampleAt(i+1).arrival-sample.arrival:0;
+
+        QJsonObject args;
+        args["pts_us"]=sample.pts;
+        args["jitter_us"]=sample.jitter;
+        args["lateness_us"]=sample.lateness;
+        args["dropped"]=sample.dropped;
+
+        QJsonObject frame;
+        frame["name"]=sample.discontinuity?"frame (discontinuity)":sample.late?"frame (late)":"frame";
+        frame["cat"]="video";
+        frame["ph"]="X";
+        frame["ts"]=sample.arrival;
+        frame["dur"]=nDuration;
+        frame["pid"]=1;
+        frame["tid"]=1;
+        frame["args"]=args;
+        events.append(frame);
+
+        QJsonObject counterArgs;
+        counterArgs["jitter_ms"]=sample.jitter/1000.0;
+        counterArgs["lateness_ms"]=sample.lateness/1000.0;
+        QJsonObject counter;
+        counter["name"]="timing";
+        counter["ph"]="C";
+        counter["ts"]=sample.arrival;
+        counter["pid"]=1;
+        counter["args"]=counterArgs;
+        events.append(counter);
+
+        if(sample.dropped>0)
+        {
+            QJsonObject drop;
+            drop["name"]=QString("dropped %1").arg(sample.dropped);
+            drop["ph"]="i";
+            drop["s"]="t";
+            drop["ts"]=sample.arrival;
+            drop["pid"]=1;
+            drop["tid"]=1;
+            events.append(drop);
+        }
+    }
+
+    QJsonObject trace;
+    trace["traceEvents"]=events;
+    trace["displayTimeUnit"]="ms";
+
+    QSaveFile file(filePath);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
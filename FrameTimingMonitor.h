@@ -0,0 +1,88 @@
+/*
+ * 帧时序监视器 记录每一帧的时间戳、到达时刻、帧间抖动以及迟到和丢帧情况
+ * 样本存放在固定容量的环形缓冲中，定期汇总滚动统计，可导出为CSV或Chrome Trace
+ */
+
+#ifndef FRAMETIMINGMONITOR_H
+#define FRAMETIMINGMONITOR_H
+
+#include<QObject>
+#include<QVector>
+#include<QVideoSink>
+#include<QVideoFrame>
+#include<QElapsedTimer>
+#include<QTimer>
+
+//滚动窗口内的统计结果
+struct FrameTimingStats
+{
+    double jitterP50 = 0;       //帧间抖动中位数（毫秒）
+    double jitterP99 = 0;       //帧间抖动99分位（毫秒）
+    double dropsPerMinute = 0;  //每分钟丢帧数
+    double effectiveFps = 0;    //实际呈现帧率
+    int lateFrames = 0;         //窗口内的迟到帧数
+    int frames = 0;             //窗口内的帧数
+};
+
+class FrameTimingMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FrameTimingMonitor(QVideoSink *sink,QObject *parent=nullptr,int nCapacity=65536);
+
+    //一帧的记录
+    struct Sample
+    {
+        qint64 pts;         //帧时间戳（微秒）
+        qint64 arrival;     //到达时刻（微秒，相对监视开始）
+        qint64 jitter;      //到达间隔与理想间隔之差（微秒）
+        qint64 lateness;    //相对理想时间线的滞后（微秒）
+        int dropped;        //与上一帧之间跳过的帧数
+        bool late;          //滞后超过一个显示间隔
+        bool discontinuity; //定位、暂停等导致的时间线中断，不参与统计
+    };
+
+    bool isActive() const {return m_bActive;}
+    int sampleCount() const {return m_nCount;}
+    FrameTimingStats stats() const {return m_stats;}
+
+    bool exportCsv(const QString &filePath) const;          //导出原始序列为CSV
+    bool exportChromeTrace(const QString &filePath) const;  //导出为chrome://tracing可读的JSON
+
+public slots:
+    void start();       //开始记录（清空之前的样本）
+    void stop();        //停止记录，保留已有样本供导出
+    void setPlaybackRate(double rate);  //速率变化时重建理想时间线
+    void setExternalPresenting(bool bPresenting);   //其他组件（倒放）正向sink送帧期间不记录，结束后重建时间线
+
+signals:
+    void statsChanged(const FrameTimingStats &stats);
+
+private slots:
+    void onVideoFrameChanged(const QVideoFrame &frame);
+    void updateStats();
+
+private:
+    QVideoSink *m_sink;
+    QElapsedTimer m_clock;
+    QTimer *m_statsTimer;
+    bool m_bActive = false;
+    bool m_bExternalPresenting = false; //sink上的帧来自其他组件，不是主播放器的呈现时序
+
+    QVector<Sample> m_samples;  //环形缓冲
+    int m_nHead = 0;            //下一个写入位置
+    int m_nCount = 0;
+
+    double m_dRate = 1.0;
+    qint64 m_nInterval = 0;         //源帧间隔（微秒），0表示尚未估计
+    qint64 m_nLastPts = -1;
+    qint64 m_nLastArrival = -1;
+    qint64 m_nAnchorPts = -1;       //理想时间线的起点
+    qint64 m_nAnchorArrival = -1;
+    FrameTimingStats m_stats;
+
+    const Sample &sampleAt(int nIndex) const;  //按时间顺序取第nIndex个样本
+    void append(const Sample &sample);
+};
+
+#endif // FRAMETIMINGMONITOR_H
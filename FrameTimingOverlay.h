@@ -0,0 +1,96 @@
+/*
+ * 帧时序统计浮层 显示在视频区域左上角
+ * 视频组件可能使用原生窗口渲染，盖在上面的子控件不一定可见，所以用无边框的顶层窗口跟随目标控件
+ */
+
+#ifndef FRAMETIMINGOVERLAY_H
+#define FRAMETIMINGOVERLAY_H
+
+#include<QLabel>
+#include<QEvent>
+
+#include"FrameTimingMonitor.h"
+
+class FrameTimingOverlay:public QLabel
+{
+    Q_OBJECT
+public:
+    explicit FrameTimingOverlay(QWidget *target)
+        : QLabel(target,Qt::Tool|Qt::FramelessWindowHint|Qt::WindowStaysOnTopHint|Qt::WindowDoesNotAcceptFocus)
+        , m_target(target)
+    {
+        setAttribute(Qt::WA_TransparentForMouseEvents);
+        setAttribute(Qt::WA_ShowWithoutActivating);
+        setStyleSheet("QLabel{background:#202020;color:#7CFC00;font-family:monospace;padding:4px;}");
+        setWindowOpacity(0.8);
+        setStats(FrameTimingStats());
+
+        //目标控件和所在窗口移动、缩放时跟随
+        m_target->installEventFilter(this);
+        m_target->window()->installEventFilter(this);
+    }
+
+    void setStats(const FrameTimingStats &stats){
+        setText(QString("fps     %1\n"
+                        "抖动p50 %2 ms\n"
+                        "抖动p99 %3 ms\n"
+                        "丢帧    %4 /min\n"
+                        "迟到    %5 / %6")
+                .arg(stats.effectiveFps,0,'f',1)
+                .arg(stats.jitterP50,0,'f',2)
+                .arg(stats.jitterP99,0,'f',2)
+                .arg(stats.dropsPerMinute,0,'f',1)
+                .arg(stats.lateFrames)
+                .arg(stats.frames));
+        adjustSize();
+    }
+
+    //打开或关闭浮层（窗口最小化时会暂时隐藏）
+    void setOverlayEnabled(bool bEnabled){
+        m_bEnabled=bEnabled;
+        if(bEnabled)
+            attach();
+        else
+            hide();
+    }
+
+protected:
+    bool eventFilter(QObject *watched,QEvent *event) override{
+        switch(event->type())
+        {
+        case QEvent::Move:
+        case QEvent::Resize:
+            reposition();
+            break;
+        case QEvent::Hide:
+            hide();
+            break;
+        case QEvent::Show:
+        case QEvent::WindowStateChange:
+            if(m_bEnabled)
+                attach();
+            break;
+        default:
+            break;
+        }
+        return QLabel::eventFilter(watched,event);
+    }
+
+private:
+    QWidget *m_target;
+    bool m_bEnabled = false;    //用户是否打开了浮层
+
+    void reposition(){
+        move(m_target->mapToGlobal(QPoint(8,8)));
+    }
+
+    void attach(){
+        reposition();
+        if(m_target->isVisible() && !m_target->window()->isMinimized())
+            show();
+        else
+            hide();
+    }
+};
+
+#endif // FRAMETIMINGOVERLAY_H
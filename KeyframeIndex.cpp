@@ -0,0 +1,507 @@
+#include "KeyframeIndex.h"
+
+#include<QDir>
+#include<QFile>
+#include<QFileInfo>
+#include<QSaveFile>
+#include<QDataStream>
+#include<QDateTime>
+#include<QCryptographicHash>
+#include<QFutureWatcher>
+#include<QtConcurrent>
+#include<QtEndian>
+#include<algorithm>
+
+namespace {
+const quint32 kIndexMagic = 0x46534b46;     //"FSKF"
+const quint16 kIndexVersion = 1;
+const qint64 kMaxMoovBytes = 256LL*1024*1024;   //moov盒子大小上限，超出视为损坏
+
+constexpr quint32 fourcc(const char (&name)[5])
+{
+    return (quint32(uchar(name[0]))<<24)|(quint32(uchar(name[1]))<<16)|(quint32(uchar(name[2]))<<8)|quint32(uchar(name[3]));
+}
+
+//大端顺序读取盒子内容，越界后所有读取返回0并置失败标志
+class BoxReader
+{
+public:
+    BoxReader() = default;
+    BoxReader(const char *data,qint64 nSize):m_data(data),m_nSize(nSize){}
+
+    bool isValid() const {return m_data && m_bOk;}
+    qint64 remaining() const {return m_nSize-m_nPos;}
+    void skip(qint64 nBytes) {if(need(nBytes)) m_nPos+=nBytes;}
+    quint8 u8() {return need(1)?quint8(m_data[m_nPos++]):0;}
+    quint32 u32() {return read<quint32>();}
+    quint64 u64() {return read<quint64>();}
+
+    //取出下一个子盒子，body为其内容
+    bool nextBox(quint32 *type,BoxReader *body)
+    {
+        if(!m_bOk || remaining()<8)
+            return false;
+        qint64 nSize=u32();
+        *type=u32();
+        qint64 nHeader=8;
+        if(nSize==1)
+        {
+            nSize=qint64(u64());
+            nHeader=16;
+        }
+        else if(nSize==0)
+        {
+            nSize=nHeader+remaining();
+        }
+        if(!m_bOk || nSize<nHeader || nSize-nHeader>remaining())
+            return false;
+        *body=BoxReader(m_data+m_nPos,nSize-nHeader);
+        m_nPos+=nSize-nHeader;
+        return true;
+    }
+
+private:
+    const char *m_data = nullptr;
+    qint64 m_nSize = 0;
+    qint64 m_nPos = 0;
+    bool m_bOk = true;
+
+    bool need(qint64 nBytes)
+    {
+        if(!m_bOk || nBytes<0 || nBytes>remaining())
+            m_bOk=false;
+        return m_bOk;
+    }
+    template<typename T> T read()
+    {
+        if(!need(sizeof(T)))
+            return 0;
+        T value=qFromBigEndian<T>(m_data+m_nPos);
+        m_nPos+=sizeof(T);
+        return value;
+    }
+};
+
+//视频轨道解析关键帧所需的样本表
+struct TrackTables
+{
+    quint32 handler = 0;
+    quint32 timescale = 0;
+    qint64 editMediaTime = 0;       //编辑列表第一个有效片段的起点（轨道时间单位）
+    qint64 editEmptyDuration = 0;   //编辑列表开头的空片段（影片时间单位）
+    bool bCo64 = false;
+    BoxReader stss,stts,ctts,stsc,stsz,stco;
+};
+
+void parseSampleTable(BoxReader stbl,TrackTables *track)
+{
+    quint32 type;
+    BoxReader box;
+    while(stbl.nextBox(&type,&box))
+    {
+        if(type==fourcc("stss"))
+            track->stss=box;
+        else if(type==fourcc("stts"))
+            track->stts=box;
+        else if(type==fourcc("ctts"))
+            track->ctts=box;
+        else if(type==fourcc("stsc"))
+            track->stsc=box;
+        else if(type==fourcc("stsz"))
+            track->stsz=box;
+        else if(type==fourcc("stco") || type==fourcc("co64"))
+        {
+            track->stco=box;
+            track->bCo64=type==fourcc("co64");
+        }
+    }
+}
+
+void parseEditList(BoxReader edts,TrackTables *track)
+{
+    quint32 type;
+    BoxReader elst;
+    while(edts.nextBox(&type,&elst))
+    {
+        if(type!=fourcc("elst"))
+            continue;
+        quint8 nVersion=elst.u8();
+        elst.skip(3);
+        quint32 nCount=elst.u32();
+        for(quint32 i=0;i<nCount && elst.isValid();i++)
+        {
+            qint64 nSegment=nVersion==1?qint64(elst.u64()):qint64(elst.u32());
+            qint64 nMediaTime=nVersion==1?qint64(elst.u64()):qint64(qint32(elst.u32()));
+            elst.skip(4);   //播放速率
+            if(nMediaTime<0)
+            {
+                track->editEmptyDuration+=nSegment;
+                continue;
+            }
+            track->editMediaTime=nMediaTime;
+            break;
+        }
+    }
+}
+
+void parseTrack(BoxReader trak,TrackTables *track)
+{
+    quint32 type;
+    BoxReader box;
+    while(trak.nextBox(&type,&box))
+    {
+        if(type==fourcc("edts"))
+        {
+            parseEditList(box,track);
+        }
+        else if(type==fourcc("mdia"))
+        {
+            quint32 mediaType;
+            BoxReader media;
+            while(box.nextBox(&mediaType,&media))
+            {
+                if(mediaType==fourcc("mdhd"))
+                {
+                    quint8 nVersion=media.u8();
+                    media.skip(3+(nVersion==1?16:8));   //创建、修改时间
+                    track->timescale=media.u32();
+                }
+                else if(mediaType==fourcc("hdlr"))
+                {
+                    media.skip(8);
+                    track->handler=media.u32();
+                }
+                else if(mediaType==fourcc("minf"))
+                {
+                    quint32 infoType;
+                    BoxReader info;
+                    while(media.nextBox(&infoType,&info))
+                    {
+                        if(infoType==fourcc("stbl"))
+                            parseSampleTable(info,track);
+                    }
+                }
+            }
+        }
+    }
+}
+
+//按块顺序遍历全部样本，同时推进stts、ctts、stss，遇到同步样本就记下时间和偏移
+QVector<KeyframeIndex::Keyframe> collectKeyframes(TrackTables track,quint32 nMovieTimescale)
+{
+    QVector<KeyframeIndex::Keyframe> keyframes;
+    if(track.timescale==0 || !track.stts.isValid() || !track.stsc.isValid() || !track.stsz.isValid() || !track.stco.isValid())
+        return keyframes;
+
+    track.stsz.skip(4);
+    quint32 nUniformSize=track.stsz.u32();
+    quint32 nSampleCount=track.stsz.u32();
+    track.stco.skip(4);
+    quint32 nChunkCount=track.stco.u32();
+    track.stsc.skip(4);
+    quint32 nStscCount=track.stsc.u32();
+    track.stts.skip(4);
+    quint32 nSttsCount=track.stts.u32();
+
+    quint32 nCttsCount=0;
+    if(track.ctts.isValid())
+    {
+        track.ctts.skip(4);
+        nCttsCount=track.ctts.u32();
+    }
+    //没有stss表示每个样本都是同步样本
+    bool bAllSync=!track.stss.isValid();
+    quint32 nStssCount=0;
+    quint32 nNextSync=0;
+    if(!bAllSync)
+    {
+        track.stss.skip(4);
+        nStssCount=track.stss.u32();
+        if(nStssCount>0)
+        {
+            nNextSync=track.stss.u32();
+            nStssCount--;
+        }
+    }
+    if(!bAllSync)
+        keyframes.reserve(int(qMin<quint32>(nStssCount+1,1<<20)));
+
+    //stsc：当前条目和下一条目的起始块号（从1开始）
+    quint32 nSamplesPerChunk=0;
+    quint32 nNextStscChunk=0;
+    if(nStscCount>0)
+    {
+        track.stsc.u32();
+        nSamplesPerChunk=track.stsc.u32();
+        track.stsc.skip(4);
+        nStscCount--;
+        nNextStscChunk=nStscCount>0?track.stsc.u32():0;
+    }
+
+    quint32 nSttsLeft=0;
+    quint32 nDelta=0;
+    quint32 nCttsLeft=0;
+    qint64 nCompositionOffset=0;
+    qint64 nDts=0;
+    qint64 nEmptyUs=nMovieTimescale>0?track.editEmptyDuration*1000000/nMovieTimescale:0;
+    quint32 nSample=0;      //当前样本号（从1开始，进入循环后先加一）
+
+    for(quint32 nChunk=1;nChunk<=nChunkCount && nSample<nSampleCount;nChunk++)
+    {
+        if(nNextStscChunk>0 && nChunk>=nNextStscChunk)
+        {
+            nSamplesPerChunk=track.stsc.u32();
+            track.stsc.skip(4);
+            nStscCount--;
+            nNextStscChunk=nStscCount>0?track.stsc.u32():0;
+        }
+
+        qint64 nOffset=track.bCo64?qint64(track.stco.u64()):qint64(track.stco.u32());
+        for(quint32 i=0;i<nSamplesPerChunk && nSample<nSampleCount;i++)
+        {
+            nSample++;
+            if(nSttsLeft==0 && nSttsCount>0)
+            {
+                nSttsLeft=track.stts.u32();
+                nDelta=track.stts.u32();
+                nSttsCount--;
+            }
+            if(nCttsLeft==0 && nCttsCount>0)
+            {
+                nCttsLeft=track.ctts.u32();
+                nCompositionOffset=qint32(track.ctts.u32());    //版本0按规范无符号，实际文件常写负值
+                nCttsCount--;
+            }
+
+            if(bAllSync || nSample==nNextSync)
+            {
+                qint64 nPts=qMax<qint64>(0,nDts+nCompositionOffset-track.editMediaTime);
+                keyframes.append({nPts*1000000/track.timescale+nEmptyUs,nOffset});
+                if(!bAllSync)
+                {
+                    nNextSync=nStssCount>0?track.stss.u32():0;
+                    if(nStssCount>0)
+                        nStssCount--;
+                }
+            }
+
+            nOffset+=nUniformSize>0?nUniformSize:track.stsz.u32();
+            nDts+=nDelta;
+            if(nSttsLeft>0)
+                nSttsLeft--;
+            if(nCttsLeft>0)
+                nCttsLeft--;
+        }
+        if(!track.stco.isValid() || !track.stsz.isValid())
+            return {};  //表格损坏，宁可不要索引
+    }
+
+    std::sort(keyframes.begin(),keyframes.end(),[](const KeyframeIndex::Keyframe &a,const KeyframeIndex::Keyframe &b){
+        return a.timeUs<b.timeUs;
+    });
+    return keyframes;
+}
+}
+
+KeyframeIndex::KeyframeIndex(const QString &dirPath,QObject *parent)
+    : QObject(parent)
+    , m_strDir(dirPath)
+{
+    QDir().mkpath(m_strDir);
+}
+
+void KeyframeIndex::setFile(const QString &filePath)
+{
+    if(filePath==m_strFilePath)
+        return;
+    m_strFilePath=filePath;
+    m_keyframes.clear();
+    if(filePath.isEmpty())
+        return;
+
+    //stat、读索引和解析都在后台进行（网络盘上stat也可能很慢）；完成时已经换了文件就只保留磁盘上的结果
+    auto *watcher = new QFutureWatcher<QVector<Keyframe>>(this);
+    connect(watcher,&QFutureWatcher<QVector<Keyframe>>::finished,this,[this,watcher,filePath](){
+        watcher->deleteLater();
+        if(filePath!=m_strFilePath)
+            return;
+        m_keyframes=watcher->result();
+        if(isReady())
+            emit indexReady(m_keyframes.size());
+    });
+    watcher->setFuture(QtConcurrent::run([filePath,dirPath=m_strDir](){
+        QString identity=identityOf(filePath);
+        QString indexPath=indexPathOf(dirPath,identity);
+        QVector<Keyframe> keyframes;
+        if(readIndex(indexPath,identity,&keyframes))
+            return keyframes;
+        keyframes=scanFile(filePath);
+        writeIndex(indexPath,identity,keyframes);
+        return keyframes;
+    }));
+}
+
+qint64 KeyframeIndex::previousKeyframe(qint64 position) const
+{
+    int nIndex=indexAtOrBefore(position*1000);
+    if(nIndex<0)
+        return isReady()?0:position;
+    return m_keyframes.at(nIndex).timeUs/1000;
+}
+
+qint64 KeyframeIndex::nextKeyframe(qint64 position) const
+{
+    if(!isReady())
+        return position;
+    int nIndex=indexAtOrBefore(position*1000);
+    if(nIndex>=0 && m_keyframes.at(nIndex).timeUs/1000==position)
+        return position;
+    return nIndex+1<m_keyframes.size()?m_keyframes.at(nIndex+1).timeUs/1000:-1;
+}
+
+qint64 KeyframeIndex::nearestKeyframe(qint64 position) const
+{
+    if(!isReady())
+        return position;
+    qint64 nBefore=previousKeyframe(position);
+    qint64 nAfter=nextKeyframe(position);
+    if(nAfter<0 || position-nBefore<=nAfter-position)
+        return nBefore;
+    return nAfter;
+}
+
+qint64 KeyframeIndex::decodeSpan(qint64 position) const
+{
+    if(!isReady())
+        return -1;
+    return position-previousKeyframe(position);
+}
+
+int KeyframeIndex::indexAtOrBefore(qint64 timeUs) const
+{
+    auto it=std::upper_bound(m_keyframes.cbegin(),m_keyframes.cend(),timeUs,[](qint64 value,const Keyframe &keyframe){
+        return value<keyframe.timeUs;
+    });
+    return int(it-m_keyframes.cbegin())-1;
+}
+
+QVector<KeyframeIndex::Keyframe> KeyframeIndex::scanFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if(!file.open(QIODevice::ReadOnly))
+        return {};
+
+    //顶层盒子逐个跳过，只把moov读进内存（mdat通常很大，可能在moov之前）
+    QByteArray moov;
+    qint64 nPos=0;
+    while(nPos+8<=file.size())
+    {
+        file.seek(nPos);
+        QByteArray header=file.read(16);
+        if(header.size()<8)
+            break;
+        qint64 nSize=qFromBigEndian<quint32>(header.constData());
+        quint32 nType=qFromBigEndian<quint32>(header.constData()+4);
+        qint64 nHeader=8;
+        if(nSize==1 && header.size()==16)
+        {
+            nSize=qint64(qFromBigEndian<quint64>(header.constData()+8));
+            nHeader=16;
+        }
+        else if(nSize==0)
+        {
+            nSize=file.size()-nPos;
+        }
+        if(nSize<nHeader)
+            break;
+        if(nType==fourcc("moov"))
+        {
+            if(nSize-nHeader>kMaxMoovBytes)
+                return {};
+            file.seek(nPos+nHeader);
+            moov=file.read(nSize-nHeader);
+            break;
+        }
+        nPos+=nSize;
+    }
+    if(moov.isEmpty())
+        return {};
+
+    BoxReader reader(moov.constData(),moov.size());
+    quint32 nMovieTimescale=0;
+    quint32 type;
+    BoxReader box;
+    while(reader.nextBox(&type,&box))
+    {
+        if(type==fourcc("mvhd"))
+        {
+            quint8 nVersion=box.u8();
+            box.skip(3+(nVersion==1?16:8));
+            nMovieTimescale=box.u32();
+        }
+        else if(type==fourcc("trak"))
+        {
+            //取第一条视频轨道（mvhd在trak之前，可以直接使用影片时间单位）
+            TrackTables track;
+            parseTrack(box,&track);
+            if(track.handler==fourcc("vide"))
+                return collectKeyframes(track,nMovieTimescale);
+        }
+    }
+    return {};
+}
+
+QString KeyframeIndex::identityOf(const QString &filePath)
+{
+    QFileInfo info(filePath);
+    return QString("%1|%2|%3").arg(info.absoluteFilePath()).arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+QString KeyframeIndex::indexPathOf(const QString &dirPath,const QString &identity)
+{
+    return QDir(dirPath).filePath(QCryptographicHash::hash(identity.toUtf8(),QCryptographicHash::Sha1).toHex()+".kfi");
+}
+
+bool KeyframeIndex::readIndex(const QString &indexPath,const QString &identity,QVector<Keyframe> *keyframes)
+{
+    QFile file(indexPath);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 nMagic;
+    quint16 nVersion;
+    QString storedIdentity;
+    quint32 nCount;
+    in>>nMagic>>nVersion>>storedIdentity>>nCount;
+    if(in.status()!=QDataStream::Ok || nMagic!=kIndexMagic || nVersion>kIndexVersion || storedIdentity!=identity)
+        return false;
+
+    //条目数取自磁盘，损坏或截断的文件可能给出极大的值，必须与剩余字节数一致
+    if(nCount>(file.size()-file.pos())/qint64(2*sizeof(qint64)))
+        return false;
+    keyframes->resize(nCount);
+    for(Keyframe &keyframe:*keyframes)
+        in>>keyframe.timeUs>>keyframe.offset;
+    if(in.status()!=QDataStream::Ok)
+    {
+        keyframes->clear();
+        return false;
+    }
+    return true;
+}
+
+void KeyframeIndex::writeIndex(const QString &indexPath,const QString &identity,const QVector<Keyframe> &keyframes)
+{
+    QSaveFile file(indexPath);
+    if(!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out<<kIndexMagic<<kIndexVersion<<identity<<quint32(keyframes.size());
+    for(const Keyframe &keyframe:keyframes)
+        out<<keyframe.timeUs<<keyframe.offset;
+    file.commit();
+}
@@ -0,0 +1,53 @@
+/*
+ * 关键帧索引 每个文件在后台解析一次容器的样本表，记录关键帧的显示时间和字节偏移
+ * 结果按文件身份（路径+大小+修改时间）存成紧凑的索引文件，再次打开时直接读取
+ * 用于把定位对齐到关键帧、预估精确定位需要解码的时长，以及在进度条上标出关键帧
+ * 目前支持MP4/MOV（非分片）；其他格式写入空索引，不再重复解析
+ */
+
+#ifndef KEYFRAMEINDEX_H
+#define KEYFRAMEINDEX_H
+
+#include<QObject>
+#include<QVector>
+
+class KeyframeIndex : public QObject
+{
+    Q_OBJECT
+public:
+    struct Keyframe
+    {
+        qint64 timeUs = 0;      //显示时间（微秒）
+        qint64 offset = 0;      //样本在文件中的字节偏移
+    };
+
+    explicit KeyframeIndex(const QString &dirPath,QObject *parent=nullptr);
+
+    void setFile(const QString &filePath);  //切换当前文件，空路径表示清空；索引在后台读取或解析，就绪时发出indexReady
+    bool isReady() const {return !m_keyframes.isEmpty();}
+    const QVector<Keyframe> &keyframes() const {return m_keyframes;}
+
+    //以下位置均为毫秒；索引未就绪时原样返回position，decodeSpan返回-1
+    qint64 previousKeyframe(qint64 position) const; //不晚于position的最后一个关键帧
+    qint64 nextKeyframe(qint64 position) const;     //不早于position的第一个关键帧，没有时返回-1
+    qint64 nearestKeyframe(qint64 position) const;
+    qint64 decodeSpan(qint64 position) const;       //精确定位到position要从前一关键帧解码的时长
+
+    static QVector<Keyframe> scanFile(const QString &filePath);     //解析MP4/MOV样本表
+
+signals:
+    void indexReady(int nKeyframes);    //当前文件的索引可用（从磁盘读取或解析完成）
+
+private:
+    QString m_strDir;
+    QString m_strFilePath;
+    QVector<Keyframe> m_keyframes;      //按时间升序
+
+    int indexAtOrBefore(qint64 timeUs) const;
+    static QString identityOf(const QString &filePath);
+    static QString indexPathOf(const QString &dirPath,const QString &identity);
+    static bool readIndex(const QString &indexPath,const QString &identity,QVector<Keyframe> *keyframes);
+    static void writeIndex(const QString &indexPath,const QString &identity,const QVector<Keyframe> &keyframes);
+};
+
+#endif // KEYFRAMEINDEX_H
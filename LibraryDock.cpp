@@ -0,0 +1,76 @@
+#include "LibraryDock.h"
+
+#include<QVBoxLayout>
+#include<QHeaderView>
+
+LibraryDock::LibraryDock(MediaLibrary *library,QWidget *parent)
+    : QDockWidget("媒体库",parent)
+    , m_library(library)
+{
+    setObjectName("LibraryDock");
+
+    m_model = new PlaylistModel(this);
+    m_proxy = new PlaylistProxyModel(m_model,this);
+
+    QWidget *panel = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(panel);
+    layout->setContentsMargins(0,0,0,0);
+    layout->setSpacing(2);
+
+    m_filterEdit = new QLineEdit(panel);
+    m_filterEdit->setPlaceholderText("筛选文件名");
+    m_filterEdit->setClearButtonEnabled(true);
+    connect(m_filterEdit,&QLineEdit::textChanged,m_proxy,&PlaylistProxyModel::setFilterText);
+
+    m_view = new QTreeView(panel);
+    m_view->setModel(m_proxy);
+    m_view->setUniformRowHeights(true);     //几十万条也只为可见行计算布局
+    m_view->setRootIsDecorated(false);
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_view->header()->setSortIndicator(-1,Qt::AscendingOrder);
+    m_view->header()->setSortIndicatorClearable(true);
+    m_view->setSortingEnabled(true);
+    //媒体库条目不做元数据探测，只显示文件名
+    for(int column=PlaylistModel::DurationColumn;column<PlaylistModel::ColumnCount;column++)
+        m_view->header()->hideSection(column);
+    connect(m_view,&QTreeView::activated,this,[this](const QModelIndex &index){
+        emit fileActivated(index.data(PlaylistModel::FilePathRole).toString());
+    });
+
+    m_statusLabel = new QLabel(panel);
+
+    layout->addWidget(m_filterEdit);
+    layout->addWidget(m_view);
+    layout->addWidget(m_statusLabel);
+    setWidget(panel);
+
+    connect(m_library,&MediaLibrary::filesAdded,m_model,&PlaylistModel::appendPaths);
+    connect(m_library,&MediaLibrary::filesRemoved,this,&LibraryDock::removeFiles);
+    connect(m_library,&MediaLibrary::scanProgress,this,&LibraryDock::updateStatus);
+    connect(m_library,&MediaLibrary::scanFinished,this,&LibraryDock::updateStatus);
+    updateStatus();
+}
+
+void LibraryDock::removeFiles(const QStringList &filePaths)
+{
+    QList<int> rows;
+    rows.reserve(filePaths.size());
+    for(const QString &filePath:filePaths)
+    {
+        int nRow=m_model->rowOf(filePath);
+        if(nRow>=0)
+            rows.append(nRow);
+    }
+    m_model->removeRowList(rows);
+    updateStatus();
+}
+
+void LibraryDock::updateStatus()
+{
+    if(m_library->roots().isEmpty())
+        m_statusLabel->setText("未添加监视目录（文件→媒体库→添加目录）");
+    else if(m_library->isScanning())
+        m_statusLabel->setText(QString("%1个文件，正在扫描…").arg(m_library->fileCount()));
+    else
+        m_statusLabel->setText(QString("%1个文件，%2个目录").arg(m_library->fileCount()).arg(m_library->roots().size()));
+}
@@ -0,0 +1,40 @@
+/*
+ * 媒体库停靠窗口 列出媒体库索引中的文件，可按文件名筛选和排序
+ * 条目增删只应用媒体库发出的差异，不重新加载整个列表
+ */
+
+#ifndef LIBRARYDOCK_H
+#define LIBRARYDOCK_H
+
+#include<QDockWidget>
+#include<QTreeView>
+#include<QLineEdit>
+#include<QLabel>
+
+#include"MediaLibrary.h"
+#include"PlaylistModel.h"
+#include"PlaylistProxyModel.h"
+
+class LibraryDock : public QDockWidget
+{
+    Q_OBJECT
+public:
+    explicit LibraryDock(MediaLibrary *library,QWidget *parent=nullptr);
+
+signals:
+    void fileActivated(const QString &filePath);    //双击或回车选中文件
+
+private slots:
+    void removeFiles(const QStringList &filePaths);
+    void updateStatus();
+
+private:
+    MediaLibrary *m_library;
+    PlaylistModel *m_model;         //与播放列表共用模型，只显示文件名列
+    PlaylistProxyModel *m_proxy;
+    QLineEdit *m_filterEdit;
+    QTreeView *m_view;
+    QLabel *m_statusLabel;          //条目数和扫描进度
+};
+
+#endif // LIBRARYDOCK_H
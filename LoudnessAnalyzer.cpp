@@ -0,0 +1,455 @@
+#include "LoudnessAnalyzer.h"
+
+#include<QAudioDecoder>
+#include<QAudioBuffer>
+#include<QAudioFormat>
+#include<QFileInfo>
+#include<QDateTime>
+#include<QTimer>
+#include<QUrl>
+#include<QtMath>
+#include<QFutureWatcher>
+#include<QtConcurrent>
+
+namespace {
+const int kSubBlocksPerBlock = 4;       //400ms测量块由4个100ms子块组成，相邻块重叠75%
+const double kAbsoluteGate = -70.0;     //绝对门限（LUFS）
+const double kRelativeGate = -10.0;     //相对门限（LU）
+
+double loudnessOf(double energy)
+{
+    return -0.691+10*std::log10(energy);
+}
+
+double energyOf(double loudness)
+{
+    return std::pow(10.0,(loudness+0.691)/10);
+}
+
+//二阶IIR滤波器（直接II型转置）
+struct Biquad
+{
+    double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    double z1 = 0, z2 = 0;
+
+    double process(double x)
+    {
+        double y=b0*x+z1;
+        z1=b1*x-a1*y+z2;
+        z2=b2*x-a2*y;
+        return y;
+    }
+};
+
+//BS.1770的K加权：高频搁架滤波加高通滤波，按采样率由模拟原型换算系数
+void kWeighting(int nRate,Biquad *shelf,Biquad *highPass)
+{
+    double f0=1681.974450955533;
+    double gain=3.999843853973347;
+    double q=0.7071752369554196;
+    double k=std::tan(M_PI*f0/nRate);
+    double vh=std::pow(10.0,gain/20);
+    double vb=std::pow(vh,0.4996667741545416);
+    double a0=1+k/q+k*k;
+    *shelf=Biquad();
+    shelf->b0=(vh+vb*k/q+k*k)/a0;
+    shelf->b1=2*(k*k-vh)/a0;
+    shelf->b2=(vh-vb*k/q+k*k)/a0;
+    shelf->a1=2*(k*k-1)/a0;
+    shelf->a2=(1-k/q+k*k)/a0;
+
+    f0=38.13547087602444;
+    q=0.5003270373238773;
+    k=std::tan(M_PI*f0/nRate);
+    a0=1+k/q+k*k;
+    *highPass=Biquad();
+    highPass->b0=1;
+    highPass->b1=-2;
+    highPass->b2=1;
+    highPass->a1=2*(k*k-1)/a0;
+    highPass->a2=(1-k/q+k*k)/a0;
+}
+
+//声道权重：LFE不计入，环绕声道加权1.41；后端没给出声道布局时按5.1的常见顺序（第4声道为LFE）
+QVector<double> channelWeights(const QAudioFormat &format)
+{
+    int nChannels=format.channelCount();
+    QVector<double> weights(nChannels,1.0);
+    if(format.channelConfig()==QAudioFormat::ChannelConfigUnknown)
+    {
+        for(int channel=3;nChannels>=6 && channel<nChannels;channel++)
+            weights[channel]=channel==3?0:1.41;
+        return weights;
+    }
+
+    auto setWeight=[&](QAudioFormat::AudioChannelPosition position,double weight){
+        int nOffset=format.channelOffset(position);
+        if(nOffset>=0 && nOffset<nChannels)
+            weights[nOffset]=weight;
+    };
+    setWeight(QAudioFormat::LFE,0);
+    setWeight(QAudioFormat::LFE2,0);
+    for(QAudioFormat::AudioChannelPosition position:{QAudioFormat::BackLeft,QAudioFormat::BackRight,
+                                                     QAudioFormat::SideLeft,QAudioFormat::SideRight})
+        setWeight(position,1.41);
+    return weights;
+}
+}
+
+//工作线程中的测量端：解码一个文件，逐样本K加权并累计100ms子块能量，结束时做门限计算
+class LoudnessWorker : public QObject
+{
+public:
+    LoudnessWorker(LoudnessAnalyzer *analyzer,int nSlot)
+        : m_analyzer(analyzer)
+        , m_nSlot(nSlot)
+    {
+    }
+
+    void start(int nGeneration,const QString &filePath)
+    {
+        stop();
+        m_nGeneration=nGeneration;
+
+        //stat和查缓存也在工作线程进行：文件已不存在或缓存命中时直接跳过
+        QFileInfo fileInfo(filePath);
+        m_job=LoudnessAnalyzer::Job{filePath,fileInfo.size(),fileInfo.lastModified().toMSecsSinceEpoch()};
+        LoudnessInfo loudness;
+        if(!fileInfo.exists() || m_analyzer->m_cache->lookupLoudness(filePath,m_job.size,m_job.modified,&loudness))
+        {
+            report(loudness,LoudnessAnalyzer::Skipped);
+            return;
+        }
+
+        m_nRate=0;
+        m_nChannels=0;
+        m_subBlocks.clear();
+        m_dSubSum=0;
+        m_nSubFrames=0;
+        m_dPeak=0;
+
+        //按源文件的声道数和采样率输出，不指定格式：下混会让5.1的声道加权失效，单声道上混为立体声会偏响3LU
+        //非浮点样本在process中自行转换
+        m_decoder=new QAudioDecoder(this);
+        m_decoder->setSource(QUrl::fromLocalFile(filePath));
+        connect(m_decoder,&QAudioDecoder::bufferReady,this,[this](){
+            while(m_decoder && m_decoder->bufferAvailable())
+                process(m_decoder->read());
+        });
+        connect(m_decoder,&QAudioDecoder::finished,this,[this](){finish(true);});
+        connect(m_decoder,qOverload<QAudioDecoder::Error>(&QAudioDecoder::error),this,[this](QAudioDecoder::Error error){
+            //平台不支持解码时结果不可信，不写缓存，下次启动再试
+            finish(false,error!=QAudioDecoder::NotSupportedError);
+        });
+        m_decoder->start();
+    }
+
+    void stop()
+    {
+        if(!m_decoder)
+            return;
+        disconnect(m_decoder,nullptr,this,nullptr);
+        m_decoder->stop();
+        m_decoder->deleteLater();
+        m_decoder=nullptr;
+    }
+
+private:
+    LoudnessAnalyzer *m_analyzer;
+    int m_nSlot;
+    QAudioDecoder *m_decoder = nullptr;
+    int m_nGeneration = 0;
+    LoudnessAnalyzer::Job m_job;    //正在分析的文件（大小和修改时间在本线程stat得到）
+    int m_nRate = 0;                //当前滤波器对应的采样率和声道数
+    int m_nChannels = 0;
+    QVector<Biquad> m_shelves;      //每声道一组K加权滤波器
+    QVector<Biquad> m_highPasses;
+    QVector<double> m_weights;
+    QVector<double> m_subBlocks;    //每个100ms子块的加权均方和
+    double m_dSubSum = 0;           //当前子块的累计
+    int m_nSubFrames = 0;
+    double m_dPeak = 0;             //采样绝对值的最大值
+    QVector<float> m_scratch;       //格式转换用的交错样本
+
+    void process(const QAudioBuffer &buffer)
+    {
+        QAudioFormat format=buffer.format();
+        int nFrames=buffer.frameCount();
+        int nRate=format.sampleRate();
+        int nChannels=format.channelCount();
+        if(!buffer.isValid() || nFrames<=0 || nRate<=0 || nChannels<=0)
+            return;
+
+        //格式中途变化时重建滤波器，已累计的子块保留
+        if(nRate!=m_nRate || nChannels!=m_nChannels)
+        {
+            m_nRate=nRate;
+            m_nChannels=nChannels;
+            m_shelves.resize(nChannels);
+            m_highPasses.resize(nChannels);
+            for(int channel=0;channel<nChannels;channel++)
+                kWeighting(nRate,&m_shelves[channel],&m_highPasses[channel]);
+            m_weights=channelWeights(format);
+            m_dSubSum=0;
+            m_nSubFrames=0;
+        }
+
+        const float *samples=nullptr;
+        if(format.sampleFormat()==QAudioFormat::Float)
+        {
+            samples=buffer.constData<float>();
+        }
+        else
+        {
+            m_scratch.resize(nFrames*nChannels);
+            const char *data=buffer.constData<char>();
+            int nBytesPerSample=format.bytesPerSample();
+            for(int i=0;i<nFrames*nChannels;i++)
+                m_scratch[i]=format.normalizedSampleValue(data+i*nBytesPerSample);
+            samples=m_scratch.constData();
+        }
+
+        int nSubLength=qMax(1,nRate/10);
+        for(int frame=0;frame<nFrames;frame++)
+        {
+            const float *sample=samples+frame*nChannels;
+            double frameSum=0;
+            for(int channel=0;channel<nChannels;channel++)
+            {
+                m_dPeak=qMax(m_dPeak,double(std::fabs(sample[channel])));
+                double y=m_highPasses[channel].process(m_shelves[channel].process(sample[channel]));
+                frameSum+=m_weights.at(channel)*y*y;
+            }
+            m_dSubSum+=frameSum;
+            if(++m_nSubFrames==nSubLength)
+            {
+                m_subBlocks.append(m_dSubSum/nSubLength);
+                m_dSubSum=0;
+                m_nSubFrames=0;
+            }
+        }
+    }
+
+    LoudnessInfo measure() const
+    {
+        LoudnessInfo loudness;
+        if(m_subBlocks.size()<kSubBlocksPerBlock || m_dPeak<=0)
+            return loudness;
+
+        //400ms块的能量为连续4个子块的平均，先按绝对门限筛选
+        QVector<double> blocks;
+        blocks.reserve(m_subBlocks.size());
+        double window=0;
+        for(int i=0;i<m_subBlocks.size();i++)
+        {
+            window+=m_subBlocks.at(i);
+            if(i>=kSubBlocksPerBlock)
+                window-=m_subBlocks.at(i-kSubBlocksPerBlock);
+            if(i>=kSubBlocksPerBlock-1)
+            {
+                double energy=qMax(0.0,window/kSubBlocksPerBlock);
+                if(energy>energyOf(kAbsoluteGate))
+                    blocks.append(energy);
+            }
+        }
+        if(blocks.isEmpty())
+            return loudness;
+
+        //相对门限为绝对门限内的平均响度减10LU
+        double sum=0;
+        for(double energy:blocks)
+            sum+=energy;
+        double relativeGate=energyOf(loudnessOf(sum/blocks.size())+kRelativeGate);
+        sum=0;
+        int nGated=0;
+        for(double energy:blocks)
+        {
+            if(energy>relativeGate)
+            {
+                sum+=energy;
+                nGated++;
+            }
+        }
+        if(nGated==0)
+            return loudness;
+
+        loudness.integrated=loudnessOf(sum/nGated);
+        loudness.peak=20*std::log10(m_dPeak);
+        loudness.valid=true;
+        return loudness;
+    }
+
+    void finish(bool bComplete,bool bStore=true)
+    {
+        stop();
+        LoudnessInfo loudness;
+        if(bComplete)
+            loudness=measure();
+        report(loudness,bStore?LoudnessAnalyzer::Measured:LoudnessAnalyzer::Unreliable);
+    }
+
+    void report(const LoudnessInfo &loudness,LoudnessAnalyzer::JobResult result)
+    {
+        LoudnessAnalyzer *analyzer=m_analyzer;
+        int nSlot=m_nSlot;
+        int nGeneration=m_nGeneration;
+        LoudnessAnalyzer::Job job=m_job;
+        QMetaObject::invokeMethod(analyzer,[analyzer,nSlot,nGeneration,job,loudness,result](){
+            analyzer->finishJob(nSlot,nGeneration,job,loudness,result);
+        },Qt::QueuedConnection);
+    }
+};
+
+LoudnessAnalyzer::LoudnessAnalyzer(MetadataCache *cache,QObject *parent,int nWorkers)
+    : QObject(parent)
+    , m_cache(cache)
+{
+    //留一个核给界面和播放
+    if(nWorkers<=0)
+        nWorkers=qMax(1,QThread::idealThreadCount()-1);
+
+    m_slots.resize(nWorkers);
+    for(int i=0;i<nWorkers;i++)
+    {
+        Slot &slot=m_slots[i];
+        slot.thread=new QThread(this);
+        slot.worker=new LoudnessWorker(this,i);
+        slot.worker->moveToThread(slot.thread);
+        connect(slot.thread,&QThread::finished,slot.worker,&QObject::deleteLater);
+        slot.thread->start(QThread::LowPriority);
+    }
+}
+
+LoudnessAnalyzer::~LoudnessAnalyzer()
+{
+    m_lookupPool.waitForDone();
+    for(Slot &slot:m_slots)
+    {
+        LoudnessWorker *worker=slot.worker;
+        QMetaObject::invokeMethod(worker,[worker](){worker->stop();},Qt::QueuedConnection);
+        slot.thread->quit();
+    }
+    for(Slot &slot:m_slots)
+        slot.thread->wait();
+}
+
+void LoudnessAnalyzer::enqueue(const QStringList &filePaths)
+{
+    for(const QString &filePath:filePaths)
+    {
+        if(m_queued.contains(filePath))
+            continue;
+        m_queued.insert(filePath);
+        m_pending.append(filePath);
+    }
+    schedulePump();
+}
+
+void LoudnessAnalyzer::prioritize(const QStringList &filePaths)
+{
+    //倒序插到队首，保持给定的先后顺序；已在工作线程中的不动
+    for(int i=filePaths.size()-1;i>=0;i--)
+    {
+        const QString &filePath=filePaths.at(i);
+        if(m_queued.contains(filePath) && !m_pending.removeOne(filePath))
+            continue;
+        m_queued.insert(filePath);
+        m_pending.prepend(filePath);
+    }
+    schedulePump();
+}
+
+void LoudnessAnalyzer::clear()
+{
+    m_pending.clear();
+    m_queued.clear();
+    for(Slot &slot:m_slots)
+    {
+        if(slot.job.filePath.isEmpty())
+            continue;
+        slot.job=Job();
+        slot.generation++;
+        LoudnessWorker *worker=slot.worker;
+        QMetaObject::invokeMethod(worker,[worker](){worker->stop();},Qt::QueuedConnection);
+    }
+}
+
+void LoudnessAnalyzer::lookup(const QString &filePath)
+{
+    //stat和查缓存放到线程池，GUI线程不碰磁盘
+    auto *watcher = new QFutureWatcher<LoudnessInfo>(this);
+    connect(watcher,&QFutureWatcher<LoudnessInfo>::finished,this,[this,watcher,filePath](){
+        watcher->deleteLater();
+        emit lookedUp(filePath,watcher->result());
+    });
+    watcher->setFuture(QtConcurrent::run(&m_lookupPool,[cache=m_cache,filePath](){
+        LoudnessInfo loudness;
+        QFileInfo fileInfo(filePath);
+        if(!fileInfo.exists() || !cache->lookupLoudness(filePath,fileInfo.size(),fileInfo.lastModified().toMSecsSinceEpoch(),&loudness))
+            loudness.valid=false;
+        return loudness;
+    }));
+}
+
+double LoudnessAnalyzer::gainFor(const LoudnessInfo &loudness)
+{
+    if(!loudness.valid)
+        return 1;
+
+    //提升时不让峰值超过上限，衰减不受峰值限制
+    double gainDb=kTargetLufs-loudness.integrated;
+    if(gainDb>0)
+        gainDb=qMin(gainDb,qMax(0.0,kPeakCeilingDb-loudness.peak));
+    gainDb=qBound(-20.0,gainDb,kHeadroomDb);
+    return std::pow(10.0,gainDb/20);
+}
+
+double LoudnessAnalyzer::referenceLevel()
+{
+    return std::pow(10.0,-kHeadroomDb/20);
+}
+
+void LoudnessAnalyzer::schedulePump()
+{
+    if(m_bPumpScheduled)
+        return;
+    m_bPumpScheduled=true;
+    QTimer::singleShot(0,this,[this](){
+        m_bPumpScheduled=false;
+        pump();
+    });
+}
+
+void LoudnessAnalyzer::pump()
+{
+    //按队列顺序交给空闲工作线程，stat和查缓存由工作线程完成，命中的很快回来接下一个
+    for(int i=0;i<m_slots.size() && !m_pending.isEmpty();i++)
+    {
+        Slot &slot=m_slots[i];
+        if(!slot.job.filePath.isEmpty())
+            continue;
+
+        QString filePath=m_pending.takeFirst();
+        slot.job.filePath=filePath;
+        LoudnessWorker *worker=slot.worker;
+        int nGeneration=slot.generation;
+        QMetaObject::invokeMethod(worker,[worker,nGeneration,filePath](){
+            worker->start(nGeneration,filePath);
+        },Qt::QueuedConnection);
+    }
+}
+
+void LoudnessAnalyzer::finishJob(int nSlot,int nGeneration,const Job &job,const LoudnessInfo &loudness,JobResult result)
+{
+    Slot &slot=m_slots[nSlot];
+    if(nGeneration!=slot.generation || slot.job.filePath.isEmpty())
+        return;
+
+    slot.job=Job();
+    m_queued.remove(job.filePath);
+    if(result==Measured)
+        m_cache->insertLoudness(job.filePath,job.size,job.modified,loudness);
+    if(result!=Skipped || loudness.valid)
+        emit analyzed(job.filePath,loudness);
+    schedulePump();
+}
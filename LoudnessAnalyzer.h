@@ -0,0 +1,80 @@
+/*
+ * 响度分析器 按EBU R128测量播放列表条目的积分响度和采样峰值，结果写入元数据缓存
+ * 每个工作线程带一个QAudioDecoder，多个文件同时分析；K加权滤波和门限计算都在工作线程完成
+ * 队列可以插队：即将播放的条目优先分析；缓存命中（大小和修改时间一致）的条目不再解码
+ * stat和查缓存都在工作线程或线程池中进行；按源文件的声道数解码，不下混
+ */
+
+#ifndef LOUDNESSANALYZER_H
+#define LOUDNESSANALYZER_H
+
+#include<QObject>
+#include<QList>
+#include<QSet>
+#include<QVector>
+#include<QThread>
+#include<QThreadPool>
+
+#include"MetadataCache.h"
+
+class LoudnessWorker;
+
+class LoudnessAnalyzer : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr double kTargetLufs = -18.0;    //均衡目标响度
+    static constexpr double kPeakCeilingDb = -1.0;  //提升音量时峰值不超过此电平
+    static constexpr double kHeadroomDb = 6.0;      //均衡时满音量对应的参考电平低于满幅的量，也是提升的上限
+
+    explicit LoudnessAnalyzer(MetadataCache *cache,QObject *parent=nullptr,int nWorkers=0);
+    ~LoudnessAnalyzer();
+
+    void enqueue(const QStringList &filePaths);     //加入分析队列（已在队列中的忽略）
+    void prioritize(const QStringList &filePaths);  //按给定顺序移到队首，不在队列中的加入
+    void clear();                                   //清空队列并放弃正在进行的分析
+    int pendingCount() const {return m_queued.size();}
+
+    void lookup(const QString &filePath);   //在线程池中查缓存（核对大小和修改时间），完成时发出lookedUp
+    static double gainFor(const LoudnessInfo &loudness);    //达到目标响度所需的线性增益，无效结果为1
+    static double referenceLevel();         //均衡时满音量对应的线性电平，留出kHeadroomDb的提升余量
+
+signals:
+    void analyzed(const QString &filePath,const LoudnessInfo &loudness);   //后台分析完成
+    void lookedUp(const QString &filePath,const LoudnessInfo &loudness);   //查缓存完成，未命中时loudness无效
+
+private:
+    friend class LoudnessWorker;
+
+    enum JobResult{
+        Skipped,        //文件已不存在或缓存命中，未解码
+        Measured,       //解码完成，结果写入缓存
+        Unreliable      //平台不支持解码，只通知不写缓存
+    };
+    struct Job
+    {
+        QString filePath;
+        qint64 size = 0;
+        qint64 modified = 0;    //修改时间（毫秒）
+    };
+    struct Slot     //一个工作线程
+    {
+        QThread *thread;
+        LoudnessWorker *worker;
+        Job job;                //正在分析的文件，路径为空表示空闲
+        int generation = 0;     //放弃分析时加一，丢弃迟到的结果
+    };
+
+    MetadataCache *m_cache;
+    QVector<Slot> m_slots;
+    QList<QString> m_pending;       //待分析的路径（队首优先）
+    QSet<QString> m_queued;         //队列和工作线程中的路径，用于去重
+    bool m_bPumpScheduled = false;
+    QThreadPool m_lookupPool;       //lookup用，析构时等它结束
+
+    void schedulePump();
+    void pump();                    //把队首的路径交给空闲工作线程
+    void finishJob(int nSlot,int nGeneration,const Job &job,const LoudnessInfo &loudness,JobResult result);
+};
+
+#endif // LOUDNESSANALYZER_H
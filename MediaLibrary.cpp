@@ -0,0 +1,449 @@
+#include "MediaLibrary.h"
+
+#include<QFile>
+#include<QFileInfo>
+#include<QDir>
+#include<QDirIterator>
+#include<QSaveFile>
+#include<QDataStream>
+#include<QtConcurrent>
+
+namespace {
+const quint32 kLibraryMagic = 0x46534c42;   //"FSLB"
+const quint16 kLibraryVersion = 1;
+const int kBatchDirs = 32;                  //每批交给工作线程的目录数
+const int kReconcileIntervalMs = 5*60*1000; //定期核对间隔
+const int kStartupDelayMs = 3000;           //启动后延迟核对，不和界面初始化抢磁盘
+const int kDeepVerifyPasses = 12;           //每轮强制重列1/12的目录，约一小时覆盖一遍
+const int kMaxWatches = 4096;               //目录监视数量上限
+const int kSaveDelayMs = 3000;              //合并写入延迟
+const qint64 kMinDirBytes = 4+8+4+4;        //一条目录记录最少占用的字节数（空路径、修改时间、空子目录表、文件数）
+const qint64 kMinFileBytes = 4+2*8;         //一条文件记录最少占用的字节数（空文件名加大小和修改时间）
+
+QString joinPath(const QString &dirPath,const QString &fileName)
+{
+    return dirPath.endsWith('/')?dirPath+fileName:dirPath+'/'+fileName;
+}
+}
+
+MediaLibrary::MediaLibrary(const QString &indexPath,QObject *parent)
+    : QObject(parent)
+    , m_strIndexPath(indexPath)
+{
+    m_batchWatcher = new QFutureWatcher<QVector<DirResult>>(this);
+    connect(m_batchWatcher,&QFutureWatcher<QVector<DirResult>>::finished,this,[this](){
+        QVector<DirResult> results=m_batchWatcher->result();
+        m_inFlight.clear();
+        applyResults(results);
+    });
+
+    //目录内容变化时立即核对该目录
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher,&QFileSystemWatcher::directoryChanged,this,[this](const QString &dirPath){
+        enqueue(dirPath,true,true);
+        startNextBatch();
+    });
+
+    m_reconcileTimer = new QTimer(this);
+    m_reconcileTimer->setInterval(kReconcileIntervalMs);
+    connect(m_reconcileTimer,&QTimer::timeout,this,&MediaLibrary::rescan);
+
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(kSaveDelayMs);
+    connect(m_saveTimer,&QTimer::timeout,this,[this](){
+        if(!m_bDirty)
+            return;
+        //上一次写入还没结束就顺延，避免两个线程同时写同一个文件
+        if(m_writeJob.isRunning())
+        {
+            m_saveTimer->start();
+            return;
+        }
+        m_bDirty=false;
+        m_writeJob=QtConcurrent::run(&MediaLibrary::writeIndex,m_strIndexPath,m_roots,m_nPass,pendingDirs(),m_dirs);
+    });
+}
+
+MediaLibrary::~MediaLibrary()
+{
+    //正在核对的目录已计入待核对队列，不必等结果
+    m_batchWatcher->cancel();
+    m_batchWatcher->waitForFinished();
+    flush();
+}
+
+bool MediaLibrary::isMediaFile(const QString &fileName)
+{
+    static const QSet<QString> suffixes={
+        "mp4","m4v","mkv","avi","mov","webm","flv","wmv","ts","m2ts","mpg","mpeg","3gp",
+        "mp3","flac","wav","m4a","aac","ogg","opus","wma"
+    };
+    int nDot=fileName.lastIndexOf('.');
+    return nDot>=0 && suffixes.contains(fileName.mid(nDot+1).toLower());
+}
+
+void MediaLibrary::load()
+{
+    QFile file(m_strIndexPath);
+    QStringList queue;
+    if(file.open(QIODevice::ReadOnly))
+    {
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_6_0);
+        quint32 nMagic;
+        quint16 nVersion;
+        quint32 nDirs;
+        in>>nMagic>>nVersion;
+        if(in.status()==QDataStream::Ok && nMagic==kLibraryMagic && nVersion<=kLibraryVersion)
+        {
+            in>>m_roots>>m_nPass>>queue>>nDirs;
+
+            //两级条目数都取自磁盘，剩余字节容纳不下就是损坏的文件，不据此预留
+            if(qint64(nDirs)>(file.size()-file.pos())/kMinDirBytes)
+                nDirs=0;
+            m_dirs.reserve(nDirs);
+            for(quint32 i=0;i<nDirs && in.status()==QDataStream::Ok;i++)
+            {
+                QString dirPath;
+                DirRecord record;
+                quint32 nFiles;
+                in>>dirPath>>record.modified>>record.subdirs>>nFiles;
+                if(in.status()!=QDataStream::Ok || qint64(nFiles)>(file.size()-file.pos())/kMinFileBytes)
+                    break;
+                record.files.reserve(nFiles);
+                for(quint32 j=0;j<nFiles && in.status()==QDataStream::Ok;j++)
+                {
+                    QString fileName;
+                    FileStamp stamp;
+                    in>>fileName>>stamp.size>>stamp.modified;
+                    record.files.insert(fileName,stamp);
+                }
+                if(in.status()!=QDataStream::Ok)
+                    break;
+                m_nFileCount+=record.files.size();
+                m_dirs.insert(dirPath,record);
+            }
+        }
+    }
+
+    for(auto it=m_dirs.constBegin();it!=m_dirs.constEnd();++it)
+        watch(it.key());
+    if(m_nFileCount>0)
+        emit filesAdded(files());
+
+    //上次没扫完的目录接着扫，否则稍后做一次增量核对
+    for(const QString &dirPath:queue)
+        enqueue(dirPath,false);
+    if(!m_queue.isEmpty())
+        startNextBatch();
+    else if(!m_roots.isEmpty())
+        QTimer::singleShot(kStartupDelayMs,this,&MediaLibrary::rescan);
+    m_reconcileTimer->start();
+}
+
+void MediaLibrary::flush()
+{
+    m_saveTimer->stop();
+    m_writeJob.waitForFinished();
+    if(m_bDirty)
+    {
+        m_bDirty=false;
+        writeIndex(m_strIndexPath,m_roots,m_nPass,pendingDirs(),m_dirs);
+    }
+}
+
+void MediaLibrary::addRoot(const QString &dirPath)
+{
+    QString root=QDir::cleanPath(QFileInfo(dirPath).absoluteFilePath());
+    if(root.isEmpty() || isUnderRoot(root))
+        return;
+
+    m_roots.append(root);
+    enqueue(root,true,true);
+    scheduleSave();
+    startNextBatch();
+}
+
+void MediaLibrary::removeRoot(const QString &dirPath)
+{
+    if(!m_roots.removeOne(dirPath))
+        return;
+
+    //队列中属于该目录的条目一并丢弃，正在核对的结果回来时按不在监视范围处理
+    QQueue<DirScan> queue;
+    for(const DirScan &scan:m_queue)
+    {
+        if(isUnderRoot(scan.path))
+            queue.enqueue(scan);
+        else
+            m_queued.remove(scan.path);
+    }
+    m_queue.swap(queue);
+
+    QStringList removed;
+    removeDir(dirPath,removed);
+    if(!removed.isEmpty())
+        emit filesRemoved(removed);
+    scheduleSave();
+}
+
+void MediaLibrary::rescan()
+{
+    m_nPass++;
+    for(const QString &root:m_roots)
+        enqueue(root,false);
+    startNextBatch();
+}
+
+QStringList MediaLibrary::files() const
+{
+    QStringList filePaths;
+    filePaths.reserve(m_nFileCount);
+    for(auto it=m_dirs.constBegin();it!=m_dirs.constEnd();++it)
+    {
+        for(auto file=it->files.constBegin();file!=it->files.constEnd();++file)
+            filePaths.append(joinPath(it.key(),file.key()));
+    }
+    return filePaths;
+}
+
+void MediaLibrary::enqueue(const QString &dirPath,bool bForce,bool bFront)
+{
+    if(m_queued.contains(dirPath))
+        return;
+
+    //每轮核对轮流强制重列一部分目录，目录修改时间不变时也能发现文件内容的修改
+    if(!bForce)
+        bForce=qHash(dirPath)%kDeepVerifyPasses==uint(m_nPass%kDeepVerifyPasses);
+
+    m_queued.insert(dirPath);
+    DirScan scan{dirPath,-1,bForce};
+    if(bFront)
+        m_queue.prepend(scan);
+    else
+        m_queue.enqueue(scan);
+}
+
+void MediaLibrary::startNextBatch()
+{
+    if(m_batchWatcher->isRunning())
+        return;
+
+    if(m_queue.isEmpty())
+    {
+        if(m_bScanning)
+        {
+            m_bScanning=false;
+            emit scanFinished(m_nAdded,m_nRemoved,m_nModified,m_scanTimer.elapsed());
+            scheduleSave();
+        }
+        return;
+    }
+
+    if(!m_bScanning)
+    {
+        m_bScanning=true;
+        m_scanTimer.start();
+        m_nScanned=m_nAdded=m_nRemoved=m_nModified=0;
+    }
+
+    QVector<DirScan> batch;
+    batch.reserve(kBatchDirs);
+    while(!m_queue.isEmpty() && batch.size()<kBatchDirs)
+    {
+        DirScan scan=m_queue.dequeue();
+        m_queued.remove(scan.path);
+        auto it=m_dirs.constFind(scan.path);
+        scan.knownModified=it==m_dirs.constEnd()?-1:it->modified;
+        m_inFlight.append(scan.path);
+        batch.append(scan);
+    }
+    m_batchWatcher->setFuture(QtConcurrent::run(&MediaLibrary::scanBatch,batch));
+}
+
+QVector<MediaLibrary::DirResult> MediaLibrary::scanBatch(const QVector<DirScan> &batch)
+{
+    QVector<DirResult> results;
+    results.reserve(batch.size());
+    for(const DirScan &scan:batch)
+    {
+        DirResult result;
+        result.path=scan.path;
+        QFileInfo dirInfo(scan.path);
+        result.exists=dirInfo.isDir();
+        if(!result.exists)
+        {
+            results.append(result);
+            continue;
+        }
+
+        //目录修改时间未变说明没有增删条目，不需要列目录
+        result.modified=dirInfo.lastModified().toMSecsSinceEpoch();
+        if(!scan.force && result.modified==scan.knownModified)
+        {
+            results.append(result);
+            continue;
+        }
+
+        result.listed=true;
+        QDirIterator it(scan.path,QDir::Files|QDir::Dirs|QDir::NoDotAndDotDot|QDir::NoSymLinks);
+        while(it.hasNext())
+        {
+            QFileInfo fileInfo=it.nextFileInfo();
+            if(fileInfo.isDir())
+                result.subdirs.append(fileInfo.filePath());
+            else if(isMediaFile(fileInfo.fileName()))
+                result.files.insert(fileInfo.fileName(),{fileInfo.size(),fileInfo.lastModified().toMSecsSinceEpoch()});
+        }
+        results.append(result);
+    }
+    return results;
+}
+
+void MediaLibrary::applyResults(const QVector<DirResult> &results)
+{
+    QStringList added;
+    QStringList removed;
+    QStringList modified;
+    for(const DirResult &result:results)
+    {
+        m_nScanned++;
+        //核对期间监视目录被移除
+        if(!isUnderRoot(result.path))
+            continue;
+        if(!result.exists)
+        {
+            removeDir(result.path,removed);
+            m_bDirty=true;
+            continue;
+        }
+
+        if(!m_dirs.contains(result.path))
+            watch(result.path);
+        QStringList staleSubdirs;
+        QStringList subdirs;
+        {
+            DirRecord &record=m_dirs[result.path];
+            if(result.listed)
+            {
+                //与索引逐项比较，只把差异通知出去
+                for(auto it=result.files.constBegin();it!=result.files.constEnd();++it)
+                {
+                    auto known=record.files.constFind(it.key());
+                    if(known==record.files.constEnd())
+                        added.append(joinPath(result.path,it.key()));
+                    else if(!(*known==*it))
+                        modified.append(joinPath(result.path,it.key()));
+                }
+                for(auto it=record.files.constBegin();it!=record.files.constEnd();++it)
+                {
+                    if(!result.files.contains(it.key()))
+                        removed.append(joinPath(result.path,it.key()));
+                }
+                for(const QString &subdir:record.subdirs)
+                {
+                    if(!result.subdirs.contains(subdir))
+                        staleSubdirs.append(subdir);
+                }
+
+                m_nFileCount+=result.files.size()-record.files.size();
+                record.files=result.files;
+                record.subdirs=result.subdirs;
+                record.modified=result.modified;
+                m_bDirty=true;
+            }
+            subdirs=record.subdirs;
+        }
+
+        //removeDir会修改m_dirs，必须在不再持有记录引用之后调用
+        for(const QString &subdir:staleSubdirs)
+            removeDir(subdir,removed);
+        for(const QString &subdir:subdirs)
+            enqueue(subdir,false);
+    }
+
+    m_nAdded+=added.size();
+    m_nRemoved+=removed.size();
+    m_nModified+=modified.size();
+    if(!removed.isEmpty())
+        emit filesRemoved(removed);
+    if(!added.isEmpty())
+        emit filesAdded(added);
+    if(!modified.isEmpty())
+        emit filesModified(modified);
+    emit scanProgress(m_nScanned,m_queue.size());
+
+    if(m_bDirty)
+        scheduleSave();
+    startNextBatch();
+}
+
+void MediaLibrary::removeDir(const QString &dirPath,QStringList &removed)
+{
+    auto it=m_dirs.find(dirPath);
+    if(it==m_dirs.end())
+        return;
+    DirRecord record=*it;
+    m_dirs.erase(it);
+
+    for(auto file=record.files.constBegin();file!=record.files.constEnd();++file)
+        removed.append(joinPath(dirPath,file.key()));
+    m_nFileCount-=record.files.size();
+    if(m_watcher->removePath(dirPath))
+        m_nWatched--;
+
+    for(const QString &subdir:record.subdirs)
+        removeDir(subdir,removed);
+}
+
+void MediaLibrary::watch(const QString &dirPath)
+{
+    if(m_nWatched<kMaxWatches && m_watcher->addPath(dirPath))
+        m_nWatched++;
+}
+
+bool MediaLibrary::isUnderRoot(const QString &dirPath) const
+{
+    for(const QString &root:m_roots)
+    {
+        if(dirPath==root || dirPath.startsWith(joinPath(root,QString())))
+            return true;
+    }
+    return false;
+}
+
+QStringList MediaLibrary::pendingDirs() const
+{
+    QStringList dirs=m_inFlight;
+    dirs.reserve(dirs.size()+m_queue.size());
+    for(const DirScan &scan:m_queue)
+        dirs.append(scan.path);
+    return dirs;
+}
+
+void MediaLibrary::scheduleSave()
+{
+    m_bDirty=true;
+    if(!m_saveTimer->isActive())
+        m_saveTimer->start();
+}
+
+void MediaLibrary::writeIndex(const QString &filePath,const QStringList &roots,int nPass,
+                              const QStringList &queue,const QHash<QString,DirRecord> &dirs)
+{
+    QSaveFile file(filePath);
+    if(!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out<<kLibraryMagic<<kLibraryVersion<<roots<<qint32(nPass)<<queue<<quint32(dirs.size());
+    for(auto it=dirs.constBegin();it!=dirs.constEnd();++it)
+    {
+        out<<it.key()<<it->modified<<it->subdirs<<quint32(it->files.size());
+        for(auto file=it->files.constBegin();file!=it->files.constEnd();++file)
+            out<<file.key()<<file->size<<file->modified;
+    }
+    file.commit();
+}
@@ -0,0 +1,117 @@
+/*
+ * 媒体库 监视配置的目录，维护磁盘上的增量索引
+ * 目录修改时间未变就不重新列目录，只把差异（新增、删除、修改）通知出去
+ * 扫描按目录分批在工作线程进行，待扫描队列随索引落盘，退出后下次启动接着扫
+ */
+
+#ifndef MEDIALIBRARY_H
+#define MEDIALIBRARY_H
+
+#include<QObject>
+#include<QHash>
+#include<QSet>
+#include<QQueue>
+#include<QVector>
+#include<QStringList>
+#include<QTimer>
+#include<QElapsedTimer>
+#include<QFuture>
+#include<QFutureWatcher>
+#include<QFileSystemWatcher>
+
+class MediaLibrary : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MediaLibrary(const QString &indexPath,QObject *parent=nullptr);
+    ~MediaLibrary();
+
+    void load();        //加载索引，发出已知文件，并继续上次未完成的扫描
+    void flush();       //立即写入索引（同步）
+
+    QStringList roots() const {return m_roots;}
+    void addRoot(const QString &dirPath);       //添加监视目录并开始扫描
+    void removeRoot(const QString &dirPath);    //移除监视目录及其下的全部条目
+    void rescan();                              //对全部目录做一次增量核对
+
+    bool isScanning() const {return m_bScanning;}
+    int fileCount() const {return m_nFileCount;}
+    QStringList files() const;                  //索引中的全部文件
+
+    static bool isMediaFile(const QString &fileName);
+
+signals:
+    void filesAdded(const QStringList &filePaths);
+    void filesRemoved(const QStringList &filePaths);
+    void filesModified(const QStringList &filePaths);
+    void scanProgress(int nScanned,int nPending);
+    void scanFinished(int nAdded,int nRemoved,int nModified,qint64 elapsedMs);
+
+private:
+    struct FileStamp
+    {
+        qint64 size = 0;
+        qint64 modified = 0;    //修改时间（毫秒）
+        bool operator==(const FileStamp &other) const {return size==other.size && modified==other.modified;}
+    };
+    struct DirRecord
+    {
+        qint64 modified = -1;               //目录修改时间，-1表示还没列过
+        QHash<QString,FileStamp> files;     //文件名——大小和修改时间
+        QStringList subdirs;                //子目录完整路径
+    };
+    struct DirScan      //交给工作线程的一个目录
+    {
+        QString path;
+        qint64 knownModified;
+        bool force;                         //即使修改时间未变也重新列目录（核对文件本身的修改）
+    };
+    struct DirResult    //工作线程返回的一个目录
+    {
+        QString path;
+        bool exists = false;
+        bool listed = false;                //重新列过目录，files和subdirs有效
+        qint64 modified = -1;
+        QHash<QString,FileStamp> files;
+        QStringList subdirs;
+    };
+
+    QString m_strIndexPath;
+    QStringList m_roots;
+    QHash<QString,DirRecord> m_dirs;    //目录——记录
+    int m_nFileCount = 0;
+
+    QQueue<DirScan> m_queue;            //待核对目录
+    QSet<QString> m_queued;
+    QStringList m_inFlight;             //正在工作线程中核对的目录（落盘时算作待核对）
+    bool m_bScanning = false;
+    int m_nPass = 0;                    //核对轮次，用于轮流强制重列一部分目录
+    QFutureWatcher<QVector<DirResult>> *m_batchWatcher;
+    QElapsedTimer m_scanTimer;
+    int m_nScanned = 0;
+    int m_nAdded = 0;
+    int m_nRemoved = 0;
+    int m_nModified = 0;
+
+    QFileSystemWatcher *m_watcher;      //目录变化通知，数量有上限，其余靠定期核对
+    int m_nWatched = 0;
+    QTimer *m_reconcileTimer;           //定期核对
+    QTimer *m_saveTimer;                //合并写入索引
+    bool m_bDirty = false;
+    QFuture<void> m_writeJob;
+
+    void enqueue(const QString &dirPath,bool bForce,bool bFront=false);
+    void startNextBatch();
+    void applyResults(const QVector<DirResult> &results);
+    void removeDir(const QString &dirPath,QStringList &removed);
+    void watch(const QString &dirPath);
+    bool isUnderRoot(const QString &dirPath) const;
+    QStringList pendingDirs() const;
+    void scheduleSave();
+
+    static QVector<DirResult> scanBatch(const QVector<DirScan> &batch);
+    static void writeIndex(const QString &filePath,const QStringList &roots,int nPass,
+                           const QStringList &queue,const QHash<QString,DirRecord> &dirs);
+};
+
+#endif // MEDIALIBRARY_H
@@ -0,0 +1,130 @@
+#include "MediaPreroller.h"
+
+#include<QUrl>
+
+namespace {
+const qint64 kStartToleranceMs = 1000;  //帧时间与起始位置相差在此范围内才算预加载完成
+}
+
+MediaPreroller::MediaPreroller(QObject *parent)
+    : QObject(parent)
+    , m_player(nullptr)
+{
+    m_sink = new QVideoSink(this);
+    //换源前上一个文件（或回收前主窗口播放的文件）的帧可能还在送出，加载完成后、时间对得上的帧才算就绪
+    connect(m_sink,&QVideoSink::videoFrameChanged,this,[this](const QVideoFrame &frame){
+        if(!frame.isValid() || m_strFilePath.isEmpty() || !m_bLoaded)
+            return;
+        if(qAbs(frame.startTime()/1000-m_nStartPosition)<=kStartToleranceMs)
+            m_bReady=true;
+    });
+    attach(new QMediaPlayer(this));
+}
+
+void MediaPreroller::attach(QMediaPlayer *player)
+{
+    m_player=player;
+    m_player->setParent(this);
+    m_player->setVideoOutput(m_sink);
+    m_player->setAudioOutput(nullptr);
+
+    //加载完成后暂停在起始位置，后端随即解码出第一帧
+    connect(m_player,&QMediaPlayer::mediaStatusChanged,this,[this](QMediaPlayer::MediaStatus status){
+        if(status==QMediaPlayer::LoadedMedia && !m_strFilePath.isEmpty())
+        {
+            m_bLoaded=true;
+            if(m_nStartPosition>0)
+                m_player->setPosition(m_nStartPosition);
+            m_player->pause();
+        }
+        else if(status==QMediaPlayer::InvalidMedia)
+        {
+            cancel();
+        }
+    });
+}
+
+void MediaPreroller::preroll(const QString &filePath,qint64 startPosition,QIODevice *device)
+{
+    if(!m_player || filePath==m_strFilePath)
+    {
+        delete device;
+        return;
+    }
+
+    m_strFilePath=filePath;
+    m_nStartPosition=startPosition;
+    m_bLoaded=false;
+    m_bReady=false;
+    QIODevice *old=m_device;
+    m_device=device;
+    if(m_device)
+    {
+        m_device->setParent(this);
+        m_player->setSourceDevice(m_device,QUrl::fromLocalFile(filePath));
+    }
+    else
+        m_player->setSource(QUrl::fromLocalFile(filePath));
+
+    //后端已经换源，旧数据源可以释放了
+    if(old)
+        old->deleteLater();
+}
+
+void MediaPreroller::cancel()
+{
+    m_strFilePath.clear();
+    m_bLoaded=false;
+    m_bReady=false;
+    if(m_player)
+    {
+        m_player->stop();
+        m_player->setSource(QUrl());
+    }
+    releaseDevice();
+}
+
+void MediaPreroller::releaseDevice()
+{
+    if(!m_device)
+        return;
+    m_device->deleteLater();
+    m_device=nullptr;
+}
+
+bool MediaPreroller::isReady(const QString &filePath) const
+{
+    return m_bReady && filePath==m_strFilePath;
+}
+
+QMediaPlayer *MediaPreroller::takePlayer(QIODevice **device)
+{
+    *device=nullptr;
+    if(!m_bReady)
+        return nullptr;
+
+    //交出前断开本类的连接，交出后的播放器不再受本类控制
+    QMediaPlayer *player=m_player;
+    disconnect(player,nullptr,this,nullptr);
+    m_player=nullptr;
+    *device=m_device;
+    m_device=nullptr;
+    m_strFilePath.clear();
+    m_bLoaded=false;
+    m_bReady=false;
+    return player;
+}
+
+void MediaPreroller::recycle(QMediaPlayer *player)
+{
+    //备用播放器仍在时直接丢弃换下来的那个
+    if(m_player)
+    {
+        player->deleteLater();
+        return;
+    }
+
+    player->stop();
+    player->setSource(QUrl());
+    attach(player);
+}
@@ -0,0 +1,43 @@
+/*
+ * 无缝切换预加载器 在当前文件播放时用备用播放器提前打开下一个文件并解码出第一帧
+ * 到达媒体结尾时直接把备用播放器交给主窗口，省去打开和探测文件的时间
+ * 启用预读时由调用方传入数据源，连同播放器一起交出，切换后照常经预读设备读取
+ */
+
+#ifndef MEDIAPREROLLER_H
+#define MEDIAPREROLLER_H
+
+#include<QObject>
+#include<QMediaPlayer>
+#include<QVideoSink>
+#include<QIODevice>
+
+class MediaPreroller : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MediaPreroller(QObject *parent=nullptr);
+
+    //预加载文件并定位到起始位置；device非空时经它读取，所有权转给本类
+    void preroll(const QString &filePath,qint64 startPosition=0,QIODevice *device=nullptr);
+    void cancel();                                  //放弃当前预加载
+    bool isReady(const QString &filePath) const;    //该文件是否已经解码出第一帧
+    QString filePath() const {return m_strFilePath;}
+
+    QMediaPlayer *takePlayer(QIODevice **device);   //取走已就绪的播放器及其数据源（没有时为nullptr），调用方负责绑定输出
+    void recycle(QMediaPlayer *player);     //回收换下来的播放器作为新的备用
+
+private:
+    QMediaPlayer *m_player;     //备用播放器
+    QVideoSink *m_sink;         //预加载期间的视频输出，不显示
+    QString m_strFilePath;      //正在预加载的文件
+    QIODevice *m_device = nullptr;  //预加载文件的数据源，直接打开时为空
+    qint64 m_nStartPosition = 0;
+    bool m_bLoaded = false;     //当前文件已加载完成，此后到达的帧才属于它
+    bool m_bReady = false;      //已解码出当前文件起始位置的帧
+
+    void attach(QMediaPlayer *player);
+    void releaseDevice();
+};
+
+#endif // MEDIAPREROLLER_H
@@ -0,0 +1,230 @@
+#include "MediaProber.h"
+
+#include<QFileInfo>
+#include<QFutureWatcher>
+#include<QtConcurrent>
+#include<QMediaMetaData>
+#include<QMediaFormat>
+#include<QThread>
+#include<QUrl>
+
+namespace {
+const int kProbeTimeoutMs = 5000;   //单个文件的探测超时
+const int kCheckBatch = 256;        //每批在线程池中stat并查缓存的路径数
+const int kEmitBatch = 512;         //攒够这么多结果立即发出
+const int kEmitDelayMs = 100;       //否则最多延迟这么久发出
+}
+
+MediaProber::MediaProber(MetadataCache *cache,QObject *parent,int nPlayers)
+    : QObject(parent)
+    , m_cache(cache)
+{
+    if(nPlayers<=0)
+        nPlayers=qBound(2,QThread::idealThreadCount()/2,4);
+
+    //探测用的播放器不绑定任何输出，只读取元数据
+    m_slots.resize(nPlayers);
+    for(int i=0;i<nPlayers;i++)
+    {
+        Slot &slot=m_slots[i];
+        slot.player=new QMediaPlayer(this);
+        slot.timer=new QTimer(this);
+        slot.timer->setSingleShot(true);
+        slot.timer->setInterval(kProbeTimeoutMs);
+        connect(slot.timer,&QTimer::timeout,this,[this,i](){finishSlot(i,false,false);});
+        connect(slot.player,&QMediaPlayer::mediaStatusChanged,this,[this,i](QMediaPlayer::MediaStatus status){
+            if(m_slots.at(i).probe.filePath.isEmpty())
+                return;
+            if(status==QMediaPlayer::LoadedMedia)
+                finishSlot(i,true,true);
+            else if(status==QMediaPlayer::InvalidMedia)
+                finishSlot(i,false,true);
+        });
+    }
+
+    m_emitTimer = new QTimer(this);
+    m_emitTimer->setSingleShot(true);
+    m_emitTimer->setInterval(kEmitDelayMs);
+    connect(m_emitTimer,&QTimer::timeout,this,&MediaProber::emitResults);
+}
+
+MediaProber::~MediaProber()
+{
+    m_checkJob.waitForFinished();
+}
+
+void MediaProber::enqueue(const QStringList &filePaths)
+{
+    for(const QString &filePath:filePaths)
+    {
+        if(m_queued.contains(filePath))
+            continue;
+        m_queued.insert(filePath);
+        m_pending.enqueue(filePath);
+    }
+    schedulePump();
+}
+
+void MediaProber::clear()
+{
+    m_nGeneration++;
+    m_pending.clear();
+    m_toOpen.clear();
+    m_queued.clear();
+    m_readyPaths.clear();
+    m_readyInfos.clear();
+    m_emitTimer->stop();
+    for(Slot &slot:m_slots)
+    {
+        if(slot.probe.filePath.isEmpty())
+            continue;
+        slot.probe=Probe();
+        slot.timer->stop();
+        slot.player->setSource(QUrl());
+    }
+}
+
+void MediaProber::schedulePump()
+{
+    if(m_bPumpScheduled)
+        return;
+    m_bPumpScheduled=true;
+    QTimer::singleShot(0,this,[this](){
+        m_bPumpScheduled=false;
+        pump();
+    });
+}
+
+void MediaProber::pump()
+{
+    //待打开的文件交给空闲播放器，同时打开的文件数不超过池大小
+    for(int i=0;i<m_slots.size() && !m_toOpen.isEmpty();i++)
+    {
+        Slot &slot=m_slots[i];
+        if(!slot.probe.filePath.isEmpty())
+            continue;
+        slot.probe=m_toOpen.dequeue();
+        slot.timer->start();
+        slot.player->setSource(QUrl::fromLocalFile(slot.probe.filePath));
+    }
+
+    //下一批路径送去线程池检查，同一时间只有一批，结果回到GUI线程后再取下一批
+    if(m_bChecking || m_pending.isEmpty())
+        return;
+    QStringList batch;
+    while(!m_pending.isEmpty() && batch.size()<kCheckBatch)
+        batch.append(m_pending.dequeue());
+
+    m_bChecking=true;
+    int nGeneration=m_nGeneration;
+    QFutureWatcher<QVector<Check>> *watcher = new QFutureWatcher<QVector<Check>>(this);
+    connect(watcher,&QFutureWatcher<QVector<Check>>::finished,this,[this,watcher,nGeneration](){
+        watcher->deleteLater();
+        m_bChecking=false;
+        if(nGeneration==m_nGeneration)
+            onChecked(watcher->result());
+        pump();
+    });
+    m_checkJob=QtConcurrent::run(&MediaProber::checkFiles,m_cache,batch);
+    watcher->setFuture(m_checkJob);
+}
+
+void MediaProber::onChecked(const QVector<Check> &checks)
+{
+    for(const Check &check:checks)
+    {
+        const QString &filePath=check.probe.filePath;
+        if(!check.exists)
+            m_queued.remove(filePath);
+        else if(check.cached)
+        {
+            addResult(filePath,check.info);
+            m_queued.remove(filePath);
+        }
+        else
+            m_toOpen.enqueue(check.probe);
+    }
+}
+
+QVector<MediaProber::Check> MediaProber::checkFiles(MetadataCache *cache,const QStringList &filePaths)
+{
+    QVector<Check> checks;
+    checks.reserve(filePaths.size());
+    for(const QString &filePath:filePaths)
+    {
+        Check check;
+        check.probe.filePath=filePath;
+        QFileInfo fileInfo(filePath);
+        check.exists=fileInfo.exists();
+        if(check.exists)
+        {
+            check.probe.size=fileInfo.size();
+            check.probe.modified=fileInfo.lastModified().toMSecsSinceEpoch();
+            check.cached=cache->lookup(filePath,check.probe.size,check.probe.modified,&check.info);
+        }
+        checks.append(check);
+    }
+    return checks;
+}
+
+void MediaProber::finishSlot(int nSlot,bool bLoaded,bool bStore)
+{
+    Slot &slot=m_slots[nSlot];
+    const Probe &probe=slot.probe;
+    slot.timer->stop();
+
+    MediaInfo info;
+    if(bLoaded)
+    {
+        QMediaMetaData metaData=slot.player->metaData();
+        info.valid=true;
+        info.duration=slot.player->duration();
+        info.resolution=metaData.value(QMediaMetaData::Resolution).toSize();
+        info.frameRate=metaData.value(QMediaMetaData::VideoFrameRate).toDouble();
+        QVariant videoCodec=metaData.value(QMediaMetaData::VideoCodec);
+        if(videoCodec.isValid())
+            info.videoCodec=QMediaFormat::videoCodecName(videoCodec.value<QMediaFormat::VideoCodec>());
+        QVariant audioCodec=metaData.value(QMediaMetaData::AudioCodec);
+        if(audioCodec.isValid())
+            info.audioCodec=QMediaFormat::audioCodecName(audioCodec.value<QMediaFormat::AudioCodec>());
+
+        //容器没有码率信息时按文件大小和时长估算
+        info.bitRate=metaData.value(QMediaMetaData::VideoBitRate).toInt()+metaData.value(QMediaMetaData::AudioBitRate).toInt();
+        if(info.bitRate<=0 && info.duration>0)
+            info.bitRate=int(probe.size*8*1000/info.duration);
+    }
+
+    //超时可能只是磁盘或网络暂时太慢，不当作坏文件记下
+    if(bStore)
+        m_cache->insert(probe.filePath,probe.size,probe.modified,info);
+    addResult(probe.filePath,info);
+    m_queued.remove(probe.filePath);
+
+    //释放解码器后再接下一个文件
+    slot.probe=Probe();
+    slot.player->setSource(QUrl());
+    schedulePump();
+}
+
+void MediaProber::addResult(const QString &filePath,const MediaInfo &info)
+{
+    m_readyPaths.append(filePath);
+    m_readyInfos.append(info);
+    if(m_readyPaths.size()>=kEmitBatch)
+        emitResults();
+    else if(!m_emitTimer->isActive())
+        m_emitTimer->start();
+}
+
+void MediaProber::emitResults()
+{
+    m_emitTimer->stop();
+    if(m_readyPaths.isEmpty())
+        return;
+
+    QStringList filePaths;
+    QVector<MediaInfo> infos;
+    filePaths.swap(m_readyPaths);
+    infos.swap(m_readyInfos);
+    emit probed(filePaths,infos);
+}
@@ -0,0 +1,79 @@
+/*
+ * 媒体元数据探测器 用固定数量的后台播放器轮流打开文件读取元数据
+ * 待探测的只是路径队列，同时打开的解码器数量始终不超过池大小；缓存命中的条目不打开文件
+ * 文件stat和查缓存分批在线程池中进行，GUI线程只分发结果；超时的文件不写缓存，下次重新探测
+ */
+
+#ifndef MEDIAPROBER_H
+#define MEDIAPROBER_H
+
+#include<QObject>
+#include<QQueue>
+#include<QSet>
+#include<QVector>
+#include<QTimer>
+#include<QMediaPlayer>
+#include<QFuture>
+
+#include"MetadataCache.h"
+
+class MediaProber : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MediaProber(MetadataCache *cache,QObject *parent=nullptr,int nPlayers=0);
+    ~MediaProber();
+
+    void enqueue(const QStringList &filePaths); //加入探测队列（已在队列中的忽略）
+    void clear();                               //清空队列并放弃正在进行的探测
+    int pendingCount() const {return m_queued.size();}
+
+signals:
+    //结果分批发出，避免逐条刷新视图
+    void probed(const QStringList &filePaths,const QVector<MediaInfo> &infos);
+
+private:
+    struct Probe    //一个需要打开的文件
+    {
+        QString filePath;
+        qint64 size = 0;
+        qint64 modified = 0;    //修改时间（毫秒）
+    };
+    struct Check    //一个路径的stat和查缓存结果
+    {
+        Probe probe;
+        bool exists = false;
+        bool cached = false;    //缓存命中，info有效
+        MediaInfo info;
+    };
+    struct Slot     //池中的一个探测播放器
+    {
+        QMediaPlayer *player;
+        QTimer *timer;          //探测超时
+        Probe probe;            //正在探测的文件，路径为空表示空闲
+    };
+
+    MetadataCache *m_cache;
+    QVector<Slot> m_slots;
+    QQueue<QString> m_pending;      //待查缓存的路径
+    QFuture<QVector<Check>> m_checkJob; //正在线程池中检查的一批
+    bool m_bChecking = false;       //有一批检查结果尚未处理（clear后也等它回来，线程池中始终最多一批）
+    int m_nGeneration = 0;          //clear时加一，丢弃迟到的检查结果
+    QQueue<Probe> m_toOpen;         //缓存未命中、等待空闲播放器的文件
+    QSet<QString> m_queued;         //队列和池中的路径，用于去重
+    bool m_bPumpScheduled = false;
+
+    QStringList m_readyPaths;       //待发出的结果
+    QVector<MediaInfo> m_readyInfos;
+    QTimer *m_emitTimer;
+
+    void schedulePump();
+    void pump();                    //未命中的文件交给空闲播放器，再把下一批路径送去检查
+    void onChecked(const QVector<Check> &checks);   //缓存命中直接出结果，未命中转入待打开队列
+    void finishSlot(int nSlot,bool bLoaded,bool bStore);    //bStore为false（超时）时只出结果不写缓存
+    void addResult(const QString &filePath,const MediaInfo &info);
+    void emitResults();
+    static QVector<Check> checkFiles(MetadataCache *cache,const QStringList &filePaths);   //工作线程执行
+};
+
+#endif // MEDIAPROBER_H
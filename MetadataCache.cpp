@@ -0,0 +1,179 @@
+#include "MetadataCache.h"
+
+#include<QFile>
+#include<QSaveFile>
+#include<QDataStream>
+#include<QtConcurrent>
+
+namespace {
+const quint32 kMetadataMagic = 0x46534d44;  //"FSMD"
+const quint16 kMetadataVersion = 2;         //2：增加响度分析结果
+const int kWriteDelayMs = 5000;             //合并写入延迟（探测时写入很密集）
+const qint64 kMinRecordBytes = 4+2*8;       //一条记录最少占用的字节数（空路径加大小和修改时间）
+}
+
+MetadataCache::MetadataCache(const QString &filePath,QObject *parent)
+    : QObject(parent)
+    , m_strFilePath(filePath)
+{
+    m_writeTimer = new QTimer(this);
+    m_writeTimer->setSingleShot(true);
+    m_writeTimer->setInterval(kWriteDelayMs);
+    connect(m_writeTimer,&QTimer::timeout,this,[this](){
+        if(!m_bDirty)
+            return;
+        //上一次写入还没结束就顺延，避免两个线程同时写同一个文件
+        if(m_writeJob.isRunning())
+        {
+            m_writeTimer->start();
+            return;
+        }
+        m_bDirty=false;
+        QReadLocker locker(&m_lock);
+        m_writeJob=QtConcurrent::run(&MetadataCache::writeRecords,m_strFilePath,m_records);
+    });
+}
+
+MetadataCache::~MetadataCache()
+{
+    flush();
+}
+
+void MetadataCache::load()
+{
+    QFile file(m_strFilePath);
+    if(!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 nMagic;
+    quint16 nVersion;
+    quint32 nCount;
+    in>>nMagic>>nVersion>>nCount;
+    if(in.status()!=QDataStream::Ok || nMagic!=kMetadataMagic || nVersion>kMetadataVersion)
+        return;
+
+    QWriteLocker locker(&m_lock);
+    //条目数取自磁盘，损坏的文件可能给出极大的值，预留不超过剩余字节数能容纳的条数
+    m_records.clear();
+    m_records.reserve(qMin<qint64>(nCount,(file.size()-file.pos())/kMinRecordBytes));
+    for(quint32 i=0;i<nCount;i++)
+    {
+        QString filePath;
+        Record record;
+        MediaInfo &info=record.info;
+        in>>filePath>>record.size>>record.modified;
+        //版本1只有探测结果
+        if(nVersion>=2)
+            in>>record.hasInfo;
+        else
+            record.hasInfo=true;
+        in>>info.duration>>info.resolution>>info.videoCodec>>info.audioCodec
+          >>info.bitRate>>info.frameRate>>info.valid;
+        if(nVersion>=2)
+        {
+            LoudnessInfo &loudness=record.loudness;
+            in>>record.hasLoudness>>loudness.integrated>>loudness.peak>>loudness.valid;
+        }
+        if(in.status()!=QDataStream::Ok)
+            break;
+        m_records.insert(filePath,record);
+    }
+}
+
+void MetadataCache::flush()
+{
+    m_writeTimer->stop();
+    m_writeJob.waitForFinished();
+    if(m_bDirty)
+    {
+        m_bDirty=false;
+        QReadLocker locker(&m_lock);
+        writeRecords(m_strFilePath,m_records);
+    }
+}
+
+bool MetadataCache::lookup(const QString &filePath,qint64 size,qint64 modified,MediaInfo *info) const
+{
+    QReadLocker locker(&m_lock);
+    auto it=m_records.constFind(filePath);
+    if(it==m_records.constEnd() || !it->hasInfo || it->size!=size || it->modified!=modified)
+        return false;
+    *info=it->info;
+    return true;
+}
+
+void MetadataCache::insert(const QString &filePath,qint64 size,qint64 modified,const MediaInfo &info)
+{
+    QWriteLocker locker(&m_lock);
+    Record &record=recordFor(filePath,size,modified);
+    record.hasInfo=true;
+    record.info=info;
+    markDirty();
+}
+
+bool MetadataCache::lookupLoudness(const QString &filePath,qint64 size,qint64 modified,LoudnessInfo *loudness) const
+{
+    QReadLocker locker(&m_lock);
+    auto it=m_records.constFind(filePath);
+    if(it==m_records.constEnd() || !it->hasLoudness || it->size!=size || it->modified!=modified)
+        return false;
+    *loudness=it->loudness;
+    return true;
+}
+
+void MetadataCache::insertLoudness(const QString &filePath,qint64 size,qint64 modified,const LoudnessInfo &loudness)
+{
+    QWriteLocker locker(&m_lock);
+    Record &record=recordFor(filePath,size,modified);
+    record.hasLoudness=true;
+    record.loudness=loudness;
+    markDirty();
+}
+
+int MetadataCache::size() const
+{
+    QReadLocker locker(&m_lock);
+    return m_records.size();
+}
+
+MetadataCache::Record &MetadataCache::recordFor(const QString &filePath,qint64 size,qint64 modified)
+{
+    Record &record=m_records[filePath];
+    if(record.size!=size || record.modified!=modified)
+    {
+        record=Record();
+        record.size=size;
+        record.modified=modified;
+    }
+    return record;
+}
+
+void MetadataCache::markDirty()
+{
+    m_bDirty=true;
+    if(!m_writeTimer->isActive())
+        m_writeTimer->start();
+}
+
+void MetadataCache::writeRecords(const QString &filePath,const QHash<QString,Record> &records)
+{
+    QSaveFile file(filePath);
+    if(!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out<<kMetadataMagic<<kMetadataVersion<<quint32(records.size());
+    for(auto it=records.constBegin();it!=records.constEnd();++it)
+    {
+        const MediaInfo &info=it->info;
+        const LoudnessInfo &loudness=it->loudness;
+        out<<it.key()<<it->size<<it->modified<<it->hasInfo
+           <<info.duration<<info.resolution<<info.videoCodec<<info.audioCodec
+           <<info.bitRate<<info.frameRate<<info.valid
+           <<it->hasLoudness<<loudness.integrated<<loudness.peak<<loudness.valid;
+    }
+    file.commit();
+}
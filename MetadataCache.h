@@ -0,0 +1,75 @@
+/*
+ * 媒体元数据磁盘缓存 按路径索引，文件大小或修改时间变化即视为失效
+ * 探测结果和响度分析结果各自写入、各自命中，同一文件的两者互不覆盖
+ * 写入采用延迟合并，落盘在工作线程完成；查询和写入加锁，可在工作线程中查缓存
+ */
+
+#ifndef METADATACACHE_H
+#define METADATACACHE_H
+
+#include<QObject>
+#include<QHash>
+#include<QSize>
+#include<QTimer>
+#include<QFuture>
+#include<QReadWriteLock>
+
+struct MediaInfo    //媒体元数据
+{
+    qint64 duration = -1;   //时长（毫秒），-1表示未知
+    QSize resolution;       //视频分辨率
+    QString videoCodec;     //视频编码
+    QString audioCodec;     //音频编码
+    int bitRate = 0;        //总码率（bps）
+    double frameRate = 0;   //帧率
+    bool valid = false;     //探测成功（失败的结果也缓存，避免反复打开坏文件）
+};
+
+struct LoudnessInfo //响度分析结果（EBU R128）
+{
+    double integrated = 0;  //积分响度（LUFS）
+    double peak = 0;        //采样峰值（dBFS）
+    bool valid = false;     //测得有效响度（无音轨、全程静音时为false，同样缓存）
+};
+
+class MetadataCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MetadataCache(const QString &filePath,QObject *parent=nullptr);
+    ~MetadataCache();
+
+    void load();        //从文件加载
+    void flush();       //立即写入（同步）
+
+    //大小和修改时间与缓存一致时才命中
+    bool lookup(const QString &filePath,qint64 size,qint64 modified,MediaInfo *info) const;
+    void insert(const QString &filePath,qint64 size,qint64 modified,const MediaInfo &info);
+    bool lookupLoudness(const QString &filePath,qint64 size,qint64 modified,LoudnessInfo *loudness) const;
+    void insertLoudness(const QString &filePath,qint64 size,qint64 modified,const LoudnessInfo &loudness);
+    int size() const;
+
+private:
+    struct Record
+    {
+        qint64 size = 0;
+        qint64 modified = 0;    //修改时间（毫秒）
+        bool hasInfo = false;   //已有探测结果
+        MediaInfo info;
+        bool hasLoudness = false;   //已有响度分析结果
+        LoudnessInfo loudness;
+    };
+
+    QString m_strFilePath;
+    QHash<QString,Record> m_records;    //路径——记录
+    mutable QReadWriteLock m_lock;      //保护m_records
+    QTimer *m_writeTimer;               //合并写入定时器
+    bool m_bDirty = false;
+    QFuture<void> m_writeJob;           //后台写入任务
+
+    Record &recordFor(const QString &filePath,qint64 size,qint64 modified);  //文件变化时清空旧结果
+    void markDirty();
+    static void writeRecords(const QString &filePath,const QHash<QString,Record> &records);
+};
+
+#endif // METADATACACHE_H
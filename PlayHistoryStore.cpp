@@ -0,0 +1,182 @@
+#include "PlayHistoryStore.h"
+
+#include<QFile>
+#include<QFileInfo>
+#include<QSaveFile>
+#include<QDataStream>
+#include<QVector>
+#include<QtConcurrent>
+#include<algorithm>
+
+namespace {
+const quint32 kHistoryMagic = 0x46534853;   //"FSHS"
+const quint16 kHistoryVersion = 1;
+const int kWriteDelayMs = 2000;             //合并写入延迟
+const qint64 kMinEntryBytes = 4+3*8;        //一条记录最少占用的字节数（空路径加三个整数）
+}
+
+PlayHistoryStore::PlayHistoryStore(const QString &filePath,QObject *parent,int nCapacity)
+    : QObject(parent)
+    , m_strFilePath(filePath)
+    , m_nCapacity(nCapacity)
+{
+    m_writeTimer = new QTimer(this);
+    m_writeTimer->setSingleShot(true);
+    m_writeTimer->setInterval(kWriteDelayMs);
+    connect(m_writeTimer,&QTimer::timeout,this,[this](){
+        if(!m_bDirty)
+            return;
+        //上一次写入还没结束就顺延，避免两个线程同时写同一个文件
+        if(m_writeJob.isRunning())
+        {
+            m_writeTimer->start();
+            return;
+        }
+        m_bDirty=false;
+        m_writeJob=QtConcurrent::run(&PlayHistoryStore::writeEntries,m_strFilePath,m_entries.values());
+    });
+}
+
+PlayHistoryStore::~PlayHistoryStore()
+{
+    flush();
+}
+
+void PlayHistoryStore::load()
+{
+    QFile file(m_strFilePath);
+    if(!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 nMagic;
+    quint16 nVersion;
+    quint32 nCount;
+    in>>nMagic>>nVersion>>nCount;
+    if(in.status()!=QDataStream::Ok || nMagic!=kHistoryMagic || nVersion>kHistoryVersion)
+        return;
+
+    //条目数取自磁盘，损坏的文件可能给出极大的值，预留不超过剩余字节数能容纳的条数
+    m_entries.clear();
+    m_entries.reserve(qMin<qint64>(nCount,(file.size()-file.pos())/kMinEntryBytes));
+    for(quint32 i=0;i<nCount;i++)
+    {
+        PlayHistory history;
+        qint64 nPlayTime;
+        in>>history.filePath>>nPlayTime>>history.duration>>history.lastPostion;
+        if(in.status()!=QDataStream::Ok)
+            break;
+        history.fileName=QFileInfo(history.filePath).fileName();
+        history.playTime=QDateTime::fromMSecsSinceEpoch(nPlayTime);
+        m_entries.insert(history.filePath,history);
+    }
+}
+
+void PlayHistoryStore::record(const QString &filePath)
+{
+    auto it=m_entries.find(filePath);
+    if(it==m_entries.end())
+    {
+        PlayHistory history;
+        history.filePath=filePath;
+        history.fileName=QFileInfo(filePath).fileName();
+        it=m_entries.insert(filePath,history);
+    }
+    it->playTime=QDateTime::currentDateTime();
+
+    trimToCapacity();
+    scheduleWrite();
+}
+
+void PlayHistoryStore::updatePosition(const QString &filePath,qint64 position,qint64 duration)
+{
+    auto it=m_entries.find(filePath);
+    if(it==m_entries.end())
+        return;
+
+    it->lastPostion=position;
+    if(duration>0)
+        it->duration=duration;
+    scheduleWrite();
+}
+
+void PlayHistoryStore::clear()
+{
+    m_entries.clear();
+    scheduleWrite();
+}
+
+void PlayHistoryStore::flush()
+{
+    m_writeTimer->stop();
+    m_writeJob.waitForFinished();
+    if(m_bDirty)
+    {
+        m_bDirty=false;
+        writeEntries(m_strFilePath,m_entries.values());
+    }
+}
+
+QList<PlayHistory> PlayHistoryStore::recent(int nCount) const
+{
+    //只对需要的前几条做部分排序
+    QVector<const PlayHistory*> entries;
+    entries.reserve(m_entries.size());
+    for(const PlayHistory &history:m_entries)
+        entries.append(&history);
+
+    nCount=qMin(nCount,int(entries.size()));
+    std::partial_sort(entries.begin(),entries.begin()+nCount,entries.end(),
+                      [](const PlayHistory *a,const PlayHistory *b){return a->playTime>b->playTime;});
+
+    QList<PlayHistory> result;
+    result.reserve(nCount);
+    for(int i=0;i<nCount;i++)
+        result.append(*entries.at(i));
+    return result;
+}
+
+void PlayHistoryStore::scheduleWrite()
+{
+    m_bDirty=true;
+    if(!m_writeTimer->isActive())
+        m_writeTimer->start();
+}
+
+void PlayHistoryStore::trimToCapacity()
+{
+    //超出10%才裁剪一次，裁剪代价分摊到多次插入
+    if(m_entries.size()<=m_nCapacity+m_nCapacity/10)
+        return;
+
+    QVector<QDateTime> playTimes;
+    playTimes.reserve(m_entries.size());
+    for(const PlayHistory &history:m_entries)
+        playTimes.append(history.playTime);
+
+    int nDrop=m_entries.size()-m_nCapacity;
+    std::nth_element(playTimes.begin(),playTimes.begin()+nDrop,playTimes.end());
+    QDateTime cutoff=playTimes.at(nDrop);
+    for(auto it=m_entries.begin();it!=m_entries.end();)
+    {
+        if(it->playTime<cutoff)
+            it=m_entries.erase(it);
+        else
+            ++it;
+    }
+}
+
+void PlayHistoryStore::writeEntries(const QString &filePath,const QList<PlayHistory> &entries)
+{
+    QSaveFile file(filePath);
+    if(!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out<<kHistoryMagic<<kHistoryVersion<<quint32(entries.size());
+    for(const PlayHistory &history:entries)
+        out<<history.filePath<<history.playTime.toMSecsSinceEpoch()<<history.duration<<history.lastPostion;
+    file.commit();
+}
@@ -0,0 +1,55 @@
+/*
+ * 播放历史存储 按路径哈希索引，带版本号的二进制文件格式
+ * 写入采用延迟合并：短时间内多次更新只落盘一次，落盘在工作线程完成
+ */
+
+#ifndef PLAYHISTORYSTORE_H
+#define PLAYHISTORYSTORE_H
+
+#include<QObject>
+#include<QHash>
+#include<QList>
+#include<QDateTime>
+#include<QTimer>
+#include<QFuture>
+
+struct PlayHistory  //播放历史记录结构
+{
+    QString filePath;       //文件完整路径
+    QString fileName;       //文件名称
+    QDateTime playTime;     //最后播放时间
+    qint64 duration = 0;    //文件总时长
+    qint64 lastPostion = 0; //最后播放位置
+};
+
+class PlayHistoryStore : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PlayHistoryStore(const QString &filePath,QObject *parent=nullptr,int nCapacity=50000);
+    ~PlayHistoryStore();
+
+    void load();                                //从文件加载
+    void record(const QString &filePath);       //记录一次播放（保留已有的时长和位置）
+    void updatePosition(const QString &filePath,qint64 position,qint64 duration);  //更新播放位置
+    void clear();                               //清空全部记录
+    void flush();                               //立即写入（同步）
+
+    bool isEmpty() const {return m_entries.isEmpty();}
+    int size() const {return m_entries.size();}
+    QList<PlayHistory> recent(int nCount) const;    //最近播放的若干条，按时间倒序
+
+private:
+    QString m_strFilePath;              //历史记录文件
+    int m_nCapacity;                    //最多保留的记录数
+    QHash<QString,PlayHistory> m_entries;   //路径——记录
+    QTimer *m_writeTimer;               //合并写入定时器
+    bool m_bDirty = false;
+    QFuture<void> m_writeJob;           //后台写入任务
+
+    void scheduleWrite();
+    void trimToCapacity();
+    static void writeEntries(const QString &filePath,const QList<PlayHistory> &entries);
+};
+
+#endif // PLAYHISTORYSTORE_H
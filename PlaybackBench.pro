@@ -0,0 +1,23 @@
+# 无窗口播放性能测试程序，与主程序共用播放速率表
+# 测试素材：bench/gen_media.sh；运行：PlaybackBench -o result.json bench/media/*
+# 帧转换对比：PlaybackBench --convert
+QT       += core gui
+QT += multimedia
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = PlaybackBench
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    FrameConverter.cpp \
+    bench/ConvertBench.cpp \
+    bench/PlaybackBench.cpp \
+    bench/main.cpp
+
+HEADERS += \
+    FrameConverter.h \
+    PlaybackRates.h \
+    bench/ConvertBench.h \
+    bench/PlaybackBench.h
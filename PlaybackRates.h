@@ -0,0 +1,58 @@
+/*
+ * 播放速率选项表 播放速度菜单和性能测试程序共用同一份
+ * 快速浏览速率单独成表：这些速率不交给后端逐帧解码，由FastScanController按关键帧跳跃显示
+ * 倒放速率同样单独成表，由ReversePlayer分段解码后倒序显示
+ */
+
+#ifndef PLAYBACKRATES_H
+#define PLAYBACKRATES_H
+
+#include<QString>
+#include<QVector>
+
+struct PlaybackRateOption
+{
+    QString displayText;
+    double rateValue;
+};
+
+inline const QVector<PlaybackRateOption> &playbackRateOptions()
+{
+    static const QVector<PlaybackRateOption> rateOptions = {
+        {"0.5x", 0.5},
+        {"0.75x", 0.75},
+        {"1.0x(正常)", 1.0},  // 恢复"正常"标注
+        {"1.25x", 1.25},
+        {"1.5x", 1.5},
+        {"2.0x", 2.0}
+    };
+    return rateOptions;
+}
+
+//按速率升序，前进/后退按钮在表中逐级切换
+inline const QVector<PlaybackRateOption> &fastScanRateOptions()
+{
+    static const QVector<PlaybackRateOption> rateOptions = {
+        {"-32x", -32.0},
+        {"-16x", -16.0},
+        {"-8x", -8.0},
+        {"-4x", -4.0},
+        {"4x", 4.0},
+        {"8x", 8.0},
+        {"16x", 16.0},
+        {"32x", 32.0}
+    };
+    return rateOptions;
+}
+
+inline const QVector<PlaybackRateOption> &reversePlaybackRateOptions()
+{
+    static const QVector<PlaybackRateOption> rateOptions = {
+        {"-0.25x", -0.25},
+        {"-0.5x", -0.5},
+        {"-1.0x", -1.0}
+    };
+    return rateOptions;
+}
+
+#endif // PLAYBACKRATES_H
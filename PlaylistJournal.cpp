@@ -0,0 +1,237 @@
+#include "PlaylistJournal.h"
+
+#include<QHash>
+#include<QVector>
+#include<QDataStream>
+#include<QTextStream>
+#include<QSaveFile>
+#include<QtConcurrent>
+
+namespace {
+const qint64 kMaxRecords = 256;                 //记录数超过该值即整理
+const qint64 kMaxJournalBytes = 1024*1024;      //日志超过1MB即整理
+const quint32 kMaxRecordBytes = 64*1024*1024;   //单条记录上限，超出视为损坏
+}
+
+PlaylistJournal::PlaylistJournal(const QString &snapshotPath,QObject *parent)
+    : QObject(parent)
+    , m_strSnapshotPath(snapshotPath)
+{
+    m_journalFile.setFileName(journalPath(m_strSnapshotPath));
+    m_journalFile.open(QIODevice::WriteOnly|QIODevice::Append);
+}
+
+PlaylistJournal::~PlaylistJournal()
+{
+    m_compaction.waitForFinished();
+}
+
+QString PlaylistJournal::journalPath(const QString &snapshotPath)
+{
+    return snapshotPath+".journal";
+}
+
+QString PlaylistJournal::compactingPath(const QString &snapshotPath)
+{
+    return snapshotPath+".journal.compacting";
+}
+
+void PlaylistJournal::recordAdd(const QStringList &filePaths)
+{
+    QByteArray payload;
+    QDataStream out(&payload,QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out<<quint8(OpAdd)<<filePaths;
+    appendRecord(payload);
+}
+
+void PlaylistJournal::recordRemove(const QStringList &filePaths)
+{
+    QByteArray payload;
+    QDataStream out(&payload,QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out<<quint8(OpRemove)<<filePaths;
+    appendRecord(payload);
+}
+
+void PlaylistJournal::recordMove(const QString &filePath,int toRow)
+{
+    QByteArray payload;
+    QDataStream out(&payload,QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out<<quint8(OpMove)<<filePath<<qint32(toRow);
+    appendRecord(payload);
+}
+
+void PlaylistJournal::appendRecord(const QByteArray &payload)
+{
+    if(!m_journalFile.isOpen())
+        return;
+
+    //记录格式：长度 + 校验和 + 内容，重放时遇到残缺记录即停止
+    QDataStream out(&m_journalFile);
+    out<<quint32(payload.size())<<qChecksum(payload);
+    m_journalFile.write(payload);
+    m_journalFile.flush();
+    m_nRecords++;
+}
+
+bool PlaylistJournal::needsCompaction() const
+{
+    return m_nRecords>=kMaxRecords || m_journalFile.size()>=kMaxJournalBytes;
+}
+
+void PlaylistJournal::compact(const QStringList &filePaths)
+{
+    if(isCompacting())
+        return;
+
+    //当前日志转为“整理中”，新记录写入新日志，整理期间的编辑不会丢
+    QString strJournal=journalPath(m_strSnapshotPath);
+    QString strCompacting=compactingPath(m_strSnapshotPath);
+    m_journalFile.close();
+    if(QFile::exists(strCompacting))
+    {
+        //上次整理未完成（例如崩溃），把当前日志接在它后面
+        QFile compacting(strCompacting);
+        QFile journal(strJournal);
+        if(compacting.open(QIODevice::WriteOnly|QIODevice::Append) && journal.open(QIODevice::ReadOnly))
+            compacting.write(journal.readAll());
+        journal.close();
+        QFile::remove(strJournal);
+    }
+    else
+    {
+        QFile::rename(strJournal,strCompacting);
+    }
+    m_journalFile.open(QIODevice::WriteOnly|QIODevice::Append);
+    m_nRecords=0;
+
+    //快照写入临时文件后原子替换，成功后才删除“整理中”日志
+    m_compaction=QtConcurrent::run([snapshotPath=m_strSnapshotPath,filePaths](){
+        QSaveFile file(snapshotPath);
+        if(!file.open(QIODevice::WriteOnly|QIODevice::Text))
+            return;
+        QTextStream out(&file);
+        for(const QString &filePath:filePaths)
+            out<<filePath<<"\n";
+        out.flush();
+        if(file.commit())
+            QFile::remove(compactingPath(snapshotPath));
+    });
+}
+
+QStringList PlaylistJournal::replay(const QString &snapshotPath)
+{
+    //移除的条目先留空位，最后统一压缩，避免每次移除都搬移整个列表；调整顺序也在带空位的列表上就地进行
+    QVector<QString> entries;
+    QHash<QString,int> rowByPath;
+    auto add=[&](const QString &filePath){
+        if(filePath.isEmpty() || rowByPath.contains(filePath))
+            return;
+        rowByPath.insert(filePath,entries.size());
+        entries.append(filePath);
+    };
+
+    QFile snapshot(snapshotPath);
+    if(snapshot.open(QIODevice::ReadOnly|QIODevice::Text))
+    {
+        QTextStream in(&snapshot);
+        while(!in.atEnd())
+        {
+            QString filePath=in.readLine().trimmed();
+            if(!filePath.startsWith('#'))
+                add(filePath);
+        }
+    }
+
+    //先重放未整理完的旧日志，再重放当前日志
+    for(const QString &path:{compactingPath(snapshotPath),journalPath(snapshotPath)})
+    {
+        QFile journal(path);
+        if(!journal.open(QIODevice::ReadOnly))
+            continue;
+
+        QDataStream in(&journal);
+        while(!in.atEnd())
+        {
+            quint32 nLength;
+            quint16 nChecksum;
+            in>>nLength>>nChecksum;
+            if(in.status()!=QDataStream::Ok || nLength>kMaxRecordBytes)
+                break;
+            QByteArray payload=journal.read(nLength);
+            if(payload.size()!=qsizetype(nLength) || qChecksum(payload)!=nChecksum)
+                break;  //写入中途崩溃留下的残缺记录
+
+            QDataStream record(payload);
+            record.setVersion(QDataStream::Qt_6_0);
+            quint8 nOp;
+            record>>nOp;
+            if(nOp==OpAdd)
+            {
+                QStringList filePaths;
+                record>>filePaths;
+                for(const QString &filePath:filePaths)
+                    add(filePath);
+            }
+            else if(nOp==OpRemove)
+            {
+                QStringList filePaths;
+                record>>filePaths;
+                for(const QString &filePath:filePaths)
+                {
+                    auto it=rowByPath.find(filePath);
+                    if(it!=rowByPath.end())
+                    {
+                        entries[*it].clear();
+                        rowByPath.erase(it);
+                    }
+                }
+            }
+            else if(nOp==OpMove)
+            {
+                QString filePath;
+                qint32 nToRow;
+                record>>filePath>>nToRow;
+                int nFrom=rowByPath.value(filePath,-1);
+                if(nFrom<0)
+                    continue;
+
+                //目标行号按存活条目计数，找出它对应的槽位
+                int nTarget=qBound(0,int(nToRow),int(rowByPath.size())-1);
+                int nTo=nFrom;
+                for(int i=0,nRow=0;i<entries.size();i++)
+                {
+                    if(entries.at(i).isEmpty())
+                        continue;
+                    if(nRow==nTarget)
+                    {
+                        nTo=i;
+                        break;
+                    }
+                    nRow++;
+                }
+                if(nTo==nFrom)
+                    continue;
+
+                //只有两个槽位之间的条目行号变化
+                entries.move(nFrom,nTo);
+                for(int i=qMin(nFrom,nTo);i<=qMax(nFrom,nTo);i++)
+                {
+                    if(!entries.at(i).isEmpty())
+                        rowByPath[entries.at(i)]=i;
+                }
+            }
+        }
+    }
+
+    QStringList filePaths;
+    filePaths.reserve(rowByPath.size());
+    for(const QString &filePath:entries)
+    {
+        if(!filePath.isEmpty())
+            filePaths.append(filePath);
+    }
+    return filePaths;
+}
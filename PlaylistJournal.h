@@ -0,0 +1,48 @@
+/*
+ * 播放列表日志式持久化 每次编辑只向日志追加一条小记录（添加/移除/调整顺序）
+ * 日志积累到一定大小后在后台整理成快照（即default.m3u），启动时先读快照再重放日志
+ */
+
+#ifndef PLAYLISTJOURNAL_H
+#define PLAYLISTJOURNAL_H
+
+#include<QObject>
+#include<QFile>
+#include<QFuture>
+#include<QStringList>
+
+class PlaylistJournal : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PlaylistJournal(const QString &snapshotPath,QObject *parent=nullptr);
+    ~PlaylistJournal();
+
+    void recordAdd(const QStringList &filePaths);       //追加添加记录
+    void recordRemove(const QStringList &filePaths);    //追加移除记录
+    void recordMove(const QString &filePath,int toRow); //追加调整顺序记录
+
+    bool needsCompaction() const;                   //日志是否已经大到值得整理
+    bool isCompacting() const {return m_compaction.isRunning();}
+    void compact(const QStringList &filePaths);     //以当前完整列表为快照，在后台整理
+
+    static QStringList replay(const QString &snapshotPath); //读取快照并重放日志，得到完整列表
+
+private:
+    enum Op : quint8{
+        OpAdd = 1,
+        OpRemove = 2,
+        OpMove = 3
+    };
+
+    QString m_strSnapshotPath;  //快照文件
+    QFile m_journalFile;        //当前追加写入的日志
+    qint64 m_nRecords = 0;      //当前日志中的记录数
+    QFuture<void> m_compaction; //后台整理任务
+
+    void appendRecord(const QByteArray &payload);
+    static QString journalPath(const QString &snapshotPath);
+    static QString compactingPath(const QString &snapshotPath);
+};
+
+#endif // PLAYLISTJOURNAL_H
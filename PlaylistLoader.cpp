@@ -0,0 +1,103 @@
+#include "PlaylistLoader.h"
+
+#include<QFileInfo>
+#include<QElapsedTimer>
+#include<QtConcurrent>
+
+#include"PlaylistJournal.h"
+
+namespace {
+const int kBatchSize = 4096;    //每批送回GUI线程的条目数
+const int kStatThreads = 16;    //网络共享上stat延迟高，并发数按I/O而不是CPU定
+}
+
+PlaylistLoader::PlaylistLoader(QObject *parent)
+    : QObject(parent)
+{
+    m_statPool.setMaxThreadCount(kStatThreads);
+}
+
+PlaylistLoader::~PlaylistLoader()
+{
+    cancel();
+}
+
+void PlaylistLoader::load(const QString &filePath)
+{
+    cancel();
+    m_bCancel=false;
+    m_bLoading=true;
+    int nGeneration=++m_nGeneration;
+    m_future=QtConcurrent::run([this,filePath,nGeneration](){
+        run(filePath,nGeneration);
+    });
+}
+
+void PlaylistLoader::cancel()
+{
+    m_bCancel=true;
+    m_future.waitForFinished();
+    m_bLoading=false;
+}
+
+void PlaylistLoader::run(const QString &filePath,int nGeneration)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    //快照加日志重放得到完整列表（只是读文件，慢的是后面的stat）
+    QStringList filePaths=PlaylistJournal::replay(filePath);
+
+    int nCount=0;
+    int nMissing=0;
+    QList<QFuture<QString>> statJobs;
+
+    //先把整批条目送去显示，再把该批的存在性检查交给stat线程池
+    auto flushBatch=[&](QStringList &batch){
+        if(batch.isEmpty())
+            return;
+        nCount+=batch.size();
+        emit batchLoaded(batch);
+        statJobs.append(QtConcurrent::filtered(&m_statPool,batch,[](const QString &path){
+            return !QFileInfo::exists(path);
+        }));
+        batch.clear();
+    };
+
+    QStringList batch;
+    for(int i=0;i<filePaths.size() && !m_bCancel;i++)
+    {
+        batch.append(filePaths.at(i));
+        if(batch.size()>=kBatchSize)
+            flushBatch(batch);
+    }
+    flushBatch(batch);
+
+    //按批次顺序收集缺失结果
+    for(QFuture<QString> &job:statJobs)
+    {
+        if(m_bCancel)
+            job.cancel();
+        job.waitForFinished();
+        if(m_bCancel)
+            continue;
+
+        QStringList missing=job.results();
+        if(!missing.isEmpty())
+        {
+            nMissing+=missing.size();
+            emit missingFound(missing);
+        }
+    }
+
+    if(m_bCancel)
+        return;
+
+    //工作线程发出的排队调用按顺序送达，加载状态在所有批次之后、finished之前清除
+    //被取消后又开始的新加载，其状态不受旧任务影响
+    QMetaObject::invokeMethod(this,[this,nGeneration](){
+        if(nGeneration==m_nGeneration)
+            m_bLoading=false;
+    },Qt::QueuedConnection);
+    emit finished(nCount,nMissing,timer.elapsed());
+}
@@ -0,0 +1,41 @@
+/*
+ * 播放列表异步加载器 在工作线程中读取快照并重放日志，分批送回GUI线程
+ * 文件是否存在由独立线程池并行检查，缺失文件稍后单独标记，不阻塞列表显示
+ */
+
+#ifndef PLAYLISTLOADER_H
+#define PLAYLISTLOADER_H
+
+#include<QObject>
+#include<QStringList>
+#include<QThreadPool>
+#include<QFuture>
+#include<atomic>
+
+class PlaylistLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PlaylistLoader(QObject *parent=nullptr);
+    ~PlaylistLoader();
+
+    void load(const QString &filePath);     //开始异步加载
+    void cancel();                          //取消并等待工作线程退出
+    bool isLoading() const {return m_bLoading;}    //直到最后一批和finished都已送达GUI线程
+
+signals:
+    void batchLoaded(const QStringList &filePaths);     //一批条目已解析
+    void missingFound(const QStringList &filePaths);    //一批条目文件不存在
+    void finished(int nCount,int nMissing,qint64 elapsedMs);
+
+private:
+    QThreadPool m_statPool;             //并行stat用的线程池（I/O密集，线程数多于核数）
+    std::atomic_bool m_bCancel{false};
+    bool m_bLoading = false;            //只在GUI线程读写
+    int m_nGeneration = 0;              //每次load递增
+    QFuture<void> m_future;
+
+    void run(const QString &filePath,int nGeneration);  //工作线程主体
+};
+
+#endif // PLAYLISTLOADER_H
@@ -0,0 +1,235 @@
+#include "PlaylistModel.h"
+
+#include<climits>
+#include<algorithm>
+#include<QColor>
+
+namespace {
+QString formatDuration(qint64 milliseconds)
+{
+    qint64 seconds=milliseconds/1000;
+    if(seconds>=3600)
+        return QString("%1:%2:%3").arg(seconds/3600).arg(seconds/60%60,2,10,QChar('0')).arg(seconds%60,2,10,QChar('0'));
+    return QString("%1:%2").arg(seconds/60,2,10,QChar('0')).arg(seconds%60,2,10,QChar('0'));
+}
+}
+
+PlaylistModel::PlaylistModel(QObject *parent)
+    : QAbstractTableModel(parent)
+    , m_nDirtyFrom(INT_MAX)
+{
+}
+
+int PlaylistModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid()?0:m_entries.size();
+}
+
+int PlaylistModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid()?0:ColumnCount;
+}
+
+QVariant PlaylistModel::data(const QModelIndex &index,int role) const
+{
+    if(!index.isValid() || index.row()>=m_entries.size())
+        return QVariant();
+
+    const Entry &entry=m_entries.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case NameColumn:
+            //文件名只在显示时从路径截取，不单独存储
+            return entry.path.mid(entry.nameOffset);
+        case DurationColumn:
+            return entry.info.duration>=0?formatDuration(entry.info.duration):QString();
+        case ResolutionColumn:
+            if(entry.info.resolution.isValid())
+                return QString("%1×%2").arg(entry.info.resolution.width()).arg(entry.info.resolution.height());
+            break;
+        case CodecColumn:
+            if(entry.info.audioCodec.isEmpty())
+                return entry.info.videoCodec;
+            return entry.info.videoCodec.isEmpty()?entry.info.audioCodec:entry.info.videoCodec+"/"+entry.info.audioCodec;
+        case BitRateColumn:
+            if(entry.info.bitRate>0)
+                return QString("%1 kbps").arg(entry.info.bitRate/1000);
+            break;
+        default:
+            break;
+        }
+        break;
+    case Qt::TextAlignmentRole:
+        if(index.column()!=NameColumn && index.column()!=CodecColumn)
+            return int(Qt::AlignRight|Qt::AlignVCenter);
+        break;
+    case Qt::ToolTipRole:
+        return entry.missing?entry.path+"（文件不存在）":entry.path;
+    case Qt::ForegroundRole:
+        if(entry.missing)
+            return QColor("#808080");
+        break;
+    case FilePathRole:
+        return entry.path;
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+QVariant PlaylistModel::headerData(int section,Qt::Orientation orientation,int role) const
+{
+    if(orientation!=Qt::Horizontal || role!=Qt::DisplayRole)
+        return QVariant();
+
+    switch (section) {
+    case NameColumn:
+        return "文件名";
+    case DurationColumn:
+        return "时长";
+    case ResolutionColumn:
+        return "分辨率";
+    case CodecColumn:
+        return "编码";
+    case BitRateColumn:
+        return "码率";
+    default:
+        return QVariant();
+    }
+}
+
+bool PlaylistModel::removeRows(int row,int count,const QModelIndex &parent)
+{
+    if(parent.isValid() || row<0 || count<=0 || row+count>m_entries.size())
+        return false;
+
+    beginRemoveRows(QModelIndex(),row,row+count-1);
+    for(int i=row;i<row+count;i++)
+        m_rowByPath.remove(m_entries.at(i).path);
+    m_entries.remove(row,count);
+    markDirtyFrom(row);
+    endRemoveRows();
+    return true;
+}
+
+int PlaylistModel::appendPaths(const QStringList &filePaths)
+{
+    //先去重再一次性插入，视图只收到一次通知
+    QVector<Entry> newEntries;
+    newEntries.reserve(filePaths.size());
+    for(const QString &filePath:filePaths)
+    {
+        if(filePath.isEmpty() || m_rowByPath.contains(filePath))
+            continue;
+        m_rowByPath.insert(filePath,m_entries.size()+newEntries.size());
+        int nNameOffset=int(qMax(filePath.lastIndexOf('/'),filePath.lastIndexOf('\\')))+1;
+        newEntries.append({filePath,nNameOffset});
+    }
+    if(newEntries.isEmpty())
+        return -1;
+
+    int nFirst=m_entries.size();
+    beginInsertRows(QModelIndex(),nFirst,nFirst+newEntries.size()-1);
+    m_entries.append(newEntries);
+    endInsertRows();
+    return nFirst;
+}
+
+void PlaylistModel::removeRowList(QList<int> rows)
+{
+    //从后往前按连续区间删除，每个区间只移动一次内存
+    std::sort(rows.begin(),rows.end());
+    rows.erase(std::unique(rows.begin(),rows.end()),rows.end());
+    int i=rows.size()-1;
+    while(i>=0)
+    {
+        int nLast=rows[i];
+        int nFirst=nLast;
+        while(i>0 && rows[i-1]==nFirst-1)
+            nFirst=rows[--i];
+        removeRows(nFirst,nLast-nFirst+1);
+        i--;
+    }
+}
+
+void PlaylistModel::markMissing(const QStringList &filePaths)
+{
+    for(const QString &filePath:filePaths)
+    {
+        int nRow=rowOf(filePath);
+        if(nRow<0 || m_entries[nRow].missing)
+            continue;
+        m_entries[nRow].missing=true;
+        emit dataChanged(index(nRow,0),index(nRow,ColumnCount-1),{Qt::ToolTipRole,Qt::ForegroundRole});
+    }
+}
+
+void PlaylistModel::setMediaInfo(const QStringList &filePaths,const QVector<MediaInfo> &infos)
+{
+    //一批结果只发一次通知，覆盖受影响行的范围
+    int nFirst=INT_MAX;
+    int nLast=-1;
+    for(int i=0;i<filePaths.size();i++)
+    {
+        int nRow=rowOf(filePaths.at(i));
+        if(nRow<0)
+            continue;
+        m_entries[nRow].info=infos.at(i);
+        nFirst=qMin(nFirst,nRow);
+        nLast=qMax(nLast,nRow);
+    }
+    if(nLast>=0)
+        emit dataChanged(index(nFirst,DurationColumn),index(nLast,ColumnCount-1),{Qt::DisplayRole});
+}
+
+bool PlaylistModel::moveEntry(int from,int to)
+{
+    if(from==to || from<0 || to<0 || from>=m_entries.size() || to>=m_entries.size())
+        return false;
+
+    //beginMoveRows的目标行是“移动到该行之前”
+    beginMoveRows(QModelIndex(),from,from,QModelIndex(),to>from?to+1:to);
+    m_entries.move(from,to);
+    markDirtyFrom(qMin(from,to));
+    endMoveRows();
+    return true;
+}
+
+void PlaylistModel::clear()
+{
+    beginResetModel();
+    m_entries.clear();
+    m_rowByPath.clear();
+    m_nDirtyFrom=INT_MAX;
+    endResetModel();
+}
+
+int PlaylistModel::rowOf(const QString &filePath) const
+{
+    auto it=m_rowByPath.constFind(filePath);
+    if(it==m_rowByPath.constEnd())
+        return -1;
+    if(*it<m_nDirtyFrom)
+        return *it;
+
+    //删除导致后面的行号整体前移，查到过期部分时一次性重建
+    for(int row=m_nDirtyFrom;row<m_entries.size();row++)
+        m_rowByPath[m_entries.at(row).path]=row;
+    m_nDirtyFrom=INT_MAX;
+    return m_rowByPath.value(filePath,-1);
+}
+
+QStringList PlaylistModel::filePaths() const
+{
+    QStringList paths;
+    paths.reserve(m_entries.size());
+    for(const Entry &entry:m_entries)
+        paths.append(entry.path);
+    return paths;
+}
+
+void PlaylistModel::markDirtyFrom(int row)
+{
+    m_nDirtyFrom=qMin(m_nDirtyFrom,row);
+}
@@ -0,0 +1,70 @@
+/*
+ * 播放列表模型 条目连续存放，路径字符串与哈希索引共享同一份数据
+ * 路径到行号的查找为O(1)，删除后只在需要时重建受影响部分的索引
+ * 元数据（时长、分辨率等）由后台探测器分批填入，按列显示
+ */
+
+#ifndef PLAYLISTMODEL_H
+#define PLAYLISTMODEL_H
+
+#include<QAbstractTableModel>
+#include<QHash>
+#include<QVector>
+#include<QStringList>
+
+#include"MetadataCache.h"
+
+class PlaylistModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum Roles{
+        FilePathRole = Qt::UserRole     //文件完整路径
+    };
+    enum Columns{
+        NameColumn,         //文件名
+        DurationColumn,     //时长
+        ResolutionColumn,   //分辨率
+        CodecColumn,        //编码
+        BitRateColumn,      //码率
+        ColumnCount
+    };
+
+    explicit PlaylistModel(QObject *parent=nullptr);
+
+    int rowCount(const QModelIndex &parent=QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent=QModelIndex()) const override;
+    QVariant data(const QModelIndex &index,int role=Qt::DisplayRole) const override;
+    QVariant headerData(int section,Qt::Orientation orientation,int role=Qt::DisplayRole) const override;
+    bool removeRows(int row,int count,const QModelIndex &parent=QModelIndex()) override;
+
+    int appendPaths(const QStringList &filePaths);  //批量追加（忽略重复路径），返回第一条新行号，无新增返回-1
+    void removeRowList(QList<int> rows);            //批量删除任意行
+    void markMissing(const QStringList &filePaths); //标记文件不存在的条目
+    void setMediaInfo(const QStringList &filePaths,const QVector<MediaInfo> &infos);  //填入探测结果
+    bool moveEntry(int from,int to);                //调整条目顺序
+    void clear();
+
+    int rowOf(const QString &filePath) const;       //路径所在行，不存在返回-1
+    QString filePath(int row) const {return m_entries.at(row).path;}
+    QStringView fileName(int row) const {return QStringView(m_entries.at(row).path).mid(m_entries.at(row).nameOffset);}
+    const MediaInfo &mediaInfo(int row) const {return m_entries.at(row).info;}
+    QStringList filePaths() const;                  //按顺序导出全部路径
+
+private:
+    struct Entry
+    {
+        QString path;       //与m_rowByPath的键共享数据
+        int nameOffset;     //文件名在路径中的起始位置
+        bool missing = false;   //文件不存在（后台检查得出）
+        MediaInfo info;         //探测结果，未探测时时长为-1
+    };
+    QVector<Entry> m_entries;
+
+    mutable QHash<QString,int> m_rowByPath; //路径——行号
+    mutable int m_nDirtyFrom;               //从该行开始的索引值已过期
+
+    void markDirtyFrom(int row);
+};
+
+#endif // PLAYLISTMODEL_H
@@ -0,0 +1,99 @@
+#include "PlaylistProxyModel.h"
+
+#include<QRegularExpression>
+
+PlaylistProxyModel::PlaylistProxyModel(PlaylistModel *model,QObject *parent)
+    : QSortFilterProxyModel(parent)
+    , m_model(model)
+{
+    setSourceModel(model);
+}
+
+void PlaylistProxyModel::setFilterText(const QString &text)
+{
+    static const QRegularExpression condition("^(>=|<=|>|<|=)?(\\d+(?:\\.\\d+)?)(s|m|h|p)$",
+                                              QRegularExpression::CaseInsensitiveOption);
+
+    m_words.clear();
+    m_duration=Range();
+    m_height=Range();
+    for(const QString &token:text.split(' ',Qt::SkipEmptyParts))
+    {
+        QRegularExpressionMatch match=condition.match(token);
+        QString op=match.captured(1);
+        QChar unit=match.hasMatch()?match.captured(3).at(0).toLower():QChar();
+
+        //时长条件必须带比较符，否则“10m”之类的词也可能是文件名的一部分
+        if(!match.hasMatch() || (unit!='p' && op.isEmpty()))
+        {
+            m_words.append(token);
+            continue;
+        }
+
+        double dValue=match.captured(2).toDouble();
+        Range *range=&m_height;
+        qint64 value=qint64(dValue);
+        if(unit!='p')
+        {
+            range=&m_duration;
+            value=qint64(dValue*(unit=='h'?3600000:unit=='m'?60000:1000));
+        }
+
+        if(op==">")
+            range->min=value+1;
+        else if(op==">=")
+            range->min=value;
+        else if(op=="<")
+            range->max=value-1;
+        else if(op=="<=")
+            range->max=value;
+        else
+            range->min=range->max=value;
+    }
+
+    m_bFiltered=!m_words.isEmpty() || m_duration.min>=0 || m_duration.max>=0 || m_height.min>=0 || m_height.max>=0;
+    invalidateFilter();
+}
+
+bool PlaylistProxyModel::filterAcceptsRow(int sourceRow,const QModelIndex &sourceParent) const
+{
+    if(!m_bFiltered || sourceParent.isValid())
+        return true;
+
+    const MediaInfo &info=m_model->mediaInfo(sourceRow);
+    if((m_duration.min>=0 || m_duration.max>=0) && (info.duration<0 || !inRange(m_duration,info.duration)))
+        return false;
+    if((m_height.min>=0 || m_height.max>=0) && (!info.resolution.isValid() || !inRange(m_height,info.resolution.height())))
+        return false;
+
+    QStringView fileName=m_model->fileName(sourceRow);
+    for(const QString &word:m_words)
+    {
+        if(!fileName.contains(word,Qt::CaseInsensitive))
+            return false;
+    }
+    return true;
+}
+
+bool PlaylistProxyModel::lessThan(const QModelIndex &left,const QModelIndex &right) const
+{
+    const MediaInfo &a=m_model->mediaInfo(left.row());
+    const MediaInfo &b=m_model->mediaInfo(right.row());
+    switch (left.column()) {
+    case PlaylistModel::DurationColumn:
+        return a.duration<b.duration;
+    case PlaylistModel::ResolutionColumn:
+        return qint64(a.resolution.width())*a.resolution.height()<qint64(b.resolution.width())*b.resolution.height();
+    case PlaylistModel::CodecColumn:
+        return a.videoCodec.compare(b.videoCodec,Qt::CaseInsensitive)<0;
+    case PlaylistModel::BitRateColumn:
+        return a.bitRate<b.bitRate;
+    default:
+        return m_model->fileName(left.row()).compare(m_model->fileName(right.row()),Qt::CaseInsensitive)<0;
+    }
+}
+
+bool PlaylistProxyModel::inRange(const Range &range,qint64 value)
+{
+    return (range.min<0 || value>=range.min) && (range.max<0 || value<=range.max);
+}
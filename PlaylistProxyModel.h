@@ -0,0 +1,44 @@
+/*
+ * 播放列表排序筛选代理 直接读取条目的元数据比较，不经过QVariant
+ * 筛选语法：普通文字匹配文件名；>10m、<=90s、>1h 按时长；>=1080p、720p 按分辨率高度
+ */
+
+#ifndef PLAYLISTPROXYMODEL_H
+#define PLAYLISTPROXYMODEL_H
+
+#include<QSortFilterProxyModel>
+#include<QStringList>
+
+#include"PlaylistModel.h"
+
+class PlaylistProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+public:
+    explicit PlaylistProxyModel(PlaylistModel *model,QObject *parent=nullptr);
+
+    void setFilterText(const QString &text);    //按筛选语法解析并立即生效
+    bool isFiltered() const {return m_bFiltered;}
+
+protected:
+    bool filterAcceptsRow(int sourceRow,const QModelIndex &sourceParent) const override;
+    bool lessThan(const QModelIndex &left,const QModelIndex &right) const override;
+
+private:
+    //数值范围条件
+    struct Range
+    {
+        qint64 min = -1;    //下限（含），-1表示不限
+        qint64 max = -1;    //上限（含），-1表示不限
+    };
+
+    PlaylistModel *m_model;
+    QStringList m_words;        //文件名需要包含的词
+    Range m_duration;           //时长范围（毫秒）
+    Range m_height;             //分辨率高度范围
+    bool m_bFiltered = false;
+
+    static bool inRange(const Range &range,qint64 value);
+};
+
+#endif // PLAYLISTPROXYMODEL_H
@@ -0,0 +1,354 @@
+#include "ReadAheadDevice.h"
+
+#include<QStorageInfo>
+#include<QElapsedTimer>
+#include<QDeadlineTimer>
+#include<QVarLengthArray>
+#include<QSet>
+#include<cstring>
+
+namespace {
+const int kMaxRetries = 6;          //读盘失败后的重试次数
+const int kRetryBaseMs = 100;       //第一次重试前的等待，之后每次加倍（合计约6秒）
+}
+
+#ifdef Q_OS_UNIX
+#include<sys/mman.h>
+#include<unistd.h>
+#endif
+
+ReadAheadDevice::ReadAheadDevice(const QString &filePath,const Options &options,QObject *parent)
+    : QIODevice(parent)
+    , m_strFilePath(filePath)
+    , m_options(options)
+{
+    //缓存至少要放得下预读范围再多两块，否则预读的块会被自己挤掉
+    m_options.blockSize=qMax<qint64>(64*1024,m_options.blockSize);
+    m_options.readAheadBytes=qMax(m_options.blockSize,m_options.readAheadBytes);
+    m_options.cacheBytes=qMax(m_options.cacheBytes,m_options.readAheadBytes+2*m_options.blockSize);
+}
+
+ReadAheadDevice::~ReadAheadDevice()
+{
+    close();
+}
+
+bool ReadAheadDevice::shouldMap() const
+{
+    if(m_options.mapMode!=MapAuto)
+        return m_options.mapMode==MapAlways;
+
+    //网络文件系统上缺页要等网络往返，交给后台线程大块读取更稳
+    static const QSet<QByteArray> networkFileSystems={
+        "nfs","nfs4","cifs","smb3","smbfs","fuse.sshfs","9p","davfs","afs","ceph","glusterfs"
+    };
+    return !networkFileSystems.contains(QStorageInfo(m_strFilePath).fileSystemType().toLower());
+}
+
+bool ReadAheadDevice::open(OpenMode mode)
+{
+    if(mode&WriteOnly)
+        return false;
+
+    m_file.setFileName(m_strFilePath);
+    if(!m_file.open(QIODevice::ReadOnly))
+    {
+        setErrorString(m_file.errorString());
+        return false;
+    }
+    m_nSize=m_file.size();
+
+    QStorageInfo storage(m_strFilePath);
+    m_stats=Stats();
+    m_stats.fileSystem=QString("%1 (%2)").arg(storage.rootPath(),QString::fromLatin1(storage.fileSystemType()));
+
+    if(m_nSize>0 && shouldMap())
+        m_map=m_file.map(0,m_nSize);
+    m_stats.mapped=m_map!=nullptr;
+
+    if(!m_map)
+    {
+        m_bStop=false;
+        m_bError=false;
+        m_worker=QThread::create([this](){prefetchLoop();});
+        m_worker->start();
+    }
+
+    //自身已经按块缓存，不需要QIODevice再缓冲一层
+    return QIODevice::open(mode|Unbuffered);
+}
+
+void ReadAheadDevice::close()
+{
+    if(m_worker)
+    {
+        {
+            QMutexLocker lock(&m_mutex);
+            m_bStop=true;
+            m_wakeWorker.wakeAll();
+            m_blockReady.wakeAll();
+        }
+        m_worker->wait();
+        delete m_worker;
+        m_worker=nullptr;
+    }
+    if(m_map)
+    {
+        m_file.unmap(m_map);
+        m_map=nullptr;
+    }
+    m_file.close();
+    m_blocks.clear();
+    if(isOpen())
+        QIODevice::close();
+}
+
+bool ReadAheadDevice::seek(qint64 pos)
+{
+    if(!QIODevice::seek(pos))
+        return false;
+
+    QMutexLocker lock(&m_mutex);
+    if(qAbs(pos-m_nLastReadEnd)>m_options.blockSize)
+        m_stats.seeks++;
+    if(!m_map)
+    {
+        m_nReadBlock=pos/m_options.blockSize;
+        m_wakeWorker.wakeOne();
+    }
+    return true;
+}
+
+ReadAheadDevice::Stats ReadAheadDevice::stats() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_stats;
+}
+
+qint64 ReadAheadDevice::readData(char *data,qint64 maxSize)
+{
+    qint64 pos=this->pos();
+    if(pos>=m_nSize)
+        return 0;
+
+    qint64 nBytes=qMin(maxSize,m_nSize-pos);
+    qint64 nRead=m_map?readMapped(data,pos,nBytes):readBuffered(data,pos,nBytes);
+    if(nRead>0)
+    {
+        QMutexLocker lock(&m_mutex);
+        m_nLastReadEnd=pos+nRead;
+    }
+    return nRead;
+}
+
+qint64 ReadAheadDevice::writeData(const char *data,qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
+
+qint64 ReadAheadDevice::readMapped(char *data,qint64 pos,qint64 nBytes)
+{
+    bool bResident=true;
+#ifdef Q_OS_UNIX
+    static const qint64 nPageSize=sysconf(_SC_PAGESIZE);
+
+    //跳出已通知的范围（随机定位）或读过一半时，通知内核预读后面一段
+    if(pos<m_nAdvisedFrom || pos>m_nAdvisedUntil || pos+nBytes>m_nAdvisedUntil-m_options.readAheadBytes/2)
+    {
+        qint64 nFrom=(pos<m_nAdvisedFrom || pos>m_nAdvisedUntil)?pos:m_nAdvisedUntil;
+        nFrom=nFrom/nPageSize*nPageSize;
+        qint64 nUntil=qMin(m_nSize,pos+m_options.readAheadBytes);
+        if(nUntil>nFrom)
+            madvise(m_map+nFrom,size_t(nUntil-nFrom),MADV_WILLNEED);
+        m_nAdvisedFrom=pos;
+        m_nAdvisedUntil=nUntil;
+    }
+
+#ifdef Q_OS_LINUX
+    //拷贝前检查页面是否已在内存中，不在说明这次读取要等磁盘
+    qint64 nStart=pos/nPageSize*nPageSize;
+    qint64 nPages=(pos+nBytes-nStart+nPageSize-1)/nPageSize;
+    QVarLengthArray<unsigned char,64> residency(nPages);
+    if(mincore(m_map+nStart,size_t(pos+nBytes-nStart),residency.data())==0)
+    {
+        for(unsigned char page:residency)
+        {
+            if(!(page&1))
+            {
+                bResident=false;
+                break;
+            }
+        }
+    }
+#endif
+#endif
+
+    QElapsedTimer timer;
+    timer.start();
+    std::memcpy(data,m_map+pos,size_t(nBytes));
+
+    QMutexLocker lock(&m_mutex);
+    recordReadLocked(nBytes,bResident?-1:timer.nsecsElapsed()/1000);
+    return nBytes;
+}
+
+qint64 ReadAheadDevice::readBuffered(char *data,qint64 pos,qint64 nBytes)
+{
+    QMutexLocker lock(&m_mutex);
+    qint64 nCopied=0;
+    qint64 stallUs=-1;
+    while(nCopied<nBytes)
+    {
+        qint64 nBlock=(pos+nCopied)/m_options.blockSize;
+        qint64 nOffset=(pos+nCopied)%m_options.blockSize;
+        if(nBlock!=m_nReadBlock)
+        {
+            m_nReadBlock=nBlock;
+            m_wakeWorker.wakeOne();
+        }
+
+        //缓存未命中：让预读线程优先读这一块，等它读完
+        auto it=m_blocks.find(nBlock);
+        if(it==m_blocks.end())
+        {
+            QElapsedTimer timer;
+            timer.start();
+            m_nWantedBlock=nBlock;
+            m_wakeWorker.wakeOne();
+            while(!m_blocks.contains(nBlock) && !m_bError && !m_bStop)
+                m_blockReady.wait(&m_mutex);
+            stallUs=qMax<qint64>(0,stallUs)+timer.nsecsElapsed()/1000;
+            it=m_blocks.find(nBlock);
+            if(it==m_blocks.end())
+                break;
+        }
+
+        it->lastUse=++m_nUseCounter;
+        qint64 nChunk=qMin(nBytes-nCopied,qint64(it->data.size())-nOffset);
+        if(nChunk<=0)
+            break;
+        std::memcpy(data+nCopied,it->data.constData()+nOffset,size_t(nChunk));
+        nCopied+=nChunk;
+    }
+
+    if(nCopied==0 && m_bError)
+        return -1;
+    recordReadLocked(nCopied,stallUs);
+    return nCopied;
+}
+
+void ReadAheadDevice::prefetchLoop()
+{
+    //预读线程使用自己的文件句柄
+    QFile file(m_strFilePath);
+    QMutexLocker lock(&m_mutex);
+    int nAttempt=0;
+    while(!file.open(QIODevice::ReadOnly))
+    {
+        if(!waitRetryLocked(nAttempt++))
+            return;
+    }
+    nAttempt=0;
+
+    qint64 nLastBlock=(m_nSize-1)/m_options.blockSize;
+    qint64 nAheadBlocks=m_options.readAheadBytes/m_options.blockSize;
+    while(!m_bStop)
+    {
+        //播放器正在等的块最优先，其次是读取位置之后预读范围内缺的块
+        qint64 nTarget=-1;
+        if(m_nWantedBlock>=0 && !m_blocks.contains(m_nWantedBlock))
+        {
+            nTarget=m_nWantedBlock;
+        }
+        else
+        {
+            m_nWantedBlock=-1;
+            for(qint64 nBlock=m_nReadBlock;nBlock<=qMin(nLastBlock,m_nReadBlock+nAheadBlocks);nBlock++)
+            {
+                if(!m_blocks.contains(nBlock))
+                {
+                    nTarget=nBlock;
+                    break;
+                }
+            }
+        }
+        if(nTarget<0)
+        {
+            m_wakeWorker.wait(&m_mutex);
+            continue;
+        }
+
+        //读盘时不持锁，播放器可以继续读已缓存的块
+        lock.unlock();
+        QByteArray data;
+        if(file.seek(nTarget*m_options.blockSize))
+            data=file.read(m_options.blockSize);
+        if(data.isEmpty())
+        {
+            //网络盘断开后旧句柄可能一直失效，重试前重新打开
+            file.close();
+            file.open(QIODevice::ReadOnly);
+        }
+        lock.relock();
+
+        if(data.isEmpty())
+        {
+            if(!waitRetryLocked(nAttempt++))
+                break;
+            continue;
+        }
+        nAttempt=0;
+        Block &block=m_blocks[nTarget];
+        block.data=data;
+        block.lastUse=++m_nUseCounter;
+        m_stats.prefetchedBytes+=data.size();
+        evictLocked();
+        m_blockReady.wakeAll();
+    }
+}
+
+bool ReadAheadDevice::waitRetryLocked(int nAttempt)
+{
+    //等待期间播放器照常读已缓存的块，等不到的读取继续阻塞；关闭时立即结束等待
+    if(nAttempt>=kMaxRetries)
+    {
+        m_bError=true;
+        m_blockReady.wakeAll();
+        return false;
+    }
+    m_stats.retries++;
+    QDeadlineTimer deadline(kRetryBaseMs<<nAttempt);
+    while(!m_bStop && !deadline.hasExpired())
+        m_wakeWorker.wait(&m_mutex,deadline);
+    return !m_bStop;
+}
+
+void ReadAheadDevice::evictLocked()
+{
+    qint64 nCapacity=m_options.cacheBytes/m_options.blockSize;
+    while(m_blocks.size()>nCapacity)
+    {
+        auto oldest=m_blocks.begin();
+        for(auto it=m_blocks.begin();it!=m_blocks.end();++it)
+        {
+            if(it->lastUse<oldest->lastUse)
+                oldest=it;
+        }
+        m_blocks.erase(oldest);
+    }
+}
+
+void ReadAheadDevice::recordReadLocked(qint64 nBytes,qint64 stallUs)
+{
+    m_stats.bytesRead+=nBytes;
+    if(stallUs<0)
+    {
+        m_stats.hitReads++;
+        return;
+    }
+    m_stats.stallReads++;
+    m_stats.stallTimeUs+=stallUs;
+    m_stats.maxStallUs=qMax(m_stats.maxStallUs,stallUs);
+}
@@ -0,0 +1,107 @@
+/*
+ * 预读数据源 通过setSourceDevice交给播放器，代替后端直接读文件
+ * 能映射的文件用mmap读取并提前通知内核预读；网络盘等不适合映射的文件由后台线程按块大段预读到有界缓存
+ * 随机定位命中已缓存的块时不等待磁盘；命中和卡顿次数可供按挂载点调整参数
+ * 后台读盘失败时重新打开文件、按递增间隔重试，网络盘短暂断开不会让播放中止
+ */
+
+#ifndef READAHEADDEVICE_H
+#define READAHEADDEVICE_H
+
+#include<QIODevice>
+#include<QFile>
+#include<QHash>
+#include<QMutex>
+#include<QWaitCondition>
+#include<QThread>
+
+class ReadAheadDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    enum MapMode{
+        MapAuto,        //本地文件系统用mmap，网络文件系统用后台预读
+        MapAlways,      //能映射就映射
+        MapNever        //始终用后台预读
+    };
+
+    struct Options
+    {
+        qint64 blockSize = 1024*1024;           //缓存块大小
+        qint64 readAheadBytes = 32*1024*1024;   //当前读取位置之后预读的范围
+        qint64 cacheBytes = 96*1024*1024;       //缓存上限（不小于预读范围）
+        MapMode mapMode = MapAuto;
+    };
+
+    struct Stats
+    {
+        bool mapped = false;        //是否为mmap方式
+        QString fileSystem;         //所在挂载点和文件系统类型
+        qint64 bytesRead = 0;       //播放器读取的总字节数
+        qint64 hitReads = 0;        //数据已就绪的读取次数
+        qint64 stallReads = 0;      //需要等待磁盘的读取次数
+        qint64 stallTimeUs = 0;     //累计等待时间
+        qint64 maxStallUs = 0;      //最长一次等待
+        qint64 prefetchedBytes = 0; //后台预读的字节数
+        int seeks = 0;              //跨块的随机定位次数
+        int retries = 0;            //读盘失败后重试的次数
+    };
+
+    explicit ReadAheadDevice(const QString &filePath,const Options &options=Options(),QObject *parent=nullptr);
+    ~ReadAheadDevice();
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override {return false;}
+    qint64 size() const override {return m_nSize;}
+    bool seek(qint64 pos) override;
+
+    QString filePath() const {return m_strFilePath;}
+    Stats stats() const;
+
+protected:
+    qint64 readData(char *data,qint64 maxSize) override;
+    qint64 writeData(const char *data,qint64 maxSize) override;
+
+private:
+    struct Block
+    {
+        QByteArray data;
+        quint64 lastUse = 0;    //最近使用的序号，用于LRU淘汰
+    };
+
+    QString m_strFilePath;
+    Options m_options;
+    QFile m_file;
+    qint64 m_nSize = 0;
+
+    //mmap方式
+    uchar *m_map = nullptr;
+    qint64 m_nAdvisedFrom = 0;      //上次通知内核预读时的读取位置
+    qint64 m_nAdvisedUntil = 0;     //已通知内核预读到的位置
+
+    //后台预读方式：播放器线程读取，预读线程填充，共用一把锁
+    mutable QMutex m_mutex;
+    QWaitCondition m_blockReady;    //有新块入缓存
+    QWaitCondition m_wakeWorker;    //读取位置变化或有块急需
+    QHash<qint64,Block> m_blocks;   //块序号——数据
+    qint64 m_nReadBlock = 0;        //播放器当前读取的块
+    qint64 m_nWantedBlock = -1;     //播放器正在等待的块
+    quint64 m_nUseCounter = 0;
+    bool m_bStop = false;
+    bool m_bError = false;          //重试用尽仍读不出来，之后的读取返回错误
+    QThread *m_worker = nullptr;
+
+    Stats m_stats;
+    qint64 m_nLastReadEnd = 0;      //上次读取结束的位置，用于识别随机定位
+
+    qint64 readMapped(char *data,qint64 pos,qint64 nBytes);
+    qint64 readBuffered(char *data,qint64 pos,qint64 nBytes);
+    void prefetchLoop();            //预读线程主循环
+    bool waitRetryLocked(int nAttempt); //读盘失败后等待一段再试，停止或重试用尽时返回false
+    void evictLocked();             //超出缓存上限时淘汰最久未用的块
+    void recordReadLocked(qint64 nBytes,qint64 stallUs);    //stallUs<0表示数据已就绪
+    bool shouldMap() const;
+};
+
+#endif // READAHEADDEVICE_H
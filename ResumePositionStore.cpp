@@ -0,0 +1,168 @@
+#include "ResumePositionStore.h"
+
+#include<QFile>
+#include<QSaveFile>
+#include<QDataStream>
+#include<QDateTime>
+#include<QFutureWatcher>
+#include<QtConcurrent>
+#include<algorithm>
+
+namespace {
+const quint32 kResumeMagic = 0x46535250;    //"FSRP"
+const quint16 kResumeVersion = 1;
+const int kFlushIntervalMs = 10000;         //定期落盘间隔
+const qint64 kMinRecordBytes = 4+2*8;       //一条记录最少占用的字节数（空路径加两个整数）
+}
+
+ResumePositionStore::ResumePositionStore(const QString &filePath,QObject *parent,int nCapacity)
+    : QObject(parent)
+    , m_strFilePath(filePath)
+    , m_nCapacity(nCapacity)
+{
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setInterval(kFlushIntervalMs);
+    connect(m_flushTimer,&QTimer::timeout,this,&ResumePositionStore::flushInBackground);
+    m_flushTimer->start();
+}
+
+ResumePositionStore::~ResumePositionStore()
+{
+    flush();
+}
+
+int ResumePositionStore::intern(const QString &filePath)
+{
+    auto it=m_idByPath.constFind(filePath);
+    if(it!=m_idByPath.constEnd())
+        return *it;
+
+    int nId=m_records.size();
+    Record record;
+    record.filePath=filePath;
+    m_records.append(record);
+    m_idByPath.insert(filePath,nId);
+    return nId;
+}
+
+qint64 ResumePositionStore::position(int nId) const
+{
+    if(nId<0 || nId>=m_records.size())
+        return 0;
+    return m_records.at(nId).position;
+}
+
+void ResumePositionStore::setPosition(int nId,qint64 position)
+{
+    if(nId<0 || nId>=m_records.size())
+        return;
+
+    Record &record=m_records[nId];
+    if(record.position==position)
+        return;
+    record.position=position;
+    record.updated=QDateTime::currentMSecsSinceEpoch();
+    m_bDirty=true;
+}
+
+void ResumePositionStore::load()
+{
+    QFile file(m_strFilePath);
+    if(!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 nMagic;
+    quint16 nVersion;
+    quint32 nCount;
+    in>>nMagic>>nVersion>>nCount;
+    if(in.status()!=QDataStream::Ok || nMagic!=kResumeMagic || nVersion>kResumeVersion)
+        return;
+
+    //条目数取自磁盘，损坏的文件可能给出极大的值；写入时最多保留m_nCapacity条，剩余字节也要容纳得下
+    qint64 nReserve=qMin<qint64>(qMin<qint64>(nCount,m_nCapacity),(file.size()-file.pos())/kMinRecordBytes);
+    m_records.reserve(m_records.size()+nReserve);
+    for(quint32 i=0;i<nCount;i++)
+    {
+        QString filePath;
+        qint64 nPosition,nUpdated;
+        in>>filePath>>nPosition>>nUpdated;
+        if(in.status()!=QDataStream::Ok)
+            break;
+
+        Record &record=m_records[intern(filePath)];
+        record.position=nPosition;
+        record.updated=nUpdated;
+    }
+}
+
+void ResumePositionStore::flush()
+{
+    //先等后台那一份写完，失败的话由这次同步写入补上
+    if(m_bFlushing)
+    {
+        m_flushJob.waitForFinished();
+        m_bFlushing=false;
+        if(!m_flushJob.result())
+            m_bDirty=true;
+    }
+    if(!m_bDirty)
+        return;
+    if(writeRecords(m_strFilePath,snapshot()))
+        m_bDirty=false;
+}
+
+void ResumePositionStore::flushInBackground()
+{
+    //慢速或网络上的主目录写入和fsync可能很久，定期落盘不能卡住播放
+    if(!m_bDirty || m_bFlushing)
+        return;
+
+    m_bDirty=false;
+    m_bFlushing=true;
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher,&QFutureWatcher<bool>::finished,this,[this,watcher](){
+        watcher->deleteLater();
+        if(!m_bFlushing)
+            return;
+        m_bFlushing=false;
+        if(!watcher->result())
+            m_bDirty=true;
+    });
+    m_flushJob=QtConcurrent::run(&ResumePositionStore::writeRecords,m_strFilePath,snapshot());
+    watcher->setFuture(m_flushJob);
+}
+
+QVector<ResumePositionStore::Record> ResumePositionStore::snapshot() const
+{
+    //只写有位置的记录；超出上限时丢弃最久未更新的
+    QVector<Record> records;
+    records.reserve(m_records.size());
+    for(const Record &record:m_records)
+    {
+        if(record.position>0)
+            records.append(record);
+    }
+    if(records.size()>m_nCapacity)
+    {
+        std::nth_element(records.begin(),records.begin()+m_nCapacity,records.end(),
+                         [](const Record &a,const Record &b){return a.updated>b.updated;});
+        records.resize(m_nCapacity);
+    }
+    return records;
+}
+
+bool ResumePositionStore::writeRecords(const QString &filePath,const QVector<Record> &records)
+{
+    QSaveFile file(filePath);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out<<kResumeMagic<<kResumeVersion<<quint32(records.size());
+    for(const Record &record:records)
+        out<<record.filePath<<record.position<<record.updated;
+    return file.commit();
+}
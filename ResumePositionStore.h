@@ -0,0 +1,51 @@
+/*
+ * 续播位置表 文件路径只在打开时驻留一次换成整数ID，播放过程中按ID更新位置
+ * 位置表定期在线程池中写入紧凑的二进制文件（GUI线程只做快照），退出时同步再写一次，下次启动可以继续播放
+ */
+
+#ifndef RESUMEPOSITIONSTORE_H
+#define RESUMEPOSITIONSTORE_H
+
+#include<QObject>
+#include<QHash>
+#include<QVector>
+#include<QTimer>
+#include<QFuture>
+
+class ResumePositionStore : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ResumePositionStore(const QString &filePath,QObject *parent=nullptr,int nCapacity=20000);
+    ~ResumePositionStore();
+
+    int intern(const QString &filePath);            //路径换成ID（不存在则新建）
+    qint64 position(int nId) const;                 //记录的位置，没有记录返回0
+    void setPosition(int nId,qint64 position);      //更新位置（只改内存，定期落盘）
+
+    void load();
+    void flush();                                   //等后台写入结束后立即同步写入（退出时）
+
+private:
+    struct Record
+    {
+        QString filePath;
+        qint64 position = 0;    //播放位置（毫秒），0表示从头播放
+        qint64 updated = 0;     //最后更新时间（毫秒时间戳），用于裁剪
+    };
+
+    QString m_strFilePath;          //位置表文件
+    int m_nCapacity;                //最多保留的有效记录数
+    QHash<QString,int> m_idByPath;  //路径——ID
+    QVector<Record> m_records;      //按ID存放
+    bool m_bDirty = false;
+    QTimer *m_flushTimer;           //定期落盘
+    QFuture<bool> m_flushJob;       //正在线程池中写入的快照
+    bool m_bFlushing = false;       //后台写入尚未结束，同一时间只写一份
+
+    QVector<Record> snapshot() const;   //要写入的记录（只含有位置的，超出上限时丢弃最久未更新的）
+    static bool writeRecords(const QString &filePath,const QVector<Record> &records);
+    void flushInBackground();
+};
+
+#endif // RESUMEPOSITIONSTORE_H
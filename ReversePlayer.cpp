@@ -0,0 +1,342 @@
+#include "ReversePlayer.h"
+
+#include<QMediaMetaData>
+
+#include"FrameConverter.h"
+
+namespace {
+const double kDecodeRate = 2.0;     //后台解码速率，需快于倒放速率加上重复解码的开销
+const int kTickMs = 10;             //检查倒放时钟的间隔
+const int kDecodeTimeoutMs = 3000;  //解码器超过这么久没有新帧就结束本段
+const int kLoadTimeoutMs = 10000;   //解码器超过这么久没加载完媒体就放弃倒放
+const int kMinBudget = 8;
+}
+
+ReversePlayer::ReversePlayer(QMediaPlayer *player,QVideoSink *sink,KeyframeIndex *index,QObject *parent)
+    : QObject(parent)
+    , m_player(player)
+    , m_sink(sink)
+    , m_index(index)
+{
+    connect(m_player,&QMediaPlayer::sourceChanged,this,&ReversePlayer::onSourceChanged);
+
+    m_decoder = new QMediaPlayer(this);
+    m_decoderSink = new QVideoSink(this);
+    m_decoder->setVideoOutput(m_decoderSink);
+    connect(m_decoderSink,&QVideoSink::videoFrameChanged,this,&ReversePlayer::onDecodedFrame);
+    connect(m_decoder,&QMediaPlayer::mediaStatusChanged,this,[this](QMediaPlayer::MediaStatus status){
+        if(status==QMediaPlayer::LoadedMedia && m_bDecoderPending)
+        {
+            m_bDecoderPending=false;
+            runDecode();
+        }
+        else if(status==QMediaPlayer::EndOfMedia && m_bDecoding)
+        {
+            completeChunk();
+        }
+        else if(status==QMediaPlayer::InvalidMedia && isActive())
+        {
+            fail("倒放失败：后台解码器无法打开当前媒体");
+        }
+    });
+    connect(m_decoder,&QMediaPlayer::errorOccurred,this,[this](QMediaPlayer::Error error,const QString &errorString){
+        if(error!=QMediaPlayer::NoError && isActive())
+            fail(QString("倒放失败：%1").arg(errorString));
+    });
+
+    m_decodeTimer = new QTimer(this);
+    m_decodeTimer->setSingleShot(true);
+    m_decodeTimer->setInterval(kDecodeTimeoutMs);
+    connect(m_decodeTimer,&QTimer::timeout,this,[this](){
+        if(m_bDecoderPending)
+            fail("倒放失败：后台解码器加载媒体超时");
+        else if(m_bDecoding)
+            completeChunk();
+    });
+
+    m_tickTimer = new QTimer(this);
+    m_tickTimer->setInterval(kTickMs);
+    m_tickTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_tickTimer,&QTimer::timeout,this,&ReversePlayer::tick);
+}
+
+void ReversePlayer::setMediaPlayer(QMediaPlayer *player)
+{
+    stop();
+    disconnect(m_player,nullptr,this,nullptr);
+    m_player=player;
+    connect(m_player,&QMediaPlayer::sourceChanged,this,&ReversePlayer::onSourceChanged);
+    onSourceChanged();
+}
+
+void ReversePlayer::setFrameBudget(int nFrames)
+{
+    m_nBudget=qMax(kMinBudget,nFrames);
+}
+
+bool ReversePlayer::start(double rate,const QSize &outputSize)
+{
+    if(!isReverseRate(rate))
+        return false;
+
+    //已在倒放：从当前显示的帧起按新速率继续
+    if(isActive())
+    {
+        if(!m_bStalled)
+        {
+            m_nAnchorUs=m_nPresentedUs>=0?m_nPresentedUs:m_nAnchorUs;
+            m_clock.start();
+        }
+        m_dRate=rate;
+        emit rateChanged(rate);
+        return true;
+    }
+
+    //后台解码器按URL打开：经预读设备播放的本地文件直接打开文件，网络流的设备（预缓冲、时移）无法再打开一份，不支持
+    if(!m_player->isSeekable() || m_player->duration()<=0 || m_player->source().isEmpty())
+        return false;
+    if(m_player->sourceDevice() && !m_player->source().isLocalFile())
+        return false;
+
+    m_player->pause();
+    double frameRate=m_player->metaData().value(QMediaMetaData::VideoFrameRate).toDouble();
+    m_nFrameUs=frameRate>0?qint64(1000000/frameRate):40000;
+    m_outputSize=outputSize;
+
+    //包含当前显示的这一帧
+    m_nAnchorUs=qMin(m_player->duration()*1000,m_player->position()*1000+m_nFrameUs/2);
+    m_chunks.clear();
+    m_bNoMoreChunks=false;
+    m_bStalled=true;
+    m_nPresentedUs=-1;
+    m_nPresented=0;
+    m_nChunks=0;
+    m_nStalls=0;
+    m_nPeakPooled=0;
+    m_dRate=rate;
+
+    fillPipeline();
+    m_tickTimer->start();
+    emit rateChanged(rate);
+    return true;
+}
+
+void ReversePlayer::stop(bool bPlay)
+{
+    if(!isActive())
+        return;
+
+    m_tickTimer->stop();
+    m_decodeTimer->stop();
+    m_decoder->pause();
+    m_bDecoding=false;
+    m_bDecoderPending=false;
+    m_chunks.clear();
+    m_dRate=0;
+
+    //播放器停在最后显示的帧，接着播放或单步都从这里开始
+    if(m_nPresentedUs>=0)
+        m_player->setPosition((m_nPresentedUs+m_nFrameUs/2)/1000);
+    if(bPlay)
+        m_player->play();
+    emit rateChanged(0);
+}
+
+ReversePlayer::Stats ReversePlayer::stats() const
+{
+    Stats stats;
+    stats.presented=m_nPresented;
+    stats.chunks=m_nChunks;
+    stats.stalls=m_nStalls;
+    stats.pooledFrames=pooledFrames();
+    stats.peakPooledFrames=m_nPeakPooled;
+    return stats;
+}
+
+int ReversePlayer::pooledFrames() const
+{
+    int nFrames=0;
+    for(const Chunk &chunk:m_chunks)
+        nFrames+=chunk.frames.size();
+    return nFrames;
+}
+
+void ReversePlayer::fillPipeline()
+{
+    if(!isActive() || m_bDecoding || m_bNoMoreChunks || m_chunks.size()>=2)
+        return;
+
+    qint64 nEndUs=m_chunks.isEmpty()?m_nAnchorUs:m_chunks.last().startUs;
+    if(nEndUs<=0)
+    {
+        m_bNoMoreChunks=true;
+        return;
+    }
+
+    //段起点取前一个关键帧，GOP超过半个帧预算时只取段尾
+    Chunk chunk;
+    chunk.endUs=nEndUs;
+    chunk.startUs=qMax<qint64>(0,nEndUs-m_nFrameUs*chunkCapacity());
+    if(m_index->isReady())
+    {
+        qint64 nKeyframeUs=m_index->previousKeyframe((nEndUs-1)/1000)*1000;
+        if(nKeyframeUs<nEndUs)
+            chunk.startUs=qMax(chunk.startUs,nKeyframeUs);
+    }
+    m_chunks.append(chunk);
+    decodeChunk();
+}
+
+void ReversePlayer::decodeChunk()
+{
+    m_bDecoding=true;
+    m_bSeekArrived=false;
+    m_nChunks++;
+    if(m_decoder->source()!=m_player->source())
+    {
+        //先开始计时，媒体一直加载不完时不会卡在等待中
+        m_bDecoderPending=true;
+        m_decodeTimer->start(kLoadTimeoutMs);
+        m_decoder->setSource(m_player->source());
+        return;
+    }
+    runDecode();
+}
+
+void ReversePlayer::runDecode()
+{
+    if(!m_bDecoding || m_chunks.isEmpty())
+        return;
+    m_decoder->setPosition(m_chunks.last().startUs/1000);
+    m_decoder->setPlaybackRate(kDecodeRate);
+    m_decoder->play();
+    m_decodeTimer->start(kDecodeTimeoutMs);
+}
+
+void ReversePlayer::onDecodedFrame(const QVideoFrame &frame)
+{
+    if(!m_bDecoding || m_bDecoderPending || m_chunks.isEmpty() || !frame.isValid() || frame.startTime()<0)
+        return;
+    m_decodeTimer->start();
+
+    //定位生效前解码器可能还送出上一段位置的旧帧，不能当作段尾
+    Chunk &chunk=m_chunks.last();
+    qint64 nTimeUs=frame.startTime();
+    if(nTimeUs>=chunk.endUs)
+    {
+        if(m_bSeekArrived)
+            completeChunk();
+        return;
+    }
+    m_bSeekArrived=true;
+    if(nTimeUs<chunk.startUs)
+        return;
+
+    if(frame.endTime()>nTimeUs)
+        m_nFrameUs=frame.endTime()-nTimeUs;
+    QImage image=FrameConverter::convert(frame,m_outputSize);
+    if(image.isNull())
+        return;
+    chunk.frames.insert(nTimeUs,image);
+
+    //帧时长估计偏大时实际帧数会超出，丢掉段首，段起点随之后移
+    while(chunk.frames.size()>chunkCapacity())
+    {
+        chunk.frames.erase(chunk.frames.begin());
+        chunk.startUs=chunk.frames.firstKey();
+    }
+    m_nPeakPooled=qMax(m_nPeakPooled,pooledFrames());
+}
+
+void ReversePlayer::completeChunk()
+{
+    m_decodeTimer->stop();
+    m_decoder->pause();
+    m_bDecoding=false;
+    if(!m_chunks.isEmpty())
+        m_chunks.last().complete=true;
+    fillPipeline();
+}
+
+void ReversePlayer::fail(const QString &message)
+{
+    stop();
+    m_decoder->stop();
+    m_decoder->setSource(QUrl());
+    emit failed(message);
+}
+
+void ReversePlayer::tick()
+{
+    if(m_chunks.isEmpty() || !m_chunks.first().complete)
+        return;
+
+    //等待解码期间时钟停走，恢复时从停下的帧继续；仍在等待的不重复计数
+    bool bResumed=m_bStalled;
+    if(m_bStalled)
+    {
+        m_bStalled=false;
+        m_nAnchorUs=m_nPresentedUs>=0?m_nPresentedUs:m_chunks.first().endUs;
+        m_clock.start();
+    }
+    qint64 nPositionUs=m_nAnchorUs-qint64(-m_dRate*m_clock.nsecsElapsed()/1000);
+
+    //越过当前段的起点时换到预取的前一段，并开始预取再前一段
+    while(nPositionUs<m_chunks.first().startUs || m_chunks.first().frames.isEmpty())
+    {
+        if(m_chunks.size()<2)
+        {
+            if(!m_bNoMoreChunks)
+            {
+                stall(bResumed);
+                return;
+            }
+            const Chunk &chunk=m_chunks.first();
+            if(!chunk.frames.isEmpty() && chunk.frames.firstKey()!=m_nPresentedUs)
+                present(chunk.frames.firstKey(),chunk.frames.first());
+            stop();
+            emit reachedStart();
+            return;
+        }
+        if(!m_chunks.at(1).complete)
+        {
+            stall(bResumed);
+            return;
+        }
+        m_chunks.removeFirst();
+        fillPipeline();
+    }
+
+    const Chunk &chunk=m_chunks.first();
+    auto it=chunk.frames.upperBound(nPositionUs);
+    if(it!=chunk.frames.begin())
+        --it;
+    if(it.key()!=m_nPresentedUs)
+        present(it.key(),it.value());
+}
+
+void ReversePlayer::stall(bool bResumed)
+{
+    if(!bResumed)
+        m_nStalls++;
+    m_bStalled=true;
+}
+
+void ReversePlayer::present(qint64 frameUs,const QImage &image)
+{
+    QVideoFrame frame(image);
+    frame.setStartTime(frameUs);
+    frame.setEndTime(frameUs+m_nFrameUs);
+    m_sink->setVideoFrame(frame);
+
+    m_nPresentedUs=frameUs;
+    m_nPresented++;
+    emit positionChanged(frameUs/1000);
+}
+
+void ReversePlayer::onSourceChanged()
+{
+    stop();
+    m_decoder->stop();
+    m_decoder->setSource(QUrl());
+}
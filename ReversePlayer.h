@@ -0,0 +1,108 @@
+/*
+ * 倒放 后台解码器按GOP把一段帧正向解码进有界帧池，再从段尾向前按倒放速率送到主播放器的sink显示
+ * 显示当前段时预取前一段，段边界取自关键帧索引（没有索引时按帧预算取固定长度）
+ * 帧池最多两段、每段不超过帧预算的一半；GOP比半个预算长时只保留段尾，前面的部分作为下一段重新解码
+ * 帧按显示尺寸转成RGB图像保存，不占用硬件解码表面；倒放时播放器暂停，没有声音
+ */
+
+#ifndef REVERSEPLAYER_H
+#define REVERSEPLAYER_H
+
+#include<QObject>
+#include<QMap>
+#include<QList>
+#include<QImage>
+#include<QTimer>
+#include<QElapsedTimer>
+#include<QMediaPlayer>
+#include<QVideoSink>
+#include<QVideoFrame>
+
+#include"KeyframeIndex.h"
+
+class ReversePlayer : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats
+    {
+        int presented = 0;      //显示的帧数
+        int chunks = 0;         //解码的段数
+        int stalls = 0;         //前一段没解码完、画面停顿的次数
+        int pooledFrames = 0;   //帧池当前帧数
+        int peakPooledFrames = 0;   //帧池最大帧数
+    };
+
+    ReversePlayer(QMediaPlayer *player,QVideoSink *sink,KeyframeIndex *index,QObject *parent=nullptr);
+
+    void setMediaPlayer(QMediaPlayer *player);  //切换跟随的主播放器（无缝切换时）
+    void setFrameBudget(int nFrames);   //帧池上限（帧），下次开始倒放时生效
+    int frameBudget() const {return m_nBudget;}
+    static bool isReverseRate(double rate) {return rate<0;}
+
+    bool start(double rate,const QSize &outputSize);    //从当前位置开始倒放，已在倒放时只改速率；rate为负
+    void stop(bool bPlay=false);    //停止倒放，播放器定位到最后显示的帧；bPlay时接着正向播放
+    bool isActive() const {return m_dRate!=0;}
+    double rate() const {return m_dRate;}
+    Stats stats() const;
+
+signals:
+    void positionChanged(qint64 position);  //显示新的一帧（毫秒）
+    void rateChanged(double rate);          //开始、改变速率或停止（0）时发出
+    void reachedStart();                    //倒放到文件开头
+    void failed(const QString &message);    //后台解码器加载失败或出错，倒放已停止
+
+private:
+    struct Chunk    //一段连续的帧 [startUs,endUs)
+    {
+        qint64 startUs = 0;
+        qint64 endUs = 0;
+        QMap<qint64,QImage> frames;     //帧起始时间(微秒)——帧图像
+        bool complete = false;
+    };
+
+    QMediaPlayer *m_player;
+    QVideoSink *m_sink;
+    KeyframeIndex *m_index;
+
+    //后台解码器 不绑定任何显示组件和音频输出
+    QMediaPlayer *m_decoder;
+    QVideoSink *m_decoderSink;
+    QTimer *m_decodeTimer;          //解码器迟迟没有新帧时按已有的帧结束本段，加载超时则停止倒放
+    bool m_bDecoding = false;       //最后一段正在解码
+    bool m_bDecoderPending = false; //解码器媒体尚未加载完成
+    bool m_bSeekArrived = false;    //本段定位后的帧已到达，之前的旧帧不算段尾
+
+    QTimer *m_tickTimer;
+    QElapsedTimer m_clock;          //自m_nAnchorUs起的倒放时间
+    double m_dRate = 0;             //倒放速率（负数），0表示未在倒放
+    qint64 m_nAnchorUs = 0;         //m_clock开始时的显示位置
+    bool m_bStalled = true;         //等待解码，时钟停走
+    QSize m_outputSize;             //帧转换的目标尺寸
+
+    QList<Chunk> m_chunks;          //[0]正在显示，[1]预取的前一段
+    bool m_bNoMoreChunks = false;   //已解码到文件开头
+    int m_nBudget = 64;
+    qint64 m_nFrameUs = 40000;      //单帧时长（微秒）
+    qint64 m_nPresentedUs = -1;     //最后显示的帧
+
+    int m_nPresented = 0;
+    int m_nChunks = 0;
+    int m_nStalls = 0;
+    int m_nPeakPooled = 0;
+
+    int chunkCapacity() const {return qMax(2,m_nBudget/2);}
+    int pooledFrames() const;
+    void fillPipeline();            //帧池不满两段时解码更前面的一段
+    void decodeChunk();             //开始解码最后一段，解码器媒体未加载时等加载完成
+    void runDecode();               //把解码器定位到最后一段的起点开始解码
+    void onSourceChanged();
+    void onDecodedFrame(const QVideoFrame &frame);
+    void completeChunk();
+    void fail(const QString &message);  //停止倒放并丢弃解码器媒体，下次倒放重新加载
+    void tick();
+    void stall(bool bResumed);      //前一段未就绪，时钟停走；bResumed表示本轮刚从停顿恢复
+    void present(qint64 frameUs,const QImage &image);
+};
+
+#endif // REVERSEPLAYER_H
@@ -0,0 +1,189 @@
+#include "SeekScheduler.h"
+
+namespace {
+const int kSlowSeekMs = 400;        //定位超过这么久记为慢定位
+const int kSeekTimeoutMs = 2000;    //定位超过这么久不再等待，免得后续定位全部卡住
+const qint64 kArriveToleranceMs = 200;  //帧时间与目标相差在此范围内视为新位置的帧
+const qint64 kNearEndMs = 1000;     //目标在文件最后这段时间内时，暂停中到达的帧都算定位结果
+}
+
+SeekScheduler::SeekScheduler(QMediaPlayer *player,QVideoSink *sink,QObject *parent)
+    : QObject(parent)
+    , m_player(player)
+    , m_sink(sink)
+{
+    connect(m_sink,&QVideoSink::videoFrameChanged,this,&SeekScheduler::onVideoFrameChanged);
+
+    m_slowTimer = new QTimer(this);
+    m_slowTimer->setSingleShot(true);
+    m_slowTimer->setInterval(kSlowSeekMs);
+    connect(m_slowTimer,&QTimer::timeout,this,[this](){
+        m_nTimeouts++;
+    });
+
+    m_timeoutTimer = new QTimer(this);
+    m_timeoutTimer->setSingleShot(true);
+    m_timeoutTimer->setInterval(kSeekTimeoutMs);
+    connect(m_timeoutTimer,&QTimer::timeout,this,&SeekScheduler::complete);
+    connectPlayer();
+}
+
+void SeekScheduler::connectPlayer()
+{
+    //后端不会再送出新位置的帧时结束定位，否则一直等到帧到达
+    connect(m_player,&QMediaPlayer::mediaStatusChanged,this,[this](QMediaPlayer::MediaStatus status){
+        if(m_nInFlight>=0 && (status==QMediaPlayer::EndOfMedia || status==QMediaPlayer::InvalidMedia || status==QMediaPlayer::NoMedia))
+            complete();
+    });
+    connect(m_player,&QMediaPlayer::playbackStateChanged,this,[this](QMediaPlayer::PlaybackState state){
+        if(m_nInFlight>=0 && state==QMediaPlayer::StoppedState)
+            complete();
+    });
+    connect(m_player,&QMediaPlayer::errorOccurred,this,[this](){
+        if(m_nInFlight>=0)
+            complete();
+    });
+    connect(m_player,&QMediaPlayer::positionChanged,this,&SeekScheduler::onPositionChanged);
+}
+
+void SeekScheduler::setMediaPlayer(QMediaPlayer *player)
+{
+    //换了播放器，进行中和等待中的定位都不再有意义
+    disconnect(m_player,nullptr,this,nullptr);
+    m_player=player;
+    connectPlayer();
+    m_slowTimer->stop();
+    m_timeoutTimer->stop();
+    m_nInFlight=-1;
+    m_nPending=-1;
+    m_nLastPreview=-1;
+}
+
+void SeekScheduler::previewSeek(qint64 position)
+{
+    m_nRequested++;
+    qint64 target=m_snap?m_snap(position):position;
+
+    //已有定位在进行：只记下最新目标，被覆盖的目标计为丢弃
+    if(m_nInFlight>=0)
+    {
+        if(m_nPending>=0)
+            m_nDropped++;
+        m_nPending=target;
+        return;
+    }
+    if(target==m_nLastPreview)
+    {
+        m_nDropped++;
+        return;
+    }
+    issue(target,false);
+}
+
+void SeekScheduler::exactSeek(qint64 position)
+{
+    m_nRequested++;
+    if(m_nPending>=0)
+    {
+        m_nDropped++;
+        m_nPending=-1;
+    }
+    //单击时按下和松开各请求一次，同一目标正在精确定位就不重复
+    if(m_nInFlight==position && m_bInFlightExact)
+    {
+        m_nDropped++;
+        return;
+    }
+    m_nLastPreview=-1;
+    issue(position,true);
+}
+
+SeekScheduler::Stats SeekScheduler::stats() const
+{
+    Stats stats;
+    stats.requested=m_nRequested;
+    stats.previewIssued=m_nPreviewIssued;
+    stats.exactIssued=m_nExactIssued;
+    stats.issued=m_nPreviewIssued+m_nExactIssued;
+    stats.dropped=m_nDropped;
+    stats.timeouts=m_nTimeouts;
+    if(m_nCompleted>0)
+        stats.avgLatencyMs=double(m_nLatencySumMs)/m_nCompleted;
+    return stats;
+}
+
+void SeekScheduler::resetStats()
+{
+    m_nRequested=0;
+    m_nPreviewIssued=0;
+    m_nExactIssued=0;
+    m_nDropped=0;
+    m_nTimeouts=0;
+    m_nCompleted=0;
+    m_nLatencySumMs=0;
+}
+
+void SeekScheduler::issue(qint64 target,bool bExact)
+{
+    m_nInFlight=target;
+    m_bInFlightExact=bExact;
+    if(bExact)
+    {
+        m_nExactIssued++;
+    }
+    else
+    {
+        m_nPreviewIssued++;
+        m_nLastPreview=target;
+    }
+    m_seekClock.start();
+    m_slowTimer->start();
+    m_timeoutTimer->start();
+    m_player->setPosition(target);
+}
+
+void SeekScheduler::complete()
+{
+    m_slowTimer->stop();
+    m_timeoutTimer->stop();
+    m_nInFlight=-1;
+
+    //上一个定位结束，发出拖动期间积攒的最新目标
+    if(m_nPending>=0)
+    {
+        qint64 target=m_nPending;
+        m_nPending=-1;
+        if(target==m_nLastPreview)
+            m_nDropped++;
+        else
+            issue(target,false);
+    }
+}
+
+void SeekScheduler::onVideoFrameChanged(const QVideoFrame &frame)
+{
+    if(m_nInFlight<0 || !frame.isValid() || frame.startTime()<0)
+        return;
+
+    //播放中定位前的帧还在陆续到达，时间对得上才算定位完成
+    //暂停时定位到文件末尾附近，最后一帧可能早于目标超出容差，此时送来的帧就是定位结果
+    bool bArrived=qAbs(frame.startTime()/1000-m_nInFlight)<=kArriveToleranceMs;
+    if(!bArrived && m_player->playbackState()!=QMediaPlayer::PlayingState)
+        bArrived=m_player->duration()>0 && m_nInFlight>=m_player->duration()-kNearEndMs;
+    if(bArrived)
+        arrive();
+}
+
+void SeekScheduler::onPositionChanged(qint64 position)
+{
+    //纯音频不会有帧到达，位置到了目标附近就算定位完成
+    if(m_nInFlight>=0 && !m_player->hasVideo() && qAbs(position-m_nInFlight)<=kArriveToleranceMs)
+        arrive();
+}
+
+void SeekScheduler::arrive()
+{
+    m_nLatencySumMs+=m_seekClock.elapsed();
+    m_nCompleted++;
+    complete();
+}
@@ -0,0 +1,75 @@
+/*
+ * 定位调度 拖动进度条时合并定位请求，任何时刻最多只有一个定位在进行
+ * 新位置的帧到达（纯音频时为新位置，或播放器报告无法再出帧）后才发出最新的请求，中间被覆盖的请求直接丢弃
+ * 慢定位只记录不打断：后端还在定位时再发新定位只会让它更慢；等到硬超时仍没有结果才放弃等待
+ * 拖动中的预览定位可经取整函数对齐到关键帧，解码量最小；松开时再做一次精确定位
+ */
+
+#ifndef SEEKSCHEDULER_H
+#define SEEKSCHEDULER_H
+
+#include<QObject>
+#include<QMediaPlayer>
+#include<QVideoSink>
+#include<QVideoFrame>
+#include<QTimer>
+#include<QElapsedTimer>
+#include<functional>
+
+class SeekScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats
+    {
+        int requested = 0;          //收到的定位请求
+        int issued = 0;             //实际发给播放器的定位
+        int previewIssued = 0;      //其中拖动中的预览定位
+        int exactIssued = 0;        //其中精确定位
+        int dropped = 0;            //被后续请求覆盖或与上次目标相同而未发出的请求
+        int timeouts = 0;           //超过慢定位阈值仍未等到新位置的帧的定位
+        double avgLatencyMs = 0;    //定位发出到新位置的帧到达的平均耗时
+    };
+
+    explicit SeekScheduler(QMediaPlayer *player,QVideoSink *sink,QObject *parent=nullptr);
+
+    void setMediaPlayer(QMediaPlayer *player);  //切换跟随的主播放器（无缝切换时）
+    void setSnapFunction(const std::function<qint64(qint64)> &snap) {m_snap=snap;}   //预览定位的取整，默认不取整
+
+    void previewSeek(qint64 position);  //拖动中：合并，只保留最新的请求
+    void exactSeek(qint64 position);    //松开、单击：丢弃等待中的预览，立即精确定位
+    bool isBusy() const {return m_nInFlight>=0;}
+
+    Stats stats() const;
+    void resetStats();
+
+private:
+    QMediaPlayer *m_player;
+    QVideoSink *m_sink;
+    QTimer *m_slowTimer;            //新位置的帧迟迟不来时记录一次慢定位
+    QTimer *m_timeoutTimer;         //硬超时：稀疏帧、可变帧率等等不到容差内的帧时结束定位
+    QElapsedTimer m_seekClock;
+    std::function<qint64(qint64)> m_snap;
+
+    qint64 m_nInFlight = -1;        //进行中的定位目标（毫秒），-1表示空闲
+    bool m_bInFlightExact = false;
+    qint64 m_nPending = -1;         //等待发出的最新预览目标
+    qint64 m_nLastPreview = -1;     //上次发出的预览目标，相同目标不再重复定位
+
+    int m_nRequested = 0;
+    int m_nPreviewIssued = 0;
+    int m_nExactIssued = 0;
+    int m_nDropped = 0;
+    int m_nTimeouts = 0;
+    int m_nCompleted = 0;
+    qint64 m_nLatencySumMs = 0;
+
+    void connectPlayer();
+    void issue(qint64 target,bool bExact);
+    void complete();
+    void onVideoFrameChanged(const QVideoFrame &frame);
+    void onPositionChanged(qint64 position);    //没有视频的媒体以位置更新作为定位结果
+    void arrive();                  //等到了新位置，记录耗时后结束定位
+};
+
+#endif // SEEKSCHEDULER_H
@@ -0,0 +1,334 @@
+#include "StreamBuffer.h"
+
+#include<QNetworkAccessManager>
+#include<QNetworkRequest>
+#include<QNetworkReply>
+#include<QPointer>
+#include<cstring>
+
+//网络线程中的下载端：从应答里按缓冲剩余空间取数据，缓冲满了就不再取，应答的读缓冲随之填满，TCP自然限速
+class StreamFetcher : public QObject
+{
+public:
+    explicit StreamFetcher(StreamBuffer *buffer)
+        : m_buffer(buffer)
+    {
+    }
+
+    void start()
+    {
+        m_manager=new QNetworkAccessManager(this);
+        QNetworkRequest request(m_buffer->m_url);
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,QNetworkRequest::NoLessSafeRedirectPolicy);
+        m_reply=m_manager->get(request);
+        m_reply->setReadBufferSize(qMin<qint64>(256*1024,m_buffer->m_options.capacity/4));
+        m_pullClock.start();
+        connect(m_reply,&QNetworkReply::readyRead,this,[this](){pull();});
+        connect(m_reply,&QNetworkReply::finished,this,[this](){onFinished();});
+    }
+
+    void pull()
+    {
+        if(!m_reply)
+            return;
+
+        QByteArray chunk;
+        qint64 nSpace;
+        {
+            QMutexLocker lock(&m_buffer->m_mutex);
+            m_buffer->m_bResumeQueued=false;
+            if(m_buffer->m_bAborted)
+                return;
+            nSpace=m_buffer->m_options.capacity-m_buffer->m_nFill;
+        }
+
+        //读应答时不持锁，只在写入环形缓冲时短暂加锁
+        while(nSpace>0 && m_reply->bytesAvailable()>0)
+        {
+            chunk=m_reply->read(qMin<qint64>(nSpace,64*1024));
+            if(chunk.isEmpty())
+                break;
+            QMutexLocker lock(&m_buffer->m_mutex);
+            m_buffer->writeLocked(chunk.constData(),chunk.size());
+            nSpace=m_buffer->m_options.capacity-m_buffer->m_nFill;
+        }
+
+        {
+            QMutexLocker lock(&m_buffer->m_mutex);
+            //暂停期间不算拉取时间，下载速度反映的是链路而不是播放消耗
+            if(m_buffer->m_bPullPaused)
+                m_pullClock.restart();
+            else
+                m_buffer->m_nPullingMs+=m_pullClock.restart();
+            m_buffer->m_bPullPaused=m_reply->bytesAvailable()>0;
+
+            if(m_buffer->m_state==StreamBuffer::Connecting)
+                m_buffer->m_state=StreamBuffer::Buffering;
+            if(m_bReplyFinished && m_reply->bytesAvailable()==0)
+                m_buffer->m_state=StreamBuffer::Finished;
+            m_buffer->m_dataReady.wakeAll();
+        }
+        emit m_buffer->readyRead();
+    }
+
+    void abort()
+    {
+        if(m_reply)
+            m_reply->abort();
+    }
+
+private:
+    StreamBuffer *m_buffer;
+    QNetworkAccessManager *m_manager = nullptr;
+    QPointer<QNetworkReply> m_reply;
+    QElapsedTimer m_pullClock;
+    bool m_bReplyFinished = false;
+
+    void onFinished()
+    {
+        m_bReplyFinished=true;
+        if(m_reply->error()!=QNetworkReply::NoError && m_reply->error()!=QNetworkReply::OperationCanceledError)
+        {
+            QMutexLocker lock(&m_buffer->m_mutex);
+            m_buffer->m_state=StreamBuffer::Failed;
+            m_buffer->m_strError=m_reply->errorString();
+            m_buffer->m_dataReady.wakeAll();
+            return;
+        }
+        //应答结束时读缓冲里可能还有数据，取完才算结束
+        pull();
+    }
+};
+
+StreamBuffer::StreamBuffer(const QUrl &url,const Options &options,QObject *parent)
+    : QIODevice(parent)
+    , m_url(url)
+    , m_options(options)
+{
+    m_options.capacity=qMax<qint64>(256*1024,m_options.capacity);
+    m_options.lowWatermark=qBound<qint64>(0,m_options.lowWatermark,m_options.capacity*3/4);
+    m_options.maxStartBytes=qBound<qint64>(64*1024,m_options.maxStartBytes,m_options.capacity);
+    m_options.startBytes=qBound<qint64>(64*1024,m_options.startBytes,m_options.maxStartBytes);
+    m_nStartThreshold=m_options.startBytes;
+    m_ring.resize(m_options.capacity);
+
+    m_networkThread = new QThread(this);
+    m_fetcher = new StreamFetcher(this);
+    m_fetcher->moveToThread(m_networkThread);
+    connect(m_networkThread,&QThread::finished,m_fetcher,&QObject::deleteLater);
+
+    m_telemetryTimer = new QTimer(this);
+    m_telemetryTimer->setInterval(500);
+    connect(m_telemetryTimer,&QTimer::timeout,this,&StreamBuffer::sampleTelemetry);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    close();
+}
+
+bool StreamBuffer::canBuffer(const QUrl &url)
+{
+    if(url.scheme()!="http" && url.scheme()!="https")
+        return false;
+
+    //清单格式里是分片地址，必须由后端自己解析和拉取
+    QString path=url.path().toLower();
+    return !path.endsWith(".m3u8") && !path.endsWith(".m3u") && !path.endsWith(".mpd");
+}
+
+bool StreamBuffer::open(OpenMode mode)
+{
+    if(mode&WriteOnly)
+        return false;
+    if(!QIODevice::open(mode|Unbuffered))
+        return false;
+
+    m_networkThread->start();
+    StreamFetcher *fetcher=m_fetcher;
+    QMetaObject::invokeMethod(fetcher,[fetcher](){fetcher->start();},Qt::QueuedConnection);
+    m_telemetryClock.start();
+    m_telemetryTimer->start();
+    return true;
+}
+
+void StreamBuffer::close()
+{
+    abort();
+    m_telemetryTimer->stop();
+    if(m_fetcher)
+    {
+        //线程退出后下载端（连同应答）在网络线程里删除
+        m_networkThread->quit();
+        m_networkThread->wait();
+        QMutexLocker lock(&m_mutex);
+        m_fetcher=nullptr;
+    }
+    if(isOpen())
+        QIODevice::close();
+}
+
+void StreamBuffer::abort()
+{
+    QMutexLocker lock(&m_mutex);
+    if(m_bAborted)
+        return;
+    m_bAborted=true;
+    m_dataReady.wakeAll();
+    if(m_fetcher)
+    {
+        StreamFetcher *fetcher=m_fetcher;
+        QMetaObject::invokeMethod(fetcher,[fetcher](){fetcher->abort();},Qt::QueuedConnection);
+    }
+}
+
+bool StreamBuffer::atEnd() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_nFill==0 && (m_bAborted || m_state==Finished || m_state==Failed);
+}
+
+qint64 StreamBuffer::bytesAvailable() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_nFill+QIODevice::bytesAvailable();
+}
+
+StreamBuffer::Stats StreamBuffer::stats() const
+{
+    QMutexLocker lock(&m_mutex);
+    Stats stats;
+    stats.state=m_state;
+    stats.fill=m_nFill;
+    stats.capacity=m_options.capacity;
+    stats.startThreshold=m_nStartThreshold;
+    stats.throughput=m_dThroughput;
+    stats.consumeRate=m_dConsumeRate;
+    stats.received=m_nReceived;
+    stats.rebuffers=m_nRebuffers;
+    stats.rebufferTimeMs=m_nRebufferTimeMs+(m_rebufferTimer.isValid()?m_rebufferTimer.elapsed():0);
+    stats.errorString=m_strError;
+    return stats;
+}
+
+qint64 StreamBuffer::readData(char *data,qint64 maxSize)
+{
+    QMutexLocker lock(&m_mutex);
+    while(true)
+    {
+        if(m_bAborted)
+            return -1;
+
+        //流已结束：把剩余数据读完
+        if(m_state==Finished || m_state==Failed)
+        {
+            if(m_nFill==0)
+                return -1;
+            break;
+        }
+
+        if(m_state==Playing)
+        {
+            if(m_nFill>0)
+                break;
+
+            //缓冲读空：进入卡顿，下次起播量加倍
+            m_state=Buffering;
+            m_nRebuffers++;
+            m_nStartThreshold=qMin(m_options.maxStartBytes,m_nStartThreshold*2);
+            m_rebufferTimer.start();
+            continue;
+        }
+
+        //起播或卡顿中：攒够起播量再放行
+        if(m_nFill>=m_nStartThreshold)
+        {
+            if(m_rebufferTimer.isValid())
+            {
+                m_nRebufferTimeMs+=m_rebufferTimer.elapsed();
+                m_rebufferTimer.invalidate();
+            }
+            m_state=Playing;
+            m_smoothTimer.start();
+            break;
+        }
+        //限时等待，换源时的abort不会被错过
+        m_dataReady.wait(&m_mutex,200);
+    }
+
+    qint64 nBytes=qMin(maxSize,m_nFill);
+    qint64 nFirst=qMin(nBytes,m_options.capacity-m_nHead);
+    std::memcpy(data,m_ring.constData()+m_nHead,size_t(nFirst));
+    if(nBytes>nFirst)
+        std::memcpy(data+nFirst,m_ring.constData(),size_t(nBytes-nFirst));
+    m_nHead=(m_nHead+nBytes)%m_options.capacity;
+    m_nFill-=nBytes;
+    m_nConsumed+=nBytes;
+
+    //暂停拉取后消耗到低水位以下，通知网络线程继续
+    if(m_bPullPaused && !m_bResumeQueued && m_nFill<=m_options.lowWatermark && m_fetcher)
+    {
+        m_bResumeQueued=true;
+        StreamFetcher *fetcher=m_fetcher;
+        QMetaObject::invokeMethod(fetcher,[fetcher](){fetcher->pull();},Qt::QueuedConnection);
+    }
+    return nBytes;
+}
+
+qint64 StreamBuffer::writeData(const char *data,qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
+
+void StreamBuffer::writeLocked(const char *data,qint64 nBytes)
+{
+    qint64 nTail=(m_nHead+m_nFill)%m_options.capacity;
+    qint64 nFirst=qMin(nBytes,m_options.capacity-nTail);
+    std::memcpy(m_ring.data()+nTail,data,size_t(nFirst));
+    if(nBytes>nFirst)
+        std::memcpy(m_ring.data(),data+nFirst,size_t(nBytes-nFirst));
+    m_nFill+=nBytes;
+    m_nReceived+=nBytes;
+}
+
+void StreamBuffer::sampleTelemetry()
+{
+    int nNewRebuffers=0;
+    {
+        QMutexLocker lock(&m_mutex);
+        qint64 elapsedMs=m_telemetryClock.restart();
+
+        //指数平滑，避免数字跳动
+        qint64 pullingMs=m_nPullingMs-m_nLastPullingMs;
+        if(pullingMs>=100)
+        {
+            double throughput=(m_nReceived-m_nLastReceived)*1000.0/pullingMs;
+            m_dThroughput=m_dThroughput>0?m_dThroughput*0.7+throughput*0.3:throughput;
+            m_nLastPullingMs=m_nPullingMs;
+            m_nLastReceived=m_nReceived;
+        }
+        if(elapsedMs>0 && m_state==Playing)
+        {
+            double consumeRate=(m_nConsumed-m_nLastConsumed)*1000.0/elapsedMs;
+            m_dConsumeRate=m_dConsumeRate>0?m_dConsumeRate*0.7+consumeRate*0.3:consumeRate;
+        }
+        m_nLastConsumed=m_nConsumed;
+
+        //平稳播放一段时间后起播量减半，逐步回到初始值
+        if(m_state==Playing && m_smoothTimer.isValid() && m_smoothTimer.elapsed()>30000 && m_nStartThreshold>m_options.startBytes)
+        {
+            m_nStartThreshold=qMax(m_options.startBytes,m_nStartThreshold/2);
+            m_smoothTimer.start();
+        }
+
+        if(m_nRebuffers>m_nLastRebuffers)
+            nNewRebuffers=m_nRebuffers;
+        m_nLastRebuffers=m_nRebuffers;
+    }
+
+    if(nNewRebuffers>0)
+        emit rebufferStarted(nNewRebuffers);
+    emit statsChanged(stats());
+}
@@ -0,0 +1,121 @@
+/*
+ * 网络流预缓冲 把HTTP流拉进有界的内存环形缓冲，再通过setSourceDevice交给播放器
+ * 缓冲达到高水位时暂停拉取（靠TCP背压限速），消耗到低水位以下再继续
+ * 起播和卡顿后都要先攒够起播量才放行；每卡顿一次起播量加倍，长时间平稳后逐步回落
+ * 网络收发在独立线程进行，播放器后端线程读取时可以放心阻塞等待
+ */
+
+#ifndef STREAMBUFFER_H
+#define STREAMBUFFER_H
+
+#include<QIODevice>
+#include<QUrl>
+#include<QMutex>
+#include<QWaitCondition>
+#include<QThread>
+#include<QTimer>
+#include<QElapsedTimer>
+
+class StreamFetcher;
+
+class StreamBuffer : public QIODevice
+{
+    Q_OBJECT
+public:
+    enum State{
+        Connecting,     //等待服务器响应
+        Buffering,      //攒起播量（起播或卡顿后）
+        Playing,        //正常供数
+        Finished,       //流已结束，缓冲中可能还有剩余数据
+        Failed          //网络错误
+    };
+
+    struct Options
+    {
+        qint64 capacity = 8*1024*1024;          //缓冲深度，也是高水位：缓冲满了暂停拉取
+        qint64 lowWatermark = 4*1024*1024;      //暂停后消耗到这里以下恢复拉取
+        qint64 startBytes = 512*1024;           //初始起播量
+        qint64 maxStartBytes = 4*1024*1024;     //起播量上限（不超过缓冲深度）
+    };
+
+    struct Stats
+    {
+        State state = Connecting;
+        qint64 fill = 0;                //缓冲中的字节数
+        qint64 capacity = 0;
+        qint64 startThreshold = 0;      //当前起播量
+        double throughput = 0;          //下载速度（字节/秒，只统计正在拉取的时间）
+        double consumeRate = 0;         //播放器读取速度（字节/秒），近似码率
+        qint64 received = 0;            //累计下载字节数
+        int rebuffers = 0;              //卡顿次数（不含起播）
+        qint64 rebufferTimeMs = 0;      //卡顿累计时长
+        QString errorString;
+    };
+
+    explicit StreamBuffer(const QUrl &url,const Options &options=Options(),QObject *parent=nullptr);
+    ~StreamBuffer();
+
+    bool open(OpenMode mode) override;      //打开即开始下载
+    void close() override;
+    bool isSequential() const override {return true;}
+    bool atEnd() const override;
+    qint64 bytesAvailable() const override;
+
+    void abort();           //唤醒并让阻塞的读取立即返回，换源前调用（任意线程）
+    QUrl url() const {return m_url;}
+    Stats stats() const;
+
+    static bool canBuffer(const QUrl &url);     //HTTP单文件流才适合，HLS/DASH等清单格式交给后端
+
+signals:
+    void statsChanged(const StreamBuffer::Stats &stats);
+    void rebufferStarted(int nRebuffers);
+
+protected:
+    qint64 readData(char *data,qint64 maxSize) override;
+    qint64 writeData(const char *data,qint64 maxSize) override;
+
+private:
+    friend class StreamFetcher;
+
+    QUrl m_url;
+    Options m_options;
+
+    //环形缓冲：网络线程写入，播放器后端线程读取
+    mutable QMutex m_mutex;
+    QWaitCondition m_dataReady;
+    QByteArray m_ring;
+    qint64 m_nHead = 0;             //读取位置
+    qint64 m_nFill = 0;
+    State m_state = Connecting;
+    bool m_bAborted = false;
+    bool m_bPullPaused = false;     //达到高水位，暂停拉取
+    bool m_bResumeQueued = false;   //已请求网络线程恢复拉取
+    qint64 m_nStartThreshold = 0;
+    qint64 m_nReceived = 0;
+    qint64 m_nConsumed = 0;
+    qint64 m_nPullingMs = 0;        //实际拉取的累计时长，用于计算下载速度
+    int m_nRebuffers = 0;
+    qint64 m_nRebufferTimeMs = 0;
+    QElapsedTimer m_rebufferTimer;  //本次卡顿开始
+    QElapsedTimer m_smoothTimer;    //上次卡顿结束以来的平稳时长
+    QString m_strError;
+
+    QThread *m_networkThread;
+    StreamFetcher *m_fetcher;
+
+    //遥测：主线程定时采样
+    QTimer *m_telemetryTimer;
+    QElapsedTimer m_telemetryClock;
+    qint64 m_nLastReceived = 0;
+    qint64 m_nLastConsumed = 0;
+    qint64 m_nLastPullingMs = 0;
+    int m_nLastRebuffers = 0;
+    double m_dThroughput = 0;
+    double m_dConsumeRate = 0;
+
+    void writeLocked(const char *data,qint64 nBytes);
+    void sampleTelemetry();
+};
+
+#endif // STREAMBUFFER_H
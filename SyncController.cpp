@@ -0,0 +1,172 @@
+#include "SyncController.h"
+
+#include<QUrl>
+
+namespace {
+const int kDriftIntervalMs = 100;       //漂移测量周期
+const qint64 kDriftToleranceMs = 15;    //容忍范围内不做修正
+const qint64 kReseekThresholdMs = 500;  //超过该值才重新定位
+const qint64 kReseekCooldownMs = 1500;  //定位后等待落地的最长时间，期间不重复定位
+const double kCatchUpHorizonMs = 1000.0;    //期望在约1秒内追平漂移
+const double kMaxRateTrim = 0.1;        //速率微调上限 ±10%
+}
+
+SyncController::SyncController(QObject *parent)
+    : QObject(parent)
+{
+    m_driftTimer = new QTimer(this);
+    m_driftTimer->setInterval(kDriftIntervalMs);
+    connect(m_driftTimer,&QTimer::timeout,this,&SyncController::correctDrift);
+}
+
+void SyncController::addStream(const QString &filePath,QVideoWidget *videoWidget)
+{
+    Stream stream;
+    stream.player = new QMediaPlayer(this);
+    stream.player->setVideoOutput(videoWidget);
+
+    //只有第一路输出声音，其余静默
+    if(m_streams.isEmpty())
+    {
+        QAudioOutput *audioOutput = new QAudioOutput(this);
+        stream.player->setAudioOutput(audioOutput);
+    }
+
+    connect(stream.player,&QMediaPlayer::durationChanged,this,[this](qint64 duration){
+        if(duration>m_nDuration)
+        {
+            m_nDuration=duration;
+            emit durationChanged(m_nDuration);
+        }
+    });
+
+    stream.player->setSource(QUrl::fromLocalFile(filePath));
+    stream.player->setPlaybackRate(m_dRate);
+    m_streams.append(stream);
+}
+
+qint64 SyncController::position() const
+{
+    if(!m_bPlaying)
+        return m_nClockBase;
+    return m_nClockBase+qint64(m_clock.elapsed()*m_dRate);
+}
+
+void SyncController::play()
+{
+    if(m_bPlaying)
+        return;
+
+    //各路先对齐到主时钟再同时启动
+    for(Stream &stream:m_streams)
+    {
+        stream.rateTrim=1.0;
+        stream.player->setPlaybackRate(m_dRate);
+        stream.player->setPosition(m_nClockBase);
+        stream.seekClock.start();
+        stream.player->play();
+    }
+    m_clock.start();
+    m_bPlaying=true;
+    m_driftTimer->start();
+    emit playingChanged(true);
+}
+
+void SyncController::pause()
+{
+    if(!m_bPlaying)
+        return;
+
+    m_nClockBase=position();
+    m_bPlaying=false;
+    m_driftTimer->stop();
+    for(Stream &stream:m_streams)
+        stream.player->pause();
+    emit playingChanged(false);
+}
+
+void SyncController::setPosition(qint64 position)
+{
+    m_nClockBase=qBound<qint64>(0,position,m_nDuration>0?m_nDuration:position);
+    if(m_bPlaying)
+        m_clock.start();
+
+    for(Stream &stream:m_streams)
+    {
+        stream.player->setPosition(m_nClockBase);
+        stream.seekClock.start();
+    }
+    emit positionChanged(m_nClockBase);
+}
+
+void SyncController::setPlaybackRate(double rate)
+{
+    if(rate<=0)
+        return;
+
+    rebaseClock();
+    m_dRate=rate;
+    for(Stream &stream:m_streams)
+        stream.player->setPlaybackRate(m_dRate*stream.rateTrim);
+}
+
+void SyncController::rebaseClock()
+{
+    m_nClockBase=position();
+    if(m_bPlaying)
+        m_clock.start();
+}
+
+void SyncController::correctDrift()
+{
+    qint64 nMaster=position();
+    if(m_nDuration>0 && nMaster>=m_nDuration)
+    {
+        pause();
+        setPosition(m_nDuration);
+        return;
+    }
+
+    qint64 nMaxDrift=0;
+    for(Stream &stream:m_streams)
+    {
+        //已经播完的流不参与修正
+        if(stream.player->mediaStatus()==QMediaPlayer::EndOfMedia)
+            continue;
+
+        qint64 nDrift=stream.player->position()-nMaster;
+        if(qAbs(nDrift)>qAbs(nMaxDrift))
+            nMaxDrift=nDrift;
+
+        //漂移回到阈值内说明上次定位已经落地
+        if(qAbs(nDrift)<=kReseekThresholdMs)
+            stream.seekClock.invalidate();
+
+        double dTrim=1.0;
+        if(qAbs(nDrift)>kReseekThresholdMs)
+        {
+            //漂移过大，速率追赶太慢，直接重新定位；上次定位还在进行时不重复发出
+            if(!stream.seekClock.isValid() || stream.seekClock.elapsed()>=kReseekCooldownMs)
+            {
+                stream.player->setPosition(nMaster);
+                stream.seekClock.start();
+            }
+        }
+        else if(qAbs(nDrift)>kDriftToleranceMs)
+        {
+            //超前则放慢，落后则加快
+            dTrim=1.0-qBound(-kMaxRateTrim,nDrift/kCatchUpHorizonMs,kMaxRateTrim);
+        }
+
+        //速率变化很小时不打扰后端
+        if(qAbs(dTrim-stream.rateTrim)>0.005)
+        {
+            stream.rateTrim=dTrim;
+            stream.player->setPlaybackRate(m_dRate*dTrim);
+        }
+    }
+
+    m_nMaxDrift=nMaxDrift;
+    emit driftMeasured(m_nMaxDrift);
+    emit positionChanged(nMaster);
+}
@@ -0,0 +1,68 @@
+/*
+ * 多路同步播放控制器 所有媒体流锁定到同一个主时钟
+ * 周期性测量各路相对主时钟的漂移，小漂移通过微调播放速率追赶，大漂移才重新定位
+ */
+
+#ifndef SYNCCONTROLLER_H
+#define SYNCCONTROLLER_H
+
+#include<QObject>
+#include<QMediaPlayer>
+#include<QAudioOutput>
+#include<QVideoWidget>
+#include<QElapsedTimer>
+#include<QTimer>
+#include<QVector>
+
+class SyncController : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SyncController(QObject *parent=nullptr);
+
+    void addStream(const QString &filePath,QVideoWidget *videoWidget);  //添加一路媒体流
+    int streamCount() const {return m_streams.size();}
+    QMediaPlayer *player(int nIndex) const {return m_streams.at(nIndex).player;}
+
+    qint64 position() const;        //主时钟位置（毫秒）
+    qint64 duration() const {return m_nDuration;}
+    double playbackRate() const {return m_dRate;}
+    bool isPlaying() const {return m_bPlaying;}
+    qint64 maxDrift() const {return m_nMaxDrift;}   //最近一次测量的最大漂移（毫秒）
+
+public slots:
+    void play();
+    void pause();
+    void setPosition(qint64 position);  //所有流同时定位
+    void setPlaybackRate(double rate);  //所有流同时变速
+
+signals:
+    void positionChanged(qint64 position);
+    void durationChanged(qint64 duration);
+    void playingChanged(bool bPlaying);
+    void driftMeasured(qint64 maxDrift);
+
+private:
+    struct Stream
+    {
+        QMediaPlayer *player;
+        double rateTrim = 1.0;  //漂移修正用的速率系数
+        QElapsedTimer seekClock;    //最近一次定位，未落地且未过冷却期时不再重新定位
+    };
+    QVector<Stream> m_streams;
+
+    //主时钟：基准位置 + 墙钟流逝时间 × 播放速率
+    QElapsedTimer m_clock;
+    qint64 m_nClockBase = 0;
+    double m_dRate = 1.0;
+    bool m_bPlaying = false;
+
+    qint64 m_nDuration = 0;
+    qint64 m_nMaxDrift = 0;
+    QTimer *m_driftTimer;       //漂移测量定时器
+
+    void correctDrift();        //测量并修正各路漂移
+    void rebaseClock();         //以当前位置重置时钟基准
+};
+
+#endif // SYNCCONTROLLER_H
@@ -0,0 +1,85 @@
+#include "SyncPlayerWindow.h"
+
+#include<QGridLayout>
+#include<QHBoxLayout>
+#include<QVBoxLayout>
+#include<QFileInfo>
+#include<QStyle>
+#include<QtMath>
+
+SyncPlayerWindow::SyncPlayerWindow(const QStringList &filePaths,QWidget *parent)
+    : QWidget(parent,Qt::Window)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(QString("FrameSync同步播放 - %1路").arg(filePaths.size()));
+    setMinimumSize(800,600);
+
+    m_controller = new SyncController(this);
+
+    //按接近正方形的网格排列各路视频
+    QGridLayout *videoGrid = new QGridLayout;
+    videoGrid->setSpacing(2);
+    int nColumns=qCeil(qSqrt(filePaths.size()));
+    for(int i=0;i<filePaths.size();i++)
+    {
+        QVideoWidget *videoWidget = new QVideoWidget(this);
+        videoWidget->setToolTip(QFileInfo(filePaths[i]).fileName());
+        videoGrid->addWidget(videoWidget,i/nColumns,i%nColumns);
+        m_controller->addStream(filePaths[i],videoWidget);
+    }
+
+    //控制栏
+    m_playButton = new QPushButton(this);
+    m_playButton->setFixedSize(32,32);
+    m_playButton->setIcon(style()->standardIcon(QStyle::SP_MediaPlay));
+    m_progressSlider = new ClickableSlider(this);
+    m_timeLabel = new QLabel("00:00",this);
+    m_driftLabel = new QLabel(this);
+    m_driftLabel->setToolTip("各路相对主时钟的最大漂移");
+
+    QHBoxLayout *controlLayout = new QHBoxLayout;
+    controlLayout->addWidget(m_playButton);
+    controlLayout->addWidget(m_progressSlider,1);
+    controlLayout->addWidget(m_timeLabel);
+    controlLayout->addWidget(m_driftLabel);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(0,0,0,4);
+    mainLayout->addLayout(videoGrid,1);
+    mainLayout->addLayout(controlLayout);
+
+    connect(m_playButton,&QPushButton::clicked,this,&SyncPlayerWindow::togglePlay);
+    connect(m_progressSlider,&QSlider::sliderMoved,m_controller,&SyncController::setPosition);
+    connect(m_controller,&SyncController::positionChanged,this,&SyncPlayerWindow::updatePosition);
+    connect(m_controller,&SyncController::driftMeasured,this,&SyncPlayerWindow::updateDrift);
+    connect(m_controller,&SyncController::durationChanged,this,[this](qint64 duration){
+        m_progressSlider->setRange(0,duration);
+    });
+    connect(m_controller,&SyncController::playingChanged,this,[this](bool bPlaying){
+        m_playButton->setIcon(style()->standardIcon(bPlaying?QStyle::SP_MediaPause:QStyle::SP_MediaPlay));
+    });
+}
+
+void SyncPlayerWindow::togglePlay()
+{
+    if(m_controller->isPlaying())
+        m_controller->pause();
+    else
+        m_controller->play();
+}
+
+void SyncPlayerWindow::updatePosition(qint64 position)
+{
+    if(!m_progressSlider->isSliderDown())
+        m_progressSlider->setValue(position);
+
+    qint64 seconds=position/1000;
+    m_timeLabel->setText(QString("%1:%2")
+                             .arg(seconds/60,2,10,QChar('0'))
+                             .arg(seconds%60,2,10,QChar('0')));
+}
+
+void SyncPlayerWindow::updateDrift(qint64 drift)
+{
+    m_driftLabel->setText(QString("漂移 %1ms").arg(drift));
+}
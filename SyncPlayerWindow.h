@@ -0,0 +1,36 @@
+/*
+ * 多路同步播放窗口 每路一个视频显示组件，网格排列，共用一套播放控制
+ */
+
+#ifndef SYNCPLAYERWINDOW_H
+#define SYNCPLAYERWINDOW_H
+
+#include<QWidget>
+#include<QPushButton>
+#include<QLabel>
+
+#include"ClickableSlider.h"
+#include"SyncController.h"
+
+class SyncPlayerWindow : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit SyncPlayerWindow(const QStringList &filePaths,QWidget *parent=nullptr);
+
+    SyncController *controller() const {return m_controller;}
+
+private slots:
+    void togglePlay();                  //播放/暂停
+    void updatePosition(qint64 position);
+    void updateDrift(qint64 drift);
+
+private:
+    SyncController *m_controller;   //同步控制器
+    QPushButton *m_playButton;
+    ClickableSlider *m_progressSlider;
+    QLabel *m_timeLabel;
+    QLabel *m_driftLabel;           //最大漂移显示
+};
+
+#endif // SYNCPLAYERWINDOW_H
@@ -0,0 +1,312 @@
+#include "ThumbnailDiskCache.h"
+
+#include<QDir>
+#include<QFileInfo>
+#include<QDateTime>
+#include<QDataStream>
+#include<QSaveFile>
+#include<QPainter>
+#include<QBuffer>
+#include<QCryptographicHash>
+#include<QFutureWatcher>
+#include<QtConcurrent>
+#include<limits>
+
+namespace {
+const quint32 kIndexMagic = 0x46535449;     //"FSTI"
+const quint16 kIndexVersion = 2;
+const quint32 kSheetMagic = 0x46535350;     //"FSSP"
+const quint16 kSheetVersion = 2;
+const qint64 kSheetHeaderBytes = 16;        //精灵图文件头，后面紧跟格子表和JPEG数据
+const int kCellQuality = 75;                //格子的JPEG质量
+const int kFlushDelayMs = 5000;             //索引合并写入延迟
+}
+
+ThumbnailDiskCache::ThumbnailDiskCache(const QString &dirPath,QObject *parent,qint64 nBudgetBytes)
+    : QObject(parent)
+    , m_strDir(dirPath)
+    , m_nBudgetBytes(nBudgetBytes)
+{
+    QDir dir(m_strDir);
+    if(!dir.exists())
+        dir.mkpath(".");
+
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(kFlushDelayMs);
+    connect(m_flushTimer,&QTimer::timeout,this,&ThumbnailDiskCache::flush);
+
+    loadIndex();
+}
+
+ThumbnailDiskCache::~ThumbnailDiskCache()
+{
+    flush();
+    unmapSheet();
+}
+
+QString ThumbnailDiskCache::identityOf(const QString &filePath)
+{
+    QFileInfo info(filePath);
+    if(!info.exists())
+        return QString();
+    return QString("%1|%2|%3").arg(info.absoluteFilePath()).arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+qint64 ThumbnailDiskCache::emptySheetBytes(int nCells)
+{
+    return kSheetHeaderBytes+qint64(nCells)*sizeof(Slot);
+}
+
+void ThumbnailDiskCache::setFile(const QString &filePath,qint64 bucketMs,int nCells)
+{
+    unmapSheet();
+    m_strIdentity.clear();
+    m_strFilePath=filePath;
+    int nGeneration=++m_nGeneration;
+    if(filePath.isEmpty())
+        return;
+
+    //网络盘上stat也可能很慢，文件身份在后台取得，之前的查询和写入都不命中
+    nCells=qBound(1,nCells,kCells);
+    auto *watcher = new QFutureWatcher<QString>(this);
+    connect(watcher,&QFutureWatcher<QString>::finished,this,[this,watcher,nGeneration,bucketMs,nCells](){
+        watcher->deleteLater();
+        if(nGeneration==m_nGeneration)
+            openSheet(watcher->result(),bucketMs,nCells);
+    });
+    watcher->setFuture(QtConcurrent::run([filePath](){
+        return identityOf(filePath);
+    }));
+}
+
+void ThumbnailDiskCache::openSheet(const QString &identity,qint64 bucketMs,int nCells)
+{
+    if(identity.isEmpty())
+        return;
+    m_strIdentity=identity;
+
+    Entry &entry=m_entries[m_strIdentity];
+    if(entry.sheetName.isEmpty())
+        entry.sheetName=QCryptographicHash::hash(m_strIdentity.toUtf8(),QCryptographicHash::Sha1).toHex()+".sheet";
+
+    //时间桶长度或格数变了，格子与时间的对应关系失效，整张图重建
+    if(entry.bucketMs!=bucketMs || entry.cells!=nCells)
+    {
+        QFile::remove(QDir(m_strDir).filePath(entry.sheetName));
+        setSheetBytes(entry,0);
+        entry.bucketMs=bucketMs;
+        entry.cells=nCells;
+    }
+    entry.lastAccess=QDateTime::currentMSecsSinceEpoch();
+    markDirty();
+
+    if(!mapSheet(entry))
+    {
+        unmapSheet();
+        m_strIdentity.clear();
+    }
+    if(m_nUsedBytes>m_nBudgetBytes)
+        evictToBudget();
+}
+
+bool ThumbnailDiskCache::lookup(qint64 bucket,QImage *image)
+{
+    if(!m_pSheet || bucket<0 || bucket>=m_nCells)
+        return false;
+
+    //格子表和JPEG数据都直接从映射内存读取
+    const Slot &slot=reinterpret_cast<const Slot*>(m_pSheet+kSheetHeaderBytes)[bucket];
+    if(slot.length==0 || slot.offset<emptySheetBytes(m_nCells) || qint64(slot.offset)+slot.length>m_sheetFile.size())
+        return false;
+
+    QImage cell=QImage::fromData(m_pSheet+slot.offset,int(slot.length),"JPG");
+    if(cell.isNull())
+        return false;
+    *image=cell;
+    return true;
+}
+
+void ThumbnailDiskCache::store(qint64 bucket,const QImage &image)
+{
+    if(!m_pSheet || bucket<0 || bucket>=m_nCells || image.isNull())
+        return;
+    if(reinterpret_cast<const Slot*>(m_pSheet+kSheetHeaderBytes)[bucket].length>0)
+        return;
+
+    //按比例缩放后居中放进格子，空白处填黑
+    QImage cell(kCellWidth,kCellHeight,QImage::Format_RGB32);
+    cell.fill(Qt::black);
+    {
+        QPainter painter(&cell);
+        QImage scaled=image.scaled(kCellWidth,kCellHeight,Qt::KeepAspectRatio,Qt::SmoothTransformation);
+        painter.drawImage((kCellWidth-scaled.width())/2,(kCellHeight-scaled.height())/2,scaled);
+    }
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    if(!cell.save(&buffer,"JPG",kCellQuality))
+        return;
+
+    //JPEG追加到文件末尾，再填格子表；文件变长后重新映射
+    qint64 nOffset=m_sheetFile.size();
+    if(nOffset+data.size()>std::numeric_limits<quint32>::max())
+        return;
+    Slot slot;
+    slot.offset=quint32(nOffset);
+    slot.length=quint32(data.size());
+
+    m_sheetFile.unmap(m_pSheet);
+    m_pSheet=nullptr;
+    bool bWritten=m_sheetFile.seek(nOffset) && m_sheetFile.write(data)==data.size()
+                  && m_sheetFile.seek(kSheetHeaderBytes+bucket*qint64(sizeof(Slot)))
+                  && m_sheetFile.write(reinterpret_cast<const char*>(&slot),sizeof(Slot))==sizeof(Slot);
+    m_sheetFile.flush();
+
+    Entry &entry=m_entries[m_strIdentity];
+    setSheetBytes(entry,m_sheetFile.size());
+    markDirty();
+    if(!bWritten || !remapSheet())
+    {
+        unmapSheet();
+        m_strIdentity.clear();
+    }
+    if(m_nUsedBytes>m_nBudgetBytes)
+        evictToBudget();
+}
+
+bool ThumbnailDiskCache::mapSheet(Entry &entry)
+{
+    m_sheetFile.setFileName(QDir(m_strDir).filePath(entry.sheetName));
+    if(!m_sheetFile.open(QIODevice::ReadWrite))
+        return false;
+
+    quint32 nMagic=0;
+    quint16 nVersion=0,nWidth=0,nHeight=0,nCells=0;
+    {
+        QDataStream in(&m_sheetFile);
+        in>>nMagic>>nVersion>>nWidth>>nHeight>>nCells;
+    }
+    if(nMagic!=kSheetMagic || nVersion!=kSheetVersion || nWidth!=kCellWidth || nHeight!=kCellHeight
+       || nCells!=entry.cells || m_sheetFile.size()<emptySheetBytes(entry.cells))
+    {
+        //新建精灵图：只有文件头和空的格子表
+        m_sheetFile.resize(0);
+        m_sheetFile.seek(0);
+        QDataStream out(&m_sheetFile);
+        out<<kSheetMagic<<kSheetVersion<<quint16(kCellWidth)<<quint16(kCellHeight)<<quint16(entry.cells);
+        m_sheetFile.resize(emptySheetBytes(entry.cells));
+        m_sheetFile.flush();
+    }
+    setSheetBytes(entry,m_sheetFile.size());
+    markDirty();
+
+    m_nCells=entry.cells;
+    return remapSheet();
+}
+
+bool ThumbnailDiskCache::remapSheet()
+{
+    m_pSheet=m_sheetFile.map(0,m_sheetFile.size());
+    return m_pSheet!=nullptr;
+}
+
+void ThumbnailDiskCache::unmapSheet()
+{
+    if(m_pSheet)
+    {
+        m_sheetFile.unmap(m_pSheet);
+        m_pSheet=nullptr;
+    }
+    if(m_sheetFile.isOpen())
+        m_sheetFile.close();
+    m_nCells=0;
+}
+
+void ThumbnailDiskCache::setSheetBytes(Entry &entry,qint64 nBytes)
+{
+    m_nUsedBytes+=nBytes-entry.bytes;
+    entry.bytes=nBytes;
+}
+
+void ThumbnailDiskCache::evictToBudget()
+{
+    //淘汰到预算的90%，避免每写入一格就触发一次淘汰
+    qint64 nTarget=m_nBudgetBytes*9/10;
+    while(m_nUsedBytes>nTarget)
+    {
+        auto oldest=m_entries.end();
+        for(auto it=m_entries.begin();it!=m_entries.end();++it)
+        {
+            if(it.key()==m_strIdentity)
+                continue;
+            if(oldest==m_entries.end() || it->lastAccess<oldest->lastAccess)
+                oldest=it;
+        }
+        if(oldest==m_entries.end())
+            break;
+
+        QFile::remove(QDir(m_strDir).filePath(oldest->sheetName));
+        m_nUsedBytes-=oldest->bytes;
+        m_entries.erase(oldest);
+    }
+    markDirty();
+}
+
+void ThumbnailDiskCache::loadIndex()
+{
+    QFile file(QDir(m_strDir).filePath("index.dat"));
+    if(!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 nMagic;
+    quint16 nVersion;
+    qint32 nCount;
+    in>>nMagic>>nVersion>>nCount;
+    if(nMagic!=kIndexMagic || nVersion!=kIndexVersion)
+    {
+        //旧格式的精灵图不在新索引中，不删掉就永远占着磁盘
+        QDir dir(m_strDir);
+        for(const QString &name:dir.entryList(QStringList("*.sheet"),QDir::Files))
+            dir.remove(name);
+        return;
+    }
+
+    for(qint32 i=0;i<nCount && in.status()==QDataStream::Ok;i++)
+    {
+        QString identity;
+        Entry entry;
+        in>>identity>>entry.sheetName>>entry.bucketMs>>entry.lastAccess>>entry.cells>>entry.bytes;
+        if(in.status()!=QDataStream::Ok || entry.cells<1 || entry.cells>kCells || entry.bytes<0)
+            break;
+        m_nUsedBytes+=entry.bytes;
+        m_entries.insert(identity,entry);
+    }
+}
+
+void ThumbnailDiskCache::flush()
+{
+    if(!m_bDirty)
+        return;
+
+    QSaveFile file(QDir(m_strDir).filePath("index.dat"));
+    if(file.open(QIODevice::WriteOnly))
+    {
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_6_0);
+        out<<kIndexMagic<<kIndexVersion<<qint32(m_entries.size());
+        for(auto it=m_entries.cbegin();it!=m_entries.cend();++it)
+            out<<it.key()<<it->sheetName<<it->bucketMs<<it->lastAccess<<it->cells<<it->bytes;
+        if(file.commit())
+            m_bDirty=false;
+    }
+}
+
+void ThumbnailDiskCache::markDirty()
+{
+    m_bDirty=true;
+    if(!m_flushTimer->isActive())
+        m_flushTimer->start();
+}
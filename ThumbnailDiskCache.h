@@ -0,0 +1,75 @@
+/*
+ * 缩略图磁盘缓存 按文件身份（路径+大小+修改时间）索引
+ * 每个媒体文件的缩略图存成一张精灵图，以内存映射方式读取，重新打开文件时无需解码即可预览
+ * 精灵图的格数与文件实际的时间桶数一致，格子压缩成JPEG按写入顺序追加，未写入的格子不占空间
+ * 总大小按实际写入的字节数计入预算，超出时按最近访问时间淘汰整张精灵图
+ */
+
+#ifndef THUMBNAILDISKCACHE_H
+#define THUMBNAILDISKCACHE_H
+
+#include<QObject>
+#include<QHash>
+#include<QFile>
+#include<QImage>
+#include<QTimer>
+
+class ThumbnailDiskCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ThumbnailDiskCache(const QString &dirPath,QObject *parent=nullptr,qint64 nBudgetBytes=512LL*1024*1024);
+    ~ThumbnailDiskCache();
+
+    static const int kCellWidth = 160;  //每格尺寸
+    static const int kCellHeight = 90;
+    static const int kCells = 201;      //每个文件最多格数（与时间桶一一对应）
+
+    void setFile(const QString &filePath,qint64 bucketMs,int nCells);   //切换当前文件，后台取得文件身份后映射其精灵图
+    bool lookup(qint64 bucket,QImage *image);               //从精灵图读取一格
+    void store(qint64 bucket,const QImage &image);          //写入一格
+    void flush();                                           //保存索引
+
+private:
+    struct Entry
+    {
+        QString sheetName;      //精灵图文件名
+        qint64 bucketMs = 0;    //时间桶长度，变化后整张图作废
+        qint64 lastAccess = 0;  //最近访问时间（毫秒时间戳）
+        qint32 cells = 0;       //格数，变化后整张图作废
+        qint64 bytes = 0;       //精灵图文件大小
+    };
+
+    //精灵图文件头之后的格子表，每格一项，长度为0表示尚未写入
+    struct Slot
+    {
+        quint32 offset;
+        quint32 length;
+    };
+
+    QString m_strDir;                   //缓存目录
+    qint64 m_nBudgetBytes;              //磁盘预算
+    qint64 m_nUsedBytes = 0;            //精灵图文件实际占用的字节数
+    QHash<QString,Entry> m_entries;     //文件身份——索引项
+    QString m_strFilePath;              //当前文件，身份在后台取得
+    QString m_strIdentity;              //当前文件身份
+    QFile m_sheetFile;                  //当前精灵图文件
+    uchar *m_pSheet = nullptr;          //当前精灵图映射地址
+    int m_nCells = 0;                   //当前精灵图的格数
+    int m_nGeneration = 0;              //每次切换文件加一，丢弃过期的身份查询结果
+    bool m_bDirty = false;
+    QTimer *m_flushTimer;               //合并索引写入
+
+    static QString identityOf(const QString &filePath);
+    static qint64 emptySheetBytes(int nCells);  //只有文件头和格子表的精灵图大小
+    void openSheet(const QString &identity,qint64 bucketMs,int nCells);
+    bool mapSheet(Entry &entry);
+    bool remapSheet();
+    void setSheetBytes(Entry &entry,qint64 nBytes);
+    void unmapSheet();
+    void evictToBudget();
+    void loadIndex();
+    void markDirty();
+};
+
+#endif // THUMBNAILDISKCACHE_H
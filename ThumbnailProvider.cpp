@@ -0,0 +1,213 @@
+#include "ThumbnailProvider.h"
+
+#include<QUrl>
+#include<QTimer>
+#include<QFutureWatcher>
+#include<QtConcurrent>
+
+#include"FrameConverter.h"
+
+const QSize ThumbnailProvider::kThumbnailSize(160,90);
+
+namespace {
+const int kDecodeTimeoutMs = 3000;  //单次取帧超时，超时后解码器回到空闲
+const int kBucketsPerFile = 200;    //整个文件最多划分的时间桶数量
+}
+
+ThumbnailProvider::ThumbnailProvider(QObject *parent,int nDecoders,int nMemoryCapKB)
+    : QObject(parent)
+{
+    m_cache.setMaxCost(nMemoryCapKB);
+
+    for(int i=0;i<nDecoders;i++)
+    {
+        Decoder *decoder = new Decoder;
+        decoder->player = new QMediaPlayer(this);
+        decoder->sink = new QVideoSink(this);
+        decoder->player->setVideoOutput(decoder->sink);
+
+        connect(decoder->sink,&QVideoSink::videoFrameChanged,this,[this,decoder](const QVideoFrame &frame){
+            onDecoderFrame(decoder,frame);
+        });
+        //媒体加载完成后才能定位
+        connect(decoder->player,&QMediaPlayer::mediaStatusChanged,this,[this,decoder](QMediaPlayer::MediaStatus status){
+            if(status==QMediaPlayer::LoadedMedia && decoder->bucket>=0)
+                startDecoder(decoder);
+            else if(status==QMediaPlayer::InvalidMedia)
+                finishDecoder(decoder);
+        });
+        connect(decoder->player,&QMediaPlayer::errorOccurred,this,[this,decoder](){
+            finishDecoder(decoder);
+        });
+        m_decoders.append(decoder);
+    }
+}
+
+ThumbnailProvider::~ThumbnailProvider()
+{
+    qDeleteAll(m_decoders);
+}
+
+void ThumbnailProvider::enableDiskCache(const QString &dirPath)
+{
+    if(!m_diskCache)
+        m_diskCache = new ThumbnailDiskCache(dirPath,this);
+}
+
+void ThumbnailProvider::setSource(const QString &filePath)
+{
+    if(filePath==m_strFilePath)
+        return;
+    m_strFilePath=filePath;
+    m_nPendingBucket=-1;
+}
+
+void ThumbnailProvider::setDuration(qint64 duration)
+{
+    m_nBucketMs=qMax<qint64>(1000,duration/kBucketsPerFile);
+
+    //时长确定后时间桶才确定，此时映射磁盘上的精灵图
+    if(m_diskCache && !m_strFilePath.isEmpty())
+    {
+        m_diskCache->setFile(m_strFilePath,m_nBucketMs,int(qMax<qint64>(0,duration)/m_nBucketMs)+1);
+        m_strDiskFile=m_strFilePath;
+    }
+}
+
+void ThumbnailProvider::request(qint64 position)
+{
+    if(m_strFilePath.isEmpty())
+        return;
+
+    qint64 nBucket=bucketOf(position);
+    if(QImage *image=m_cache.object(cacheKey(m_strFilePath,nBucket)))
+    {
+        emit thumbnailReady(nBucket*m_nBucketMs,*image);
+        return;
+    }
+
+    //内存未命中时查磁盘精灵图，命中则无需解码
+    QImage image;
+    if(m_diskCache && m_strDiskFile==m_strFilePath && m_diskCache->lookup(nBucket,&image))
+    {
+        m_cache.insert(cacheKey(m_strFilePath,nBucket),new QImage(image),qMax<qsizetype>(1,image.sizeInBytes()/1024));
+        emit thumbnailReady(nBucket*m_nBucketMs,image);
+        return;
+    }
+
+    if(isRunning(nBucket))
+        return;
+
+    //新的悬停位置直接取代尚未开始的旧请求
+    m_nPendingBucket=nBucket;
+    dispatch();
+}
+
+void ThumbnailProvider::cancelPending()
+{
+    m_nPendingBucket=-1;
+}
+
+QString ThumbnailProvider::cacheKey(const QString &filePath,qint64 bucket) const
+{
+    return QString("%1|%2|%3").arg(filePath).arg(m_nBucketMs).arg(bucket);
+}
+
+bool ThumbnailProvider::isRunning(qint64 bucket) const
+{
+    for(const Decoder *decoder:m_decoders)
+    {
+        if(decoder->bucket==bucket && decoder->source==m_strFilePath)
+            return true;
+    }
+    return false;
+}
+
+void ThumbnailProvider::dispatch()
+{
+    if(m_nPendingBucket<0)
+        return;
+
+    //优先选择已经加载了当前文件的空闲解码器，省去打开文件的开销
+    Decoder *idle=nullptr;
+    for(Decoder *decoder:m_decoders)
+    {
+        if(decoder->bucket>=0)
+            continue;
+        if(!idle || decoder->source==m_strFilePath)
+            idle=decoder;
+    }
+    if(!idle)
+        return;
+
+    idle->bucket=m_nPendingBucket;
+    idle->target=m_nPendingBucket*m_nBucketMs+m_nBucketMs/2;
+    m_nPendingBucket=-1;
+
+    int nGeneration=++idle->generation;
+    QTimer::singleShot(kDecodeTimeoutMs,this,[this,idle,nGeneration](){
+        if(idle->generation==nGeneration && idle->bucket>=0)
+            finishDecoder(idle);
+    });
+
+    if(idle->source!=m_strFilePath)
+    {
+        idle->source=m_strFilePath;
+        idle->player->setSource(QUrl::fromLocalFile(m_strFilePath));
+        return;
+    }
+    startDecoder(idle);
+}
+
+void ThumbnailProvider::startDecoder(Decoder *decoder)
+{
+    //暂停状态下定位，后端只解码目标帧
+    decoder->player->setPosition(decoder->target);
+    if(decoder->player->playbackState()!=QMediaPlayer::PausedState)
+        decoder->player->pause();
+}
+
+void ThumbnailProvider::onDecoderFrame(Decoder *decoder,const QVideoFrame &frame)
+{
+    if(decoder->bucket<0 || !frame.isValid())
+        return;
+
+    //忽略定位完成前残留的旧帧
+    qint64 nFrameMs=frame.startTime()/1000;
+    if(qAbs(nFrameMs-decoder->target)>qMax<qint64>(m_nBucketMs,1000))
+        return;
+
+    QString filePath=decoder->source;
+    qint64 nBucket=decoder->bucket;
+    finishDecoder(decoder);
+
+    //颜色转换和缩放一趟完成，放到线程池，GUI线程只负责收结果
+    QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher,&QFutureWatcher<QImage>::finished,this,[this,watcher,filePath,nBucket](){
+        storeThumbnail(filePath,nBucket,watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([frame](){
+        return FrameConverter::convert(frame,kThumbnailSize);
+    }));
+}
+
+void ThumbnailProvider::finishDecoder(Decoder *decoder)
+{
+    decoder->bucket=-1;
+    dispatch();
+}
+
+void ThumbnailProvider::storeThumbnail(const QString &filePath,qint64 bucket,const QImage &image)
+{
+    if(image.isNull())
+        return;
+
+    m_cache.insert(cacheKey(filePath,bucket),new QImage(image),qMax<qsizetype>(1,image.sizeInBytes()/1024));
+    if(filePath==m_strFilePath)
+    {
+        if(m_diskCache && m_strDiskFile==filePath)
+            m_diskCache->store(bucket,image);
+        emit thumbnailReady(bucket*m_nBucketMs,image);
+    }
+}
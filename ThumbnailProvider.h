@@ -0,0 +1,68 @@
+/*
+ * 进度条悬停预览缩略图提供者
+ * 由少量后台解码器取帧，缩放在线程池中完成，结果放入有内存上限的LRU缓存
+ * 新的悬停请求到来时丢弃尚未开始的过期请求
+ */
+
+#ifndef THUMBNAILPROVIDER_H
+#define THUMBNAILPROVIDER_H
+
+#include<QObject>
+#include<QCache>
+#include<QImage>
+#include<QVector>
+#include<QMediaPlayer>
+#include<QVideoSink>
+#include<QVideoFrame>
+
+#include"ThumbnailDiskCache.h"
+
+class ThumbnailProvider : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ThumbnailProvider(QObject *parent=nullptr,int nDecoders=2,int nMemoryCapKB=32*1024);
+    ~ThumbnailProvider();
+
+    static const QSize kThumbnailSize;  //缩略图尺寸
+
+    void enableDiskCache(const QString &dirPath);   //启用跨会话的磁盘缓存
+    void setSource(const QString &filePath);    //切换当前文件（清空待处理请求）
+    void setDuration(qint64 duration);          //根据时长确定取帧粒度
+    qint64 bucketOf(qint64 position) const {return position/m_nBucketMs;}
+
+    void request(qint64 position);  //请求某时刻的缩略图
+    void cancelPending();           //丢弃尚未开始解码的请求
+
+signals:
+    void thumbnailReady(qint64 position,const QImage &image);
+
+private:
+    struct Decoder
+    {
+        QMediaPlayer *player;
+        QVideoSink *sink;
+        QString source;         //已加载的文件
+        qint64 bucket = -1;     //正在解码的时间桶，-1表示空闲
+        qint64 target = 0;      //定位目标（毫秒）
+        int generation = 0;     //用于识别超时
+    };
+    QVector<Decoder*> m_decoders;   //后台解码器池
+
+    QString m_strFilePath;          //当前文件
+    qint64 m_nBucketMs = 1000;      //每个时间桶的长度（毫秒）
+    qint64 m_nPendingBucket = -1;   //等待解码的时间桶，只保留最新一次悬停
+    QCache<QString,QImage> m_cache; //缩略图LRU缓存，开销按KB计
+    ThumbnailDiskCache *m_diskCache = nullptr;  //磁盘缓存（可选）
+    QString m_strDiskFile;          //磁盘缓存当前映射的文件
+
+    QString cacheKey(const QString &filePath,qint64 bucket) const;
+    bool isRunning(qint64 bucket) const;
+    void startDecoder(Decoder *decoder);
+    void dispatch();                //把待处理请求分配给空闲解码器
+    void onDecoderFrame(Decoder *decoder,const QVideoFrame &frame);
+    void finishDecoder(Decoder *decoder);
+    void storeThumbnail(const QString &filePath,qint64 bucket,const QImage &image);
+};
+
+#endif // THUMBNAILPROVIDER_H
@@ -0,0 +1,398 @@
+#include "TimeshiftBuffer.h"
+
+#include<QNetworkAccessManager>
+#include<QNetworkRequest>
+#include<QNetworkReply>
+#include<QPointer>
+#include<QFileInfo>
+#include<QDir>
+#include<QCoreApplication>
+#include<algorithm>
+
+namespace {
+const qint64 TsPacketSize = 188;            //MPEG-TS包长，从中间开始读时按包对齐
+const qint64 MaxWriteChunk = 256*1024;      //每次写入的上限，须小于读写之间的保留距离
+const qint64 IndexIntervalMs = 200;         //时间索引的采样间隔
+
+qint64 alignUp(qint64 offset)
+{
+    return (offset+TsPacketSize-1)/TsPacketSize*TsPacketSize;
+}
+}
+
+//网络线程中的录制端：收到的数据直接写入循环文件，不做背压
+class TimeshiftWriter : public QObject
+{
+public:
+    explicit TimeshiftWriter(TimeshiftBuffer *buffer)
+        : m_buffer(buffer)
+    {
+    }
+
+    void start()
+    {
+        //预先设好文件长度，之后只在文件内覆盖写
+        m_file.setFileName(m_buffer->m_strFilePath);
+        if(!m_file.open(QIODevice::ReadWrite|QIODevice::Truncate) || !m_file.resize(m_buffer->m_nCapacity))
+        {
+            fail(m_file.errorString());
+            return;
+        }
+
+        m_manager=new QNetworkAccessManager(this);
+        QNetworkRequest request(m_buffer->m_url);
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,QNetworkRequest::NoLessSafeRedirectPolicy);
+        m_reply=m_manager->get(request);
+        connect(m_reply,&QNetworkReply::readyRead,this,[this](){writeAvailable();});
+        connect(m_reply,&QNetworkReply::finished,this,[this](){
+            writeAvailable();
+            if(m_reply->error()!=QNetworkReply::NoError && m_reply->error()!=QNetworkReply::OperationCanceledError)
+            {
+                fail(m_reply->errorString());
+                return;
+            }
+            QMutexLocker lock(&m_buffer->m_mutex);
+            m_buffer->m_state=TimeshiftBuffer::Finished;
+            m_buffer->m_dataWritten.wakeAll();
+        });
+    }
+
+    void abort()
+    {
+        if(m_reply)
+            m_reply->abort();
+    }
+
+private:
+    TimeshiftBuffer *m_buffer;
+    QFile m_file;
+    QNetworkAccessManager *m_manager = nullptr;
+    QPointer<QNetworkReply> m_reply;
+
+    void writeAvailable()
+    {
+        const qint64 nCapacity=m_buffer->m_nCapacity;
+        while(m_reply && m_reply->bytesAvailable()>0)
+        {
+            QByteArray data=m_reply->read(MaxWriteChunk);
+            if(data.isEmpty())
+                break;
+
+            //只有本线程修改写入位置，读取它不需要加锁
+            qint64 nPhysical=m_buffer->m_nWritten%nCapacity;
+            qint64 nFirst=qMin<qint64>(data.size(),nCapacity-nPhysical);
+            bool bOk=m_file.seek(nPhysical) && m_file.write(data.constData(),nFirst)==nFirst;
+            if(bOk && data.size()>nFirst)
+                bOk=m_file.seek(0) && m_file.write(data.constData()+nFirst,data.size()-nFirst)==data.size()-nFirst;
+            //写到系统缓存，读取端用自己的文件句柄才能看到
+            bOk=bOk && m_file.flush();
+            if(!bOk)
+            {
+                fail(m_file.errorString());
+                m_reply->abort();
+                return;
+            }
+
+            QMutexLocker lock(&m_buffer->m_mutex);
+            m_buffer->m_nWritten+=data.size();
+            m_buffer->m_state=TimeshiftBuffer::Recording;
+
+            qint64 timeMs=m_buffer->m_clock.elapsed();
+            QList<TimeshiftBuffer::IndexEntry> &index=m_buffer->m_index;
+            if(index.isEmpty() || timeMs-index.last().timeMs>=IndexIntervalMs)
+                index.append({timeMs,m_buffer->m_nWritten});
+            //保留一条早于最旧数据的条目，换算时间时用来插值
+            qint64 oldest=m_buffer->m_nWritten-nCapacity;
+            while(index.size()>1 && index.at(1).offset<=oldest)
+                index.removeFirst();
+            m_buffer->m_dataWritten.wakeAll();
+        }
+    }
+
+    void fail(const QString &errorString)
+    {
+        QMutexLocker lock(&m_buffer->m_mutex);
+        m_buffer->m_state=TimeshiftBuffer::Failed;
+        m_buffer->m_strError=errorString;
+        m_buffer->m_dataWritten.wakeAll();
+    }
+};
+
+TimeshiftBuffer::TimeshiftBuffer(const QUrl &url,const QString &filePath,qint64 capacity,QObject *parent)
+    : QObject(parent)
+    , m_url(url)
+    , m_nCapacity(qMax<qint64>(16*1024*1024,capacity))
+{
+    //每个缓冲用自己的循环文件：换流时旧缓冲延迟删除，不能删掉新缓冲刚建的文件
+    static int s_nSerial=0;
+    QFileInfo fileInfo(filePath);
+    m_strFilePath=fileInfo.dir().filePath(QString("%1-%2-%3.%4").arg(fileInfo.completeBaseName())
+                                              .arg(QCoreApplication::applicationPid())
+                                              .arg(++s_nSerial)
+                                              .arg(fileInfo.suffix()));
+    m_nSafetyMargin=qMax<qint64>(2*1024*1024,m_nCapacity/64);
+
+    m_networkThread = new QThread(this);
+    m_writer = new TimeshiftWriter(this);
+    m_writer->moveToThread(m_networkThread);
+    connect(m_networkThread,&QThread::finished,m_writer,&QObject::deleteLater);
+}
+
+TimeshiftBuffer::~TimeshiftBuffer()
+{
+    stop();
+    //读取端关闭时要用到本对象的锁，先于成员析构删除
+    qDeleteAll(findChildren<TimeshiftReader*>(Qt::FindDirectChildrenOnly));
+}
+
+bool TimeshiftBuffer::start()
+{
+    if(!m_writer || m_networkThread->isRunning())
+        return false;
+
+    m_clock.start();
+    m_networkThread->start();
+    TimeshiftWriter *writer=m_writer;
+    QMetaObject::invokeMethod(writer,[writer](){writer->start();},Qt::QueuedConnection);
+    return true;
+}
+
+void TimeshiftBuffer::stop()
+{
+    if(!m_writer)
+        return;
+
+    TimeshiftWriter *writer=m_writer;
+    QMetaObject::invokeMethod(writer,[writer](){writer->abort();},Qt::QueuedConnection);
+    m_networkThread->quit();
+    m_networkThread->wait();
+    m_writer=nullptr;
+
+    {
+        QMutexLocker lock(&m_mutex);
+        if(m_state==Connecting || m_state==Recording)
+            m_state=Finished;
+        m_dataWritten.wakeAll();
+    }
+    QFile::remove(m_strFilePath);
+}
+
+qint64 TimeshiftBuffer::oldestOffsetLocked() const
+{
+    return qMax<qint64>(0,m_nWritten-m_nCapacity+m_nSafetyMargin);
+}
+
+qint64 TimeshiftBuffer::offsetAtLocked(qint64 timeMs) const
+{
+    qint64 oldest=oldestOffsetLocked();
+    auto it=std::lower_bound(m_index.cbegin(),m_index.cend(),timeMs,[](const IndexEntry &entry,qint64 time){
+        return entry.timeMs<time;
+    });
+    //该时刻之前已写入的位置就是该时刻到达的数据的起点
+    qint64 offset=it==m_index.cend()?m_nWritten:it->offset;
+    if(it!=m_index.cbegin() && it!=m_index.cend())
+        offset=std::prev(it)->offset;
+    offset=offset/TsPacketSize*TsPacketSize;
+    return qBound(alignUp(oldest),offset,m_nWritten);
+}
+
+qint64 TimeshiftBuffer::timeAtLocked(qint64 offset) const
+{
+    if(m_index.isEmpty())
+        return 0;
+
+    //最后一条位置不超过offset的条目，与下一条之间线性插值
+    auto it=std::upper_bound(m_index.cbegin(),m_index.cend(),offset,[](qint64 pos,const IndexEntry &entry){
+        return pos<entry.offset;
+    });
+    if(it==m_index.cbegin())
+        return it->timeMs;
+    if(it==m_index.cend())
+        return m_index.last().timeMs;
+    const IndexEntry &before=*std::prev(it);
+    const IndexEntry &after=*it;
+    if(after.offset==before.offset)
+        return after.timeMs;
+    return before.timeMs+(after.timeMs-before.timeMs)*(offset-before.offset)/(after.offset-before.offset);
+}
+
+qint64 TimeshiftBuffer::oldestTime() const
+{
+    QMutexLocker lock(&m_mutex);
+    return timeAtLocked(oldestOffsetLocked());
+}
+
+qint64 TimeshiftBuffer::liveTime() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_index.isEmpty()?0:m_index.last().timeMs;
+}
+
+qint64 TimeshiftBuffer::timeAt(qint64 offset) const
+{
+    QMutexLocker lock(&m_mutex);
+    return timeAtLocked(offset);
+}
+
+TimeshiftBuffer::Stats TimeshiftBuffer::stats() const
+{
+    QMutexLocker lock(&m_mutex);
+    Stats stats;
+    stats.state=m_state;
+    stats.written=m_nWritten;
+    stats.capacity=m_nCapacity;
+    stats.overruns=m_nOverruns;
+    stats.errorString=m_strError;
+    if(!m_index.isEmpty())
+    {
+        const IndexEntry &last=m_index.last();
+        stats.windowMs=last.timeMs-timeAtLocked(oldestOffsetLocked());
+
+        //最近约5秒的接收速度
+        for(auto it=m_index.crbegin();it!=m_index.crend();++it)
+        {
+            if(last.timeMs-it->timeMs>=5000)
+            {
+                stats.bitRate=(last.offset-it->offset)*1000.0/(last.timeMs-it->timeMs);
+                break;
+            }
+        }
+    }
+    return stats;
+}
+
+TimeshiftReader *TimeshiftBuffer::createReader(qint64 timeMs)
+{
+    QMutexLocker lock(&m_mutex);
+    return new TimeshiftReader(this,offsetAtLocked(timeMs),this);
+}
+
+TimeshiftReader::TimeshiftReader(TimeshiftBuffer *buffer,qint64 offset,QObject *parent)
+    : QIODevice(parent)
+    , m_buffer(buffer)
+    , m_file(buffer->m_strFilePath)
+    , m_nOffset(offset)
+{
+}
+
+TimeshiftReader::~TimeshiftReader()
+{
+    close();
+}
+
+bool TimeshiftReader::open(OpenMode mode)
+{
+    if(mode&WriteOnly)
+        return false;
+    //循环文件由录制线程创建，打开时可能还不存在，留到后端线程第一次读取时再打开
+    return QIODevice::open(mode|Unbuffered);
+}
+
+void TimeshiftReader::close()
+{
+    abort();
+    m_file.close();
+    if(isOpen())
+        QIODevice::close();
+}
+
+void TimeshiftReader::abort()
+{
+    QMutexLocker lock(&m_buffer->m_mutex);
+    m_bAborted=true;
+    m_buffer->m_dataWritten.wakeAll();
+}
+
+bool TimeshiftReader::atEnd() const
+{
+    QMutexLocker lock(&m_buffer->m_mutex);
+    if(m_bAborted)
+        return true;
+    bool bLive=m_buffer->m_state==TimeshiftBuffer::Connecting || m_buffer->m_state==TimeshiftBuffer::Recording;
+    return !bLive && m_nOffset>=m_buffer->m_nWritten;
+}
+
+qint64 TimeshiftReader::bytesAvailable() const
+{
+    QMutexLocker lock(&m_buffer->m_mutex);
+    return qMax<qint64>(0,m_buffer->m_nWritten-m_nOffset)+QIODevice::bytesAvailable();
+}
+
+qint64 TimeshiftReader::playheadTime() const
+{
+    QMutexLocker lock(&m_buffer->m_mutex);
+    return m_buffer->timeAtLocked(m_nOffset);
+}
+
+qint64 TimeshiftReader::readData(char *data,qint64 maxSize)
+{
+    const qint64 nCapacity=m_buffer->m_nCapacity;
+    QMutexLocker lock(&m_buffer->m_mutex);
+    while(true)
+    {
+        if(m_bAborted)
+            return -1;
+
+        //落后到已被覆盖的范围：跳到最旧的可用位置
+        qint64 oldest=m_buffer->oldestOffsetLocked();
+        if(m_nOffset<oldest)
+        {
+            m_nOffset=alignUp(oldest);
+            m_buffer->m_nOverruns++;
+        }
+
+        //到达直播边缘：等新数据
+        if(m_buffer->m_nWritten<=m_nOffset)
+        {
+            if(m_buffer->m_state==TimeshiftBuffer::Finished || m_buffer->m_state==TimeshiftBuffer::Failed)
+                return -1;
+            m_buffer->m_dataWritten.wait(&m_buffer->m_mutex,200);
+            continue;
+        }
+
+        //已有数据说明循环文件已经建好
+        if(!m_file.isOpen())
+        {
+            lock.unlock();
+            bool bOpened=m_file.open(QIODevice::ReadOnly);
+            lock.relock();
+            if(!bOpened)
+            {
+                setErrorString(m_file.errorString());
+                return -1;
+            }
+            continue;
+        }
+
+        //读盘时不持锁，读完再确认这段没有在读取期间被覆盖
+        qint64 offset=m_nOffset;
+        qint64 nBytes=qMin(maxSize,qMin(m_buffer->m_nWritten-offset,m_buffer->m_nSafetyMargin/2));
+        lock.unlock();
+
+        qint64 nPhysical=offset%nCapacity;
+        qint64 nFirst=qMin(nBytes,nCapacity-nPhysical);
+        qint64 nRead=-1;
+        if(m_file.seek(nPhysical))
+            nRead=m_file.read(data,nFirst);
+        if(nRead==nFirst && nBytes>nFirst && m_file.seek(0))
+        {
+            qint64 nSecond=m_file.read(data+nFirst,nBytes-nFirst);
+            nRead=nSecond<0?-1:nRead+nSecond;
+        }
+
+        lock.relock();
+        if(nRead<0)
+            return -1;
+        if(offset<m_buffer->m_nWritten-nCapacity)
+            continue;
+        m_nOffset=offset+nRead;
+        return nRead;
+    }
+}
+
+qint64 TimeshiftReader::writeData(const char *data,qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
@@ -0,0 +1,121 @@
+/*
+ * 直播时移 把网络流收到的字节循环写入磁盘上的定长文件，同时记录到达时间索引
+ * 播放器通过TimeshiftReader从任意已缓存的时间点读取：暂停不丢内容，可以后退、拖动，再回到直播
+ * 写满后从头覆盖最旧的数据；读取落后到被覆盖的范围时跳到最旧的可用位置
+ * 从中间开始读取依赖容器能自行重新同步（MPEG-TS、ADTS、MP3等直播常用格式），偏移按TS包长对齐
+ */
+
+#ifndef TIMESHIFTBUFFER_H
+#define TIMESHIFTBUFFER_H
+
+#include<QObject>
+#include<QIODevice>
+#include<QUrl>
+#include<QFile>
+#include<QList>
+#include<QMutex>
+#include<QWaitCondition>
+#include<QThread>
+#include<QElapsedTimer>
+
+class TimeshiftWriter;
+class TimeshiftReader;
+
+class TimeshiftBuffer : public QObject
+{
+    Q_OBJECT
+public:
+    enum State{
+        Connecting,
+        Recording,
+        Finished,       //服务器结束了流
+        Failed
+    };
+
+    struct Stats
+    {
+        State state = Connecting;
+        qint64 written = 0;         //累计收到的字节数
+        qint64 capacity = 0;
+        qint64 windowMs = 0;        //可回看的时长
+        double bitRate = 0;         //最近的接收速度（字节/秒）
+        int overruns = 0;           //读取落后被覆盖的次数
+        QString errorString;
+    };
+
+    //filePath为循环文件名模板，实际文件名加上进程号和序号，各缓冲互不干扰
+    explicit TimeshiftBuffer(const QUrl &url,const QString &filePath,qint64 capacity,QObject *parent=nullptr);
+    ~TimeshiftBuffer();
+
+    bool start();       //创建循环文件并开始录制
+    void stop();        //停止录制并删除循环文件
+
+    QUrl url() const {return m_url;}
+    qint64 oldestTime() const;      //最早可回看的时间（录制开始以来的毫秒数）
+    qint64 liveTime() const;        //最新数据的到达时间
+    qint64 timeAt(qint64 offset) const;     //字节位置对应的到达时间
+    Stats stats() const;
+
+    TimeshiftReader *createReader(qint64 timeMs);   //从指定时间开始读取，读取端归缓冲所有
+
+private:
+    friend class TimeshiftWriter;
+    friend class TimeshiftReader;
+
+    struct IndexEntry
+    {
+        qint64 timeMs;      //录制开始以来的毫秒数
+        qint64 offset;      //该时刻已写入的逻辑字节位置
+    };
+
+    QUrl m_url;
+    QString m_strFilePath;
+    qint64 m_nCapacity;
+    qint64 m_nSafetyMargin;         //读取与写入位置之间保留的距离，防止读到正在覆盖的数据
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_dataWritten;
+    qint64 m_nWritten = 0;          //逻辑字节位置，文件中的位置为对容量取模
+    QList<IndexEntry> m_index;      //按时间递增，最旧的条目随覆盖丢弃
+    QElapsedTimer m_clock;
+    State m_state = Connecting;
+    int m_nOverruns = 0;
+    QString m_strError;
+
+    QThread *m_networkThread;
+    TimeshiftWriter *m_writer = nullptr;
+
+    qint64 oldestOffsetLocked() const;
+    qint64 offsetAtLocked(qint64 timeMs) const;
+    qint64 timeAtLocked(qint64 offset) const;
+};
+
+//时移读取端 顺序设备，读到直播边缘时阻塞等待新数据；循环文件在第一次读到数据时才打开，open不等待
+class TimeshiftReader : public QIODevice
+{
+    Q_OBJECT
+public:
+    TimeshiftReader(TimeshiftBuffer *buffer,qint64 offset,QObject *parent=nullptr);
+    ~TimeshiftReader();
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override {return true;}
+    bool atEnd() const override;
+    qint64 bytesAvailable() const override;
+
+    void abort();               //让阻塞的读取立即返回，换源前调用
+    qint64 playheadTime() const;    //当前读到的数据的到达时间
+
+protected:
+    qint64 readData(char *data,qint64 maxSize) override;
+    qint64 writeData(const char *data,qint64 maxSize) override;
+
+private:
+    TimeshiftBuffer *m_buffer;
+    QFile m_file;               //读取线程第一次读到数据时打开
+    qint64 m_nOffset;           //下一次读取的逻辑位置（受缓冲的锁保护）
+    bool m_bAborted = false;
+};
+
+#endif // TIMESHIFTBUFFER_H
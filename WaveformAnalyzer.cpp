@@ -0,0 +1,513 @@
+#include "WaveformAnalyzer.h"
+
+#include<QAudioDecoder>
+#include<QAudioBuffer>
+#include<QAudioFormat>
+#include<QDir>
+#include<QFile>
+#include<QFileInfo>
+#include<QSaveFile>
+#include<QDataStream>
+#include<QDateTime>
+#include<QCryptographicHash>
+#include<QElapsedTimer>
+#include<QUrl>
+#include<QFutureWatcher>
+#include<QtConcurrent>
+#include<cfloat>
+#include<cmath>
+
+#if defined(Q_PROCESSOR_X86)
+#define WAVEFORM_X86
+#include<immintrin.h>
+#endif
+
+#if defined(WAVEFORM_X86) && defined(Q_CC_GNU)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define TARGET_SSE2
+#endif
+
+namespace {
+const quint32 kCacheMagic = 0x46535746;     //"FSWF"
+const quint16 kCacheVersion = 2;            //2：增加无音轨标记（包络点数为0）
+const int kSampleRate = 16000;              //解码输出采样率，包络只需要粗略的时间分辨率
+const int kFlushIntervalMs = 250;           //向主线程送回新段的间隔
+
+#ifdef WAVEFORM_X86
+TARGET_SSE2 void reduceSse2(const float *samples,int nCount,float *min,float *max,double *sumSquares)
+{
+    //两组累加器交替使用，减少加法的依赖链
+    __m128 vMin=_mm_set1_ps(*min);
+    __m128 vMax=_mm_set1_ps(*max);
+    __m128 vSum0=_mm_setzero_ps();
+    __m128 vSum1=_mm_setzero_ps();
+    int i=0;
+    for(;i+8<=nCount;i+=8)
+    {
+        __m128 a=_mm_loadu_ps(samples+i);
+        __m128 b=_mm_loadu_ps(samples+i+4);
+        vMin=_mm_min_ps(vMin,_mm_min_ps(a,b));
+        vMax=_mm_max_ps(vMax,_mm_max_ps(a,b));
+        vSum0=_mm_add_ps(vSum0,_mm_mul_ps(a,a));
+        vSum1=_mm_add_ps(vSum1,_mm_mul_ps(b,b));
+    }
+    for(;i+4<=nCount;i+=4)
+    {
+        __m128 a=_mm_loadu_ps(samples+i);
+        vMin=_mm_min_ps(vMin,a);
+        vMax=_mm_max_ps(vMax,a);
+        vSum0=_mm_add_ps(vSum0,_mm_mul_ps(a,a));
+    }
+
+    float lanesMin[4];
+    float lanesMax[4];
+    float lanesSum[4];
+    _mm_storeu_ps(lanesMin,vMin);
+    _mm_storeu_ps(lanesMax,vMax);
+    _mm_storeu_ps(lanesSum,_mm_add_ps(vSum0,vSum1));
+    double dSum=0;
+    for(int lane=0;lane<4;lane++)
+    {
+        *min=qMin(*min,lanesMin[lane]);
+        *max=qMax(*max,lanesMax[lane]);
+        dSum+=lanesSum[lane];
+    }
+    *sumSquares+=dSum;
+    WaveformAnalyzer::reduceScalar(samples+i,nCount-i,min,max,sumSquares);
+}
+
+bool hasSse2()
+{
+#if defined(Q_CC_GNU)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#else
+    return true;    //MSVC的x64目标必有SSE2
+#endif
+}
+#endif
+
+//一个时间段的累计统计
+struct Accumulator
+{
+    float min = FLT_MAX;
+    float max = -FLT_MAX;
+    double sumSquares = 0;
+    qint64 count = 0;
+
+    WaveformAnalyzer::Bucket bucket() const
+    {
+        WaveformAnalyzer::Bucket bucket;
+        if(count>0)
+        {
+            bucket.min=min;
+            bucket.max=max;
+            bucket.rms=float(std::sqrt(sumSquares/count));
+            bucket.filled=true;
+        }
+        return bucket;
+    }
+};
+}
+
+//解码线程中的统计端：读取解码器输出，按时间段归并，定期把变化的段送回主线程
+class WaveformDecoder : public QObject
+{
+public:
+    explicit WaveformDecoder(WaveformAnalyzer *analyzer)
+        : m_analyzer(analyzer)
+    {
+    }
+
+    void start(int nGeneration,const QString &filePath,qint64 durationMs,const QString &cachePath,const QString &identity)
+    {
+        stop();
+        m_nGeneration=nGeneration;
+        m_strCachePath=cachePath;
+        m_strIdentity=identity;
+        m_nBucketUs=qMax<qint64>(1000,durationMs*1000/WaveformAnalyzer::kBuckets);
+        m_accumulators=QVector<Accumulator>(WaveformAnalyzer::kBuckets);
+        m_nDirtyFrom=-1;
+        m_nDirtyTo=-1;
+        m_nNextUs=0;
+
+        //请求单声道浮点输出，后端不支持时在process中自行转换
+        QAudioFormat format;
+        format.setSampleFormat(QAudioFormat::Float);
+        format.setChannelCount(1);
+        format.setSampleRate(kSampleRate);
+        m_decoder=new QAudioDecoder(this);
+        m_decoder->setAudioFormat(format);
+        m_decoder->setSource(QUrl::fromLocalFile(filePath));
+        connect(m_decoder,&QAudioDecoder::bufferReady,this,[this](){onBufferReady();});
+        connect(m_decoder,&QAudioDecoder::finished,this,[this](){finish(true,false);});
+        //格式错误即没有可解码的音轨，文件读取失败等其他错误下次还要重试
+        connect(m_decoder,qOverload<QAudioDecoder::Error>(&QAudioDecoder::error),this,[this](QAudioDecoder::Error error){
+            finish(false,error==QAudioDecoder::FormatError);
+        });
+        m_flushClock.start();
+        m_decoder->start();
+    }
+
+    void stop()
+    {
+        if(!m_decoder)
+            return;
+        disconnect(m_decoder,nullptr,this,nullptr);
+        m_decoder->stop();
+        m_decoder->deleteLater();
+        m_decoder=nullptr;
+    }
+
+private:
+    WaveformAnalyzer *m_analyzer;
+    QAudioDecoder *m_decoder = nullptr;
+    int m_nGeneration = 0;
+    QString m_strCachePath;
+    QString m_strIdentity;
+    qint64 m_nBucketUs = 1000;      //每段时长（微秒）
+    qint64 m_nNextUs = 0;           //下一个缓冲的预期起始时间，缓冲不带时间戳时使用
+    QVector<Accumulator> m_accumulators;
+    QVector<float> m_scratch;       //格式转换用的单声道样本
+    int m_nDirtyFrom = -1;          //上次送回之后变化的段
+    int m_nDirtyTo = -1;
+    QElapsedTimer m_flushClock;
+
+    void onBufferReady()
+    {
+        while(m_decoder && m_decoder->bufferAvailable())
+            process(m_decoder->read());
+        if(m_flushClock.elapsed()>=kFlushIntervalMs)
+            flush();
+    }
+
+    void process(const QAudioBuffer &buffer)
+    {
+        QAudioFormat format=buffer.format();
+        int nFrames=buffer.frameCount();
+        int nRate=format.sampleRate();
+        if(!buffer.isValid() || nFrames<=0 || nRate<=0)
+            return;
+
+        const float *samples=nullptr;
+        if(format.sampleFormat()==QAudioFormat::Float && format.channelCount()==1)
+        {
+            samples=buffer.constData<float>();
+        }
+        else
+        {
+            //后端没有按请求输出：各声道取平均混成单声道
+            m_scratch.resize(nFrames);
+            const char *data=buffer.constData<char>();
+            int nChannels=format.channelCount();
+            int nBytesPerFrame=format.bytesPerFrame();
+            int nBytesPerSample=format.bytesPerSample();
+            for(int frame=0;frame<nFrames;frame++)
+            {
+                float sum=0;
+                for(int channel=0;channel<nChannels;channel++)
+                    sum+=format.normalizedSampleValue(data+frame*nBytesPerFrame+channel*nBytesPerSample);
+                m_scratch[frame]=sum/nChannels;
+            }
+            samples=m_scratch.constData();
+        }
+
+        qint64 nStartUs=buffer.startTime()>=0?buffer.startTime():m_nNextUs;
+        int nLast=WaveformAnalyzer::kBuckets-1;
+        int i=0;
+        while(i<nFrames)
+        {
+            //从样本i开始、落在同一段内的样本一次统计完；时长估计偏短时多出的样本并入最后一段
+            qint64 nTimeUs=nStartUs+qint64(i)*1000000/nRate;
+            int nBucket=int(qBound<qint64>(0,nTimeUs/m_nBucketUs,nLast));
+            int nEnd=nFrames;
+            if(nBucket<nLast)
+            {
+                qint64 nBoundaryUs=(nBucket+1)*m_nBucketUs;
+                qint64 nBoundary=((nBoundaryUs-nStartUs)*nRate+999999)/1000000;
+                nEnd=int(qBound<qint64>(i+1,nBoundary,nFrames));
+            }
+
+            Accumulator &accumulator=m_accumulators[nBucket];
+            WaveformAnalyzer::reduce(samples+i,nEnd-i,&accumulator.min,&accumulator.max,&accumulator.sumSquares);
+            accumulator.count+=nEnd-i;
+            m_nDirtyFrom=m_nDirtyFrom<0?nBucket:qMin(m_nDirtyFrom,nBucket);
+            m_nDirtyTo=qMax(m_nDirtyTo,nBucket);
+            i=nEnd;
+        }
+        m_nNextUs=nStartUs+qint64(nFrames)*1000000/nRate;
+    }
+
+    void flush()
+    {
+        m_flushClock.restart();
+        if(m_nDirtyFrom<0)
+            return;
+
+        QVector<WaveformAnalyzer::Bucket> buckets;
+        buckets.reserve(m_nDirtyTo-m_nDirtyFrom+1);
+        for(int i=m_nDirtyFrom;i<=m_nDirtyTo;i++)
+            buckets.append(m_accumulators.at(i).bucket());
+
+        WaveformAnalyzer *analyzer=m_analyzer;
+        int nGeneration=m_nGeneration;
+        int nFirst=m_nDirtyFrom;
+        QMetaObject::invokeMethod(analyzer,[analyzer,nGeneration,nFirst,buckets](){
+            analyzer->mergeBuckets(nGeneration,nFirst,buckets);
+        },Qt::QueuedConnection);
+        m_nDirtyFrom=-1;
+        m_nDirtyTo=-1;
+    }
+
+    void finish(bool bComplete,bool bNoAudio)
+    {
+        flush();
+        stop();
+
+        //没有任何样本说明没有音轨，写入无音轨标记，下次打开不再解码
+        bool bHasAudio=false;
+        for(const Accumulator &accumulator:m_accumulators)
+        {
+            if(accumulator.count>0)
+            {
+                bHasAudio=true;
+                break;
+            }
+        }
+        bNoAudio=!bHasAudio && (bComplete || bNoAudio);
+        bComplete=bComplete && bHasAudio;
+        if(bComplete)
+        {
+            QVector<WaveformAnalyzer::Bucket> envelope;
+            envelope.reserve(m_accumulators.size());
+            for(const Accumulator &accumulator:m_accumulators)
+                envelope.append(accumulator.bucket());
+            WaveformAnalyzer::writeCache(m_strCachePath,m_strIdentity,envelope);
+        }
+        else if(bNoAudio)
+        {
+            WaveformAnalyzer::writeCache(m_strCachePath,m_strIdentity,{});
+        }
+
+        WaveformAnalyzer *analyzer=m_analyzer;
+        int nGeneration=m_nGeneration;
+        QMetaObject::invokeMethod(analyzer,[analyzer,nGeneration,bComplete](){
+            analyzer->finishAnalysis(nGeneration,bComplete);
+        },Qt::QueuedConnection);
+    }
+};
+
+WaveformAnalyzer::WaveformAnalyzer(const QString &dirPath,QObject *parent)
+    : QObject(parent)
+    , m_strDir(dirPath)
+{
+    QDir().mkpath(m_strDir);
+
+    m_decodeThread = new QThread(this);
+    m_decoder = new WaveformDecoder(this);
+    m_decoder->moveToThread(m_decodeThread);
+    connect(m_decodeThread,&QThread::finished,m_decoder,&QObject::deleteLater);
+    m_decodeThread->start(QThread::LowPriority);
+}
+
+WaveformAnalyzer::~WaveformAnalyzer()
+{
+    WaveformDecoder *decoder=m_decoder;
+    QMetaObject::invokeMethod(decoder,[decoder](){decoder->stop();},Qt::QueuedConnection);
+    m_decodeThread->quit();
+    m_decodeThread->wait();
+}
+
+void WaveformAnalyzer::setFile(const QString &filePath,qint64 durationMs)
+{
+    //时长信号可能重复发出，同一文件已经开始分析就不再重来
+    if(filePath==m_strFilePath && (filePath.isEmpty() || m_nDurationMs>0))
+        return;
+
+    m_strFilePath=filePath;
+    m_nDurationMs=durationMs;
+    m_nGeneration++;
+    m_bComplete=false;
+    m_envelope.clear();
+    WaveformDecoder *decoder=m_decoder;
+    QMetaObject::invokeMethod(decoder,[decoder](){decoder->stop();},Qt::QueuedConnection);
+    emit envelopeChanged();
+    if(filePath.isEmpty() || durationMs<=0)
+        return;
+
+    //stat和读缓存都在后台进行，切换条目时GUI线程不碰磁盘
+    int nGeneration=m_nGeneration;
+    auto *watcher = new QFutureWatcher<CacheLookup>(this);
+    connect(watcher,&QFutureWatcher<CacheLookup>::finished,this,[this,watcher,nGeneration](){
+        watcher->deleteLater();
+        onCacheLookup(nGeneration,watcher->result());
+    });
+    watcher->setFuture(QtConcurrent::run(&WaveformAnalyzer::lookupCache,m_strDir,filePath));
+}
+
+void WaveformAnalyzer::onCacheLookup(int nGeneration,const CacheLookup &lookup)
+{
+    if(nGeneration!=m_nGeneration)
+        return;
+    if(lookup.hit)
+    {
+        //无音轨标记读出为空包络，按分析失败通知
+        m_envelope=lookup.envelope;
+        m_bComplete=!m_envelope.isEmpty();
+        emit envelopeChanged();
+        emit analysisFinished(m_bComplete);
+        return;
+    }
+
+    m_envelope=QVector<Bucket>(kBuckets);
+    WaveformDecoder *decoder=m_decoder;
+    QString filePath=m_strFilePath;
+    qint64 durationMs=m_nDurationMs;
+    QMetaObject::invokeMethod(decoder,[decoder,nGeneration,filePath,durationMs,lookup](){
+        decoder->start(nGeneration,filePath,durationMs,lookup.cachePath,lookup.identity);
+    },Qt::QueuedConnection);
+}
+
+WaveformAnalyzer::CacheLookup WaveformAnalyzer::lookupCache(const QString &dirPath,const QString &filePath)
+{
+    CacheLookup lookup;
+    lookup.identity=identityOf(filePath);
+    lookup.cachePath=cachePathOf(dirPath,lookup.identity);
+    lookup.hit=readCache(lookup.cachePath,lookup.identity,&lookup.envelope);
+    return lookup;
+}
+
+QImage WaveformAnalyzer::render(int nHeight) const
+{
+    if(m_envelope.isEmpty())
+        return QImage();
+
+    //外层为峰值范围，内层为以中线对称的均方根
+    nHeight=qMax(2,nHeight);
+    QImage image(m_envelope.size(),nHeight,QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    const QRgb peakColor=qPremultiply(qRgba(144,202,249,140));
+    const QRgb rmsColor=qPremultiply(qRgba(255,255,255,190));
+    int nCenter=nHeight/2;
+    float halfHeight=(nHeight-1)/2.0f;
+    for(int x=0;x<m_envelope.size();x++)
+    {
+        const Bucket &bucket=m_envelope.at(x);
+        if(!bucket.filled)
+            continue;
+        int nTop=qBound(0,nCenter-qRound(bucket.max*halfHeight),nHeight-1);
+        int nBottom=qBound(0,nCenter-qRound(bucket.min*halfHeight),nHeight-1);
+        for(int y=nTop;y<=nBottom;y++)
+            reinterpret_cast<QRgb*>(image.scanLine(y))[x]=peakColor;
+        int nRms=qRound(bucket.rms*halfHeight);
+        for(int y=qMax(0,nCenter-nRms);y<=qMin(nHeight-1,nCenter+nRms);y++)
+            reinterpret_cast<QRgb*>(image.scanLine(y))[x]=rmsColor;
+    }
+    return image;
+}
+
+void WaveformAnalyzer::reduce(const float *samples,int nCount,float *min,float *max,double *sumSquares)
+{
+#ifdef WAVEFORM_X86
+    static const bool bSse2=hasSse2();
+    if(bSse2)
+    {
+        reduceSse2(samples,nCount,min,max,sumSquares);
+        return;
+    }
+#endif
+    reduceScalar(samples,nCount,min,max,sumSquares);
+}
+
+void WaveformAnalyzer::reduceScalar(const float *samples,int nCount,float *min,float *max,double *sumSquares)
+{
+    float minValue=*min;
+    float maxValue=*max;
+    double dSum=0;
+    for(int i=0;i<nCount;i++)
+    {
+        minValue=qMin(minValue,samples[i]);
+        maxValue=qMax(maxValue,samples[i]);
+        dSum+=double(samples[i])*samples[i];
+    }
+    *min=minValue;
+    *max=maxValue;
+    *sumSquares+=dSum;
+}
+
+void WaveformAnalyzer::mergeBuckets(int nGeneration,int nFirst,const QVector<Bucket> &buckets)
+{
+    if(nGeneration!=m_nGeneration || nFirst<0 || nFirst+buckets.size()>m_envelope.size())
+        return;
+    std::copy(buckets.cbegin(),buckets.cend(),m_envelope.begin()+nFirst);
+    emit envelopeChanged();
+}
+
+void WaveformAnalyzer::finishAnalysis(int nGeneration,bool bComplete)
+{
+    if(nGeneration!=m_nGeneration)
+        return;
+    m_bComplete=bComplete;
+    emit analysisFinished(bComplete);
+}
+
+QString WaveformAnalyzer::identityOf(const QString &filePath)
+{
+    QFileInfo info(filePath);
+    return QString("%1|%2|%3").arg(info.absoluteFilePath()).arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+QString WaveformAnalyzer::cachePathOf(const QString &dirPath,const QString &identity)
+{
+    return QDir(dirPath).filePath(QCryptographicHash::hash(identity.toUtf8(),QCryptographicHash::Sha1).toHex()+".wfm");
+}
+
+bool WaveformAnalyzer::readCache(const QString &cachePath,const QString &identity,QVector<Bucket> *envelope)
+{
+    QFile file(cachePath);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    quint32 nMagic;
+    quint16 nVersion;
+    QString storedIdentity;
+    quint32 nCount;
+    in>>nMagic>>nVersion>>storedIdentity>>nCount;
+    if(in.status()!=QDataStream::Ok || nMagic!=kCacheMagic || nVersion>kCacheVersion
+        || storedIdentity!=identity || (nCount!=quint32(kBuckets) && nCount!=0))
+        return false;
+
+    //无音轨标记
+    if(nCount==0)
+    {
+        envelope->clear();
+        return true;
+    }
+
+    QVector<Bucket> buckets(kBuckets);
+    for(Bucket &bucket:buckets)
+        in>>bucket.min>>bucket.max>>bucket.rms>>bucket.filled;
+    if(in.status()!=QDataStream::Ok)
+        return false;
+    *envelope=buckets;
+    return true;
+}
+
+void WaveformAnalyzer::writeCache(const QString &cachePath,const QString &identity,const QVector<Bucket> &envelope)
+{
+    QSaveFile file(cachePath);
+    if(!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    out<<kCacheMagic<<kCacheVersion<<identity<<quint32(envelope.size());
+    for(const Bucket &bucket:envelope)
+        out<<bucket.min<<bucket.max<<bucket.rms<<bucket.filled;
+    file.commit();
+}
@@ -0,0 +1,80 @@
+/*
+ * 音频波形包络 在后台线程用QAudioDecoder解码当前文件，按固定点数统计每段的最小值、最大值和均方根
+ * 解码过程中定期把新统计的段送回主线程，进度条背后的波形随解码逐步填满
+ * 统计内核按SSE2向量化，完整结果按文件身份（路径+大小+修改时间）缓存到磁盘；没有音轨的文件也缓存一个标记，不再反复解码
+ */
+
+#ifndef WAVEFORMANALYZER_H
+#define WAVEFORMANALYZER_H
+
+#include<QObject>
+#include<QVector>
+#include<QImage>
+#include<QThread>
+
+class WaveformDecoder;
+
+class WaveformAnalyzer : public QObject
+{
+    Q_OBJECT
+public:
+    struct Bucket
+    {
+        float min = 0;          //样本最小值（-1~1）
+        float max = 0;
+        float rms = 0;          //均方根，反映响度
+        bool filled = false;    //已有样本落入此段
+    };
+
+    static const int kBuckets = 2048;   //整个文件的包络点数
+
+    explicit WaveformAnalyzer(const QString &dirPath,QObject *parent=nullptr);
+    ~WaveformAnalyzer();
+
+    void setFile(const QString &filePath,qint64 durationMs);    //切换文件并开始分析，空路径表示停止并清空
+    const QVector<Bucket> &envelope() const {return m_envelope;}
+    bool isComplete() const {return m_bComplete;}
+    QImage render(int nHeight) const;   //宽kBuckets的波形条，未填充的段透明
+
+    //统计一段单声道浮点样本，结果并入min、max、sumSquares
+    static void reduce(const float *samples,int nCount,float *min,float *max,double *sumSquares);
+    static void reduceScalar(const float *samples,int nCount,float *min,float *max,double *sumSquares);
+
+signals:
+    void envelopeChanged();             //有新的段填入
+    void analysisFinished(bool bComplete);  //解码结束；失败（无音轨等）时为false
+
+private:
+    friend class WaveformDecoder;
+
+    QString m_strDir;
+    QString m_strFilePath;
+    qint64 m_nDurationMs = 0;
+    QVector<Bucket> m_envelope;
+    bool m_bComplete = false;
+    int m_nGeneration = 0;          //每次切换文件加一，丢弃旧任务送回的结果
+
+    QThread *m_decodeThread;
+    WaveformDecoder *m_decoder;
+
+    void mergeBuckets(int nGeneration,int nFirst,const QVector<Bucket> &buckets);
+    void finishAnalysis(int nGeneration,bool bComplete);
+
+    //后台查缓存的结果：身份、缓存路径，命中时带出包络
+    struct CacheLookup
+    {
+        QString identity;
+        QString cachePath;
+        bool hit = false;
+        QVector<Bucket> envelope;
+    };
+
+    void onCacheLookup(int nGeneration,const CacheLookup &lookup);
+    static CacheLookup lookupCache(const QString &dirPath,const QString &filePath);
+    static QString identityOf(const QString &filePath);
+    static QString cachePathOf(const QString &dirPath,const QString &identity);
+    static bool readCache(const QString &cachePath,const QString &identity,QVector<Bucket> *envelope);   //无音轨标记读出空包络
+    static void writeCache(const QString &cachePath,const QString &identity,const QVector<Bucket> &envelope);
+};
+
+#endif // WAVEFORMANALYZER_H
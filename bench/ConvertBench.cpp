@@ -0,0 +1,169 @@
+#include "ConvertBench.h"
+
+#include<QElapsedTimer>
+#include<QJsonArray>
+#include<QImage>
+#include<QVector>
+#include<algorithm>
+#include<cstdlib>
+
+#include"FrameConverter.h"
+
+namespace {
+const QSize kThumbnailSize(160,90);     //与进度条预览相同
+}
+
+QJsonObject ConvertBench::run()
+{
+    QJsonArray frames;
+    for(const QSize &size:{QSize(1920,1080),QSize(3840,2160)})
+    {
+        for(QVideoFrameFormat::PixelFormat format:{QVideoFrameFormat::Format_NV12,QVideoFrameFormat::Format_YUV420P})
+            frames.append(measureFrame(size,format));
+    }
+
+    QJsonObject result;
+    result["bestPath"]=FrameConverter::pathName(FrameConverter::bestPath());
+    result["iterations"]=m_nIterations;
+    result["frames"]=frames;
+    return result;
+}
+
+QJsonObject ConvertBench::measureFrame(const QSize &size,QVideoFrameFormat::PixelFormat format)
+{
+    QVideoFrame frame=makeFrame(size,format);
+
+    QJsonObject result;
+    result["size"]=QString("%1x%2").arg(size.width()).arg(size.height());
+    result["format"]=format==QVideoFrameFormat::Format_NV12?"NV12":"YUV420P";
+
+    QImage reference;
+    double dToImageMs=medianMs([&](){reference=frame.toImage();});
+    double dToImageThumbMs=medianMs([&](){
+        frame.toImage().scaled(kThumbnailSize,Qt::KeepAspectRatio,Qt::SmoothTransformation);
+    });
+    result["toImageMs"]=dToImageMs;
+    result["toImageThumbMs"]=dToImageThumbMs;
+
+    //逐个实现测量，并与标量结果逐位比较
+    FrameConverter::Path savedPath=FrameConverter::activePath();
+    QJsonObject paths;
+    QImage scalarImage;
+    bool bBitExact=true;
+    double dBestFullMs=0;
+    double dBestThumbMs=0;
+    for(int nPath=FrameConverter::Scalar;nPath<=FrameConverter::bestPath();nPath++)
+    {
+        FrameConverter::Path path=FrameConverter::Path(nPath);
+        FrameConverter::setPath(path);
+
+        QImage image;
+        double dFullMs=medianMs([&](){image=FrameConverter::convert(frame);});
+        double dThumbMs=medianMs([&](){FrameConverter::convert(frame,kThumbnailSize);});
+        if(path==FrameConverter::Scalar)
+            scalarImage=image;
+        else if(image!=scalarImage)
+            bBitExact=false;
+
+        QJsonObject timing;
+        timing["fullMs"]=dFullMs;
+        timing["thumbMs"]=dThumbMs;
+        paths[FrameConverter::pathName(path)]=timing;
+        dBestFullMs=dFullMs;
+        dBestThumbMs=dThumbMs;
+    }
+    FrameConverter::setPath(savedPath);
+
+    result["convert"]=paths;
+    result["bitExact"]=bBitExact;
+    result["meanAbsDiffVsToImage"]=meanAbsDiff(scalarImage,reference);
+    result["speedupFull"]=dBestFullMs>0?dToImageMs/dBestFullMs:0;
+    result["speedupThumb"]=dBestThumbMs>0?dToImageThumbMs/dBestThumbMs:0;
+    return result;
+}
+
+double ConvertBench::medianMs(const std::function<void()> &work) const
+{
+    //先跑一次预热（缓冲池、页面分配），再取中位数
+    work();
+    QVector<double> times;
+    times.reserve(m_nIterations);
+    QElapsedTimer timer;
+    for(int i=0;i<m_nIterations;i++)
+    {
+        timer.start();
+        work();
+        times.append(timer.nsecsElapsed()/1e6);
+    }
+    std::sort(times.begin(),times.end());
+    return times.at(times.size()/2);
+}
+
+QVideoFrame ConvertBench::makeFrame(const QSize &size,QVideoFrameFormat::PixelFormat format)
+{
+    QVideoFrameFormat frameFormat(size,format);
+    frameFormat.setColorSpace(QVideoFrameFormat::ColorSpace_BT709);
+    frameFormat.setColorRange(QVideoFrameFormat::ColorRange_Video);
+    QVideoFrame frame(frameFormat);
+    if(!frame.map(QVideoFrame::WriteOnly))
+        return frame;
+
+    //亮度为斜向渐变加少量噪声，色度为水平、垂直渐变，覆盖各种颜色
+    std::srand(1);
+    for(int y=0;y<size.height();y++)
+    {
+        uchar *line=frame.bits(0)+qsizetype(y)*frame.bytesPerLine(0);
+        for(int x=0;x<size.width();x++)
+            line[x]=uchar(16+((x+y)*219/(size.width()+size.height())+std::rand()%8)%220);
+    }
+    int nChromaWidth=(size.width()+1)/2;
+    int nChromaHeight=(size.height()+1)/2;
+    for(int y=0;y<nChromaHeight;y++)
+    {
+        uchar u=uchar(16+y*224/nChromaHeight);
+        if(format==QVideoFrameFormat::Format_NV12)
+        {
+            uchar *line=frame.bits(1)+qsizetype(y)*frame.bytesPerLine(1);
+            for(int x=0;x<nChromaWidth;x++)
+            {
+                line[2*x]=u;
+                line[2*x+1]=uchar(16+x*224/nChromaWidth);
+            }
+        }
+        else
+        {
+            uchar *uLine=frame.bits(1)+qsizetype(y)*frame.bytesPerLine(1);
+            uchar *vLine=frame.bits(2)+qsizetype(y)*frame.bytesPerLine(2);
+            for(int x=0;x<nChromaWidth;x++)
+            {
+                uLine[x]=u;
+                vLine[x]=uchar(16+x*224/nChromaWidth);
+            }
+        }
+    }
+    frame.unmap();
+    return frame;
+}
+
+double ConvertBench::meanAbsDiff(const QImage &a,const QImage &b)
+{
+    if(a.isNull() || b.isNull() || a.size()!=b.size())
+        return -1;
+
+    //隔行隔列抽样比较RGB三个分量
+    QImage left=a.convertToFormat(QImage::Format_RGB32);
+    QImage right=b.convertToFormat(QImage::Format_RGB32);
+    qint64 nSum=0;
+    qint64 nCount=0;
+    for(int y=0;y<left.height();y+=4)
+    {
+        const QRgb *lineA=reinterpret_cast<const QRgb*>(left.constScanLine(y));
+        const QRgb *lineB=reinterpret_cast<const QRgb*>(right.constScanLine(y));
+        for(int x=0;x<left.width();x+=4)
+        {
+            nSum+=qAbs(qRed(lineA[x])-qRed(lineB[x]))+qAbs(qGreen(lineA[x])-qGreen(lineB[x]))+qAbs(qBlue(lineA[x])-qBlue(lineB[x]));
+            nCount+=3;
+        }
+    }
+    return nCount>0?double(nSum)/nCount:0;
+}
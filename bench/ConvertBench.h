@@ -0,0 +1,31 @@
+/*
+ * 帧转换性能测试 用合成的NV12/YUV420P帧（1080p、4K）对比QVideoFrame::toImage与FrameConverter各实现
+ * 分别测原尺寸转换和缩略图尺寸转换的中位耗时，并核对各实现结果一致、与toImage的平均偏差
+ */
+
+#ifndef CONVERTBENCH_H
+#define CONVERTBENCH_H
+
+#include<QJsonObject>
+#include<QVideoFrame>
+#include<QVideoFrameFormat>
+#include<functional>
+
+class ConvertBench
+{
+public:
+    void setIterations(int nIterations) {m_nIterations=qMax(1,nIterations);}
+
+    QJsonObject run();      //全部尺寸和格式的结果
+
+private:
+    int m_nIterations = 20;
+
+    QJsonObject measureFrame(const QSize &size,QVideoFrameFormat::PixelFormat format);
+    double medianMs(const std::function<void()> &work) const;
+
+    static QVideoFrame makeFrame(const QSize &size,QVideoFrameFormat::PixelFormat format);
+    static double meanAbsDiff(const QImage &a,const QImage &b);
+};
+
+#endif // CONVERTBENCH_H
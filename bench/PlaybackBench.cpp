@@ -0,0 +1,269 @@
+#include "PlaybackBench.h"
+
+#include<QCoreApplication>
+#include<QMediaMetaData>
+#include<QMediaFormat>
+#include<QJsonArray>
+#include<QFileInfo>
+#include<QUrl>
+#include<algorithm>
+#include<cmath>
+
+#include"PlaybackRates.h"
+
+namespace {
+//取排序后数组的分位数
+double percentile(QVector<double> values,double p)
+{
+    if(values.isEmpty())
+        return 0;
+    std::sort(values.begin(),values.end());
+    int nIndex=qBound(0,int(std::ceil(p*values.size()))-1,int(values.size())-1);
+    return values.at(nIndex);
+}
+}
+
+PlaybackBench::PlaybackBench(QObject *parent)
+    : QObject(parent)
+{
+    //与主窗口相同的配置：一个播放器、一个音频输出，视频输出换成QVideoSink
+    m_player = new QMediaPlayer(this);
+    m_audioOutput = new QAudioOutput(this);
+    m_audioOutput->setMuted(true);
+    m_player->setAudioOutput(m_audioOutput);
+    m_sink = new QVideoSink(this);
+    m_player->setVideoOutput(m_sink);
+
+    m_clock.start();
+    connect(m_sink,&QVideoSink::videoFrameChanged,this,[this](const QVideoFrame &frame){
+        if(!frame.isValid())
+            return;
+        m_nLastFrameWall=m_clock.nsecsElapsed()/1000;
+        m_nLastFrameTime=frame.startTime();
+        if(m_bRecording)
+            m_samples.append({m_nLastFrameWall,m_nLastFrameTime});
+    });
+}
+
+QJsonObject PlaybackBench::run(const QString &filePath)
+{
+    QJsonObject result;
+    result["file"]=QFileInfo(filePath).fileName();
+
+    QJsonObject open=measureOpen(filePath);
+    result["open"]=open;
+    if(open.contains("error"))
+        return result;
+
+    QMediaMetaData metaData=m_player->metaData();
+    QVariant codec=metaData.value(QMediaMetaData::VideoCodec);
+    if(codec.isValid())
+        result["videoCodec"]=QMediaFormat::videoCodecName(codec.value<QMediaFormat::VideoCodec>());
+    QSize resolution=metaData.value(QMediaMetaData::Resolution).toSize();
+    result["width"]=resolution.width();
+    result["height"]=resolution.height();
+    result["durationMs"]=m_player->duration();
+    result["frameIntervalUs"]=frameDuration();
+
+    result["seek"]=measureSeeks();
+
+    QJsonArray rates;
+    for(const PlaybackRateOption &option:playbackRateOptions())
+        rates.append(measureRate(option.rateValue));
+    result["rates"]=rates;
+
+    m_player->stop();
+    m_player->setSource(QUrl());
+    return result;
+}
+
+QJsonObject PlaybackBench::measureOpen(const QString &filePath)
+{
+    QJsonObject result;
+    m_player->stop();
+    m_player->setSource(QUrl());
+    m_player->setPlaybackRate(1.0);
+
+    //从setSource开始计时，分别记录加载完成和首帧到达
+    qint64 nLoadedAt=-1;
+    auto conn=connect(m_player,&QMediaPlayer::mediaStatusChanged,this,[&](QMediaPlayer::MediaStatus status){
+        if(status==QMediaPlayer::LoadedMedia && nLoadedAt<0)
+            nLoadedAt=m_clock.nsecsElapsed()/1000;
+    });
+
+    qint64 nStart=m_clock.nsecsElapsed()/1000;
+    m_nLastFrameWall=-1;
+    m_player->setSource(QUrl::fromLocalFile(filePath));
+    m_player->play();
+    bool bOK=waitUntil([&](){
+        return m_nLastFrameWall>=nStart || m_player->mediaStatus()==QMediaPlayer::InvalidMedia;
+    },m_nTimeoutMs);
+    disconnect(conn);
+    m_player->pause();
+
+    if(!bOK || m_nLastFrameWall<nStart)
+    {
+        result["error"]=m_player->errorString().isEmpty()?QString("timeout"):m_player->errorString();
+        return result;
+    }
+    if(nLoadedAt>=0)
+        result["loadedMs"]=(nLoadedAt-nStart)/1000.0;
+    result["firstFrameMs"]=(m_nLastFrameWall-nStart)/1000.0;
+    return result;
+}
+
+QJsonObject PlaybackBench::measureSeeks()
+{
+    QJsonObject result;
+    qint64 duration=m_player->duration();
+    if(duration<=0)
+        return result;
+
+    //位置网格两端交替取，前跳和后跳都覆盖到
+    QVector<int> order;
+    for(int lo=0,hi=m_nSeekPoints-1;lo<=hi;lo++,hi--)
+    {
+        order.append(lo);
+        if(hi!=lo)
+            order.append(hi);
+    }
+
+    m_player->pause();
+    QJsonArray points;
+    QVector<double> latencies;
+    int nTimeouts=0;
+    for(int i:order)
+    {
+        qint64 target=duration*(2*i+1)/(2*m_nSeekPoints);
+        qint64 nPrevTime=m_nLastFrameTime;
+        qint64 nStart=m_clock.nsecsElapsed()/1000;
+        m_player->setPosition(target);
+
+        //暂停状态下定位后后端会送出一帧，时间戳变化即视为完成
+        bool bOK=waitUntil([&](){
+            return m_nLastFrameWall>=nStart && m_nLastFrameTime!=nPrevTime;
+        },m_nTimeoutMs);
+
+        QJsonObject point;
+        point["targetMs"]=target;
+        if(bOK)
+        {
+            double dLatency=(m_nLastFrameWall-nStart)/1000.0;
+            latencies.append(dLatency);
+            point["latencyMs"]=dLatency;
+            point["landedMs"]=m_nLastFrameTime/1000;  //落点与目标的差反映是否对齐到关键帧
+        }
+        else
+        {
+            nTimeouts++;
+            point["timeout"]=true;
+        }
+        points.append(point);
+    }
+
+    result["points"]=points;
+    result["p50Ms"]=percentile(latencies,0.5);
+    result["p90Ms"]=percentile(latencies,0.9);
+    result["maxMs"]=percentile(latencies,1.0);
+    result["timeouts"]=nTimeouts;
+    return result;
+}
+
+QJsonObject PlaybackBench::measureRate(double rate)
+{
+    QJsonObject result;
+    result["rate"]=rate;
+
+    //从靠前的位置开始，保证时长足够
+    qint64 nStart=m_clock.nsecsElapsed()/1000;
+    m_player->pause();
+    m_player->setPosition(m_player->duration()/10);
+    waitUntil([&](){return m_nLastFrameWall>=nStart;},m_nTimeoutMs);
+
+    m_samples.clear();
+    m_samples.reserve(int(m_dRateSeconds*240));
+    m_player->setPlaybackRate(rate);
+    m_bRecording=true;
+    m_player->play();
+    waitUntil([this](){return m_player->mediaStatus()==QMediaPlayer::EndOfMedia;},int(m_dRateSeconds*1000));
+    m_bRecording=false;
+    m_player->pause();
+    m_player->setPlaybackRate(1.0);
+
+    int nFrames=m_samples.size();
+    result["frames"]=nFrames;
+    if(nFrames<2)
+        return result;
+
+    qint64 nInterval=frameDuration();
+    const FrameSample &first=m_samples.first();
+    double dWallSeconds=(m_samples.last().wallTime-first.wallTime)/1e6;
+    result["wallSeconds"]=dWallSeconds;
+    result["fps"]=dWallSeconds>0?(nFrames-1)/dWallSeconds:0;
+    result["expectedFps"]=rate*1e6/nInterval;
+
+    //时间戳跳过的帧计为丢帧
+    int nDropped=0;
+    for(int i=1;i<nFrames;i++)
+    {
+        qint64 gap=m_samples.at(i).startTime-m_samples.at(i-1).startTime;
+        if(gap>nInterval*3/2)
+            nDropped+=int(std::lround(double(gap)/nInterval))-1;
+    }
+
+    //到达时刻相对理想时间线的滞后，以最早的一帧为基准，超过一个显示间隔计为迟到
+    QVector<double> lags;
+    lags.reserve(nFrames);
+    for(const FrameSample &sample:m_samples)
+    {
+        double dIdeal=(sample.startTime-first.startTime)/rate;
+        lags.append(sample.wallTime-first.wallTime-dIdeal);
+    }
+    double dBase=*std::min_element(lags.begin(),lags.end());
+    double dThreshold=nInterval/rate;
+    int nLate=0;
+    double dMaxLate=0;
+    for(double dLag:lags)
+    {
+        double dLate=dLag-dBase;
+        dMaxLate=qMax(dMaxLate,dLate);
+        if(dLate>dThreshold)
+            nLate++;
+    }
+
+    result["dropped"]=nDropped;
+    result["late"]=nLate;
+    result["maxLateMs"]=dMaxLate/1000.0;
+    return result;
+}
+
+qint64 PlaybackBench::frameDuration() const
+{
+    double dFrameRate=m_player->metaData().value(QMediaMetaData::VideoFrameRate).toDouble();
+    if(dFrameRate>0)
+        return qint64(1e6/dFrameRate);
+
+    //元数据没有帧率时取录制到的相邻时间戳间隔的中位数
+    QVector<double> intervals;
+    for(int i=1;i<m_samples.size();i++)
+    {
+        qint64 gap=m_samples.at(i).startTime-m_samples.at(i-1).startTime;
+        if(gap>0)
+            intervals.append(gap);
+    }
+    return intervals.isEmpty()?40000:qint64(percentile(intervals,0.5));
+}
+
+bool PlaybackBench::waitUntil(const std::function<bool()> &done,int nTimeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while(!done())
+    {
+        qint64 nRemaining=nTimeoutMs-timer.elapsed();
+        if(nRemaining<=0)
+            return false;
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents,int(qMin<qint64>(nRemaining,10)));
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+/*
+ * 无窗口播放性能测试 与主窗口相同的QMediaPlayer配置，视频输出换成QVideoSink
+ * 测量打开到首帧的耗时、各位置的定位延迟、各档速率下的实际帧率以及丢帧和迟到帧
+ */
+
+#ifndef PLAYBACKBENCH_H
+#define PLAYBACKBENCH_H
+
+#include<QObject>
+#include<QMediaPlayer>
+#include<QAudioOutput>
+#include<QVideoSink>
+#include<QVideoFrame>
+#include<QElapsedTimer>
+#include<QJsonObject>
+#include<QVector>
+#include<functional>
+
+class PlaybackBench : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PlaybackBench(QObject *parent=nullptr);
+
+    void setSeekPoints(int nPoints) {m_nSeekPoints=qMax(1,nPoints);}       //定位测试的位置数
+    void setRateSeconds(double dSeconds) {m_dRateSeconds=qMax(0.5,dSeconds);}  //每档速率的持续播放时长
+    void setTimeout(int nTimeoutMs) {m_nTimeoutMs=nTimeoutMs;}             //单次等待的超时
+
+    QJsonObject run(const QString &filePath);   //测试一个文件，结果为JSON对象
+
+private:
+    //一帧到达的记录
+    struct FrameSample
+    {
+        qint64 wallTime;    //到达时刻（微秒，相对计时起点）
+        qint64 startTime;   //帧时间戳（微秒）
+    };
+
+    QMediaPlayer *m_player;
+    QAudioOutput *m_audioOutput;
+    QVideoSink *m_sink;
+
+    QElapsedTimer m_clock;              //计时起点
+    QVector<FrameSample> m_samples;     //录制期间到达的帧
+    bool m_bRecording = false;
+    qint64 m_nLastFrameTime = -1;       //最近一帧的时间戳（微秒）
+    qint64 m_nLastFrameWall = -1;       //最近一帧的到达时刻（微秒）
+
+    int m_nSeekPoints = 10;
+    double m_dRateSeconds = 3.0;
+    int m_nTimeoutMs = 5000;
+
+    QJsonObject measureOpen(const QString &filePath);
+    QJsonObject measureSeeks();
+    QJsonObject measureRate(double rate);
+
+    qint64 frameDuration() const;   //源帧间隔（微秒），按元数据或时间戳估计
+    bool waitUntil(const std::function<bool()> &done,int nTimeoutMs);
+};
+
+#endif // PLAYBACKBENCH_H
@@ -0,0 +1,28 @@
+#!/bin/sh
+# 生成性能测试用的合成素材：不同编码格式和GOP长度
+# 用法：bench/gen_media.sh [输出目录]（默认 bench/media）
+set -e
+
+OUT=${1:-$(dirname "$0")/media}
+DURATION=30
+SIZE=1280x720
+RATE=30
+mkdir -p "$OUT"
+
+# 带时间码的测试图案和正弦音频，逐帧内容不同，便于核对落点
+# gen 文件名 音频编码 视频编码参数...
+gen() {
+    name=$1; acodec=$2; shift 2
+    echo "生成 $OUT/$name"
+    ffmpeg -v error -y \
+        -f lavfi -i "testsrc2=size=$SIZE:rate=$RATE:duration=$DURATION" \
+        -f lavfi -i "sine=frequency=440:duration=$DURATION" \
+        "$@" -c:a "$acodec" -b:a 128k -shortest "$OUT/$name"
+}
+
+gen h264_gop1.mp4   aac -c:v libx264 -preset veryfast -pix_fmt yuv420p -g 1
+gen h264_gop30.mp4  aac -c:v libx264 -preset veryfast -pix_fmt yuv420p -g 30 -keyint_min 30 -sc_threshold 0
+gen h264_gop300.mp4 aac -c:v libx264 -preset veryfast -pix_fmt yuv420p -g 300 -keyint_min 300 -sc_threshold 0
+gen hevc_gop60.mp4  aac -c:v libx265 -preset veryfast -pix_fmt yuv420p -tag:v hvc1 -x265-params keyint=60:min-keyint=60:scenecut=0:log-level=error
+gen vp9_gop60.webm  libopus -c:v libvpx-vp9 -deadline realtime -cpu-used 8 -pix_fmt yuv420p -g 60
+gen mpeg4_gop12.avi libmp3lame -c:v mpeg4 -q:v 4 -g 12
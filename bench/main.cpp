@@ -0,0 +1,153 @@
+/*
+ * 播放性能测试程序 无窗口运行，结果输出为JSON
+ * 用法：PlaybackBench [--output result.json] [--baseline last.json] media/*.mp4
+ *       PlaybackBench --convert（帧转换与toImage对比，不需要素材）
+ * 测试素材由 bench/gen_media.sh 生成；指定基线时指标退化超过容差则返回非零
+ */
+
+#include "PlaybackBench.h"
+#include "ConvertBench.h"
+
+#include<QGuiApplication>
+#include<QCommandLineParser>
+#include<QJsonDocument>
+#include<QJsonArray>
+#include<QFile>
+#include<QDateTime>
+#include<QTextStream>
+
+namespace {
+//按文件名和速率对比两次结果，返回退化项的说明
+QStringList compareWithBaseline(const QJsonArray &results,const QJsonArray &baseline,double dTolerance)
+{
+    QHash<QString,QJsonObject> baselineByFile;
+    for(const QJsonValue &value:baseline)
+        baselineByFile.insert(value["file"].toString(),value.toObject());
+
+    //耗时类指标越小越好，低于5毫秒的波动不计
+    auto slower=[dTolerance](double dNow,double dBefore){
+        return dNow>dBefore*(1+dTolerance) && dNow-dBefore>5;
+    };
+
+    QStringList regressions;
+    for(const QJsonValue &value:results)
+    {
+        QString file=value["file"].toString();
+        if(!baselineByFile.contains(file))
+            continue;
+        QJsonObject before=baselineByFile.value(file);
+
+        double dOpen=value["open"]["firstFrameMs"].toDouble();
+        double dOpenBefore=before["open"]["firstFrameMs"].toDouble();
+        if(slower(dOpen,dOpenBefore))
+            regressions<<QString("%1: 首帧 %2ms -> %3ms").arg(file).arg(dOpenBefore).arg(dOpen);
+
+        double dSeek=value["seek"]["p50Ms"].toDouble();
+        double dSeekBefore=before["seek"]["p50Ms"].toDouble();
+        if(slower(dSeek,dSeekBefore))
+            regressions<<QString("%1: 定位p50 %2ms -> %3ms").arg(file).arg(dSeekBefore).arg(dSeek);
+
+        QJsonArray rates=value["rates"].toArray();
+        QJsonArray ratesBefore=before["rates"].toArray();
+        for(int i=0;i<qMin(rates.size(),ratesBefore.size());i++)
+        {
+            QJsonObject rate=rates.at(i).toObject();
+            QJsonObject rateBefore=ratesBefore.at(i).toObject();
+            double dFps=rate["fps"].toDouble();
+            double dFpsBefore=rateBefore["fps"].toDouble();
+            if(dFps<dFpsBefore*(1-dTolerance))
+                regressions<<QString("%1 @%2x: 帧率 %3 -> %4").arg(file).arg(rate["rate"].toDouble()).arg(dFpsBefore).arg(dFps);
+            int nDropped=rate["dropped"].toInt();
+            int nDroppedBefore=rateBefore["dropped"].toInt();
+            if(nDropped>nDroppedBefore+qMax(2,int(nDroppedBefore*dTolerance)))
+                regressions<<QString("%1 @%2x: 丢帧 %3 -> %4").arg(file).arg(rate["rate"].toDouble()).arg(nDroppedBefore).arg(nDropped);
+        }
+    }
+    return regressions;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    //没有显示环境也能运行
+    if(!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM","offscreen");
+
+    QGuiApplication a(argc, argv);
+    QCoreApplication::setApplicationName("PlaybackBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("FrameSync播放性能测试");
+    parser.addHelpOption();
+    QCommandLineOption outputOption({"o","output"},"结果写入文件（默认输出到标准输出）","file");
+    QCommandLineOption baselineOption("baseline","与之前的结果对比","file");
+    QCommandLineOption toleranceOption("tolerance","允许的退化比例（百分比）","percent","20");
+    QCommandLineOption seekOption("seek-points","定位测试的位置数","count","10");
+    QCommandLineOption rateOption("rate-seconds","每档速率的播放时长（秒）","seconds","3");
+    QCommandLineOption convertOption("convert","测试帧转换：1080p、4K下FrameConverter与toImage对比");
+    QCommandLineOption convertIterationsOption("convert-iterations","帧转换每项的重复次数","count","20");
+    parser.addOptions({outputOption,baselineOption,toleranceOption,seekOption,rateOption,convertOption,convertIterationsOption});
+    parser.addPositionalArgument("files","测试用的媒体文件");
+    parser.process(a);
+
+    QStringList files=parser.positionalArguments();
+    if(files.isEmpty() && !parser.isSet(convertOption))
+        parser.showHelp(1);
+
+    PlaybackBench bench;
+    bench.setSeekPoints(parser.value(seekOption).toInt());
+    bench.setRateSeconds(parser.value(rateOption).toDouble());
+
+    QTextStream err(stderr);
+    QJsonArray results;
+    for(const QString &filePath:files)
+    {
+        err<<"测试 "<<filePath<<Qt::endl;
+        results.append(bench.run(filePath));
+    }
+
+    QJsonObject report;
+    report["qtVersion"]=QString(qVersion());
+    report["timestamp"]=QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["results"]=results;
+    if(parser.isSet(convertOption))
+    {
+        err<<"测试帧转换"<<Qt::endl;
+        ConvertBench convertBench;
+        convertBench.setIterations(parser.value(convertIterationsOption).toInt());
+        report["convert"]=convertBench.run();
+    }
+    QByteArray json=QJsonDocument(report).toJson();
+
+    if(parser.isSet(outputOption))
+    {
+        QFile file(parser.value(outputOption));
+        if(!file.open(QIODevice::WriteOnly))
+        {
+            err<<"无法写入 "<<file.fileName()<<Qt::endl;
+            return 1;
+        }
+        file.write(json);
+    }
+    else
+    {
+        QTextStream(stdout)<<json;
+    }
+
+    if(parser.isSet(baselineOption))
+    {
+        QFile file(parser.value(baselineOption));
+        if(!file.open(QIODevice::ReadOnly))
+        {
+            err<<"无法读取基线 "<<file.fileName()<<Qt::endl;
+            return 1;
+        }
+        QJsonArray baseline=QJsonDocument::fromJson(file.readAll())["results"].toArray();
+        QStringList regressions=compareWithBaseline(results,baseline,parser.value(toleranceOption).toDouble()/100.0);
+        for(const QString &regression:regressions)
+            err<<"退化 "<<regression<<Qt::endl;
+        if(!regressions.isEmpty())
+            return 2;
+    }
+    return 0;
+}
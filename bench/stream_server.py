@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+# 本地HTTP流测试服务器：按指定速率发送媒体文件，并可周期性停顿，模拟抖动的网络链路
+# 用法：bench/stream_server.py 文件 [--port 8000] [--rate 400] [--stall-every 10] [--stall-ms 3000] [--jitter 0.3] [--live]
+# 播放器中打开 http://127.0.0.1:8000/文件名，观察状态栏的缓冲水位、下载速度和卡顿次数
+# --live 循环发送、不给长度，充当直播源测试时移；素材用TS格式，例如：
+#   ffmpeg -i bench/media/h264_gop30.mp4 -c copy -f mpegts bench/media/live.ts
+import argparse
+import os
+import random
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+CHUNK = 16 * 1024
+
+
+def make_handler(args):
+    class Handler(BaseHTTPRequestHandler):
+        def do_HEAD(self):
+            self.send_headers()
+
+        def do_GET(self):
+            self.send_headers()
+            rate = args.rate * 1024
+            next_stall = time.monotonic() + args.stall_every if args.stall_every > 0 else None
+            with open(args.file, "rb") as f:
+                while True:
+                    data = f.read(CHUNK)
+                    if not data:
+                        # 直播模式从头循环，TS按包拼接即可连续播放
+                        if not args.live:
+                            break
+                        f.seek(0)
+                        continue
+                    try:
+                        self.wfile.write(data)
+                    except (BrokenPipeError, ConnectionResetError):
+                        return
+                    # 按速率限速，每块的间隔随机抖动
+                    delay = len(data) / rate
+                    delay *= 1 + random.uniform(-args.jitter, args.jitter)
+                    time.sleep(max(0.0, delay))
+                    if next_stall and time.monotonic() >= next_stall:
+                        self.log_message("停顿 %d ms", args.stall_ms)
+                        time.sleep(args.stall_ms / 1000)
+                        next_stall = time.monotonic() + args.stall_every
+
+        def send_headers(self):
+            self.send_response(200)
+            self.send_header("Content-Type", "application/octet-stream")
+            if not args.live:
+                self.send_header("Content-Length", str(os.path.getsize(args.file)))
+            self.end_headers()
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description="限速、带停顿的本地HTTP流测试服务器")
+    parser.add_argument("file", help="要发送的媒体文件（可用 bench/gen_media.sh 生成）")
+    parser.add_argument("--port", type=int, default=8000)
+    parser.add_argument("--rate", type=float, default=400, help="平均发送速率（KB/s）")
+    parser.add_argument("--stall-every", type=float, default=0, help="每隔多少秒停顿一次，0为不停顿")
+    parser.add_argument("--stall-ms", type=int, default=3000, help="每次停顿的时长（毫秒）")
+    parser.add_argument("--jitter", type=float, default=0.3, help="每块发送间隔的随机抖动比例")
+    parser.add_argument("--live", action="store_true", help="循环发送且不给长度，模拟直播")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer(("127.0.0.1", args.port), make_handler(args))
+    print(f"http://127.0.0.1:{args.port}/{os.path.basename(args.file)}  {args.rate:.0f}KB/s")
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
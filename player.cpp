@@ -104,22 +104,120 @@ Player::Player(QWidget *parent)
     QShortcut *muteShrtcut=new QShortcut(Qt::Key_M,this);
     connect(muteShrtcut,&QShortcut::activated,this,&Player::toggleMute);
 
-    //进度条相关
-    connect(m_mediaPlayer,&QMediaPlayer::positionChanged,this,&Player::updatePosition);
-    connect(m_mediaPlayer,&QMediaPlayer::durationChanged,this,&Player::updateDuration);
+    //逐帧步进：方向键左右逐帧后退/前进，按住可连续步进
+    m_frameStepper = new FrameStepper(m_mediaPlayer,m_videoWidget->videoSink(),this);
+    QShortcut *stepBackwardShortcut=new QShortcut(Qt::Key_Left,this);
+    //倒放中单步先停在当前显示的帧上
+    connect(stepBackwardShortcut,&QShortcut::activated,this,[this](){
+        m_reversePlayer->stop();
+        m_frameStepper->stepBackward();
+    });
+    QShortcut *stepForwardShortcut=new QShortcut(Qt::Key_Right,this);
+    connect(stepForwardShortcut,&QShortcut::activated,this,[this](){
+        m_reversePlayer->stop();
+        m_frameStepper->stepForward();
+    });
+    //缓存帧不经过播放器，需要手动刷新进度条
+    connect(m_frameStepper,&FrameStepper::framePresented,this,[this](qint64 position){
+        ui->progressSlider->setValue(position);
+        ui->currentTimeLabel->setText(formatTime(position));
+    });
+
+    //入出点：I、O键在进度条上标记当前位置，供导出帧序列使用
+    QShortcut *inPointShortcut=new QShortcut(Qt::Key_I,this);
+    connect(inPointShortcut,&QShortcut::activated,this,[this](){markInOut(false);});
+    QShortcut *outPointShortcut=new QShortcut(Qt::Key_O,this);
+    connect(outPointShortcut,&QShortcut::activated,this,[this](){markInOut(true);});
+    m_frameExporter = new FrameExporter(this);
+    connect(m_frameExporter,&FrameExporter::progressChanged,this,&Player::updateExportProgress);
+    connect(m_frameExporter,&FrameExporter::finished,this,[this](bool bSuccess){
+        if(m_exportProgress)
+            m_exportProgress->close();
+        FrameExporter::Stats stats=m_frameExporter->stats();
+        if(bSuccess)
+        {
+            QString message=QString("已导出%1帧，%2帧/秒，%3MB/秒")
+                                .arg(stats.written)
+                                .arg(stats.framesPerSecond,0,'f',1)
+                                .arg(stats.bytesPerSecond/(1024*1024),0,'f',1);
+            //1倍速重新解码后仍然存在的间隔来自源文件（可变帧率或缺帧）
+            if(stats.acceptedGaps>0)
+                message+=QString("，源文件中有%1处帧间隔已按原样导出").arg(stats.acceptedGaps);
+            statusBar()->showMessage(message,10000);
+        }
+        else if(m_frameExporter->errorString().isEmpty())
+            statusBar()->showMessage(QString("导出已取消，已写出%1帧").arg(stats.written),5000);
+        else
+            QMessageBox::warning(this,"导出帧序列",m_frameExporter->errorString());
+    });
+
+    //帧时序监视（诊断菜单中打开），统计结果显示在视频区域左上角
+    m_frameTimingMonitor = new FrameTimingMonitor(m_videoWidget->videoSink(),this);
+    m_frameTimingOverlay = new FrameTimingOverlay(m_videoWidget);
+    connect(m_frameTimingMonitor,&FrameTimingMonitor::statsChanged,m_frameTimingOverlay,&FrameTimingOverlay::setStats);
+
+    //进度条相关（播放器信号见connectMediaPlayer）
+    //拖动中的定位经调度器合并，松开时精确定位到松开的位置
+    m_seekScheduler = new SeekScheduler(m_mediaPlayer,m_videoWidget->videoSink(),this);
     connect(ui->progressSlider,&QSlider::sliderMoved,this,&Player::setPosition);
+    connect(ui->progressSlider,&QSlider::sliderReleased,this,[this](){
+        if(!m_timeshift && m_mediaPlayer->isSeekable())
+        {
+            qint64 target=snapSeekTarget(ui->progressSlider->value());
+            m_seekScheduler->exactSeek(target);
+            seekSyncStreams(target);
+        }
+    });
+
+    //进度条悬停预览：缩略图在后台解码，只显示与当前悬停位置匹配的结果
+    m_thumbnailProvider = new ThumbnailProvider(this);
+    connect(ui->progressSlider,&ClickableSlider::hoverValueChanged,this,&Player::showSeekPreview);
+    connect(ui->progressSlider,&ClickableSlider::hoverLeft,this,[this](){
+        m_nHoverPosition=-1;
+        m_thumbnailProvider->cancelPending();
+    });
+    connect(m_thumbnailProvider,&ThumbnailProvider::thumbnailReady,this,[this](qint64 position,const QImage &image){
+        if(m_nHoverPosition>=0 && m_thumbnailProvider->bucketOf(position)==m_thumbnailProvider->bucketOf(m_nHoverPosition))
+            ui->progressSlider->showPreview(image,seekPreviewText(m_nHoverPosition));
+    });
 
     //音量控制相关
     connect(ui->volumeSlider,&QSlider::valueChanged,this,&Player::setVolume);
 
-    //播放状态改变时
-    connect(m_mediaPlayer,&QMediaPlayer::playbackStateChanged,this,&Player::updatePlayIcon);
-
     //创建视频播放列表
     m_playlistDock = new QDockWidget(this);
     m_playlistDock->setTitleBarWidget(new QWidget());
-    m_playlistWidget=new QListWidget(m_playlistDock);
-    m_playlistDock->setWidget(m_playlistWidget);
+    m_playlistModel=new PlaylistModel(this);
+    m_playlistProxy=new PlaylistProxyModel(m_playlistModel,this);
+    QWidget *playlistPanel=new QWidget(m_playlistDock);
+    QVBoxLayout *playlistLayout=new QVBoxLayout(playlistPanel);
+    playlistLayout->setContentsMargins(0,0,0,0);
+    playlistLayout->setSpacing(2);
+    m_playlistFilterEdit=new QLineEdit(playlistPanel);
+    m_playlistFilterEdit->setPlaceholderText("筛选：文件名  >10m  <1h  >=1080p");
+    m_playlistFilterEdit->setClearButtonEnabled(true);
+    connect(m_playlistFilterEdit,&QLineEdit::textChanged,m_playlistProxy,&PlaylistProxyModel::setFilterText);
+    m_playlistView=new QTreeView(playlistPanel);
+    m_playlistView->setModel(m_playlistProxy);
+    m_playlistView->setUniformRowHeights(true);  //行高一致，视图只为可见行计算布局
+    m_playlistView->setRootIsDecorated(false);
+    m_playlistView->setAllColumnsShowFocus(true);
+    m_playlistView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_playlistView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    //点击表头排序，第三次点击恢复播放列表原有顺序
+    m_playlistView->header()->setSortIndicator(-1,Qt::AscendingOrder);
+    m_playlistView->header()->setSortIndicatorClearable(true);
+    m_playlistView->setSortingEnabled(true);
+    //固定列宽，避免按内容计算列宽时遍历全部行
+    m_playlistView->header()->setStretchLastSection(false);
+    m_playlistView->header()->setSectionResizeMode(PlaylistModel::NameColumn,QHeaderView::Stretch);
+    m_playlistView->header()->resizeSection(PlaylistModel::DurationColumn,64);
+    m_playlistView->header()->resizeSection(PlaylistModel::ResolutionColumn,80);
+    m_playlistView->header()->resizeSection(PlaylistModel::CodecColumn,80);
+    m_playlistView->header()->resizeSection(PlaylistModel::BitRateColumn,80);
+    playlistLayout->addWidget(m_playlistFilterEdit);
+    playlistLayout->addWidget(m_playlistView);
+    m_playlistDock->setWidget(playlistPanel);
     addDockWidget(Qt::RightDockWidgetArea,m_playlistDock);
 
     //根据屏幕分辨率设置播放列表最小宽度
@@ -134,26 +232,26 @@ Player::Player(QWidget *parent)
     }
 
     //设置播放列表样式
-    m_playlistWidget->setStyleSheet(R"(
-        QListWidget{
+    m_playlistView->setStyleSheet(R"(
+        QTreeView{
             background-color: #2b2b2b;
             border:none;
         }
 
         /*设置列表默认样式*/
-        QListWidget::item{
+        QTreeView::item{
             color:#ffffff;  /*文字颜色为白色*/
             padding:4px;    /*文字四周留4像素内边距*/
             border-bottom:1px solid #3a3a3a;    /*底层添加浅灰色1像素分割线*/
         }
 
         /*设置被选中项的样式*/
-        QListWidget::itme:hover{
+        QTreeView::itme:hover{
             background-color:#323232;   /*浅灰色*/
         }
 
         /*设置鼠标悬停项的样式*/
-        QListWidget::itme:selected{
+        QTreeView::itme:selected{
             background-color:#3a3a3a;   /*灰色*/
         }
     )");
@@ -176,8 +274,14 @@ Player::Player(QWidget *parent)
     //将播放列表命令按钮添加到控制栏
     connect(ui->PlaylistButton,&QPushButton::clicked,this,&Player::togglePlaylist);
 
+    //Ctrl+上/下调整当前条目顺序
+    QShortcut *moveUpShortcut=new QShortcut(QKeySequence(Qt::CTRL|Qt::Key_Up),m_playlistView,nullptr,nullptr,Qt::WidgetShortcut);
+    connect(moveUpShortcut,&QShortcut::activated,this,[this](){moveCurrentPlaylistItem(-1);});
+    QShortcut *moveDownShortcut=new QShortcut(QKeySequence(Qt::CTRL|Qt::Key_Down),m_playlistView,nullptr,nullptr,Qt::WidgetShortcut);
+    connect(moveDownShortcut,&QShortcut::activated,this,[this](){moveCurrentPlaylistItem(1);});
+
     //连接播放列表信号 - 双击实现播放功能
-    connect(m_playlistWidget,&QListWidget::itemDoubleClicked,this,&Player::playlistItemDoubleClicked);
+    connect(m_playlistView,&QTreeView::doubleClicked,this,&Player::playlistItemDoubleClicked);
 
     //初始化菜单指针
     m_playbackRateMenu = nullptr;
@@ -192,28 +296,167 @@ Player::Player(QWidget *parent)
 
     m_strDefaultPlaylistFile = appDataDir.filePath("default.m3u");
 
-    //添加默认播放列表
-    loadDefaultPlaylist();
+    //缩略图磁盘缓存与播放列表放在同一目录
+    m_thumbnailProvider->enableDiskCache(appDataDir.filePath("thumbnails"));
+
+    //关键帧索引同样按文件身份存放；就绪后在进度条上标出，拖动预览对齐到最近的关键帧
+    m_keyframeIndex = new KeyframeIndex(appDataDir.filePath("keyframes"),this);
+    connect(m_keyframeIndex,&KeyframeIndex::indexReady,this,[this](int nKeyframes){
+        QVector<int> positions;
+        positions.reserve(nKeyframes);
+        for(const KeyframeIndex::Keyframe &keyframe:m_keyframeIndex->keyframes())
+            positions.append(int(keyframe.timeUs/1000));
+        ui->progressSlider->setKeyframes(positions);
+    });
+    m_seekScheduler->setSnapFunction([this](qint64 position){
+        return m_keyframeIndex->nearestKeyframe(position);
+    });
 
-    //添加媒体状态变化处理操作
-    connect(m_mediaPlayer,&QMediaPlayer::mediaStatusChanged,this,[this](QMediaPlayer::MediaStatus status){
-        switch (status) {
-        case QMediaPlayer::LoadedMedia:
-            //媒体加载完成后，可以开始操作
-            ui->playButton->setEnabled(true);
-            break;
-        case QMediaPlayer::InvalidMedia:
-            //无效媒体
-            QMessageBox::warning(this,"错误","无效的媒体文件！");
-            break;
+    //快速浏览：只显示关键帧，速率菜单选4x以上或按住前进/后退按钮进入
+    m_fastScan = new FastScanController(m_mediaPlayer,m_seekScheduler,m_keyframeIndex,this);
+    connect(m_fastScan,&FastScanController::rateChanged,this,[this](double rate){
+        //退出后勾回实际的播放速率
+        checkRateAction(rate!=0?rate:m_mediaPlayer->playbackRate());
+        if(rate!=0)
+            statusBar()->showMessage(QString("快速浏览 %1x（%2）").arg(rate).arg(m_keyframeIndex->isReady()?"关键帧":"无关键帧索引，按间隔取帧"));
+        else
+            statusBar()->showMessage(QString("快速浏览结束，显示%1帧").arg(m_fastScan->shownFrames()),3000);
+    });
+    //前进/后退按钮：单击跳10秒，按住进入快速浏览；浏览中单击逐级调整速率
+    m_scanHoldTimer = new QTimer(this);
+    m_scanHoldTimer->setSingleShot(true);
+    m_scanHoldTimer->setInterval(500);
+    connect(m_scanHoldTimer,&QTimer::timeout,this,[this](){
+        if(m_timeshift || m_fastScan->isActive())
+            return;
+        m_bScanHoldStarted=true;
+        setPlayBackRate(m_nScanHoldDirection*FastScanController::kMinRate);
+    });
+    connect(ui->forwardButton,&QPushButton::pressed,this,[this](){m_nScanHoldDirection=1;m_scanHoldTimer->start();});
+    connect(ui->backwardButton,&QPushButton::pressed,this,[this](){m_nScanHoldDirection=-1;m_scanHoldTimer->start();});
+    connect(ui->forwardButton,&QPushButton::released,m_scanHoldTimer,&QTimer::stop);
+    connect(ui->backwardButton,&QPushButton::released,m_scanHoldTimer,&QTimer::stop);
+    connect(ui->forwardButton,&QPushButton::clicked,this,[this](){scanButtonClicked(1);});
+    connect(ui->backwardButton,&QPushButton::clicked,this,[this](){scanButtonClicked(-1);});
+
+    //倒放：后台按GOP分段解码，显示当前段时预取前一段，帧池大小在播放菜单中设置
+    m_reversePlayer = new ReversePlayer(m_mediaPlayer,m_videoWidget->videoSink(),m_keyframeIndex,this);
+    m_reversePlayer->setFrameBudget(m_nReverseFrameBudget);
+    connect(m_reversePlayer,&ReversePlayer::positionChanged,this,&Player::updatePosition);
+    connect(m_reversePlayer,&ReversePlayer::rateChanged,this,[this](double rate){
+        //倒放的帧直接写入视频sink，单步缓存和帧时序监视不能把它们当作播放器的解码帧
+        m_frameStepper->setExternalPresenting(rate!=0);
+        m_frameTimingMonitor->setExternalPresenting(rate!=0);
+        checkRateAction(rate!=0?rate:m_mediaPlayer->playbackRate());
+        if(rate!=0)
+        {
+            statusBar()->showMessage(QString("倒放 %1x").arg(rate));
+            return;
+        }
+        ReversePlayer::Stats stats=m_reversePlayer->stats();
+        statusBar()->showMessage(QString("倒放结束：显示%1帧，解码%2段，停顿%3次，帧池峰值%4帧")
+                                 .arg(stats.presented).arg(stats.chunks).arg(stats.stalls).arg(stats.peakPooledFrames),5000);
+    });
+    connect(m_reversePlayer,&ReversePlayer::failed,this,[this](const QString &message){
+        statusBar()->showMessage(message,5000);
+    });
 
-        default:
-            break;
+    //音频波形：时长确定后开始分析，解码过程中逐步画满；完整结果缓存到磁盘
+    m_waveformAnalyzer = new WaveformAnalyzer(appDataDir.filePath("waveforms"),this);
+    ui->progressSlider->setMinimumHeight(28);
+    connect(m_waveformAnalyzer,&WaveformAnalyzer::envelopeChanged,this,[this](){
+        ui->progressSlider->setWaveform(m_bShowWaveform?m_waveformAnalyzer->render(ui->progressSlider->height()):QImage());
+    });
+
+    //添加默认播放列表（异步加载，条目分批出现；编辑以日志形式追加）
+    m_playlistJournal = new PlaylistJournal(m_strDefaultPlaylistFile,this);
+    m_playlistLoader = new PlaylistLoader(this);
+    connect(m_playlistLoader,&PlaylistLoader::batchLoaded,m_playlistModel,&PlaylistModel::appendPaths);
+    connect(m_playlistLoader,&PlaylistLoader::missingFound,m_playlistModel,&PlaylistModel::markMissing);
+    connect(m_playlistLoader,&PlaylistLoader::finished,this,[this](int nCount,int nMissing,qint64 elapsedMs){
+        statusBar()->showMessage(QString("播放列表加载完成：%1项，缺失%2项，用时%3ms").arg(nCount).arg(nMissing).arg(elapsedMs),5000);
+        //上次会话遗留的日志可能已经很大，加载完成后检查一次
+        m_bPlaylistSavePending=false;
+        saveDefaultPlaylist();
+    });
+    loadDefaultPlaylist();
+
+    //加载播放历史记录
+    m_strHistoryFile=appDataDir.filePath("history.dat");
+    m_historyStore=new PlayHistoryStore(m_strHistoryFile,this);
+    m_historyStore->load();
+
+    //加载续播位置表
+    m_resumeStore=new ResumePositionStore(appDataDir.filePath("resume.dat"),this);
+    m_resumeStore->load();
+
+    //元数据探测：新加入播放列表的条目在后台探测，结果按路径、大小和修改时间缓存
+    m_metadataCache=new MetadataCache(appDataDir.filePath("metadata.dat"),this);
+    m_metadataCache->load();
+    m_mediaProber=new MediaProber(m_metadataCache,this);
+    //响度分析：每个核一个解码线程，结果同样写入元数据缓存，开始播放前按缓存的增益设置音量
+    //播放中分析完成也不改音量，下次播放这个文件时生效
+    m_loudnessAnalyzer=new LoudnessAnalyzer(m_metadataCache,this);
+    connect(m_loudnessAnalyzer,&LoudnessAnalyzer::lookedUp,this,[this](const QString &filePath,const LoudnessInfo &loudness){
+        if(filePath!=m_strLoudnessFile)
+            return;
+        m_strLoudnessFile.clear();
+        m_dLoudnessGain=LoudnessAnalyzer::referenceLevel()*LoudnessAnalyzer::gainFor(loudness);
+        setVolume(ui->volumeSlider->value());
+        if(m_bPlayAfterLoudness)
+        {
+            m_bPlayAfterLoudness=false;
+            m_mediaPlayer->play();
+        }
+    });
+    connect(m_mediaProber,&MediaProber::probed,m_playlistModel,&PlaylistModel::setMediaInfo);
+    connect(m_playlistModel,&QAbstractItemModel::rowsInserted,this,[this](const QModelIndex &,int first,int last){
+        QStringList filePaths;
+        filePaths.reserve(last-first+1);
+        for(int row=first;row<=last;row++)
+            filePaths.append(m_playlistModel->filePath(row));
+        m_mediaProber->enqueue(filePaths);
+        m_loudnessAnalyzer->enqueue(filePaths);
+    });
+    connect(m_playlistModel,&QAbstractItemModel::modelReset,m_mediaProber,&MediaProber::clear);
+    connect(m_playlistModel,&QAbstractItemModel::modelReset,m_loudnessAnalyzer,&LoudnessAnalyzer::clear);
+
+    //媒体库：监视目录的增量索引，修改过的文件如果在播放列表中则重新探测元数据
+    m_mediaLibrary=new MediaLibrary(appDataDir.filePath("library.dat"),this);
+    m_libraryDock=new LibraryDock(m_mediaLibrary,this);
+    addDockWidget(Qt::LeftDockWidgetArea,m_libraryDock);
+    connect(m_libraryDock,&LibraryDock::fileActivated,this,[this](const QString &filePath){
+        if(m_playlistModel->appendPaths({filePath})>=0)
+        {
+            m_playlistJournal->recordAdd({filePath});
+            saveDefaultPlaylist();
         }
+        playFile(filePath);
     });
+    connect(m_mediaLibrary,&MediaLibrary::filesModified,this,[this](const QStringList &filePaths){
+        QStringList inPlaylist;
+        for(const QString &filePath:filePaths)
+        {
+            if(m_playlistModel->rowOf(filePath)>=0)
+                inPlaylist.append(filePath);
+        }
+        if(!inPlaylist.isEmpty())
+        {
+            m_mediaProber->enqueue(inPlaylist);
+            m_loudnessAnalyzer->enqueue(inPlaylist);
+        }
+    });
+    connect(m_mediaLibrary,&MediaLibrary::scanFinished,this,[this](int nAdded,int nRemoved,int nModified,qint64 elapsedMs){
+        if(nAdded+nRemoved+nModified>0)
+            statusBar()->showMessage(QString("媒体库已更新：新增%1，删除%2，修改%3，用时%4ms").arg(nAdded).arg(nRemoved).arg(nModified).arg(elapsedMs),5000);
+    });
+    m_mediaLibrary->load();
+    m_libraryDock->setVisible(!m_mediaLibrary->roots().isEmpty());
 
     //设置流媒体历史记录文件路径
     m_strStreamHistoryFile=appDataDir.filePath("streams.dat");
+    //直播时移的循环文件名模板，每次录制另建文件，停止时删除
+    m_strTimeshiftFile=appDataDir.filePath("timeshift.buf");
 
     //加载流媒体历史记录
     loadStreamHistory();
@@ -221,38 +464,116 @@ Player::Player(QWidget *parent)
     //播放速度控制（创建播放速度菜单）
     createPlaybackRateMenu();
 
+    //网络流缓冲状态，只在经预缓冲播放时显示
+    m_streamStatusLabel = new QLabel(this);
+    m_streamStatusLabel->hide();
+    statusBar()->addPermanentWidget(m_streamStatusLabel);
+
+    //时移期间进度条表示可回看的窗口，由定时器刷新
+    m_timeshiftTimer = new QTimer(this);
+    m_timeshiftTimer->setInterval(500);
+    connect(m_timeshiftTimer,&QTimer::timeout,this,&Player::updateTimeshiftPosition);
+    connect(ui->progressSlider,&QSlider::sliderReleased,this,[this](){
+        if(m_timeshift && m_nTimeshiftSeekTarget>=0)
+            seekTimeshift(m_nTimeshiftSeekTarget);
+        m_nTimeshiftSeekTarget=-1;
+    });
+
+    //下一项预加载器：当前文件快结束时提前打开下一项，结尾处无缝切换
+    m_preroller = new MediaPreroller(this);
+    //播放列表增删、移动后预测的行号失效，重新预测
+    auto resetPrediction=[this](){
+        m_nPredictedNextRow=-1;
+        m_bPrerollRequested=false;
+    };
+    connect(m_playlistModel,&QAbstractItemModel::rowsRemoved,this,resetPrediction);
+    connect(m_playlistModel,&QAbstractItemModel::rowsMoved,this,resetPrediction);
+    connect(m_playlistModel,&QAbstractItemModel::modelReset,this,resetPrediction);
+    connect(m_playlistProxy,&QAbstractItemModel::layoutChanged,this,resetPrediction);
+
+    //播放器信号统一在此连接，无缝切换换播放器时重新连接
+    connectMediaPlayer();
+}
+
+void Player::connectMediaPlayer()
+{
+    //进度条相关
+    connect(m_mediaPlayer,&QMediaPlayer::positionChanged,this,&Player::updatePosition);
+    connect(m_mediaPlayer,&QMediaPlayer::durationChanged,this,&Player::updateDuration);
+    connect(m_mediaPlayer,&QMediaPlayer::durationChanged,m_thumbnailProvider,&ThumbnailProvider::setDuration);
+
+    //播放状态改变时
+    connect(m_mediaPlayer,&QMediaPlayer::playbackStateChanged,this,&Player::updatePlayIcon);
+    //同步播放窗口打开时，主窗口的播放/暂停同时作用到所有流
+    connect(m_mediaPlayer,&QMediaPlayer::playbackStateChanged,this,[this](QMediaPlayer::PlaybackState state){
+        if(!m_syncWindow)
+            return;
+        if(state==QMediaPlayer::PlayingState)
+            m_syncWindow->controller()->play();
+        else if(state==QMediaPlayer::PausedState)
+            m_syncWindow->controller()->pause();
+    });
+
+    //添加媒体状态变化处理操作
+    connect(m_mediaPlayer,&QMediaPlayer::mediaStatusChanged,this,&Player::handleMediaStatus);
+
     //添加错误处理连接
     connect(m_mediaPlayer,&QMediaPlayer::errorOccurred,this,[this](QMediaPlayer::Error error,const QString &errorString){
         if(error!=QMediaPlayer::NoError)
             QMessageBox::warning(this,"播放错误","播放出错，请重试："+errorString);
     });
+}
 
-    //媒体播放结束时的处理操作
-    connect(m_mediaPlayer,&QMediaPlayer::mediaStatusChanged,this,[this](QMediaPlayer::MediaStatus status){
-        if(status==QMediaPlayer::EndOfMedia)
-            {
-            switch (m_playMode) {
-            case SingleLoop:
-
-                break;
-            case Loop:
-
-                break;
-            case Sequential:
-
-                break;
-            case Random:
+void Player::handleMediaStatus(QMediaPlayer::MediaStatus status)
+{
+    switch (status) {
+    case QMediaPlayer::LoadedMedia:
+        //媒体加载完成后，可以开始操作
+        ui->playButton->setEnabled(true);
+        if(m_nPendingResume>0)
+        {
+            m_mediaPlayer->setPosition(m_nPendingResume);
+            m_nPendingResume=0;
+        }
+        break;
+    case QMediaPlayer::EndOfMedia:
+        //播放完毕，下次从头开始
+        if(m_nCurrentResumeId>=0)
+            m_resumeStore->setPosition(m_nCurrentResumeId,0);
 
-                break;
-            default:
-                break;
-            }
+        //只有播放列表条目按播放模式接着播，网络流播完就停在结尾
+        if(m_strCurrentFile.isEmpty())
+            break;
+        switch (m_playMode) {
+        case SingleLoop:
+            m_mediaPlayer->setPosition(0);
+            m_mediaPlayer->play();
+            break;
+        case Loop:
+        case Sequential:
+        case Random:
+            playNext();
+            break;
+        default:
+            break;
         }
-    });
+        break;
+    case QMediaPlayer::InvalidMedia:
+        //无效媒体
+        QMessageBox::warning(this,"错误","无效的媒体文件！");
+        break;
+
+    default:
+        break;
+    }
 }
 
 Player::~Player()
 {
+    saveCurrentHistoryPosition();
+    //探测器和响度分析器在后台线程查元数据缓存，缓存先创建、会先于它们析构，这里先等它们退出
+    delete m_mediaProber;
+    delete m_loudnessAnalyzer;
     delete ui;
 }
 
@@ -321,33 +642,156 @@ QString Player::formatTime(qint64 milliseconds)
 
 void Player::updatePosition(qint64 position)   //进度条控制
 {
-    ui->progressSlider->setValue(position);
+    //时移期间进度条由时移缓冲驱动
+    if(m_timeshift)
+        return;
+
+    //拖动中滑块跟随鼠标，不被预览定位的位置拉回
+    if(!ui->progressSlider->isSliderDown())
+        ui->progressSlider->setValue(position);
     ui->currentTimeLabel->setText(formatTime(position));
 
-    //保存当前播放位置
-    if(!m_mediaPlayer->source().isEmpty())
+    //按固定频率采样当前播放位置，用ID更新，不再每次重建路径字符串
+    //等待恢复位置期间和播放结束后的位置不采样，以免覆盖表中的记录
+    if(m_nCurrentResumeId>=0 && m_nPendingResume==0
+        && m_mediaPlayer->mediaStatus()!=QMediaPlayer::EndOfMedia
+        && (!m_resumeSampleTimer.isValid() || m_resumeSampleTimer.elapsed()>=1000))
+    {
+        m_resumeStore->setPosition(m_nCurrentResumeId,position);
+        m_resumeSampleTimer.start();
+    }
+
+    //接近结尾时预加载下一项
+    qint64 duration=m_mediaPlayer->duration();
+    if(!m_bPrerollRequested && !m_strCurrentFile.isEmpty() && duration>0 && duration-position<10000)
     {
-        m_lastPositions[m_mediaPlayer->source().toString()]=position;
+        m_bPrerollRequested=true;
+        prerollNext();
     }
 }
 
 void Player::updateDuration(qint64 duration)    //更新总时长
 {
+    if(m_timeshift)
+        return;
     ui->progressSlider->setRange(0,duration);
     ui->totalTimeLabel->setText(formatTime(duration));
+    if(m_bShowWaveform && m_waveformAnalyzer && !m_strCurrentFile.isEmpty() && duration>0)
+        m_waveformAnalyzer->setFile(m_strCurrentFile,duration);
+}
+
+void Player::showSeekPreview(int position)
+{
+    if(ui->progressSlider->maximum()<=0)
+        return;
+
+    //时移：显示距直播的时长，没有缩略图
+    if(m_timeshift)
+    {
+        ui->progressSlider->showPreview(QImage(),"-"+formatTime(ui->progressSlider->maximum()-position));
+        return;
+    }
+
+    //先显示时间，缩略图就绪后再替换
+    m_nHoverPosition=position;
+    ui->progressSlider->showPreview(QImage(),seekPreviewText(position));
+    m_thumbnailProvider->request(position);
 }
 
 void Player::setPosition(int position)         //设置播放位置
 {
-    if(m_mediaPlayer->isSeekable())
+    //时移：拖动中只记下目标，松开后再重新读取；单击直接定位
+    if(m_timeshift)
+    {
+        qint64 timeMs=m_timeshift->oldestTime()+position;
+        if(ui->progressSlider->isSliderDown())
+            m_nTimeshiftSeekTarget=timeMs;
+        else
+            seekTimeshift(timeMs);
+        return;
+    }
+
+    if(!m_mediaPlayer->isSeekable())
+        return;
+    m_fastScan->stop();
+    m_reversePlayer->stop();
+    if(ui->progressSlider->isSliderDown())
+    {
+        m_seekScheduler->previewSeek(position);
+    }
+    else
     {
-        m_mediaPlayer->setPosition(position);
+        qint64 target=snapSeekTarget(position);
+        m_seekScheduler->exactSeek(target);
+        seekSyncStreams(target);
     }
 }
 
+void Player::seekSyncStreams(qint64 position)
+{
+    //同步播放窗口打开时，主窗口的定位同时作用到所有流；拖动中不转发，松开时一次定位
+    if(m_syncWindow)
+        m_syncWindow->controller()->setPosition(position);
+}
+
+qint64 Player::snapSeekTarget(qint64 position) const
+{
+    return m_bSnapToKeyframe?m_keyframeIndex->nearestKeyframe(position):position;
+}
+
+QString Player::seekPreviewText(qint64 position)
+{
+    //有关键帧索引时提示这次定位的代价：落在关键帧上很快，否则要从前一关键帧解码过来
+    QString text=formatTime(position);
+    if(!m_keyframeIndex->isReady())
+        return text;
+    if(m_bSnapToKeyframe)
+        return text+QString("（对齐到关键帧%1）").arg(formatTime(m_keyframeIndex->nearestKeyframe(position)));
+    qint64 nSpan=m_keyframeIndex->decodeSpan(position);
+    if(nSpan<=50)
+        return text+"（关键帧）";
+    return text+QString("（需解码%1秒）").arg(nSpan/1000.0,0,'f',1);
+}
+
+void Player::scanButtonClicked(int nDirection)
+{
+    if(m_bScanHoldStarted)
+    {
+        m_bScanHoldStarted=false;
+        return;
+    }
+    if(m_fastScan->isActive())
+        setPlayBackRate(FastScanController::steppedRate(m_fastScan->rate(),nDirection));
+    else
+        seekRelative(nDirection*10000);
+}
+
+void Player::seekRelative(qint64 deltaMs)
+{
+    if(m_timeshift)
+    {
+        seekTimeshiftRelative(deltaMs);
+        return;
+    }
+    if(!m_mediaPlayer->isSeekable())
+        return;
+
+    //前进取目标之后的关键帧，后退取目标之前的关键帧，定位耗时可预期
+    qint64 target=qBound<qint64>(0,m_mediaPlayer->position()+deltaMs,m_mediaPlayer->duration());
+    if(m_keyframeIndex->isReady())
+    {
+        qint64 keyframe=deltaMs>0?m_keyframeIndex->nextKeyframe(target):m_keyframeIndex->previousKeyframe(target);
+        if(keyframe>=0)
+            target=keyframe;
+    }
+    m_seekScheduler->exactSeek(target);
+    seekSyncStreams(target);
+}
+
 void Player::setVolume(int volume)
 {
-    m_audioOutput->setVolume(volume/100.0);
+    //均衡增益叠加在用户音量上；均衡时满音量对应低于满幅的参考电平，安静的文件也能提升
+    m_audioOutput->setVolume(qMin(1.0,volume/100.0*m_dLoudnessGain));
     //更新音量图标
     //Qt5存在但Qt6不存在QStyle::SP_MediaVolumeLow 和 QStyle::SP_MediaVolumeHigh，暂时没找到低中高音量的图标，到时候有了素材可以替换。
     if(volume == 0)
@@ -413,10 +857,10 @@ void Player::togglePlaylist()
     ui->PlaylistButton->setIcon(style()->standardIcon(m_playlistDock->isVisible()?QStyle::SP_FileDialogDetailedView : QStyle::SP_FileDialogListView));
 }
 
-void Player::playlistItemDoubleClicked(QListWidgetItem *item)
+void Player::playlistItemDoubleClicked(const QModelIndex &index)
 {
     //播放视频文件方法 双击播放
-    playFile(item->data(Qt::UserRole).toString());
+    playFile(index.data(PlaylistModel::FilePathRole).toString());
 
 }
 
@@ -441,8 +885,14 @@ void Player::createMenus()
     //槽函数连接
     connect(removeFromPlaylistAct,&QAction::triggered,this,&Player::removeFromPlaylist);
 
+    //多路同步播放
+    QAction *openSyncAct = new QAction("同步播放多个文件(&S)",this);
+    openSyncAct->setStatusTip("多个文件锁定到同一时钟并排播放");
+    connect(openSyncAct,&QAction::triggered,this,&Player::openSyncFiles);
+
     //将动作添加到文件菜单
     fileMenu->addAction(openAct);
+    fileMenu->addAction(openSyncAct);
     fileMenu->addAction(addToPlaylistAct);
     fileMenu->addAction(removeFromPlaylistAct);
     fileMenu->addSeparator();
@@ -450,7 +900,7 @@ void Player::createMenus()
     QMenu *historyMenu = fileMenu->addMenu("播放历史(&H)");
     connect(historyMenu,&QMenu::aboutToShow,this,[this,historyMenu](){
         historyMenu->clear();
-        if(m_playHistory.isEmpty())
+        if(m_historyStore->isEmpty())
         {
             QAction *emptyAct = historyMenu->addAction("暂无播放历史记录");
             emptyAct->setEnabled(false);
@@ -458,17 +908,14 @@ void Player::createMenus()
         else
         {
             //添加最近播放文件
-            for (const auto &history:m_playHistory)
+            for (const auto &history:m_historyStore->recent(30))
             {
                 QString timeStr=history.playTime.toString("yyyy-MM-dd hh::mm");
                 QString text=QString("%1(%2)").arg(history.fileName,timeStr);
                 QAction *action=historyMenu->addAction(text);
                 connect(action,&QAction::triggered,this,[this,history](){
+                    //playFile会从续播表恢复上次播放位置
                     playFile(history.filePath);
-                    //恢复上次播放位置
-                    QTimer::singleShot(100,this,[this,history](){
-                        m_mediaPlayer->setPosition(history.lastPostion);
-                    });
                 });
             }
             historyMenu->addSeparator();
@@ -487,8 +934,7 @@ void Player::createMenus()
         recentStreamsMenu->clear();
         for(const QString &url:m_recentStreams){
             recentStreamsMenu->addAction(url,[=](){
-                m_mediaPlayer->setSource(QUrl(url));
-                m_mediaPlayer->play();
+                playStream(url);
             });
         }
 
@@ -506,6 +952,86 @@ void Player::createMenus()
     streamMenu->addSeparator();
     streamMenu->addMenu(recentStreamsMenu);
 
+    //预缓冲：HTTP流先拉进内存缓冲再交给播放器，抖动的链路上少卡顿
+    QMenu *prebufferMenu = streamMenu->addMenu("预缓冲(&B)");
+    QAction *prebufferAct = prebufferMenu->addAction("启用预缓冲(&E)");
+    prebufferAct->setCheckable(true);
+    prebufferAct->setChecked(m_bStreamPrebuffer);
+    prebufferAct->setStatusTip("适用于直播流，下一个打开的网络流起生效；预缓冲只能顺序读取，点播文件不能拖动；HLS/DASH清单不经预缓冲");
+    connect(prebufferAct,&QAction::toggled,this,[this](bool bChecked){m_bStreamPrebuffer=bChecked;});
+    prebufferMenu->addSeparator();
+    QActionGroup *bufferDepthGroup = new QActionGroup(this);
+    for(int nMegaBytes:{2,8,32})
+    {
+        QAction *action = prebufferMenu->addAction(QString("缓冲深度%1MB").arg(nMegaBytes));
+        action->setCheckable(true);
+        action->setData(qint64(nMegaBytes)*1024*1024);
+        action->setChecked(action->data().toLongLong()==m_nStreamBufferBytes);
+        bufferDepthGroup->addAction(action);
+    }
+    connect(bufferDepthGroup,&QActionGroup::triggered,this,[this](QAction *action){
+        m_nStreamBufferBytes=action->data().toLongLong();
+    });
+
+    //时移：直播录制到磁盘循环文件，可以暂停、后退、拖动，再回到直播
+    QMenu *timeshiftMenu = streamMenu->addMenu("时移(&T)");
+    QAction *timeshiftAct = timeshiftMenu->addAction("录制直播以便时移(&E)");
+    timeshiftAct->setCheckable(true);
+    timeshiftAct->setChecked(m_bTimeshift);
+    timeshiftAct->setStatusTip("下一个打开的HTTP网络流起生效，启用后不再经预缓冲");
+    connect(timeshiftAct,&QAction::toggled,this,[this](bool bChecked){m_bTimeshift=bChecked;});
+    QActionGroup *timeshiftSizeGroup = new QActionGroup(this);
+    for(int nMegaBytes:{256,1024,4096})
+    {
+        QAction *action = timeshiftMenu->addAction(nMegaBytes<1024?QString("录制上限%1MB").arg(nMegaBytes):QString("录制上限%1GB").arg(nMegaBytes/1024));
+        action->setCheckable(true);
+        action->setData(qint64(nMegaBytes)*1024*1024);
+        action->setChecked(action->data().toLongLong()==m_nTimeshiftBytes);
+        timeshiftSizeGroup->addAction(action);
+    }
+    connect(timeshiftSizeGroup,&QActionGroup::triggered,this,[this](QAction *action){
+        m_nTimeshiftBytes=action->data().toLongLong();
+    });
+    timeshiftMenu->addSeparator();
+    timeshiftMenu->addAction("暂停/继续(&P)",this,[this](){
+        if(m_mediaPlayer->playbackState()==QMediaPlayer::PlayingState)
+            m_mediaPlayer->pause();
+        else
+            m_mediaPlayer->play();
+    });
+    timeshiftMenu->addAction("后退10秒(&B)",this,[this](){seekTimeshiftRelative(-10000);});
+    timeshiftMenu->addAction("前进10秒(&F)",this,[this](){seekTimeshiftRelative(10000);});
+    timeshiftMenu->addAction("回到直播(&L)",this,&Player::goLive);
+
+    //媒体库：监视目录的增删和手动核对
+    QMenu *libraryMenu = fileMenu->addMenu("媒体库(&L)");
+    connect(libraryMenu,&QMenu::aboutToShow,this,[this,libraryMenu](){
+        libraryMenu->clear();
+        libraryMenu->addAction(m_libraryDock->toggleViewAction());
+        libraryMenu->addSeparator();
+        libraryMenu->addAction("添加目录(&A)...",this,[this](){
+            QString dirPath=QFileDialog::getExistingDirectory(this,"添加媒体库目录");
+            if(dirPath.isEmpty())
+                return;
+            m_mediaLibrary->addRoot(dirPath);
+            m_libraryDock->show();
+        });
+        QMenu *removeMenu = libraryMenu->addMenu("移除目录(&R)");
+        removeMenu->setEnabled(!m_mediaLibrary->roots().isEmpty());
+        for(const QString &root:m_mediaLibrary->roots())
+            removeMenu->addAction(root,this,[this,root](){m_mediaLibrary->removeRoot(root);});
+        QAction *rescanAct = libraryMenu->addAction("立即核对(&S)",m_mediaLibrary,&MediaLibrary::rescan);
+        rescanAct->setEnabled(!m_mediaLibrary->roots().isEmpty() && !m_mediaLibrary->isScanning());
+    });
+
+    //导出帧序列
+    QMenu *exportMenu = fileMenu->addMenu("导出帧序列(&E)");
+    exportMenu->addAction("设为入点(I)",this,[this](){markInOut(false);});
+    exportMenu->addAction("设为出点(O)",this,[this](){markInOut(true);});
+    exportMenu->addAction("清除入出点",this,[this](){ui->progressSlider->clearInOut();});
+    exportMenu->addSeparator();
+    exportMenu->addAction("导出(&E)...",this,&Player::exportFrameRange);
+
     //二、播放菜单
     QMenu *playMenu = ui->menubar->addMenu("播放(&P)");
     m_playbackRateMenu = playMenu->addMenu("播放速度(&R)");
@@ -535,12 +1061,85 @@ void Player::createMenus()
         setPlayMode(static_cast<PlayMode>(action->data().toInt()));
     });
 
-    ///////////
+    //关键帧索引就绪后，单击进度条可对齐到最近的关键帧（定位最快）
+    QAction *snapAct = playMenu->addAction("定位对齐关键帧(&K)");
+    snapAct->setCheckable(true);
+    snapAct->setChecked(m_bSnapToKeyframe);
+    snapAct->setStatusTip("单击进度条时定位到最近的关键帧，不必从关键帧解码到目标位置");
+    connect(snapAct,&QAction::toggled,this,[this](bool bChecked){m_bSnapToKeyframe=bChecked;});
+
+    //音频波形
+    QAction *waveformAct = playMenu->addAction("显示音频波形(&W)");
+    waveformAct->setCheckable(true);
+    waveformAct->setChecked(m_bShowWaveform);
+    waveformAct->setStatusTip("在进度条背后显示整个文件的音频峰值和响度，便于定位声音事件");
+    connect(waveformAct,&QAction::toggled,this,[this](bool bChecked){
+        m_bShowWaveform=bChecked;
+        m_waveformAnalyzer->setFile(QString(),0);
+        if(bChecked && !m_strCurrentFile.isEmpty())
+            m_waveformAnalyzer->setFile(m_strCurrentFile,m_mediaPlayer->duration());
+    });
 
+    //响度均衡
+    QAction *loudnessAct = playMenu->addAction("响度均衡(&L)");
+    loudnessAct->setCheckable(true);
+    loudnessAct->setChecked(m_bNormalizeLoudness);
+    loudnessAct->setStatusTip(QString("按后台分析的EBU R128响度把各文件调整到%1 LUFS，切换条目时生效").arg(LoudnessAnalyzer::kTargetLufs));
+    connect(loudnessAct,&QAction::toggled,this,[this](bool bChecked){
+        m_bNormalizeLoudness=bChecked;     //播放中不改音量，切换条目时生效
+    });
 
+    //倒放帧池：越大GOP越长的文件越少重复解码，内存占用按显示尺寸的RGB图像计
+    QMenu *reverseBudgetMenu = playMenu->addMenu("倒放帧缓存(&V)");
+    QActionGroup *reverseBudgetGroup = new QActionGroup(this);
+    for(int nFrames:{32,64,128,256})
+    {
+        QAction *action = reverseBudgetMenu->addAction(QString("%1帧").arg(nFrames));
+        action->setCheckable(true);
+        action->setData(nFrames);
+        action->setChecked(nFrames==m_nReverseFrameBudget);
+        reverseBudgetGroup->addAction(action);
+    }
+    connect(reverseBudgetGroup,&QActionGroup::triggered,this,[this](QAction *action){
+        m_nReverseFrameBudget=action->data().toInt();
+        m_reversePlayer->setFrameBudget(m_nReverseFrameBudget);
+    });
 
+    //预读缓冲：慢速磁盘、网络挂载的本地文件经后台预读播放
+    QMenu *readAheadMenu = playMenu->addMenu("预读缓冲(&B)");
+    QAction *readAheadAct = readAheadMenu->addAction("启用预读(&E)");
+    readAheadAct->setCheckable(true);
+    readAheadAct->setChecked(m_bReadAhead);
+    readAheadAct->setStatusTip("下一个打开的本地文件起生效");
+    connect(readAheadAct,&QAction::toggled,this,[this](bool bChecked){m_bReadAhead=bChecked;});
+    readAheadMenu->addSeparator();
+    QActionGroup *readAheadGroup = new QActionGroup(this);
+    for(int nMegaBytes:{8,32,128})
+    {
+        QAction *action = readAheadMenu->addAction(QString("预读%1MB").arg(nMegaBytes));
+        action->setCheckable(true);
+        action->setData(qint64(nMegaBytes)*1024*1024);
+        action->setChecked(action->data().toLongLong()==m_nReadAheadBytes);
+        readAheadGroup->addAction(action);
+    }
+    connect(readAheadGroup,&QActionGroup::triggered,this,[this](QAction *action){
+        m_nReadAheadBytes=action->data().toLongLong();
+    });
 
-    //三、帮助菜单
+    //三、诊断菜单
+    QMenu *diagnosticsMenu = ui->menubar->addMenu("诊断(&D)");
+    QAction *frameTimingAct = diagnosticsMenu->addAction("帧时序监视(&T)");
+    frameTimingAct->setCheckable(true);
+    frameTimingAct->setStatusTip("记录每一帧的到达时刻、抖动、迟到和丢帧，统计显示在视频区域");
+    connect(frameTimingAct,&QAction::toggled,this,&Player::toggleFrameTiming);
+    diagnosticsMenu->addSeparator();
+    diagnosticsMenu->addAction("导出帧时序(CSV)...",this,[this](){exportFrameTiming(false);});
+    diagnosticsMenu->addAction("导出帧时序(Chrome Trace)...",this,[this](){exportFrameTiming(true);});
+    diagnosticsMenu->addSeparator();
+    diagnosticsMenu->addAction("预读缓冲统计(&R)",this,&Player::showReadAheadStats);
+    diagnosticsMenu->addAction("定位统计(&S)",this,&Player::showSeekStats);
+
+    //四、帮助菜单
 
 }
 
@@ -550,121 +1149,150 @@ void Player::openFile()
 
     if(!fileNames.isEmpty())
     {
-        //添加到播放列表
-        for(const QString &fileName:fileNames)
-        {
-            QListWidgetItem *item=new QListWidgetItem(QFileInfo(fileName).fileName());
-            item->setData(Qt::UserRole,fileName);
-            m_playlistWidget->addItem(item);
-        }
+        //添加到播放列表（已存在的文件不重复添加）
+        m_playlistModel->appendPaths(fileNames);
         //自动保存到默认播放列表
+        m_playlistJournal->recordAdd(fileNames);
         saveDefaultPlaylist();
 
-        //播放第一个媒体文件
+        //播放第一个媒体文件（playFile会高亮对应行）
         playFile(fileNames.first());
 
-        m_playlistWidget->setCurrentRow(m_playlistWidget->count()-fileNames.size());
+    }
+}
 
+void Player::openSyncFiles()
+{
+    QStringList fileNames = QFileDialog::getOpenFileNames(this,"选择要同步播放的文件","","媒体文件(*.mp4 *.avi *.mkv);;所有文件(*.*)");
+    if(fileNames.size()<2)
+    {
+        if(!fileNames.isEmpty())
+            QMessageBox::information(this,"提示","同步播放至少需要选择两个文件");
+        return;
     }
+
+    //同一时间只保留一个同步播放窗口
+    if(m_syncWindow)
+        m_syncWindow->close();
+
+    m_syncWindow = new SyncPlayerWindow(fileNames,this);
+    m_syncWindow->controller()->setPlaybackRate(m_mediaPlayer->playbackRate());
+    m_syncWindow->show();
 }
 
 void Player::playFile(const QString& filePath)
 {
     if(!filePath.isEmpty())
     {
-        m_mediaPlayer->setSource(QUrl::fromLocalFile(filePath));
-
-        //恢复上次播放位置
-        if(m_lastPositions.contains(filePath))
+        //离开上一个文件前记下它的播放位置
+        saveCurrentHistoryPosition();
+        m_strCurrentFile=filePath;
+
+        //恢复上次播放位置（跨会话），媒体加载完成后再定位
+        m_nCurrentResumeId=m_resumeStore->intern(filePath);
+        m_nPendingResume=m_resumeStore->position(m_nCurrentResumeId);
+        m_resumeSampleTimer.invalidate();
+        m_bPrerollRequested=false;
+        m_nPredictedNextRow=-1;
+
+        //先让网络流的预缓冲和时移停止阻塞读取，后端才能顺利换源
+        m_fastScan->stop(false);
+        m_reversePlayer->stop();
+        releaseStreamBuffer();
+        releaseTimeshift();
+        ui->progressSlider->clearInOut();
+        ui->progressSlider->setKeyframes({});
+        m_keyframeIndex->setFile(filePath);
+        m_waveformAnalyzer->setFile(QString(),0);   //时长确定后再分析新文件
+
+        //预加载器已经准备好这个文件就直接换上，否则照常打开
+        if(!switchToPrerolledPlayer(filePath))
         {
-            m_mediaPlayer->setPosition(m_lastPositions[filePath]);
+            m_preroller->cancel();
+            setLocalSource(filePath);
         }
-        m_mediaPlayer->play();
+        m_thumbnailProvider->setSource(filePath);
+        applyLoudnessGain(filePath,true);   //查到增益后再开始播放
 
         setWindowTitle("FrameSync视频播放器 - "+QFileInfo(filePath).fileName());
 
-        //当前播放项高亮显示
-        for(int i=0;i<m_playlistWidget->count();i++)
-        {
-            QListWidgetItem *item = m_playlistWidget->item(i);
-            if(item->data(Qt::UserRole).toString() == filePath)
-            {
-                m_playlistWidget->setCurrentItem(item);
-                break;
-            }
-        }
+        //当前播放项高亮显示（哈希索引查行号）
+        int nRow=m_playlistModel->rowOf(filePath);
+        if(nRow>=0)
+            setCurrentPlaylistRow(nRow);
 
         //添加到历史记录
         addToHistory(filePath);
     }
 }
 
-void Player::saveDefaultPlaylist()
+void Player::applyLoudnessGain(const QString &filePath,bool bPlay)
 {
-    QFile file(m_strDefaultPlaylistFile);
-    if(file.open(QIODevice::WriteOnly|QIODevice::Text))
+    //增益在开始播放前确定，播放中不再改变，避免先按原音量响一下再跳变
+    //没有分析结果的文件按参考电平播放，和均衡到目标响度的文件大致同一档
+    m_strLoudnessFile.clear();
+    m_bPlayAfterLoudness=false;
+    if(!m_bNormalizeLoudness || filePath.isEmpty())
     {
-        QTextStream out(&file);
-        for(int i = 0;i < m_playlistWidget->count();i++)
-        {
-            out<<m_playlistWidget->item(i)->data(Qt::UserRole).toString()<<"\n";
-        }
+        m_dLoudnessGain=1.0;
+        setVolume(ui->volumeSlider->value());
+        if(bPlay)
+            m_mediaPlayer->play();
     }
+    else
+    {
+        m_strLoudnessFile=filePath;
+        m_bPlayAfterLoudness=bPlay;
+        m_loudnessAnalyzer->lookup(filePath);
+    }
+
+    //当前文件和随后几项插到分析队列最前面，连续播放时下一项大多已有结果
+    if(filePath.isEmpty())
+        return;
+    QStringList upcoming{filePath};
+    int nRow=m_playlistModel->rowOf(filePath);
+    for(int row=nRow+1;nRow>=0 && row<=nRow+5 && row<m_playlistModel->rowCount();row++)
+        upcoming.append(m_playlistModel->filePath(row));
+    m_loudnessAnalyzer->prioritize(upcoming);
 }
 
-void Player::clearHistory()
+void Player::saveDefaultPlaylist()
 {
-    if(QMessageBox::question(this,"确认","是否要清除所有播放记录？")==QMessageBox::Yes)
+    //编辑本身已经写入日志，这里只在日志足够大时把它整理成快照
+    //加载尚未完成时整理会丢掉未加载的条目，推迟到加载完成
+    if(m_playlistLoader->isLoading())
     {
-        m_playHistory.clear();
-        //保存播放历史记录
-        savePlayHistory();
+        m_bPlaylistSavePending=true;
+        return;
     }
+
+    if(m_playlistJournal->needsCompaction())
+        m_playlistJournal->compact(m_playlistModel->filePaths());
 }
 
-void Player::savePlayHistory()
+void Player::clearHistory()
 {
-    QFile file(m_strHistoryFile);
-    if(file.open(QIODevice::WriteOnly))
+    if(QMessageBox::question(this,"确认","是否要清除所有播放记录？")==QMessageBox::Yes)
     {
-        QDataStream out(&file);
-        out.setVersion(QDataStream::Qt_6_0);
-        out<<qint32(m_playHistory.size());
+        m_historyStore->clear();
     }
 }
 
 void Player::addToHistory(const QString &filePath)
 {
-    //检查是否已经存在
-    auto it= std::find_if(m_playHistory.begin(),m_playHistory.end(),
-                           [&filePath](const PlayHistory &h)
-                            {return h.filePath == filePath;});
-
-    PlayHistory history;
-    history.filePath=filePath;
-    history.fileName=QFileInfo(filePath).fileName();
-    history.playTime=QDateTime::currentDateTime();
-    history.duration=m_mediaPlayer->duration();
-    history.lastPostion=m_mediaPlayer->position();
-
-    if(it != m_playHistory.end())
-    {
-        //更新现有记录
-        *it=history;
-    }
-    else
-    {
-        //添加新记录
-        m_playHistory.prepend(history);
+    //哈希查找已有记录，写入由存储合并后在后台完成
+    m_historyStore->record(filePath);
+}
 
-        //限制历史记录数量
-        while (m_playHistory.size()>30) {
-            m_playHistory.removeLast();
-        }
-    }
+void Player::saveCurrentHistoryPosition()
+{
+    //此时播放器仍是当前文件，位置和时长才有意义
+    if(m_historyStore && !m_strCurrentFile.isEmpty())
+        m_historyStore->updatePosition(m_strCurrentFile,m_mediaPlayer->position(),m_mediaPlayer->duration());
 
-    //调用保存历史记录
-    savePlayHistory();
+    //已经播完的文件不覆盖“从头开始”
+    if(m_resumeStore && m_nCurrentResumeId>=0 && m_mediaPlayer->mediaStatus()!=QMediaPlayer::EndOfMedia)
+        m_resumeStore->setPosition(m_nCurrentResumeId,m_mediaPlayer->position());
 }
 
 void Player::addToPlaylist()
@@ -677,10 +1305,7 @@ void Player::addToPlaylist()
         if(file.open(QIODevice::WriteOnly|QIODevice::Text))
         {
             QTextStream out(&file);
-            for(int i=0;i<m_playlistWidget->count();i++)
-            {
-                out << m_playlistWidget->item(i)->data(Qt::UserRole).toString()<<"\n";
-            }
+            out<<m_playlistModel->filePaths().join("\n")<<"\n";
             m_strCurrentPlaylistFile = fileName;
         }
     }
@@ -688,11 +1313,18 @@ void Player::addToPlaylist()
 
 void Player::removeFromPlaylist()
 {
-    QList<QListWidgetItem*> items = m_playlistWidget->selectedItems();
-    for(QListWidgetItem* item:items)
+    QList<int> rows;
+    QStringList filePaths;
+    for(const QModelIndex &index:m_playlistView->selectionModel()->selectedRows())
     {
-        delete m_playlistWidget->takeItem(m_playlistWidget->row(item));
+        int nRow=m_playlistProxy->mapToSource(index).row();
+        rows.append(nRow);
+        filePaths.append(m_playlistModel->filePath(nRow));
     }
+    if(rows.isEmpty())
+        return;
+    m_playlistModel->removeRowList(rows);
+    m_playlistJournal->recordRemove(filePaths);
 
     //自动保存到默认播放列表
     saveDefaultPlaylist();
@@ -701,23 +1333,9 @@ void Player::removeFromPlaylist()
 
 void Player::loadDefaultPlaylist()
 {
-    QFile file(m_strDefaultPlaylistFile);
-
-    if(file.open(QIODevice::ReadOnly|QIODevice::Text))
-    {
-        m_playlistWidget->clear();
-        QTextStream in(&file);
-        while(!in.atEnd())
-        {
-            QString filePath = in.readLine().trimmed();
-            if(!filePath.isEmpty() && QFile::exists(filePath))
-            {
-                QListWidgetItem *item = new QListWidgetItem(QFileInfo(filePath).fileName());
-                item->setData(Qt::UserRole,filePath);
-                m_playlistWidget->addItem(item);
-            }
-        }
-    }
+    //即使快照不存在，日志里也可能有记录
+    m_playlistModel->clear();
+    m_playlistLoader->load(m_strDefaultPlaylistFile);
 }
 
 void Player::openStreamUrl()
@@ -749,8 +1367,7 @@ void Player::openStreamUrl()
         }
 
         //播放流媒体
-        m_mediaPlayer->setSource(QUrl(url));
-        m_mediaPlayer->play();
+        playStream(url);
 
         //更新播放器界面
         setWindowTitle("FrameSync视频播放器 - " + url);
@@ -786,24 +1403,8 @@ void Player::createPlaybackRateMenu()
 
     m_rateGroup = new QActionGroup(this);
 
-    // 定义局部结构体（仅在函数内可见）
-    struct RateOption {
-        QString displayText;
-        double rateValue;
-    };
-
-    // 使用结构体初始化向量
-    QVector<RateOption> rateOptions = {
-        {"0.5x", 0.5},
-        {"0.75x", 0.75},
-        {"1.0x(正常)", 1.0},  // 恢复"正常"标注
-        {"1.25x", 1.25},
-        {"1.5x", 1.5},
-        {"2.0x", 2.0}
-    };
-
-    // 使用基于范围的for循环（更清晰）
-    for (const auto& option : rateOptions) {
+    // 速率表与性能测试程序共用（PlaybackRates.h）
+    for (const auto& option : playbackRateOptions()) {
         QAction* rateAct = new QAction(option.displayText, this);
         rateAct->setData(option.rateValue);
         rateAct->setCheckable(true);
@@ -817,6 +1418,25 @@ void Player::createPlaybackRateMenu()
         m_playbackRateMenu->addAction(rateAct);
     }
 
+    // 倒放和快速浏览只对主播放器有效，与普通速率同组互斥
+    m_playbackRateMenu->addSection("倒放");
+    for (const auto& option : reversePlaybackRateOptions()) {
+        QAction* rateAct = new QAction(option.displayText, this);
+        rateAct->setData(option.rateValue);
+        rateAct->setCheckable(true);
+        m_rateGroup->addAction(rateAct);
+        m_playbackRateMenu->addAction(rateAct);
+    }
+
+    m_playbackRateMenu->addSection("快速浏览（仅关键帧）");
+    for (const auto& option : fastScanRateOptions()) {
+        QAction* rateAct = new QAction(option.displayText, this);
+        rateAct->setData(option.rateValue);
+        rateAct->setCheckable(true);
+        m_rateGroup->addAction(rateAct);
+        m_playbackRateMenu->addAction(rateAct);
+    }
+
     connect(m_rateGroup, &QActionGroup::triggered, this, [this](QAction* action) {
         setPlayBackRate(action->data().toDouble());
     });
@@ -825,29 +1445,614 @@ void Player::createPlaybackRateMenu()
 void Player::setPlayMode(PlayMode mode)
 {
     m_playMode=mode;
+    m_nPredictedNextRow=-1;
+    m_bPrerollRequested=false;
     updatePlayModeIcon();
 }
 
+void Player::checkRateAction(double rate)
+{
+    if(!m_rateGroup)
+        return;
+    for(QAction *action:m_rateGroup->actions())
+    {
+        if(qFuzzyCompare(action->data().toDouble(),rate))
+            action->setChecked(true);
+    }
+}
+
 void Player::setPlayBackRate(double rate)
 {
+    //4x以上改为关键帧快速浏览，后端保持原速率
+    if(FastScanController::isScanRate(rate))
+    {
+        m_reversePlayer->stop();
+        if(m_timeshift || !m_fastScan->start(rate))
+            checkRateAction(m_fastScan->isActive()?m_fastScan->rate():m_mediaPlayer->playbackRate());
+        return;
+    }
+
+    //负速率为倒放，帧按视频区域的像素尺寸保存
+    if(ReversePlayer::isReverseRate(rate))
+    {
+        m_fastScan->stop(false);
+        if(m_timeshift || !m_reversePlayer->start(rate,m_videoWidget->size()*m_videoWidget->devicePixelRatioF()))
+            checkRateAction(m_reversePlayer->isActive()?m_reversePlayer->rate():m_mediaPlayer->playbackRate());
+        return;
+    }
+
     if(m_mediaPlayer)
     {
         m_mediaPlayer->setPlaybackRate(rate);
     }
+    m_fastScan->stop();
+    m_reversePlayer->stop(true);    //从倒放切回正向速率时接着播放
+
+    //同步播放窗口打开时，速率同时作用到所有流
+    if(m_syncWindow)
+    {
+        m_syncWindow->controller()->setPlaybackRate(rate);
+    }
+
+    //速率变化后理想帧间隔随之变化
+    m_frameTimingMonitor->setPlaybackRate(rate);
+}
+
+void Player::toggleFrameTiming(bool bEnabled)
+{
+    if(bEnabled)
+    {
+        if(m_rateGroup && m_rateGroup->checkedAction())
+            m_frameTimingMonitor->setPlaybackRate(m_rateGroup->checkedAction()->data().toDouble());
+        m_frameTimingMonitor->start();
+    }
+    else
+    {
+        m_frameTimingMonitor->stop();
+    }
+    m_frameTimingOverlay->setOverlayEnabled(bEnabled);
+}
+
+void Player::exportFrameTiming(bool bChromeTrace)
+{
+    if(m_frameTimingMonitor->sampleCount()==0)
+    {
+        QMessageBox::information(this,"导出帧时序","还没有记录到帧时序数据，请先在诊断菜单中打开帧时序监视。");
+        return;
+    }
+
+    QString fileName = bChromeTrace
+            ? QFileDialog::getSaveFileName(this,"导出帧时序","frame_timing.json","Chrome Trace(*.json)")
+            : QFileDialog::getSaveFileName(this,"导出帧时序","frame_timing.csv","CSV文件(*.csv)");
+    if(fileName.isEmpty())
+        return;
+
+    bool bOK = bChromeTrace ? m_frameTimingMonitor->exportChromeTrace(fileName)
+                            : m_frameTimingMonitor->exportCsv(fileName);
+    if(bOK)
+        statusBar()->showMessage(QString("已导出%1帧的时序数据到%2").arg(m_frameTimingMonitor->sampleCount()).arg(fileName),5000);
+    else
+        QMessageBox::warning(this,"导出帧时序","无法写入文件："+fileName);
+}
+
+void Player::markInOut(bool bOut)
+{
+    //时移期间进度条表示回看窗口，不是文件时间
+    if(m_strCurrentFile.isEmpty() || m_timeshift)
+        return;
+
+    int nPosition=int(m_mediaPlayer->position());
+    ClickableSlider *slider=ui->progressSlider;
+    if(bOut)
+    {
+        slider->setOutPoint(nPosition);
+        if(slider->inPoint()>=nPosition)
+            slider->setInPoint(-1);
+    }
+    else
+    {
+        slider->setInPoint(nPosition);
+        if(slider->outPoint()>=0 && slider->outPoint()<=nPosition)
+            slider->setOutPoint(-1);
+    }
+    statusBar()->showMessage(QString("%1：%2").arg(bOut?"出点":"入点",formatTime(nPosition)),3000);
+}
+
+void Player::exportFrameRange()
+{
+    if(m_strCurrentFile.isEmpty())
+    {
+        QMessageBox::information(this,"导出帧序列","只能导出本地文件。");
+        return;
+    }
+    if(m_frameExporter->isRunning())
+    {
+        if(m_exportProgress)
+            m_exportProgress->raise();
+        return;
+    }
+
+    //只设了一端时另一端取文件开头或结尾
+    ClickableSlider *slider=ui->progressSlider;
+    qint64 nIn=qMax(0,slider->inPoint());
+    qint64 nOut=slider->outPoint()>=0?slider->outPoint():m_mediaPlayer->duration();
+    if(nOut<=nIn)
+    {
+        QMessageBox::information(this,"导出帧序列","请先用I、O键在进度条上标记入点和出点。");
+        return;
+    }
+
+    const QStringList formats{"PNG","JPEG","原始RGB32"};
+    bool bOK=false;
+    QString format=QInputDialog::getItem(this,"导出帧序列","图像格式：",formats,0,false,&bOK);
+    if(!bOK)
+        return;
+    QString dir=QFileDialog::getExistingDirectory(this,"选择输出目录",QFileInfo(m_strCurrentFile).absolutePath());
+    if(dir.isEmpty())
+        return;
+
+    FrameExporter::Options options;
+    options.filePath=m_strCurrentFile;
+    options.inMs=nIn;
+    options.outMs=nOut;
+    options.outputDir=dir;
+    options.prefix=QFileInfo(m_strCurrentFile).completeBaseName();
+    options.format=FrameExporter::Format(formats.indexOf(format));
+
+    //同名文件会被逐个覆盖，先确认
+    QStringList existing=FrameExporter::existingFiles(options);
+    if(!existing.isEmpty())
+    {
+        QString text=QString("输出目录中已有%1个同名文件（如%2），导出时会被覆盖。是否继续？").arg(existing.size()).arg(existing.first());
+        if(QMessageBox::question(this,"导出帧序列",text)!=QMessageBox::Yes)
+            return;
+    }
+    if(!m_frameExporter->start(options))
+    {
+        QMessageBox::warning(this,"导出帧序列",m_frameExporter->errorString());
+        return;
+    }
+
+    m_exportProgress=new QProgressDialog(QString("正在导出%1 - %2").arg(formatTime(nIn),formatTime(nOut)),"取消",0,1000,this);
+    m_exportProgress->setWindowTitle("导出帧序列");
+    m_exportProgress->setAttribute(Qt::WA_DeleteOnClose);
+    m_exportProgress->setAutoClose(false);
+    m_exportProgress->setAutoReset(false);
+    m_exportProgress->setMinimumDuration(0);
+    connect(m_exportProgress,&QProgressDialog::canceled,m_frameExporter,&FrameExporter::cancel);
+    m_exportProgress->show();
+}
+
+void Player::updateExportProgress(const FrameExporter::Stats &stats)
+{
+    if(!m_exportProgress)
+        return;
+    m_exportProgress->setValue(int(stats.progress*1000));
+    m_exportProgress->setLabelText(QString("已写出%1帧（编码中%2）  %3帧/秒  %4MB/秒")
+                                   .arg(stats.written)
+                                   .arg(stats.queued)
+                                   .arg(stats.framesPerSecond,0,'f',1)
+                                   .arg(stats.bytesPerSecond/(1024*1024),0,'f',1));
 }
 
 void Player::playNext()
 {
-    if(m_playlistWidget->count()>0)
+    int nNextRow = nextPlaylistRow();
+    if(nNextRow>=0)
     {
-        int nNextRow = m_playlistWidget->currentRow()+1;
-        if(nNextRow>=m_playlistWidget->count())
-            nNextRow=m_playMode==Loop?0:-1;
+        playFile(m_playlistModel->filePath(nNextRow));
+    }
+}
 
-        if(nNextRow>=0)
-        {
-            m_playlistWidget->setCurrentRow(nNextRow);
-            playFile(m_playlistWidget->currentItem()->data(Qt::UserRole).toString());
-        }
+int Player::nextPlaylistRow()
+{
+    int nCount=m_playlistModel->rowCount();
+    if(nCount==0)
+        return -1;
+
+    //随机模式下预测结果要保留，预加载的和真正播放的必须是同一项
+    if(m_nPredictedNextRow>=0 && m_nPredictedNextRow<nCount)
+        return m_nPredictedNextRow;
+
+    //按视图中（排序、筛选后）的顺序取下一项，再换算回播放列表的行号
+    int nViewCount=m_playlistProxy->rowCount();
+    if(nViewCount==0)
+        return -1;
+    int nViewRow=-1;
+    switch (m_playMode) {
+    case Random:
+        nViewRow=QRandomGenerator::global()->bounded(nViewCount);
+        break;
+    case SingleLoop:
+        nViewRow=m_playlistView->currentIndex().row();
+        break;
+    default:
+        nViewRow = m_playlistView->currentIndex().row()+1;
+        if(nViewRow>=nViewCount)
+            nViewRow=m_playMode==Loop?0:-1;
+        break;
+    }
+    int nNextRow=nViewRow<0?-1:m_playlistProxy->mapToSource(m_playlistProxy->index(nViewRow,0)).row();
+    m_nPredictedNextRow=nNextRow;
+    return nNextRow;
+}
+
+void Player::prerollNext()
+{
+    //单曲循环只需回到开头，不需要另开一个播放器
+    if(m_playMode==SingleLoop)
+        return;
+
+    int nNextRow=nextPlaylistRow();
+    if(nNextRow<0)
+        return;
+
+    QString filePath=m_playlistModel->filePath(nNextRow);
+    if(filePath==m_strCurrentFile)
+        return;
+    //启用预读时备用播放器同样经预读设备打开，切换后不退回直接读文件
+    m_preroller->preroll(filePath,m_resumeStore->position(m_resumeStore->intern(filePath)),openReadAheadDevice(filePath));
+}
+
+bool Player::switchToPrerolledPlayer(const QString &filePath)
+{
+    if(!m_preroller->isReady(filePath))
+        return false;
+
+    QIODevice *device=nullptr;
+    QMediaPlayer *next=m_preroller->takePlayer(&device);
+    if(!next)
+        return false;
+
+    //旧播放器解除所有连接和输出，新播放器接管窗口的视频和音频输出
+    QMediaPlayer *old=m_mediaPlayer;
+    disconnect(old,nullptr,this,nullptr);
+    disconnect(old,nullptr,m_thumbnailProvider,nullptr);
+    old->pause();
+    old->setVideoOutput(nullptr);
+    old->setAudioOutput(nullptr);
+
+    next->setParent(this);
+    next->setVideoOutput(m_videoWidget);
+    next->setAudioOutput(m_audioOutput);
+    if(m_rateGroup && m_rateGroup->checkedAction())
+        next->setPlaybackRate(m_rateGroup->checkedAction()->data().toDouble());
+
+    m_mediaPlayer=next;
+    connectMediaPlayer();
+    m_frameStepper->setMediaPlayer(m_mediaPlayer);
+    m_seekScheduler->setMediaPlayer(m_mediaPlayer);
+    m_fastScan->setMediaPlayer(m_mediaPlayer);
+    m_reversePlayer->setMediaPlayer(m_mediaPlayer);
+    m_preroller->recycle(old);
+    releaseReadAheadDevice();
+    m_readAheadDevice=qobject_cast<ReadAheadDevice*>(device);
+    if(m_readAheadDevice)
+        m_readAheadDevice->setParent(this);
+
+    //预加载时已经定位到续播位置，时长信号也已经错过，这里手动补上
+    m_nPendingResume=0;
+    updateDuration(m_mediaPlayer->duration());
+    m_thumbnailProvider->setSource(filePath);
+    m_thumbnailProvider->setDuration(m_mediaPlayer->duration());
+    return true;
+}
+
+void Player::setLocalSource(const QString &filePath)
+{
+    ReadAheadDevice *device=openReadAheadDevice(filePath);
+
+    //URL仍然传入，后端据此判断格式
+    if(device)
+        m_mediaPlayer->setSourceDevice(device,QUrl::fromLocalFile(filePath));
+    else
+        m_mediaPlayer->setSource(QUrl::fromLocalFile(filePath));
+
+    //后端已经换源，旧数据源可以释放了
+    releaseReadAheadDevice();
+    m_readAheadDevice=device;
+}
+
+ReadAheadDevice *Player::openReadAheadDevice(const QString &filePath)
+{
+    if(!m_bReadAhead)
+        return nullptr;
+
+    ReadAheadDevice::Options options;
+    options.readAheadBytes=m_nReadAheadBytes;
+    options.cacheBytes=m_nReadAheadBytes*3;
+    ReadAheadDevice *device=new ReadAheadDevice(filePath,options,this);
+    if(!device->open(QIODevice::ReadOnly))
+    {
+        statusBar()->showMessage("预读数据源打开失败，改为直接打开："+device->errorString(),5000);
+        delete device;
+        return nullptr;
+    }
+    return device;
+}
+
+void Player::releaseReadAheadDevice()
+{
+    if(!m_readAheadDevice)
+        return;
+
+    m_readAheadDevice->deleteLater();
+    m_readAheadDevice=nullptr;
+}
+
+void Player::showReadAheadStats()
+{
+    if(!m_readAheadDevice)
+    {
+        statusBar()->showMessage("当前文件未经预读缓冲播放",3000);
+        return;
+    }
+
+    ReadAheadDevice::Stats stats=m_readAheadDevice->stats();
+    qint64 nReads=stats.hitReads+stats.stallReads;
+    statusBar()->showMessage(QString("预读（%1，%2）：命中率%3%，卡顿%4次，平均%5ms，最长%6ms，定位%7次，重试%8次")
+                                 .arg(stats.fileSystem,stats.mapped?"mmap":"后台预读")
+                                 .arg(nReads>0?100.0*stats.hitReads/nReads:100.0,0,'f',1)
+                                 .arg(stats.stallReads)
+                                 .arg(stats.stallReads>0?stats.stallTimeUs/1000.0/stats.stallReads:0.0,0,'f',1)
+                                 .arg(stats.maxStallUs/1000.0,0,'f',1)
+                                 .arg(stats.seeks)
+                                 .arg(stats.retries),10000);
+}
+
+void Player::showSeekStats()
+{
+    SeekScheduler::Stats stats=m_seekScheduler->stats();
+    statusBar()->showMessage(QString("定位：请求%1次，发出%2次（预览%3，精确%4），丢弃%5次，超时%6次，平均耗时%7ms")
+                                 .arg(stats.requested)
+                                 .arg(stats.issued)
+                                 .arg(stats.previewIssued)
+                                 .arg(stats.exactIssued)
+                                 .arg(stats.dropped)
+                                 .arg(stats.timeouts)
+                                 .arg(stats.avgLatencyMs,0,'f',1),10000);
+}
+
+void Player::playStream(const QString &url)
+{
+    saveCurrentHistoryPosition();
+    m_strCurrentFile.clear();
+    m_nCurrentResumeId=-1;
+    m_preroller->cancel();      //不再接着播放列表，预加载的下一项作废
+    m_bPrerollRequested=false;
+    m_nPredictedNextRow=-1;
+    m_fastScan->stop(false);
+    m_reversePlayer->stop();
+    releaseStreamBuffer();
+    releaseTimeshift();
+    ui->progressSlider->clearInOut();
+    ui->progressSlider->setKeyframes({});
+    m_keyframeIndex->setFile(QString());
+    m_waveformAnalyzer->setFile(QString(),0);
+    applyLoudnessGain(QString());
+
+    QUrl streamUrl(url);
+    if(m_bTimeshift && StreamBuffer::canBuffer(streamUrl))
+    {
+        startTimeshift(streamUrl);
+    }
+    else if(m_bStreamPrebuffer && StreamBuffer::canBuffer(streamUrl))
+    {
+        StreamBuffer::Options options;
+        options.capacity=m_nStreamBufferBytes;
+        options.lowWatermark=m_nStreamBufferBytes/2;
+        options.startBytes=qMin<qint64>(512*1024,m_nStreamBufferBytes/8);
+        options.maxStartBytes=m_nStreamBufferBytes/2;
+        m_streamBuffer=new StreamBuffer(streamUrl,options,this);
+        connect(m_streamBuffer,&StreamBuffer::statsChanged,this,&Player::updateStreamStatus);
+        connect(m_streamBuffer,&StreamBuffer::rebufferStarted,this,[this](int nRebuffers){
+            statusBar()->showMessage(QString("网络缓冲不足，正在重新缓冲（第%1次）").arg(nRebuffers),3000);
+        });
+        m_streamBuffer->open(QIODevice::ReadOnly);
+        m_mediaPlayer->setSourceDevice(m_streamBuffer,streamUrl);
+        m_streamStatusLabel->setText("正在连接…");
+        m_streamStatusLabel->show();
+    }
+    else
+    {
+        m_mediaPlayer->setSource(streamUrl);
+    }
+    releaseReadAheadDevice();
+
+    //网络流不提供悬停预览
+    m_thumbnailProvider->setSource(QString());
+    m_mediaPlayer->play();
+}
+
+void Player::startTimeshift(const QUrl &url)
+{
+    m_timeshift=new TimeshiftBuffer(url,m_strTimeshiftFile,m_nTimeshiftBytes,this);
+    m_timeshift->start();
+    m_timeshiftReader=m_timeshift->createReader(0);
+    if(!m_timeshiftReader->open(QIODevice::ReadOnly))
+    {
+        statusBar()->showMessage("时移缓冲创建失败："+m_timeshiftReader->errorString(),5000);
+        releaseTimeshift();
+        m_mediaPlayer->setSource(url);
+        return;
+    }
+    m_mediaPlayer->setSourceDevice(m_timeshiftReader,url);
+    m_streamStatusLabel->setText("正在连接…");
+    m_streamStatusLabel->show();
+    m_timeshiftTimer->start();
+}
+
+void Player::seekTimeshift(qint64 timeMs)
+{
+    if(!m_timeshift)
+        return;
+
+    //换一个读取端从目标位置读，旧的先中止，换源后再删除
+    bool bPaused=m_mediaPlayer->playbackState()==QMediaPlayer::PausedState;
+    TimeshiftReader *old=m_timeshiftReader;
+    if(old)
+        old->abort();
+    m_timeshiftReader=m_timeshift->createReader(timeMs);
+    if(!m_timeshiftReader->open(QIODevice::ReadOnly))
+    {
+        statusBar()->showMessage("时移定位失败："+m_timeshiftReader->errorString(),5000);
+        delete m_timeshiftReader;
+        m_timeshiftReader=nullptr;
+    }
+    else
+    {
+        m_mediaPlayer->setSourceDevice(m_timeshiftReader,m_timeshift->url());
+    }
+    if(old)
+        old->deleteLater();
+
+    if(bPaused)
+        m_mediaPlayer->pause();
+    else
+        m_mediaPlayer->play();
+    updateTimeshiftPosition();
+}
+
+void Player::seekTimeshiftRelative(qint64 deltaMs)
+{
+    if(!m_timeshift || !m_timeshiftReader)
+    {
+        statusBar()->showMessage("当前没有在录制的直播",3000);
+        return;
+    }
+    seekTimeshift(m_timeshiftReader->playheadTime()+deltaMs);
+}
+
+void Player::goLive()
+{
+    if(!m_timeshift)
+    {
+        statusBar()->showMessage("当前没有在录制的直播",3000);
+        return;
+    }
+    //留出一秒数据，起播时不必立刻等网络
+    seekTimeshift(m_timeshift->liveTime()-1000);
+    m_mediaPlayer->play();
+}
+
+void Player::releaseTimeshift()
+{
+    if(!m_timeshift)
+        return;
+
+    //读取端先中止，录制在缓冲删除时停止，循环文件随之删除
+    m_timeshiftTimer->stop();
+    if(m_timeshiftReader)
+        m_timeshiftReader->abort();
+    m_timeshiftReader=nullptr;
+    m_timeshift->deleteLater();
+    m_timeshift=nullptr;
+    m_nTimeshiftSeekTarget=-1;
+    m_streamStatusLabel->hide();
+}
+
+void Player::updateTimeshiftPosition()
+{
+    if(!m_timeshift)
+        return;
+
+    TimeshiftBuffer::Stats stats=m_timeshift->stats();
+    qint64 oldest=m_timeshift->oldestTime();
+    qint64 live=m_timeshift->liveTime();
+    qint64 playhead=m_timeshiftReader?m_timeshiftReader->playheadTime():live;
+    qint64 behindMs=qMax<qint64>(0,live-playhead);
+
+    if(!ui->progressSlider->isSliderDown())
+    {
+        ui->progressSlider->setRange(0,int(live-oldest));
+        ui->progressSlider->setValue(int(playhead-oldest));
+    }
+    ui->currentTimeLabel->setText(behindMs<2000?"直播":"-"+formatTime(behindMs));
+    ui->totalTimeLabel->setText(formatTime(stats.windowMs));
+
+    QString text;
+    if(stats.state==TimeshiftBuffer::Failed)
+        text="时移录制中断："+stats.errorString;
+    else if(stats.state==TimeshiftBuffer::Finished)
+        text=QString("直播已结束，可回看%1").arg(formatTime(stats.windowMs));
+    else
+        text=QString("时移 可回看%1 录制%2KB/s 已用%3/%4MB")
+                   .arg(formatTime(stats.windowMs))
+                   .arg(stats.bitRate/1024.0,0,'f',0)
+                   .arg(qMin(stats.written,stats.capacity)/(1024*1024))
+                   .arg(stats.capacity/(1024*1024));
+    if(stats.overruns>0)
+        text+=QString(" 被覆盖跳过%1次").arg(stats.overruns);
+    m_streamStatusLabel->setText(text);
+}
+
+void Player::releaseStreamBuffer()
+{
+    if(!m_streamBuffer)
+        return;
+
+    //先中止，后端线程阻塞中的读取立即返回；换源完成后再删除
+    m_streamBuffer->abort();
+    disconnect(m_streamBuffer,nullptr,this,nullptr);
+    m_streamBuffer->deleteLater();
+    m_streamBuffer=nullptr;
+    m_streamStatusLabel->hide();
+}
+
+void Player::updateStreamStatus(const StreamBuffer::Stats &stats)
+{
+    if(stats.state==StreamBuffer::Failed && stats.fill==0)
+    {
+        m_streamStatusLabel->setText("网络错误："+stats.errorString);
+        return;
+    }
+
+    const double dMegaByte=1024.0*1024.0;
+    QString text=QString("缓冲%1% %2/%3MB")
+                       .arg(stats.capacity>0?100*stats.fill/stats.capacity:0)
+                       .arg(stats.fill/dMegaByte,0,'f',1)
+                       .arg(stats.capacity/dMegaByte,0,'f',0);
+    //按读取速度（近似码率）估算缓冲可播放的时长
+    if(stats.consumeRate>0)
+        text+=QString(" 约%1秒").arg(stats.fill/stats.consumeRate,0,'f',0);
+    if(stats.state==StreamBuffer::Finished)
+        text+=" 已下载完";
+    else
+        text+=QString(" ↓%1MB/s").arg(stats.throughput/dMegaByte,0,'f',2);
+    if(stats.state==StreamBuffer::Buffering || stats.state==StreamBuffer::Connecting)
+        text+=QString(" 缓冲中(%1KB起播)").arg(stats.startThreshold/1024);
+    if(stats.rebuffers>0)
+        text+=QString(" 卡顿%1次/%2秒").arg(stats.rebuffers).arg(stats.rebufferTimeMs/1000.0,0,'f',1);
+    m_streamStatusLabel->setText(text);
+}
+
+void Player::setCurrentPlaylistRow(int row)
+{
+    //被筛选掉的条目在视图中没有对应行
+    QModelIndex index=m_playlistProxy->mapFromSource(m_playlistModel->index(row,0));
+    if(!index.isValid())
+        return;
+    m_playlistView->setCurrentIndex(index);
+    m_playlistView->scrollTo(index);
+}
+
+void Player::moveCurrentPlaylistItem(int delta)
+{
+    //排序或筛选时视图中的相邻行不是播放列表中的相邻行
+    if(m_playlistProxy->sortColumn()>=0 || m_playlistProxy->isFiltered())
+    {
+        statusBar()->showMessage("请先取消排序和筛选再调整顺序",3000);
+        return;
+    }
+
+    int nRow=m_playlistProxy->mapToSource(m_playlistView->currentIndex()).row();
+    if(nRow<0)
+        return;
+
+    if(m_playlistModel->moveEntry(nRow,nRow+delta))
+    {
+        setCurrentPlaylistRow(nRow+delta);
+        m_playlistJournal->recordMove(m_playlistModel->filePath(nRow+delta),nRow+delta);
+        saveDefaultPlaylist();
     }
 }
@@ -12,7 +12,10 @@
 #include<QFileDialog>
 #include<QMenu>
 #include<QActionGroup>
-#include<QListWidget>
+#include<QTreeView>
+#include<QHeaderView>
+#include<QLineEdit>
+#include<QVBoxLayout>
 #include<QMap>
 #include<QStandardPaths>
 #include<QDir>
@@ -26,8 +29,41 @@
 #include<QInputDialog>
 #include<QMessageBox>
 #include<QVector>
+#include<QPointer>
+#include<QStatusBar>
+#include<QLabel>
+#include<QElapsedTimer>
+#include<QRandomGenerator>
+#include<QProgressDialog>
 
 #include"ClickableSlider.h"
+#include"FrameStepper.h"
+#include"SyncPlayerWindow.h"
+#include"ThumbnailProvider.h"
+#include"PlaylistModel.h"
+#include"PlaylistProxyModel.h"
+#include"MetadataCache.h"
+#include"MediaProber.h"
+#include"MediaLibrary.h"
+#include"LibraryDock.h"
+#include"PlaylistLoader.h"
+#include"PlaylistJournal.h"
+#include"PlayHistoryStore.h"
+#include"ResumePositionStore.h"
+#include"MediaPreroller.h"
+#include"PlaybackRates.h"
+#include"FrameTimingMonitor.h"
+#include"FrameTimingOverlay.h"
+#include"ReadAheadDevice.h"
+#include"StreamBuffer.h"
+#include"TimeshiftBuffer.h"
+#include"FrameExporter.h"
+#include"SeekScheduler.h"
+#include"KeyframeIndex.h"
+#include"WaveformAnalyzer.h"
+#include"LoudnessAnalyzer.h"
+#include"FastScanController.h"
+#include"ReversePlayer.h"
 
 
 QT_BEGIN_NAMESPACE
@@ -52,12 +88,17 @@ private slots:
     void setVolume(int volume);             //设置音量（0-100）
     void updatePlayIcon(QMediaPlayer::PlaybackState state); //更新播放按钮图标
     void togglePlaylist();      //切换播放列表可见性
-    void playlistItemDoubleClicked(QListWidgetItem *item);  //处理列表双击事件
+    void playlistItemDoubleClicked(const QModelIndex &index);   //处理列表双击事件
     void openFile();            //打开媒体文件
     void addToPlaylist();       //添加文件到播放列表
     void removeFromPlaylist();  //从播放列表移除
     void openStreamUrl();       //打开网络流媒体URL
+    void openSyncFiles();       //多路同步播放
     void setPlayBackRate(double rate);  //设置播放速率
+    void showSeekPreview(int position); //进度条悬停预览
+    void handleMediaStatus(QMediaPlayer::MediaStatus status);   //媒体状态变化处理
+    void toggleFrameTiming(bool bEnabled);      //打开/关闭帧时序监视
+    void exportFrameTiming(bool bChromeTrace);  //导出帧时序数据
 
 
 private:
@@ -67,6 +108,29 @@ private:
     QVideoWidget *m_videoWidget;  //视频显示组件
     QMediaPlayer *m_mediaPlayer;  //媒体播放器核心
     QAudioOutput *m_audioOutput;  //音频输出设备
+    FrameStepper *m_frameStepper; //逐帧步进引擎
+    SeekScheduler *m_seekScheduler; //拖动进度条时合并定位请求
+    KeyframeIndex *m_keyframeIndex = nullptr;   //当前文件的关键帧索引
+    bool m_bSnapToKeyframe = false; //单击进度条时对齐到最近的关键帧
+    qint64 snapSeekTarget(qint64 position) const;   //按设置对齐单击定位的目标
+    QString seekPreviewText(qint64 position);   //悬停预览文字，附带定位代价
+    void seekRelative(qint64 deltaMs);  //前进/后退按钮，有索引时落在关键帧上
+    void seekSyncStreams(qint64 position);  //主窗口的定位转发给同步播放窗口的所有流
+    FastScanController *m_fastScan;     //4x以上的关键帧快速浏览
+    QTimer *m_scanHoldTimer;            //按住前进/后退按钮进入快速浏览
+    int m_nScanHoldDirection = 0;       //按住的按钮方向（1前进，-1后退）
+    bool m_bScanHoldStarted = false;    //本次按住已进入快速浏览，松开后的单击不再跳转
+    void scanButtonClicked(int nDirection); //前进/后退按钮单击
+    void checkRateAction(double rate);  //勾选速率菜单中对应的项
+    ReversePlayer *m_reversePlayer;     //分段解码的倒放
+    int m_nReverseFrameBudget = 64;     //倒放帧池上限（帧）
+    WaveformAnalyzer *m_waveformAnalyzer = nullptr; //进度条背后的音频波形
+    bool m_bShowWaveform = true;        //是否分析并显示波形
+    QPointer<SyncPlayerWindow> m_syncWindow;  //多路同步播放窗口（关闭后自动置空）
+    ThumbnailProvider *m_thumbnailProvider;   //进度条悬停预览缩略图
+    qint64 m_nHoverPosition = -1;             //进度条当前悬停位置（毫秒）
+    FrameTimingMonitor *m_frameTimingMonitor; //帧时序监视器
+    FrameTimingOverlay *m_frameTimingOverlay; //帧时序统计浮层
 
     //
     enum PlayMode{  //播放模式枚举
@@ -80,21 +144,78 @@ private:
 
     int m_nLastVolume = 50;      //静音之前的音量缓存
     QString formatTime(qint64 milliseconds);    //格式化显示时间(mm:ss)
-    QMap<QString,qint64> m_lastPositions;     //文件路径——最后播放位置映射
+    ResumePositionStore *m_resumeStore = nullptr; //续播位置表
+    int m_nCurrentResumeId = -1;        //当前文件在续播表中的ID
+    qint64 m_nPendingResume = 0;        //媒体加载完成后要恢复的位置
+    QElapsedTimer m_resumeSampleTimer;  //控制续播位置的采样频率
+
+    MediaPreroller *m_preroller;        //下一项预加载器
+    bool m_bPrerollRequested = false;   //当前文件是否已经发起预加载
+    int m_nPredictedNextRow = -1;       //预测的下一项行号（随机模式下需要固定）
+    void connectMediaPlayer();          //连接主播放器的信号
+    int nextPlaylistRow();              //按播放模式预测下一项
+    void prerollNext();                 //预加载下一项
+    bool switchToPrerolledPlayer(const QString &filePath);  //换上预加载好的播放器
+
+    bool m_bReadAhead = false;          //本地文件是否经预读数据源播放
+    qint64 m_nReadAheadBytes = 32*1024*1024;    //预读范围
+    ReadAheadDevice *m_readAheadDevice = nullptr;   //当前文件的预读数据源
+    void setLocalSource(const QString &filePath);   //按预读设置打开本地文件
+    ReadAheadDevice *openReadAheadDevice(const QString &filePath);  //未启用预读或打开失败时返回nullptr
+    void releaseReadAheadDevice();      //换源后释放预读数据源并记录统计
+    void showReadAheadStats();          //在状态栏显示预读统计
+    void showSeekStats();               //在状态栏显示定位调度统计
+
+    bool m_bStreamPrebuffer = false;    //HTTP流是否经预缓冲播放（只能顺序读，适合直播；点播文件不能拖动，moov在尾部的MP4无法打开）
+    qint64 m_nStreamBufferBytes = 8*1024*1024;  //预缓冲深度
+    StreamBuffer *m_streamBuffer = nullptr;     //当前网络流的预缓冲
+    QLabel *m_streamStatusLabel;        //状态栏中的缓冲状态
+    void playStream(const QString &url);        //播放网络流
+    void releaseStreamBuffer();         //停止并释放预缓冲（换源前调用）
+    void updateStreamStatus(const StreamBuffer::Stats &stats);  //刷新缓冲状态显示
+
+    bool m_bTimeshift = false;          //HTTP直播是否录制到时移缓冲
+    qint64 m_nTimeshiftBytes = 1024LL*1024*1024;    //时移循环文件大小
+    QString m_strTimeshiftFile;         //时移循环文件名模板
+    TimeshiftBuffer *m_timeshift = nullptr;         //当前直播的时移缓冲
+    TimeshiftReader *m_timeshiftReader = nullptr;   //播放器正在读取的位置
+    qint64 m_nTimeshiftSeekTarget = -1; //拖动进度条期间的目标位置，松开后再定位
+    QTimer *m_timeshiftTimer;           //刷新时移进度条
+    void startTimeshift(const QUrl &url);   //开始录制并从直播边缘播放
+    void seekTimeshift(qint64 timeMs);  //从时移缓冲的指定时间重新读取
+    void seekTimeshiftRelative(qint64 deltaMs); //相对当前位置前进/后退
+    void goLive();                      //回到直播
+    void releaseTimeshift();            //停止录制并释放（换源前调用）
+    void updateTimeshiftPosition();     //进度条显示可回看的窗口和当前位置
+
+    FrameExporter *m_frameExporter;     //入出点之间的帧序列导出
+    QPointer<QProgressDialog> m_exportProgress; //导出进度（关闭后自动置空）
+    void markInOut(bool bOut);          //把当前位置设为入点/出点
+    void exportFrameRange();            //选择格式和目录后开始导出
+    void updateExportProgress(const FrameExporter::Stats &stats);
 
     //播放列表组件
     QDockWidget *m_playlistDock;      //播放列表停靠窗口
-    QListWidget *m_playlistWidget;    //播放列表内容控件
-
-    struct PlayHistory  //播放历史记录结构
-    {
-        QString filePath;       //文件完整路径
-        QString fileName;       //文件名称
-        QDateTime playTime;     //最后播放时间
-        qint64 duration;        //文件总时长
-        qint64 lastPostion;     //最后播放位置
-    };
-    QList<PlayHistory> m_playHistory;   //播放历史记录列表
+    QTreeView *m_playlistView;        //播放列表内容控件
+    QLineEdit *m_playlistFilterEdit;  //播放列表筛选输入框
+    PlaylistModel *m_playlistModel;   //播放列表数据模型
+    PlaylistProxyModel *m_playlistProxy;  //播放列表排序筛选
+    MetadataCache *m_metadataCache;   //媒体元数据缓存
+    MediaProber *m_mediaProber;       //媒体元数据后台探测
+    LoudnessAnalyzer *m_loudnessAnalyzer;   //播放列表条目的后台响度分析
+    double m_dLoudnessGain = 1.0;     //当前文件的音量系数（线性，均衡时含参考电平）
+    bool m_bNormalizeLoudness = true; //切换条目时按分析结果均衡响度
+    QString m_strLoudnessFile;        //正在查增益的文件，查到前不开始播放
+    bool m_bPlayAfterLoudness = false;  //查到增益后开始播放
+    void applyLoudnessGain(const QString &filePath,bool bPlay=false);   //查文件的增益并设置音量，bPlay时设置后开始播放
+    MediaLibrary *m_mediaLibrary;     //监视目录的媒体库
+    LibraryDock *m_libraryDock;       //媒体库停靠窗口
+    PlaylistLoader *m_playlistLoader; //播放列表异步加载器
+    PlaylistJournal *m_playlistJournal;   //播放列表编辑日志
+    bool m_bPlaylistSavePending = false;  //加载期间请求的整理，加载完成后补做
+
+    PlayHistoryStore *m_historyStore = nullptr; //播放历史记录存储
+    QString m_strCurrentFile;           //当前播放的本地文件
 
     QMenu *m_playbackRateMenu;          //播放速度选择菜单
     QActionGroup *m_rateGroup;          //播放速度动作组
@@ -105,7 +226,7 @@ private:
     void playFile(const QString& filePath); //播放文件方法
     void saveDefaultPlaylist();     //保存当前播放列表
     void clearHistory();            //清空播放历史
-    void savePlayHistory();         //保存历史记录
+    void saveCurrentHistoryPosition();  //把当前文件的播放位置写回历史记录和续播表
 
     void addToHistory(const QString &filePath); //添加到播放记录
     QString m_strCurrentPlaylistFile;   //当前加载的播放列表文件
@@ -118,6 +239,8 @@ private:
     void createPlaybackRateMenu();      //播放速度控制
     void setPlayMode(PlayMode mode);    //设置播放模式
     void playNext();                    //播放下一个视频文件
+    void setCurrentPlaylistRow(int row);    //选中并滚动到播放列表某行
+    void moveCurrentPlaylistItem(int delta);    //当前条目上移/下移
 
 
 };